@@ -79,6 +79,8 @@ struct _operand
   char xn_size;
 };
 
+static MnemonicIndex table_68000_index;
+
 static int get_register_d_68000(char *token)
 {
   if (token[0] != 'd' && token[0] != 'D') return -1;
@@ -1579,6 +1581,11 @@ int parse_instruction_68000(AsmContext *asm_context, char *instr)
   int ret;
   int n;
 
+  if (mnemonic_index_build(&table_68000_index, table_68000, sizeof(table_68000[0])) != 0)
+  {
+    return -1;
+  }
+
   lower_copy(instr_case, instr);
   memset(operands, 0, sizeof(operands));
 
@@ -2180,8 +2187,9 @@ printf("\n");
     }
   }
 
-  n = 0;
-  while (table_68000[n].instr != NULL)
+  for (n = mnemonic_index_find(&table_68000_index, instr_case);
+       n != -1;
+       n = mnemonic_index_next(&table_68000_index, n))
   {
     if (strcmp(table_68000[n].instr, instr_case) == 0)
     {
@@ -2203,7 +2211,6 @@ printf("\n");
 
       if (check_size(operand_size, table_68000[n].omit_size) != 0)
       {
-        n++;
         continue;
       }
 
@@ -2330,14 +2337,11 @@ printf("\n");
           ret = write_dreg_ea(asm_context, instr, operands, operand_count, &table_68000[n], operand_size);
           break;
         default:
-          n++;
           continue;
       }
 
       if (ret != 0) { return ret; }
     }
-
-    n++;
   }
 
   if (matched == 1)
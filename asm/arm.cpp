@@ -65,6 +65,34 @@ struct _operand
   uint8_t set_cond : 1;
 };
 
+static MnemonicIndex table_arm_index;
+static int table_arm_max_len = 0;
+
+static int build_mnemonic_index()
+{
+  int count = 0;
+  int n;
+
+  if (table_arm_index.size != 0) { return 0; }
+
+  while (table_arm[count].instr != NULL) { count++; }
+
+  if (mnemonic_index_init(&table_arm_index, count) != 0) { return -1; }
+
+  // Entries are keyed on the first len chars of the name only.
+  for (n = 0; n < count; n++)
+  {
+    mnemonic_index_add(&table_arm_index, table_arm[n].instr, table_arm[n].len, n);
+
+    if (table_arm[n].len > table_arm_max_len)
+    {
+      table_arm_max_len = table_arm[n].len;
+    }
+  }
+
+  return 0;
+}
+
 #if 0
 static void print_error_extra_condition(asm_context, char *instr)
 {
@@ -914,6 +942,8 @@ int parse_instruction_arm(AsmContext *asm_context, char *instr)
   int bytes = -1;
   int num;
 
+  if (build_mnemonic_index() != 0) { return -1; }
+
   lower_copy(instr_case, instr);
   memset(operands, 0, sizeof(operands));
   operand_count = 0;
@@ -1218,80 +1248,102 @@ int parse_instruction_arm(AsmContext *asm_context, char *instr)
   }
 #endif
 
-  n = 0;
-  while (table_arm[n].instr != NULL)
+  // Candidates are entries whose name (the first len chars) is a prefix
+  // of instr_case, the rest being condition codes and flags.  Each prefix
+  // length has its own chain in table order so merge them to try the
+  // entries in the same order a scan of the table would.
+  int prefix_len = strlen(instr_case);
+  int chain[TOKENLEN];
+  int i;
+
+  if (prefix_len > table_arm_max_len) { prefix_len = table_arm_max_len; }
+
+  for (i = 0; i < prefix_len; i++)
   {
-    if (strncmp(table_arm[n].instr, instr_case, table_arm[n].len) == 0)
+    chain[i] = mnemonic_index_find_len(&table_arm_index, instr_case, i + 1);
+  }
+
+  while (1)
+  {
+    int prefix = -1;
+
+    for (i = 0; i < prefix_len; i++)
     {
-      char *instr_cond = instr_case + table_arm[n].len;
-      matched = 1;
+      if (chain[i] == -1) { continue; }
+      if (prefix == -1 || chain[i] < chain[prefix]) { prefix = i; }
+    }
 
-      switch (table_arm[n].type)
-      {
-        case OP_ALU_3:
-          bytes = parse_alu_3(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-          break;
-        case OP_ALU_2_N:
-          bytes = parse_alu_2(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode, 0);
-          break;
-        case OP_ALU_2_D:
-          bytes = parse_alu_2(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode, 1);
-          break;
-        case OP_MULTIPLY:
-          bytes = parse_multiply(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-          break;
-        case OP_SWAP:
-          bytes = parse_swap(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-          break;
-        case OP_MRS:
-          bytes=parse_mrs(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-          break;
-        case OP_MSR_ALL:
-          bytes = parse_msr(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-          break;
-        //case OP_MSR_FLAG:
-        //  bytes = parse_msr_flag(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-        //  break;
-        case OP_LDR_STR:
-          bytes = parse_ldr_str(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-          break;
-        case OP_UNDEFINED:
-          matched = 0;
-          bytes = ARM_UNKNOWN_INSTRUCTION;
-          break;
-        case OP_LDM_STM:
-          bytes = parse_ldm_stm(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-          break;
-        case OP_BRANCH:
-          bytes = parse_branch(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-          break;
-        case OP_BRANCH_EXCHANGE:
-          bytes = parse_branch_exchange(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-          break;
-        case OP_SWI:
-          bytes = parse_swi(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
-          break;
-        default:
-          print_error_internal(asm_context, __FILE__, __LINE__);
-          break;
-      }
+    if (prefix == -1) { break; }
 
-      if (bytes == -1) { return -1; }
+    n = chain[prefix];
+    chain[prefix] = mnemonic_index_next(&table_arm_index, n);
 
-      if (bytes == ARM_UNKNOWN_INSTRUCTION)
-      {
-        print_error_unknown_instr(asm_context, instr);
-      }
-        else
-      if (bytes == ARM_ILLEGAL_OPERANDS)
-      {
-        print_error_illegal_operands(asm_context, instr);
-      }
+    char *instr_cond = instr_case + table_arm[n].len;
+    matched = 1;
 
-      if (bytes != ARM_ERROR_OPCOMBO) { return bytes; }
+    switch (table_arm[n].type)
+    {
+      case OP_ALU_3:
+        bytes = parse_alu_3(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+        break;
+      case OP_ALU_2_N:
+        bytes = parse_alu_2(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode, 0);
+        break;
+      case OP_ALU_2_D:
+        bytes = parse_alu_2(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode, 1);
+        break;
+      case OP_MULTIPLY:
+        bytes = parse_multiply(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+        break;
+      case OP_SWAP:
+        bytes = parse_swap(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+        break;
+      case OP_MRS:
+        bytes=parse_mrs(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+        break;
+      case OP_MSR_ALL:
+        bytes = parse_msr(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+        break;
+      //case OP_MSR_FLAG:
+      //  bytes = parse_msr_flag(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+      //  break;
+      case OP_LDR_STR:
+        bytes = parse_ldr_str(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+        break;
+      case OP_UNDEFINED:
+        matched = 0;
+        bytes = ARM_UNKNOWN_INSTRUCTION;
+        break;
+      case OP_LDM_STM:
+        bytes = parse_ldm_stm(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+        break;
+      case OP_BRANCH:
+        bytes = parse_branch(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+        break;
+      case OP_BRANCH_EXCHANGE:
+        bytes = parse_branch_exchange(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+        break;
+      case OP_SWI:
+        bytes = parse_swi(asm_context, operands, operand_count, instr_cond, table_arm[n].opcode);
+        break;
+      default:
+        print_error_internal(asm_context, __FILE__, __LINE__);
+        break;
+    }
+
+    if (bytes == -1) { return -1; }
+
+    if (bytes == ARM_UNKNOWN_INSTRUCTION)
+    {
+      print_error_unknown_instr(asm_context, instr);
+    }
+      else
+    if (bytes == ARM_ILLEGAL_OPERANDS)
+    {
+      print_error_illegal_operands(asm_context, instr);
     }
 
-    n++;
+    if (bytes != ARM_ERROR_OPCOMBO) { return bytes; }
   }
 
   if (matched == 1)
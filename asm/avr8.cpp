@@ -61,6 +61,8 @@ static struct _alias alias[] =
   { NULL, NULL },
 };
 
+static MnemonicIndex table_avr8_index;
+
 #if 0
 int get_register_avr8(char *token)
 {
@@ -98,6 +100,11 @@ int parse_instruction_avr8(AsmContext *asm_context, char *instr)
   int n,num;
   int rd, rr, k;
 
+  if (mnemonic_index_build(&table_avr8_index, table_avr8, sizeof(table_avr8[0])) != 0)
+  {
+    return -1;
+  }
+
   lower_copy(instr_case, instr);
 
   //tokens_push(asm_context, token, token_type);
@@ -301,9 +308,9 @@ int parse_instruction_avr8(AsmContext *asm_context, char *instr)
     strcpy(instr_case, "andi");
   }
 
-  n = 0;
-
-  while (table_avr8[n].instr != NULL)
+  for (n = mnemonic_index_find(&table_avr8_index, instr_case);
+       n != -1;
+       n = mnemonic_index_next(&table_avr8_index, n))
   {
     if (strcmp(table_avr8[n].instr, instr_case) == 0)
     {
@@ -895,7 +902,6 @@ int parse_instruction_avr8(AsmContext *asm_context, char *instr)
           break;
       }
     }
-    n++;
   }
 
   if (matched == 1)
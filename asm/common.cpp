@@ -16,6 +16,7 @@
 
 #include "asm/common.h"
 #include "common/Memory.h"
+#include "common/string_hash.h"
 
 int ignore_operand(AsmContext *asm_context)
 {
@@ -157,3 +158,125 @@ int get_reg_number(const char *token, int max)
   return num;
 }
 
+int mnemonic_index_init(MnemonicIndex *index, int count)
+{
+  int size = 16;
+
+  // Buckets hold the first entry for each name, keep them at most
+  // half full.
+  while (size < count * 2) { size = size * 2; }
+
+  // An empty table still gets one entry since malloc(0) can return NULL.
+  const int entries = count > 0 ? count : 1;
+
+  index->names = (const char **)malloc(entries * sizeof(const char *));
+  index->lens = (int *)malloc(entries * sizeof(int));
+  index->next = (int *)malloc(entries * sizeof(int));
+  index->buckets = (int *)malloc(size * sizeof(int));
+
+  if (index->names == NULL || index->lens == NULL ||
+      index->next == NULL || index->buckets == NULL)
+  {
+    printf("Error: Out of memory building mnemonic index.\n");
+
+    free(index->names);
+    free(index->lens);
+    free(index->next);
+    free(index->buckets);
+    memset(index, 0, sizeof(MnemonicIndex));
+
+    return -1;
+  }
+
+  for (int n = 0; n < size; n++) { index->buckets[n] = -1; }
+
+  index->size = size;
+  index->count = count;
+
+  return 0;
+}
+
+void mnemonic_index_add(MnemonicIndex *index, const char *name, int len, int n)
+{
+  const uint32_t mask = index->size - 1;
+  uint32_t i = string_hash_len(name, len) & mask;
+
+  index->names[n] = name;
+  index->lens[n] = len;
+  index->next[n] = -1;
+
+  while (index->buckets[i] != -1)
+  {
+    int curr = index->buckets[i];
+
+    if (index->lens[curr] == len && memcmp(index->names[curr], name, len) == 0)
+    {
+      // Same name, add to the end of the chain to keep table order.
+      while (index->next[curr] != -1) { curr = index->next[curr]; }
+      index->next[curr] = n;
+      return;
+    }
+
+    i = (i + 1) & mask;
+  }
+
+  index->buckets[i] = n;
+}
+
+int mnemonic_index_build(MnemonicIndex *index, const void *table, int entry_size)
+{
+  // The table is an array of structs ending with a NULL name where the
+  // first member of each struct is the name (const char *).  Only the
+  // first call does any work so this can be called for every instruction.
+  const uint8_t *entry = (const uint8_t *)table;
+  int count = 0;
+
+  if (index->size != 0) { return 0; }
+
+  while (*(const char * const *)(entry + (count * entry_size)) != NULL)
+  {
+    count++;
+  }
+
+  if (mnemonic_index_init(index, count) != 0) { return -1; }
+
+  for (int n = 0; n < count; n++)
+  {
+    const char *name = *(const char * const *)(entry + (n * entry_size));
+
+    mnemonic_index_add(index, name, strlen(name), n);
+  }
+
+  return 0;
+}
+
+int mnemonic_index_find_len(MnemonicIndex *index, const char *name, int len)
+{
+  const uint32_t mask = index->size - 1;
+  uint32_t i = string_hash_len(name, len) & mask;
+
+  while (index->buckets[i] != -1)
+  {
+    int n = index->buckets[i];
+
+    if (index->lens[n] == len && memcmp(index->names[n], name, len) == 0)
+    {
+      return n;
+    }
+
+    i = (i + 1) & mask;
+  }
+
+  return -1;
+}
+
+int mnemonic_index_find(MnemonicIndex *index, const char *name)
+{
+  return mnemonic_index_find_len(index, name, strlen(name));
+}
+
+int mnemonic_index_next(MnemonicIndex *index, int n)
+{
+  return index->next[n];
+}
+
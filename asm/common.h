@@ -18,6 +18,19 @@
 #include "common/assembler.h"
 #include "common/tokens.h"
 
+// Index from mnemonic to the entries of an instruction table that use
+// it.  Entries with the same name are chained in table order so callers
+// can try each candidate the same way a linear scan of the table would.
+struct MnemonicIndex
+{
+  const char **names;
+  int *lens;
+  int *next;
+  int *buckets;
+  int size;
+  int count;
+};
+
 int ignore_operand(AsmContext *asm_context);
 int ignore_paren_expression(AsmContext *asm_context);
 int ignore_line(AsmContext *asm_context);
@@ -26,6 +39,12 @@ int expect_token(AsmContext *asm_context, char ch);
 int expect_token_s(AsmContext *asm_context, const char *s);
 int check_range(AsmContext *asm_context, const char *type, int num, int min, int max);
 int get_reg_number(const char *token, int max);
+int mnemonic_index_init(MnemonicIndex *index, int count);
+void mnemonic_index_add(MnemonicIndex *index, const char *name, int len, int n);
+int mnemonic_index_build(MnemonicIndex *index, const void *table, int entry_size);
+int mnemonic_index_find_len(MnemonicIndex *index, const char *name, int len);
+int mnemonic_index_find(MnemonicIndex *index, const char *name);
+int mnemonic_index_next(MnemonicIndex *index, int n);
 
 #endif
 
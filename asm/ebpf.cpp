@@ -45,7 +45,7 @@ static int get_register_ebpf(const char *token)
 
   if (token[0] != 0 && token[1] == 0)
   {
-    if (*token < '0' || *token > '7') { return -1; }
+    if (*token < '0' || *token > '9') { return -1; }
 
     return (*token) - '0';
   }
@@ -66,6 +66,36 @@ struct _operand
   int field_mask;
 };
 
+static MnemonicIndex mips_r_table_index;
+static MnemonicIndex mips_i_table_index;
+static MnemonicIndex mips_branch_table_index;
+static MnemonicIndex mips_special_table_index;
+static MnemonicIndex mips_other_index;
+static MnemonicIndex mips_ee_index;
+static MnemonicIndex mips_four_reg_index;
+static MnemonicIndex mips_msa_index;
+static MnemonicIndex mips_ee_vector_index;
+static MnemonicIndex mips_rsp_vector_index;
+
+static int build_mnemonic_index()
+{
+  if (mnemonic_index_build(&mips_r_table_index, mips_r_table, sizeof(mips_r_table[0])) != 0 ||
+      mnemonic_index_build(&mips_i_table_index, mips_i_table, sizeof(mips_i_table[0])) != 0 ||
+      mnemonic_index_build(&mips_branch_table_index, mips_branch_table, sizeof(mips_branch_table[0])) != 0 ||
+      mnemonic_index_build(&mips_special_table_index, mips_special_table, sizeof(mips_special_table[0])) != 0 ||
+      mnemonic_index_build(&mips_other_index, mips_other, sizeof(mips_other[0])) != 0 ||
+      mnemonic_index_build(&mips_ee_index, mips_ee, sizeof(mips_ee[0])) != 0 ||
+      mnemonic_index_build(&mips_four_reg_index, mips_four_reg, sizeof(mips_four_reg[0])) != 0 ||
+      mnemonic_index_build(&mips_msa_index, mips_msa, sizeof(mips_msa[0])) != 0 ||
+      mnemonic_index_build(&mips_ee_vector_index, mips_ee_vector, sizeof(mips_ee_vector[0])) != 0 ||
+      mnemonic_index_build(&mips_rsp_vector_index, mips_rsp_vector, sizeof(mips_rsp_vector[0])) != 0)
+  {
+    return -1;
+  }
+
+  return 0;
+}
+
 static int get_number(char *s)
 {
   int n = 0;
@@ -338,17 +368,11 @@ static int add_offset(
 
 static uint32_t find_opcode(const char *instr_case)
 {
-  int n;
+  int n = mnemonic_index_find(&mips_i_table_index, instr_case);
 
-  for (n = 0; mips_i_table[n].instr != NULL; n++)
-  {
-    if (strcmp(instr_case, mips_i_table[n].instr) == 0)
-    {
-      return mips_i_table[n].function << 26;
-    }
-  }
+  if (n == -1) { return 0xffffffff; }
 
-  return 0xffffffff;
+  return mips_i_table[n].function << 26;
 }
 
 void get_dest(char *instr_case, int *dest)
@@ -1055,7 +1079,9 @@ static int check_ee_instruction(
 {
   int n, r;
 
-  for (n = 0; mips_ee[n].instr != NULL; n++)
+  for (n = mnemonic_index_find(&mips_ee_index, instr_case);
+       n != -1;
+       n = mnemonic_index_next(&mips_ee_index, n))
   {
     // Check of this specific MIPS chip uses this instruction.
     if ((mips_ee[n].version & asm_context->flags) == 0)
@@ -1320,7 +1346,9 @@ static int check_other_instruction(
 {
   int n, r;
 
-  for (n = 0; mips_other[n].instr != NULL; n++)
+  for (n = mnemonic_index_find(&mips_other_index, instr_case);
+       n != -1;
+       n = mnemonic_index_next(&mips_other_index, n))
   {
     // Check of this specific MIPS chip uses this instruction.
     if ((mips_other[n].version & asm_context->flags) == 0) { continue; }
@@ -1590,6 +1618,8 @@ int parse_instruction_mips(AsmContext *asm_context, char *instr)
   int found = 0;
   int32_t offset;
 
+  if (build_mnemonic_index() != 0) { return -1; }
+
   lower_copy(instr_case, instr);
   memset(operands, 0, sizeof(operands));
 
@@ -1623,7 +1653,9 @@ int parse_instruction_mips(AsmContext *asm_context, char *instr)
   }
 
   // R-Type Instruction [ op 6, rs 5, rt 5, rd 5, sa 5, function 6 ]
-  for (n = 0; mips_r_table[n].instr != NULL; n++)
+  for (n = mnemonic_index_find(&mips_r_table_index, instr_case);
+       n != -1;
+       n = mnemonic_index_next(&mips_r_table_index, n))
   {
     // Check of this specific MIPS chip uses this instruction.
     if ((mips_r_table[n].version & asm_context->flags) == 0)
@@ -1725,7 +1757,9 @@ int parse_instruction_mips(AsmContext *asm_context, char *instr)
   }
 
   // I-Type?  [ op 6, rs 5, rt 5, imm 16 ]
-  for (n = 0; mips_i_table[n].instr != NULL; n++)
+  for (n = mnemonic_index_find(&mips_i_table_index, instr_case);
+       n != -1;
+       n = mnemonic_index_next(&mips_i_table_index, n))
   {
     // Check of this specific MIPS chip uses this instruction.
     if ((mips_i_table[n].version & asm_context->flags) == 0)
@@ -1821,7 +1855,9 @@ int parse_instruction_mips(AsmContext *asm_context, char *instr)
     }
   }
 
-  for (n = 0; mips_branch_table[n].instr != NULL; n++)
+  for (n = mnemonic_index_find(&mips_branch_table_index, instr_case);
+       n != -1;
+       n = mnemonic_index_next(&mips_branch_table_index, n))
   {
     // Check of this specific MIPS chip uses this instruction.
     if ((mips_branch_table[n].version & asm_context->flags) == 0)
@@ -1892,7 +1928,9 @@ int parse_instruction_mips(AsmContext *asm_context, char *instr)
   }
 
   // Special2 / Special3 type
-  for (n = 0; mips_special_table[n].instr != NULL; n++)
+  for (n = mnemonic_index_find(&mips_special_table_index, instr_case);
+       n != -1;
+       n = mnemonic_index_next(&mips_special_table_index, n))
   {
     // Check of this specific MIPS chip uses this instruction.
     if ((mips_special_table[n].version & asm_context->flags) == 0) { continue; }
@@ -2019,7 +2057,9 @@ int parse_instruction_mips(AsmContext *asm_context, char *instr)
   }
 
   // Some MIPS instructions seem to have 4 registers.
-  for (n = 0; mips_four_reg[n].instr != NULL; n++)
+  for (n = mnemonic_index_find(&mips_four_reg_index, instr_case);
+       n != -1;
+       n = mnemonic_index_next(&mips_four_reg_index, n))
   {
     // Check of this specific MIPS chip uses this instruction.
     if ((mips_four_reg[n].version & asm_context->flags) == 0) { continue; }
@@ -2076,7 +2116,9 @@ int parse_instruction_mips(AsmContext *asm_context, char *instr)
 
   if ((asm_context->flags & MIPS_MSA) != 0)
   {
-    for (n = 0; mips_msa[n].instr != NULL; n++)
+    for (n = mnemonic_index_find(&mips_msa_index, instr_case);
+         n != -1;
+         n = mnemonic_index_next(&mips_msa_index, n))
     {
       if (strcmp(instr_case, mips_msa[n].instr) == 0)
       {
@@ -2141,7 +2183,9 @@ int parse_instruction_mips(AsmContext *asm_context, char *instr)
 
     get_dest(instr_case, &dest);
 
-    for (n = 0; mips_ee_vector[n].instr != NULL; n++)
+    for (n = mnemonic_index_find(&mips_ee_vector_index, instr_case);
+         n != -1;
+         n = mnemonic_index_next(&mips_ee_vector_index, n))
     {
       if (strcmp(instr_case, mips_ee_vector[n].instr) == 0)
       {
@@ -2467,7 +2511,9 @@ int parse_instruction_mips(AsmContext *asm_context, char *instr)
 
   if ((asm_context->flags & MIPS_RSP) != 0)
   {
-    for (n = 0; mips_rsp_vector[n].instr != NULL; n++)
+    for (n = mnemonic_index_find(&mips_rsp_vector_index, instr_case);
+         n != -1;
+         n = mnemonic_index_next(&mips_rsp_vector_index, n))
     {
       if (strcmp(instr_case, mips_rsp_vector[n].instr) != 0) { continue; }
 
@@ -104,6 +104,45 @@ struct _operand
   int offset;
 };
 
+// table_z80 and table_z80_4_byte are searched by instr_enum.  These hold
+// the range of entries for each instr_enum so only that part of the table
+// needs to be checked.
+struct _opcode_range
+{
+  int first[256];
+  int last[256];
+  bool built;
+};
+
+static MnemonicIndex table_instr_z80_index;
+static struct _opcode_range table_z80_range;
+static struct _opcode_range table_z80_4_byte_range;
+
+static void build_opcode_range(
+  struct _opcode_range *range,
+  struct _table_z80 *table)
+{
+  int n;
+
+  if (range->built) { return; }
+
+  for (n = 0; n < 256; n++)
+  {
+    range->first[n] = 0;
+    range->last[n] = -1;
+  }
+
+  for (n = 0; table[n].instr_enum != Z80_NONE; n++)
+  {
+    const int instr_enum = table[n].instr_enum;
+
+    if (range->last[instr_enum] == -1) { range->first[instr_enum] = n; }
+    range->last[instr_enum] = n;
+  }
+
+  range->built = true;
+}
+
 static int get_cond(char *token)
 {
   const char *cond[] = { "nz", "z", "nc", "c", "po", "pe", "p", "m" };
@@ -276,19 +315,22 @@ int parse_instruction_z80(AsmContext *asm_context, char *instr)
   int num;
   int n,reg;
 
+  if (mnemonic_index_build(&table_instr_z80_index, table_instr_z80, sizeof(table_instr_z80[0])) != 0)
+  {
+    return -1;
+  }
+
+  build_opcode_range(&table_z80_range, table_z80);
+  build_opcode_range(&table_z80_4_byte_range, table_z80_4_byte);
+
   lower_copy(instr_case, instr);
 
   memset(&operands, 0, sizeof(operands));
 
   // Find instruction
-  n = 0;
-  while (table_instr_z80[n].instr != NULL)
-  {
-    if (strcmp(instr_case, table_instr_z80[n].instr) == 0) { break; }
-    n++;
-  }
+  n = mnemonic_index_find(&table_instr_z80_index, instr_case);
 
-  if (table_instr_z80[n].instr == NULL)
+  if (n == -1)
   {
     print_error_unknown_instr(asm_context, instr);
     return -1;
@@ -488,8 +530,9 @@ printf("-- %d %d %d\n", operands[n].type, operands[n].value, operands[n].offset)
 
   // Instruction is parsed, now find matching opcode
 
-  n = 0;
-  while (table_z80[n].instr_enum != Z80_NONE)
+  for (n = table_z80_range.first[instr_enum];
+       n <= table_z80_range.last[instr_enum];
+       n++)
   {
     if (table_z80[n].instr_enum == instr_enum)
     {
@@ -1577,11 +1620,11 @@ printf("-- %d %d %d\n", operands[n].type, operands[n].value, operands[n].offset)
         }
       }
     }
-    n++;
   }
 
-  n = 0;
-  while (table_z80_4_byte[n].instr_enum != Z80_NONE)
+  for (n = table_z80_4_byte_range.first[instr_enum];
+       n <= table_z80_4_byte_range.last[instr_enum];
+       n++)
   {
     if (table_z80_4_byte[n].instr_enum == instr_enum)
     {
@@ -1624,8 +1667,6 @@ printf("-- %d %d %d\n", operands[n].type, operands[n].value, operands[n].offset)
         }
       }
     }
-
-    n++;
   }
 
   if (matched==1)
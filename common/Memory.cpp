@@ -21,8 +21,13 @@ Memory::Memory() :
   low_address  (0xffffffff),
   high_address (0),
   entry_point  (0xfffffff),
-  endian       (ENDIAN_LITTLE)
+  endian       (ENDIAN_LITTLE),
+  last_page    (NULL),
+  snapshot_active       (false),
+  snapshot_low_address  (0),
+  snapshot_high_address (0)
 {
+  memset(directory, 0, sizeof(directory));
 }
 
 Memory::~Memory()
@@ -37,51 +42,43 @@ Memory::~Memory()
   }
 
   pages = NULL;
-}
-
-void Memory::clear()
-{
-  MemoryPage *page = pages;
+  last_page = NULL;
 
-  while (page != NULL)
+  for (uint32_t n = 0; n < PAGE_DIRECTORY_LEN; n++)
   {
-    MemoryPage *next = page->next;
-    memset(page->bin, 0, PAGE_SIZE);
-    page->offset_min = PAGE_SIZE;
-    page->offset_max = 0;
-    page = next;
+    free(directory[n]);
+    directory[n] = NULL;
   }
 }
 
-bool Memory::in_use(uint32_t address)
+void Memory::clear()
 {
   MemoryPage *page = pages;
 
+  // Pages stay allocated, but all data and debug info is dropped.
   while (page != NULL)
   {
-    if (address >= page->address && address < page->address + PAGE_SIZE)
-    {
-      return true;
-    }
-
+    prepare_write(page);
+    page->clear();
     page = page->next;
   }
 
-  return false;
+  low_address = 0xffffffff;
+  high_address = 0;
+}
+
+bool Memory::in_use(uint32_t address)
+{
+  return find_page(address) != NULL;
 }
 
 uint32_t Memory::get_page_address_min(uint32_t address)
 {
-  MemoryPage *page = pages;
+  MemoryPage *page = find_page(address);
 
-  while (page != NULL)
+  if (page != NULL)
   {
-    if (address >= page->address && address < page->address + PAGE_SIZE)
-    {
-      return page->address + page->offset_min;
-    }
-
-    page = page->next;
+    return page->address + page->offset_min;
   }
 
   print_error_internal(NULL, __FILE__, __LINE__);
@@ -91,16 +88,11 @@ uint32_t Memory::get_page_address_min(uint32_t address)
 
 uint32_t Memory::get_page_address_max(uint32_t address)
 {
-  MemoryPage *page = pages;
+  MemoryPage *page = find_page(address);
 
-  while (page != NULL)
+  if (page != NULL)
   {
-    if (address >= page->address && address < page->address + PAGE_SIZE)
-    {
-      return page->address + page->offset_max;
-    }
-
-    page = page->next;
+    return page->address + page->offset_max;
   }
 
   print_error_internal(NULL, __FILE__, __LINE__);
@@ -110,19 +102,11 @@ uint32_t Memory::get_page_address_max(uint32_t address)
 
 uint8_t Memory::read8(uint32_t address)
 {
-  MemoryPage *page = pages;
+  MemoryPage *page = find_page(address);
 
-  while (page != NULL)
-  {
-    if (address >= page->address && address < page->address + PAGE_SIZE)
-    {
-      return page->bin[address-page->address];
-    }
+  if (page == NULL) { return 0; }
 
-    page = page->next;
-  }
-
-  return 0;
+  return page->bin[address - page->address];
 }
 
 uint16_t Memory::read16(uint32_t address)
@@ -157,32 +141,12 @@ uint32_t Memory::read32(uint32_t address)
 
 void Memory::write8(uint32_t address, uint8_t data)
 {
-  if (pages == NULL)
-  {
-    pages = new MemoryPage(address);
-  }
-
-  MemoryPage *page = pages;
-
-  while (page != NULL)
-  {
-    if (address >= page->address &&
-        address < (uint64_t)page->address + PAGE_SIZE)
-    {
-      break;
-    }
-
-    if (page->next == NULL)
-    {
-      page->next = new MemoryPage(address);
-    }
-
-    page = page->next;
-  }
+  MemoryPage *page = get_page(address);
 
   if (low_address  > address) { low_address  = address; }
   if (high_address < address) { high_address = address; }
 
+  prepare_write(page);
   page->set_data(address, data);
 }
 
@@ -220,77 +184,259 @@ void Memory::write32(uint32_t address, uint32_t data)
 
 int Memory::read_debug(uint32_t address)
 {
-  MemoryPage *page = pages;
+  MemoryPage *page = find_page(address);
 
-  while (page != NULL)
+  if (page == NULL) { return -1; }
+
+  return page->get_debug(address);
+}
+
+void Memory::write_debug(uint32_t address, int line)
+{
+  MemoryPage *page = get_page(address);
+
+  page->set_debug(address, line);
+}
+
+void Memory::write(uint32_t address, uint8_t data, int line)
+{
+  MemoryPage *page = get_page(address);
+
+  if (low_address  > address) { low_address  = address; }
+  if (high_address < address) { high_address = address; }
+
+  prepare_write(page);
+  page->set_data(address, data);
+  page->set_debug(address, line);
+}
+
+void Memory::read_block(uint32_t address, uint8_t *data, int len)
+{
+  while (len > 0)
   {
-    if (address >= page->address && address < page->address + PAGE_SIZE)
+    const int count = get_block_len(address, len);
+    MemoryPage *page = find_page(address);
+
+    if (page == NULL)
+    {
+      memset(data, 0, count);
+    }
+      else
     {
-      return page->debug_line[address-page->address];
+      memcpy(data, page->bin + (address - page->address), count);
     }
 
-    page = page->next;
+    address += count;
+    data += count;
+    len -= count;
   }
+}
 
-  return -1;
+void Memory::write_block(uint32_t address, const uint8_t *data, int len)
+{
+  while (len > 0)
+  {
+    const int count = get_block_len(address, len);
+    MemoryPage *page = get_page(address);
+
+    update_address_range(address, count);
+    prepare_write(page);
+    page->set_block(address, data, count);
+
+    address += count;
+    data += count;
+    len -= count;
+  }
 }
 
-void Memory::write_debug(uint32_t address, int line)
+void Memory::write_block(
+  uint32_t address,
+  const uint8_t *data,
+  int len,
+  int line)
 {
-  if (pages == NULL)
+  while (len > 0)
   {
-    pages = new MemoryPage(address);
+    const int count = get_block_len(address, len);
+    MemoryPage *page = get_page(address);
+
+    update_address_range(address, count);
+    prepare_write(page);
+    page->set_block(address, data, count);
+    page->set_debug_block(address, line, count);
+
+    address += count;
+    data += count;
+    len -= count;
   }
+}
 
-  MemoryPage *page = pages;
+void Memory::fill(uint32_t address, uint8_t data, int len, int line)
+{
+  while (len > 0)
+  {
+    const int count = get_block_len(address, len);
+    MemoryPage *page = get_page(address);
 
-  while (page != NULL)
+    update_address_range(address, count);
+    prepare_write(page);
+    page->set_fill(address, data, count);
+    page->set_debug_block(address, line, count);
+
+    address += count;
+    len -= count;
+  }
+}
+
+int Memory::iterate(MemoryIter *iter)
+{
+  if (iter->end_flag == 1) { return -1; }
+
+  while (iter->page_index < PAGE_COUNT)
   {
-    if (address >= page->address && address < page->address + PAGE_SIZE)
+    MemoryPage **table = directory[iter->page_index / PAGE_TABLE_LEN];
+
+    if (table == NULL)
     {
-      break;
+      iter->page_index = (iter->page_index / PAGE_TABLE_LEN + 1) * PAGE_TABLE_LEN;
+      iter->offset = 0;
+      continue;
     }
 
-    if (page->next == NULL)
+    MemoryPage *page = table[iter->page_index % PAGE_TABLE_LEN];
+    uint32_t start, length;
+
+    if (page != NULL && page->find_used(iter->offset, &start, &length))
     {
-      page->next = new MemoryPage(address);
+      iter->address = page->address + start;
+      iter->length = length;
+      iter->data = page->bin + start;
+      iter->offset = start + length;
+
+      return 0;
     }
 
-    page = page->next;
+    iter->page_index++;
+    iter->offset = 0;
   }
 
-  page->set_debug(address, line);
+  iter->end_flag = 1;
+
+  return -1;
 }
 
-void Memory::write(uint32_t address, uint8_t data, int line)
+MemoryPage *Memory::alloc_page(uint32_t address)
 {
-  if (pages == NULL)
+  const uint32_t index = address / PAGE_SIZE;
+  MemoryPage **table = directory[index / PAGE_TABLE_LEN];
+
+  if (table == NULL)
   {
-    pages = new MemoryPage(address);
+    table = (MemoryPage **)calloc(PAGE_TABLE_LEN, sizeof(MemoryPage *));
+    directory[index / PAGE_TABLE_LEN] = table;
   }
 
+  MemoryPage *page = new MemoryPage(address);
+
+  table[index % PAGE_TABLE_LEN] = page;
+
+  if (snapshot_active) { page->snapshot_flags = PAGE_SNAPSHOT_NEW; }
+
+  // The linked list is kept so all pages can be walked without
+  // scanning the whole directory.
+  page->next = pages;
+  pages = page;
+
+  last_page = page;
+
+  return page;
+}
+
+int Memory::save_snapshot()
+{
   MemoryPage *page = pages;
 
+  // Only the buffers are allocated here so an allocation failure is
+  // reported now instead of on a write.
   while (page != NULL)
   {
-    if (address >= page->address && address < page->address + PAGE_SIZE)
+    if (page->saved == NULL)
     {
-      break;
+      page->saved = (uint8_t *)malloc(PAGE_SIZE);
+
+      if (page->saved == NULL)
+      {
+        free_snapshot();
+        return -1;
+      }
     }
 
-    if (page->next == NULL)
+    page->snapshot_flags = PAGE_SNAPSHOT_CLEAN;
+    page = page->next;
+  }
+
+  snapshot_active = true;
+  snapshot_low_address = low_address;
+  snapshot_high_address = high_address;
+
+  return 0;
+}
+
+void Memory::restore_snapshot()
+{
+  if (snapshot_active == false) { return; }
+
+  MemoryPage *page = pages;
+
+  // Pages that are still clean already match the snapshot.
+  while (page != NULL)
+  {
+    if ((page->snapshot_flags & PAGE_SNAPSHOT_CLEAN) == 0)
     {
-      page->next = new MemoryPage(address);
+      if ((page->snapshot_flags & PAGE_SNAPSHOT_NEW) != 0)
+      {
+        memset(page->bin, 0, PAGE_SIZE);
+      }
+        else
+      {
+        memcpy(page->bin, page->saved, PAGE_SIZE);
+      }
+
+      page->snapshot_flags |= PAGE_SNAPSHOT_CLEAN;
     }
 
     page = page->next;
   }
 
-  if (low_address  > address) { low_address  = address; }
-  if (high_address < address) { high_address = address; }
+  low_address = snapshot_low_address;
+  high_address = snapshot_high_address;
+}
 
-  page->set_data(address, data);
-  page->set_debug(address, line);
+void Memory::free_snapshot()
+{
+  MemoryPage *page = pages;
+
+  while (page != NULL)
+  {
+    free(page->saved);
+    page->saved = NULL;
+    page->snapshot_flags = 0;
+    page = page->next;
+  }
+
+  snapshot_active = false;
+}
+
+void Memory::save_page(MemoryPage *page)
+{
+  // A page that was all 0 in the snapshot has nothing to copy.
+  if ((page->snapshot_flags & (PAGE_SNAPSHOT_SAVED | PAGE_SNAPSHOT_NEW)) == 0)
+  {
+    memcpy(page->saved, page->bin, PAGE_SIZE);
+    page->snapshot_flags |= PAGE_SNAPSHOT_SAVED;
+  }
+
+  page->snapshot_flags &= ~PAGE_SNAPSHOT_CLEAN;
 }
 
 #if 0
@@ -19,9 +19,24 @@
 #define ENDIAN_LITTLE 0
 #define ENDIAN_BIG 1
 
-#define DL_EMPTY -1
-#define DL_DATA -2
-#define DL_NO_CG -3
+// Pages are found through a two level table indexed by address / PAGE_SIZE
+// so a lookup costs the same no matter how many pages an image touches.
+#define PAGE_COUNT ((uint32_t)(0x100000000ULL / PAGE_SIZE))
+#define PAGE_TABLE_LEN 256
+#define PAGE_DIRECTORY_LEN ((PAGE_COUNT + PAGE_TABLE_LEN - 1) / PAGE_TABLE_LEN)
+
+// Used with Memory::iterate() to walk the runs of bytes that have been
+// written to (read_debug() != DL_EMPTY) in address order.  A run never
+// crosses a page boundary.  Set to all 0's before the first call.
+struct MemoryIter
+{
+  uint32_t address;
+  uint32_t length;
+  uint8_t *data;
+  uint32_t page_index;
+  uint32_t offset;
+  int end_flag;
+};
 
 class Memory
 {
@@ -46,6 +61,29 @@ public:
   void write_debug(uint32_t address, int line);
   void write(uint32_t address, uint8_t data, int line);
 
+  // Block transfers are split on page boundaries and use memcpy()
+  // and memset() inside each page.
+  void read_block(uint32_t address, uint8_t *data, int len);
+  void write_block(uint32_t address, const uint8_t *data, int len);
+  void write_block(uint32_t address, const uint8_t *data, int len, int line);
+  void fill(uint32_t address, uint8_t data, int len, int line);
+
+  // Direct access to the bytes of the page holding address (allocated
+  // if needed) for simulators that can't afford read8() / write8().
+  // Writes through the pointer don't update the address range and
+  // aren't seen by snapshots.
+  uint8_t *get_page_data(uint32_t address) { return get_page(address)->bin; }
+
+  int iterate(MemoryIter *iter);
+
+  // Pages are copy-on-write while a snapshot is kept: a page is only
+  // copied the first time it's written after save_snapshot() or
+  // restore_snapshot(), so a restore only copies back the pages that
+  // were written.  Pages allocated after the snapshot go back to 0.
+  int save_snapshot();
+  void restore_snapshot();
+  void free_snapshot();
+
   void dump();
 
   MemoryPage *pages;
@@ -53,6 +91,74 @@ public:
   uint32_t high_address;
   uint32_t entry_point;
   int endian;
+
+private:
+  MemoryPage *find_page(uint32_t address)
+  {
+    if (last_page != NULL && address - last_page->address < PAGE_SIZE)
+    {
+      return last_page;
+    }
+
+    const uint32_t index = address / PAGE_SIZE;
+    MemoryPage **table = directory[index / PAGE_TABLE_LEN];
+
+    if (table == NULL) { return NULL; }
+
+    MemoryPage *page = table[index % PAGE_TABLE_LEN];
+
+    if (page != NULL) { last_page = page; }
+
+    return page;
+  }
+
+  MemoryPage *get_page(uint32_t address)
+  {
+    MemoryPage *page = find_page(address);
+
+    if (page == NULL) { page = alloc_page(address); }
+
+    return page;
+  }
+
+  MemoryPage *alloc_page(uint32_t address);
+
+  void prepare_write(MemoryPage *page)
+  {
+    if ((page->snapshot_flags & PAGE_SNAPSHOT_CLEAN) != 0)
+    {
+      save_page(page);
+    }
+  }
+
+  void save_page(MemoryPage *page);
+
+  int get_block_len(uint32_t address, int len)
+  {
+    const int count = PAGE_SIZE - (address % PAGE_SIZE);
+
+    return count < len ? count : len;
+  }
+
+  void update_address_range(uint32_t address, int len)
+  {
+    if (len <= 0) { return; }
+
+    // Done in 64 bits so a block ending at 0xffffffff doesn't wrap.
+    uint64_t end = (uint64_t)address + len - 1;
+
+    if (end > 0xffffffff) { end = 0xffffffff; }
+
+    if (low_address  > address) { low_address  = address; }
+    if (high_address < end) { high_address = (uint32_t)end; }
+  }
+
+  MemoryPage **directory[PAGE_DIRECTORY_LEN];
+  MemoryPage *last_page;
+
+  bool snapshot_active;
+  uint32_t snapshot_low_address;
+  uint32_t snapshot_high_address;
 };
 
 class AsmContext;
@@ -0,0 +1,219 @@
+/**
+ *  naken_asm assembler.
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: https://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2010-2023 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/MemoryPage.h"
+
+void MemoryPage::clear()
+{
+  memset(bin, 0, sizeof(bin));
+  memset(used, 0, sizeof(used));
+
+  free(debug_runs);
+  free(debug_line);
+
+  offset_min = PAGE_SIZE;
+  offset_max = 0;
+  debug_runs = NULL;
+  debug_runs_count = 0;
+  debug_runs_size = 0;
+  debug_line = NULL;
+}
+
+void MemoryPage::set_debug_block(uint32_t address, int value, uint32_t len)
+{
+  uint32_t offset = address - this->address;
+
+  update_range(offset, len);
+
+  set_used(offset, len, value != DL_EMPTY);
+
+  // Bytes that aren't marked in used[] are DL_EMPTY no matter what the
+  // runs say, so there is nothing else to store.
+  if (value == DL_EMPTY) { return; }
+
+  if (debug_line != NULL)
+  {
+    for (uint32_t n = 0; n < len; n++) { debug_line[offset + n] = value; }
+    return;
+  }
+
+  set_debug_runs(offset, len, value);
+
+  if (debug_runs_count > DEBUG_RUNS_MAX) { convert_debug_runs(); }
+}
+
+bool MemoryPage::find_used(uint32_t offset, uint32_t *start, uint32_t *length)
+{
+  // Find the next run of bytes at or after offset that are marked in
+  // used[].  Whole bytes of the bitmap are skipped at a time.
+  while (offset < PAGE_SIZE)
+  {
+    if ((offset % 8) == 0 && used[offset / 8] == 0x00) { offset += 8; continue; }
+    if (is_used(offset)) { break; }
+    offset++;
+  }
+
+  if (offset >= PAGE_SIZE) { return false; }
+
+  *start = offset;
+
+  while (offset < PAGE_SIZE)
+  {
+    if ((offset % 8) == 0 && used[offset / 8] == 0xff) { offset += 8; continue; }
+    if (!is_used(offset)) { break; }
+    offset++;
+  }
+
+  *length = offset - *start;
+
+  return true;
+}
+
+int MemoryPage::find_debug_run(uint32_t offset)
+{
+  // Return the index of the first run starting at or after offset.
+  // Code is almost always written in order so check the end first.
+  if (debug_runs_count == 0) { return 0; }
+
+  if (debug_runs[debug_runs_count - 1].offset < offset)
+  {
+    return debug_runs_count;
+  }
+
+  int low = 0;
+  int high = debug_runs_count - 1;
+
+  while (low < high)
+  {
+    int mid = (low + high) / 2;
+
+    if (debug_runs[mid].offset < offset)
+    {
+      low = mid + 1;
+    }
+      else
+    {
+      high = mid;
+    }
+  }
+
+  return low;
+}
+
+void MemoryPage::set_used(uint32_t offset, uint32_t len, bool value)
+{
+  uint32_t end = offset + len;
+
+  // Bits up to the first byte boundary, whole bytes, then the tail.
+  while (offset < end && (offset % 8) != 0)
+  {
+    if (value) { used[offset / 8] |= 1 << (offset % 8); }
+    else { used[offset / 8] &= ~(1 << (offset % 8)); }
+    offset++;
+  }
+
+  if (end - offset >= 8)
+  {
+    memset(used + (offset / 8), value ? 0xff : 0x00, (end - offset) / 8);
+    offset += ((end - offset) / 8) * 8;
+  }
+
+  while (offset < end)
+  {
+    if (value) { used[offset / 8] |= 1 << (offset % 8); }
+    else { used[offset / 8] &= ~(1 << (offset % 8)); }
+    offset++;
+  }
+}
+
+void MemoryPage::set_debug_runs(uint32_t offset, uint32_t len, int value)
+{
+  const uint32_t end = offset + len;
+
+  // Runs starting in [offset, end] are replaced by a run for value and,
+  // if needed, a run at end that keeps whatever was there before.
+  int first = find_debug_run(offset);
+  int last = end < PAGE_SIZE ? find_debug_run(end + 1) : debug_runs_count;
+
+  int prev_value = first == 0 ? DL_EMPTY : debug_runs[first - 1].line;
+  int end_value = last == 0 ? DL_EMPTY : debug_runs[last - 1].line;
+
+  DebugLineRun runs[2];
+  int count = 0;
+
+  if (prev_value != value)
+  {
+    runs[count].offset = offset;
+    runs[count].line = value;
+    count++;
+  }
+
+  if (end < PAGE_SIZE && end_value != value)
+  {
+    runs[count].offset = end;
+    runs[count].line = end_value;
+    count++;
+  }
+
+  const int new_count = debug_runs_count - (last - first) + count;
+
+  if (new_count > debug_runs_size)
+  {
+    int size = debug_runs_size == 0 ? 64 : debug_runs_size * 2;
+
+    debug_runs =
+      (DebugLineRun *)realloc(debug_runs, size * sizeof(DebugLineRun));
+    debug_runs_size = size;
+  }
+
+  if (last != first + count)
+  {
+    memmove(debug_runs + first + count,
+            debug_runs + last,
+            (debug_runs_count - last) * sizeof(DebugLineRun));
+  }
+
+  memcpy(debug_runs + first, runs, count * sizeof(DebugLineRun));
+
+  debug_runs_count = new_count;
+}
+
+void MemoryPage::convert_debug_runs()
+{
+  debug_line = (int *)malloc(PAGE_SIZE * sizeof(int));
+
+  for (int n = 0; n < debug_runs_count; n++)
+  {
+    uint32_t start = debug_runs[n].offset;
+    uint32_t end =
+      n + 1 < debug_runs_count ? debug_runs[n + 1].offset : PAGE_SIZE;
+
+    for (uint32_t i = start; i < end; i++)
+    {
+      debug_line[i] = debug_runs[n].line;
+    }
+  }
+
+  for (uint32_t n = 0; n < debug_runs[0].offset; n++)
+  {
+    debug_line[n] = DL_EMPTY;
+  }
+
+  free(debug_runs);
+  debug_runs = NULL;
+  debug_runs_count = 0;
+  debug_runs_size = 0;
+}
+
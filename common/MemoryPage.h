@@ -31,23 +31,55 @@
 #define PAGE_SIZE (64 * 1024)
 //#define PAGE_SIZE 2097152
 
+#define DL_EMPTY -1
+#define DL_DATA -2
+#define DL_NO_CG -3
+
+// MemoryPage.snapshot_flags.  CLEAN pages haven't been written since
+// the snapshot was saved or restored.  SAVED pages have a copy of the
+// snapshot in saved.  NEW pages were allocated after the snapshot was
+// saved so they were all 0 in it.
+#define PAGE_SNAPSHOT_CLEAN 1
+#define PAGE_SNAPSHOT_SAVED 2
+#define PAGE_SNAPSHOT_NEW 4
+
+// Once a page has this many runs of debug lines it's stored as one int
+// per byte instead, so a page never costs more than it used to.
+#define DEBUG_RUNS_MAX (PAGE_SIZE / 2)
+
+struct DebugLineRun
+{
+  // The run covers from offset up to the offset of the next run.
+  uint32_t offset;
+  int line;
+};
+
 class MemoryPage
 {
 public:
   MemoryPage(uint32_t address) :
-    address    (address),
-    offset_min (PAGE_SIZE),
-    offset_max (0),
-    next       (NULL)
+    address          (address),
+    offset_min       (PAGE_SIZE),
+    offset_max       (0),
+    next             (NULL),
+    debug_runs       (NULL),
+    debug_runs_count (0),
+    debug_runs_size  (0),
+    debug_line       (NULL),
+    saved            (NULL),
+    snapshot_flags   (0)
   {
     memset(bin, 0, sizeof(bin));
-    memset(debug_line, -1, sizeof(debug_line));
+    memset(used, 0, sizeof(used));
 
     this->address = (this->address / PAGE_SIZE) * PAGE_SIZE;
   }
 
   ~MemoryPage()
   {
+    free(debug_runs);
+    free(debug_line);
+    free(saved);
   }
 
   void set_data(uint32_t address, uint8_t data)
@@ -61,13 +93,51 @@ public:
   }
 
   void set_debug(uint32_t address, int value)
+  {
+    set_debug_block(address, value, 1);
+  }
+
+  int get_debug(uint32_t address)
   {
     uint32_t offset = address - this->address;
 
-    if (offset < offset_min) { offset_min = offset; }
-    if (offset > offset_max) { offset_max = offset; }
+    if (!is_used(offset)) { return DL_EMPTY; }
+    if (debug_line != NULL) { return debug_line[offset]; }
+
+    return debug_runs[find_debug_run(offset + 1) - 1].line;
+  }
+
+  bool is_used(uint32_t offset)
+  {
+    return (used[offset / 8] & (1 << (offset % 8))) != 0;
+  }
+
+  void set_block(uint32_t address, const uint8_t *data, uint32_t len)
+  {
+    uint32_t offset = address - this->address;
+
+    update_range(offset, len);
+
+    memcpy(bin + offset, data, len);
+  }
+
+  void set_fill(uint32_t address, uint8_t data, uint32_t len)
+  {
+    uint32_t offset = address - this->address;
+
+    update_range(offset, len);
+
+    memset(bin + offset, data, len);
+  }
 
-    debug_line[offset] = value;
+  void clear();
+  void set_debug_block(uint32_t address, int value, uint32_t len);
+  bool find_used(uint32_t offset, uint32_t *start, uint32_t *length);
+
+  void update_range(uint32_t offset, uint32_t len)
+  {
+    if (offset < offset_min) { offset_min = offset; }
+    if (offset + len - 1 > offset_max) { offset_max = offset + len - 1; }
   }
 
   void dump()
@@ -77,6 +147,7 @@ public:
     printf("  offset_min: 0x%08x\n", offset_min);
     printf("  offset_max: 0x%08x\n", offset_max);
     printf("        next: %p\n", next);
+    printf("  debug_runs: %d\n", debug_runs_count);
   }
 
   uint32_t address;
@@ -87,7 +158,25 @@ public:
   // debug_line was used to associate a line of code with an address.
   // It's also used to know which memory locations have been written to
   // so the hexfiles only save data for memory locations that are full.
-  int debug_line[PAGE_SIZE];
+  // Which bytes are not DL_EMPTY is kept as a bitmap in used[] and the
+  // line numbers as sorted runs, since most of a page is either empty or
+  // the same value repeated.  Busy pages fall back to one int per byte.
+  uint8_t used[PAGE_SIZE / 8];
+  DebugLineRun *debug_runs;
+  int debug_runs_count;
+  int debug_runs_size;
+  int *debug_line;
+
+  // For simulator snapshots.  saved is allocated when the snapshot is
+  // saved, but bin is only copied to it on the first write after that.
+  uint8_t *saved;
+  uint8_t snapshot_flags;
+
+private:
+  int find_debug_run(uint32_t offset);
+  void set_used(uint32_t offset, uint32_t len, bool value);
+  void set_debug_runs(uint32_t offset, uint32_t len, int value);
+  void convert_debug_runs();
 };
 
 #endif
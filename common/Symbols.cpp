@@ -16,13 +16,20 @@
 
 #include "common/MemoryPool.h"
 #include "common/Symbols.h"
+#include "common/string_hash.h"
 
 int symbols_init(Symbols *symbols)
 {
   symbols->memory_pool = NULL;
+  symbols->memory_pool_tail = NULL;
+  symbols->hash_table = NULL;
+  symbols->hash_size = 0;
+  symbols->hash_count = 0;
   symbols->locked = 0;
   symbols->in_scope = 0;
   symbols->debug = 0;
+  symbols->relax = 0;
+  symbols->moved = 0;
   symbols->current_scope = 0;
 
   return 0;
@@ -32,123 +39,135 @@ void symbols_free(Symbols *symbols)
 {
   memory_pool_free(symbols->memory_pool);
   symbols->memory_pool = NULL;
+  symbols->memory_pool_tail = NULL;
+
+  free(symbols->hash_table);
+  symbols->hash_table = NULL;
+  symbols->hash_size = 0;
+  symbols->hash_count = 0;
 }
 
-SymbolsData *symbols_find(Symbols *symbols, const char *name)
+static uint32_t symbols_hash(const char *name, uint32_t scope)
 {
-  MemoryPool *memory_pool = symbols->memory_pool;
-  int ptr;
-
-  // Check local scope.
-  if (symbols->in_scope != 0)
-  {
-    while (memory_pool != NULL)
-    {
-      ptr = 0;
+  // The same name in another scope is a different symbol.
+  return string_hash_add(string_hash(name), scope);
+}
 
-      while (ptr < memory_pool->ptr)
-      {
-        SymbolsData *symbols_data =
-          (SymbolsData *)(memory_pool->buffer + ptr);
+static SymbolsData *symbols_hash_find(
+  Symbols *symbols,
+  const char *name,
+  uint32_t scope)
+{
+  if (symbols->hash_table == NULL) { return NULL; }
 
-        if (symbols->current_scope == symbols_data->scope &&
-            strcmp(symbols_data->name, name) == 0)
-        {
-          return symbols_data;
-        }
+  const uint32_t mask = symbols->hash_size - 1;
+  uint32_t n = symbols_hash(name, scope) & mask;
 
-        ptr += symbols_data->len + sizeof(SymbolsData);
-      }
+  while (symbols->hash_table[n] != NULL)
+  {
+    SymbolsData *symbols_data = symbols->hash_table[n];
 
-      memory_pool = memory_pool->next;
+    if (symbols_data->scope == scope && strcmp(symbols_data->name, name) == 0)
+    {
+      return symbols_data;
     }
 
-    memory_pool = symbols->memory_pool;
+    n = (n + 1) & mask;
   }
 
-  // Check global scope.
-  while (memory_pool != NULL)
+  return NULL;
+}
+
+static void symbols_hash_insert(Symbols *symbols, SymbolsData *symbols_data)
+{
+  const uint32_t mask = symbols->hash_size - 1;
+  uint32_t n = symbols_hash(symbols_data->name, symbols_data->scope) & mask;
+
+  while (symbols->hash_table[n] != NULL)
   {
-    ptr = 0;
+    n = (n + 1) & mask;
+  }
 
-    while (ptr < memory_pool->ptr)
-    {
-      SymbolsData *symbols_data = (SymbolsData *)(memory_pool->buffer + ptr);
+  symbols->hash_table[n] = symbols_data;
+}
 
-      if (symbols_data->scope == 0 && strcmp(symbols_data->name, name) == 0)
-      {
-        return symbols_data;
-      }
+static int symbols_hash_grow(Symbols *symbols)
+{
+  SymbolsData **old_table = symbols->hash_table;
+  uint32_t old_size = symbols->hash_size;
+  uint32_t new_size =
+    old_size == 0 ? SYMBOLS_HASH_INITIAL_SIZE : old_size * 2;
 
-      ptr += symbols_data->len + sizeof(SymbolsData);
-    }
+  SymbolsData **new_table =
+    (SymbolsData **)calloc(new_size, sizeof(SymbolsData *));
 
-    memory_pool = memory_pool->next;
+  if (new_table == NULL)
+  {
+    printf("Error: Out of memory growing symbol table.\n");
+    return -1;
   }
 
-  return NULL;
-}
+  symbols->hash_table = new_table;
+  symbols->hash_size = new_size;
 
-int symbols_append(Symbols *symbols, const char *name, uint32_t address)
-{
-  int token_len;
-  MemoryPool *memory_pool = symbols->memory_pool;
-  SymbolsData *symbols_data;
+  for (uint32_t n = 0; n < old_size; n++)
+  {
+    if (old_table[n] != NULL) { symbols_hash_insert(symbols, old_table[n]); }
+  }
 
-#ifdef DEBUG
-//printf("symbols_append(%s, %d);\n", name, address);
-#endif
+  free(old_table);
 
-  if (symbols->locked == 1) { return 0; }
+  return 0;
+}
 
-  symbols_data = symbols_find(symbols, name);
+SymbolsData *symbols_find(Symbols *symbols, const char *name)
+{
+  SymbolsData *symbols_data;
 
-  if (symbols_data != NULL)
+  // Check local scope.
+  if (symbols->in_scope != 0)
   {
-    // For unit test.  Probably a better way to do this.
-    if (symbols->debug == 1)
-    {
-      symbols_data->address = address;
-      return 0;
-    }
+    symbols_data = symbols_hash_find(symbols, name, symbols->current_scope);
 
-    if (symbols->in_scope == 0 || symbols_data->scope == symbols->current_scope)
-    {
-      printf("Error: Label '%s' already defined.\n", name);
-      return -1;
-    }
+    if (symbols_data != NULL) { return symbols_data; }
   }
 
+  // Check global scope.
+  return symbols_hash_find(symbols, name, 0);
+}
+
+static SymbolsData *symbols_add(
+  Symbols *symbols,
+  const char *name,
+  uint32_t address,
+  uint32_t scope)
+{
+  int token_len;
+  MemoryPool *memory_pool = symbols->memory_pool_tail;
+  SymbolsData *symbols_data;
+
   token_len = strlen(name) + 1;
 
   // Check if size of new label is bigger than 255.
   if (token_len > 255)
   {
     printf("Error: Label '%s' is too big.\n", name);
-    return -1;
+    return NULL;
   }
 
-  // If there is no pool, add one.
-  if (memory_pool == NULL)
+  // Keep the hash table at most half full so probe chains stay short.
+  if ((symbols->hash_count + 1) * 2 > symbols->hash_size)
   {
-    memory_pool = memory_pool_add((NakenHeap *)symbols, SYMBOLS_HEAP_SIZE);
+    if (symbols_hash_grow(symbols) != 0) { return NULL; }
   }
 
-  // Find a pool that has enough area at the end to add this address.
-  // If none can be found, alloc a new one.
-  while (1)
+  // Records are only ever appended to the last pool so that the order
+  // symbols_iterate() returns matches the order they were added in.
+  if (memory_pool == NULL ||
+      memory_pool->ptr + token_len + (int)sizeof(SymbolsData) >= memory_pool->len)
   {
-     if (memory_pool->ptr + token_len + (int)sizeof(SymbolsData) < memory_pool->len)
-     {
-       break;
-     }
-
-     if (memory_pool->next == NULL)
-     {
-       memory_pool->next = memory_pool_add((NakenHeap *)symbols, SYMBOLS_HEAP_SIZE);
-     }
-
-     memory_pool = memory_pool->next;
+    memory_pool = memory_pool_add((NakenHeap *)symbols, SYMBOLS_HEAP_SIZE);
+    symbols->memory_pool_tail = memory_pool;
   }
 
   // Divide by bytes_per_address (for AVR8 and dsPIC).
@@ -163,10 +182,61 @@ int symbols_append(Symbols *symbols, const char *name, uint32_t address)
   symbols_data->flag_rw = 0;
   symbols_data->flag_export = 0;
   symbols_data->address = address;
-  symbols_data->scope = symbols->in_scope == 0 ? 0 : symbols->current_scope;
+  symbols_data->scope = scope;
 
   memory_pool->ptr += token_len + sizeof(SymbolsData);
 
+  symbols_hash_insert(symbols, symbols_data);
+  symbols->hash_count++;
+
+  return symbols_data;
+}
+
+int symbols_append(Symbols *symbols, const char *name, uint32_t address)
+{
+  SymbolsData *symbols_data;
+
+#ifdef DEBUG
+//printf("symbols_append(%s, %d);\n", name, address);
+#endif
+
+  if (symbols->locked == 1)
+  {
+    if (symbols->relax == 0) { return 0; }
+
+    symbols_data = symbols_find(symbols, name);
+
+    if (symbols_data != NULL && symbols_data->address != address)
+    {
+      symbols_data->address = address;
+      symbols->moved++;
+    }
+
+    return 0;
+  }
+
+  symbols_data = symbols_find(symbols, name);
+
+  if (symbols_data != NULL)
+  {
+    // For unit test.  Probably a better way to do this.
+    if (symbols->debug == 1)
+    {
+      symbols_data->address = address;
+      return 0;
+    }
+
+    if (symbols->in_scope == 0 || symbols_data->scope == symbols->current_scope)
+    {
+      printf("Error: Label '%s' already defined.\n", name);
+      return -1;
+    }
+  }
+
+  const uint32_t scope = symbols->in_scope == 0 ? 0 : symbols->current_scope;
+
+  if (symbols_add(symbols, name, address, scope) == NULL) { return -1; }
+
   return 0;
 }
 
@@ -178,13 +248,13 @@ int symbols_set(Symbols *symbols, const char *name, uint32_t address)
 
   if (symbols_data == NULL)
   {
-    if (symbols_append(symbols, name, address) != 0)
-    {
-      return -1;
-    }
+    if (symbols->locked == 1) { return 0; }
+
+    // Variables are always global.
+    symbols_data = symbols_add(symbols, name, address, 0);
+
+    if (symbols_data == NULL) { return -1; }
 
-    symbols_data = symbols_find(symbols, name);
-    symbols_data->scope = 0;
     symbols_data->flag_rw = 1;
   }
     else
@@ -239,8 +309,6 @@ int symbols_lookup(Symbols *symbols, const char *name, uint32_t *address)
 
 int symbols_iterate(Symbols *symbols, SymbolsIter *iter)
 {
-  MemoryPool *memory_pool = symbols->memory_pool;
-
   if (iter->end_flag == 1) { return -1; }
   if (iter->memory_pool == NULL)
   {
@@ -248,8 +316,10 @@ int symbols_iterate(Symbols *symbols, SymbolsIter *iter)
     iter->ptr = 0;
   }
 
-  while (memory_pool != NULL)
+  while (iter->memory_pool != NULL)
   {
+    MemoryPool *memory_pool = iter->memory_pool;
+
     if (iter->ptr < memory_pool->ptr)
     {
       SymbolsData * symbols_data =
@@ -265,7 +335,8 @@ int symbols_iterate(Symbols *symbols, SymbolsIter *iter)
       return 0;
     }
 
-    memory_pool = memory_pool->next;
+    iter->memory_pool = memory_pool->next;
+    iter->ptr = 0;
   }
 
   iter->end_flag = 1;
@@ -293,25 +364,7 @@ int symbols_print(Symbols *symbols, FILE *out)
 
 int symbols_count(Symbols *symbols)
 {
-  MemoryPool *memory_pool = symbols->memory_pool;
-  int ptr;
-  int count = 0;
-
-  while (memory_pool != NULL)
-  {
-    ptr = 0;
-    while (ptr < memory_pool->ptr)
-    {
-      SymbolsData *symbols_data =
-        (SymbolsData *)(memory_pool->buffer + ptr);
-      ptr += symbols_data->len + sizeof(SymbolsData);
-      count++;
-    }
-
-    memory_pool = memory_pool->next;
-  }
-
-  return count;
+  return symbols->hash_count;
 }
 
 int symbols_export_count(Symbols *symbols)
@@ -17,6 +17,7 @@
 #include "MemoryPool.h"
 
 #define SYMBOLS_HEAP_SIZE 32768
+#define SYMBOLS_HASH_INITIAL_SIZE 1024
 
 struct SymbolsData
 {
@@ -31,9 +32,19 @@ struct SymbolsData
 struct Symbols
 {
   MemoryPool *memory_pool;
+  // Last pool in the list, new records are always appended here.
+  MemoryPool *memory_pool_tail;
+  // Open addressing index (name + scope) into the memory_pool records.
+  SymbolsData **hash_table;
+  uint32_t hash_size;
+  uint32_t hash_count;
   uint8_t locked : 1;
   uint8_t in_scope : 1;
   uint8_t debug : 1;
+  // When set, appending a locked label moves it to the new address and
+  // counts it in moved (used for relaxation passes).
+  uint8_t relax : 1;
+  uint32_t moved;
   uint32_t current_scope;
 };
 
@@ -548,6 +548,7 @@ void util_write8(UtilContext *util_context, const char *token)
 
     token = util_get_num(token, &num);
     if (token == NULL) { break; }
+    util_context->simulate->prepare_write(address, 1);
     util_context->memory.write8(address++, num);
     count++;
   }
@@ -593,6 +594,7 @@ void util_write16(UtilContext *util_context, const char *token)
 
     token = util_get_num(token, &num);
     if (token == NULL) { break; }
+    util_context->simulate->prepare_write(address, 2);
     util_context->memory.write16(address, num);
     address += 2;
     count++;
@@ -637,6 +639,7 @@ void util_write32(UtilContext *util_context, const char *token)
 
     token = util_get_num(token, &num);
     if (token == NULL) { break; }
+    util_context->simulate->prepare_write(address, 4);
     util_context->memory.write32(address, num);
     address += 4;
     count++;
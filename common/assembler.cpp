@@ -82,6 +82,7 @@ AsmContext::~AsmContext()
 
   symbols_free(&symbols);
   macros_free(&macros);
+  tokens_free(this);
 }
 
 void AsmContext::init()
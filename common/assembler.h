@@ -70,6 +70,18 @@ public:
     memory.write(address++, data, line);
   }
 
+  void memory_write_block_inc(const uint8_t *data, int len, int line)
+  {
+    memory.write_block(address, data, len, line);
+    address += len;
+  }
+
+  void memory_fill_inc(uint8_t data, int len, int line)
+  {
+    memory.fill(address, data, len, line);
+    address += len;
+  }
+
   Memory memory;
   Tokens tokens;
   Symbols symbols;
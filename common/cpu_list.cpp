@@ -119,9 +119,11 @@
 #include "disasm/xtensa.h"
 #include "disasm/z80.h"
 #include "simulate/1802.h"
+#include "simulate/68000.h"
 #include "simulate/6502.h"
 #include "simulate/65816.h"
 #include "simulate/8008.h"
+#include "simulate/arm.h"
 #include "simulate/avr8.h"
 #include "simulate/ebpf.h"
 #include "simulate/lc3.h"
@@ -383,7 +385,7 @@ struct _cpu_list cpu_list[] =
     link_not_supported,
     list_output_68000,
     disasm_range_68000,
-    NULL,
+    Simulate68000::init,
     NO_FLAGS,
   },
 #endif
@@ -549,7 +551,7 @@ struct _cpu_list cpu_list[] =
     link_not_supported,
     list_output_arm,
     disasm_range_arm,
-    NULL,
+    SimulateArm::init,
     NO_FLAGS,
   },
 #endif
@@ -1421,7 +1423,7 @@ struct _cpu_list cpu_list[] =
     link_not_supported,
     list_output_thumb,
     disasm_range_thumb,
-    NULL,
+    SimulateArm::init_thumb,
     NO_FLAGS,
   },
 #endif
@@ -267,16 +267,33 @@ int parse_repeat(AsmContext *asm_context)
   asm_context->in_repeat = 0;
 
   uint32_t address_end = asm_context->address;
-  uint32_t r;
+  int len = address_end - address_start;
   int n;
 
-  for (n = 0; n < count - 1; n++)
+  if (len > 0 && count > 1)
   {
-    for (r = address_start; r < address_end; r++)
+    uint8_t *buffer = (uint8_t *)malloc(len);
+
+    if (buffer == NULL)
+    {
+      print_error(asm_context, "Out of memory in .repeat block.");
+      return -1;
+    }
+
+    asm_context->memory.read_block(address_start, buffer, len);
+
+    for (n = 0; n < count - 1; n++)
     {
-      uint8_t data = asm_context->memory_read(r);
-      add_bin8(asm_context, data, 0);
+      if (asm_context->pass == 1 && asm_context->pass_1_write_disable == 1)
+      {
+        asm_context->address += len;
+        continue;
+      }
+
+      asm_context->memory_write_block_inc(buffer, len, DL_NO_CG);
     }
+
+    free(buffer);
   }
 
   if (asm_context->list != NULL && asm_context->write_list_file == 1)
@@ -346,7 +346,7 @@ int parse_dc(AsmContext *asm_context)
 
 int parse_data_fill(AsmContext *asm_context)
 {
-  int count, value, n;
+  int count, value;
 
   if (eval_expression(asm_context, &value) == -1)
   {
@@ -381,10 +381,7 @@ int parse_data_fill(AsmContext *asm_context)
     return -1;
   }
 
-  for (n = 0; n < count; n++)
-  {
-    asm_context->memory_write_inc(value & 0xff, DL_DATA);
-  }
+  asm_context->memory_fill_inc(value & 0xff, count, DL_DATA);
 
   return 0;
 }
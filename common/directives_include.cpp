@@ -53,7 +53,6 @@ int binfile_parse(AsmContext *asm_context)
   uint8_t buffer[8192];
   //int token_type;
   int len;
-  int n;
 
   if (asm_context->segment == SEGMENT_BSS)
   {
@@ -82,10 +81,7 @@ int binfile_parse(AsmContext *asm_context)
     len = fread(buffer, 1, sizeof(buffer), in);
     if (len <= 0) { break; }
 
-    for (n = 0; n < len; n++)
-    {
-      asm_context->memory_write_inc(buffer[n], DL_DATA);
-    }
+    asm_context->memory_write_block_inc(buffer, len, DL_DATA);
 
     asm_context->data_count += len;
   }
@@ -101,8 +97,9 @@ int include_parse(AsmContext *asm_context)
   //int token_type;
   const char *oldname;
   int oldline;
-  FILE *oldfp;
+  TokenBuffer old_token_buffer;
   uint8_t write_list_file;
+  int found;
   int ret;
 
   tokens_get(asm_context, token, TOKENLEN);
@@ -113,10 +110,12 @@ printf("including file %s.\n", token);
   write_list_file = asm_context->write_list_file;
   asm_context->write_list_file = 0;
 
-  oldfp = asm_context->tokens.in;
+  old_token_buffer = asm_context->tokens.token_buffer;
   oldname = asm_context->tokens.filename;
 
-  if (tokens_open_file(asm_context, token) != 0)
+  found = tokens_open_file(asm_context, token) == 0;
+
+  if (!found)
   {
     int ptr = 0;
     char *s = asm_context->include_path;
@@ -132,7 +131,7 @@ printf("including file %s.\n", token);
 #ifdef DEBUG
         printf("Trying %s\n", filename);
 #endif
-        if (tokens_open_file(asm_context, filename) == 0) { break; }
+        if (tokens_open_file(asm_context, filename) == 0) { found = 1; break; }
 
         if (asm_context->cpu_list_index != -1)
         {
@@ -141,7 +140,7 @@ printf("including file %s.\n", token);
 #ifdef DEBUG
           printf("Trying %s\n", filename);
 #endif
-          if (tokens_open_file(asm_context, filename) == 0) { break; }
+          if (tokens_open_file(asm_context, filename) == 0) { found = 1; break; }
         }
       }
 
@@ -150,7 +149,7 @@ printf("including file %s.\n", token);
     }
   }
 
-  if (asm_context->tokens.in == NULL)
+  if (!found)
   {
     printf("Cannot open include file '%s' at %s:%d\n",
       token, asm_context->tokens.filename, asm_context->tokens.line);
@@ -168,10 +167,8 @@ printf("including file %s.\n", token);
     asm_context->tokens.line = oldline;
   }
 
-  if (asm_context->tokens.in != NULL) { fclose(asm_context->tokens.in); }
-
   asm_context->tokens.filename = oldname;
-  asm_context->tokens.in = oldfp;
+  asm_context->tokens.token_buffer = old_token_buffer;
   asm_context->write_list_file = write_list_file;
 
   return ret;
@@ -16,6 +16,7 @@
 #include "common/assembler.h"
 #include "common/macros.h"
 #include "common/MemoryPool.h"
+#include "common/string_hash.h"
 //#include "common/symbols.h"
 #include "common/tokens.h"
 
@@ -145,9 +146,55 @@ static int check_endm(char *macro, int ptr)
   return 0;
 }
 
+static void macros_hash_insert(Macros *macros, MacroData *macro_data)
+{
+  const uint32_t mask = macros->hash_size - 1;
+  uint32_t n = string_hash(macro_data->data) & mask;
+
+  while (macros->hash_table[n] != NULL)
+  {
+    n = (n + 1) & mask;
+  }
+
+  macros->hash_table[n] = macro_data;
+}
+
+static int macros_hash_grow(Macros *macros)
+{
+  MacroData **old_table = macros->hash_table;
+  uint32_t old_size = macros->hash_size;
+  uint32_t new_size =
+    old_size == 0 ? MACROS_HASH_INITIAL_SIZE : old_size * 2;
+
+  MacroData **new_table =
+    (MacroData **)calloc(new_size, sizeof(MacroData *));
+
+  if (new_table == NULL)
+  {
+    printf("Error: Out of memory growing macro table.\n");
+    return -1;
+  }
+
+  macros->hash_table = new_table;
+  macros->hash_size = new_size;
+
+  for (uint32_t n = 0; n < old_size; n++)
+  {
+    if (old_table[n] != NULL) { macros_hash_insert(macros, old_table[n]); }
+  }
+
+  free(old_table);
+
+  return 0;
+}
+
 int macros_init(Macros *macros)
 {
   macros->memory_pool = NULL;
+  macros->memory_pool_tail = NULL;
+  macros->hash_table = NULL;
+  macros->hash_size = 0;
+  macros->hash_count = 0;
   macros->locked = 0;
 
   return 0;
@@ -157,7 +204,13 @@ void macros_free(Macros *macros)
 {
   memory_pool_free(macros->memory_pool);
   macros->memory_pool = NULL;
+  macros->memory_pool_tail = NULL;
   macros->stack_ptr = 0;
+
+  free(macros->hash_table);
+  macros->hash_table = NULL;
+  macros->hash_size = 0;
+  macros->hash_count = 0;
 }
 
 int macros_append(
@@ -167,7 +220,7 @@ int macros_append(
   int param_count)
 {
   Macros *macros = &asm_context->macros;
-  MemoryPool *memory_pool = macros->memory_pool;
+  MemoryPool *memory_pool = macros->memory_pool_tail;
   uint32_t address;
   int param_count_temp;
   int name_len;
@@ -199,27 +252,19 @@ int macros_append(
     return -1;
   }
 
-  // If there is no pool, add one.
-  if (memory_pool == NULL)
+  // Grow the table before it's half full.
+  if ((macros->hash_count + 1) * 2 > macros->hash_size)
   {
-    memory_pool = memory_pool_add((NakenHeap *)macros, MACROS_HEAP_SIZE);
+    if (macros_hash_grow(macros) != 0) { return -1; }
   }
 
-  // Find a pool that has enough area at the end to add this macro.
-  // If none can be found, alloc a new one.
-  while (1)
+  // macros_iterate() walks the pools in order, so a new macro always
+  // goes at the end of the last one.
+  if (memory_pool == NULL ||
+      memory_pool->ptr + name_len + value_len + (int)sizeof(MacroData) >= memory_pool->len)
   {
-     if (memory_pool->ptr + name_len + value_len + (int)sizeof(MacroData) < memory_pool->len)
-     {
-       break;
-     }
-
-     if (memory_pool->next == NULL)
-     {
-       memory_pool->next = memory_pool_add((NakenHeap *)macros, MACROS_HEAP_SIZE);
-     }
-
-     memory_pool = memory_pool->next;
+    memory_pool = memory_pool_add((NakenHeap *)macros, MACROS_HEAP_SIZE);
+    macros->memory_pool_tail = memory_pool;
   }
 
   // Set the new macro entry.
@@ -232,6 +277,9 @@ int macros_append(
   memcpy(macro_data->data + name_len, value, value_len);
   memory_pool->ptr += name_len + value_len + sizeof(MacroData);
 
+  macros_hash_insert(macros, macro_data);
+  macros->hash_count++;
+
   return 0;
 }
 
@@ -242,29 +290,22 @@ void macros_lock(Macros *macros)
 
 char *macros_lookup(Macros *macros, char *name, int *param_count)
 {
-  MemoryPool *memory_pool = macros->memory_pool;
-  char *value;
-  int ptr;
+  if (macros->hash_table == NULL) { return NULL; }
+
+  const uint32_t mask = macros->hash_size - 1;
+  uint32_t n = string_hash(name) & mask;
 
-  while (memory_pool != NULL)
+  while (macros->hash_table[n] != NULL)
   {
-    ptr = 0;
-    while (ptr < memory_pool->ptr)
-    {
-      MacroData *macro_data = (MacroData *)(memory_pool->buffer + ptr);
-      //name_len = strlen((char *)memory_pool->buffer+ptr) + 1;
-      //value_len = strlen((char *)memory_pool->buffer + ptr + name_len) + 1;
+    MacroData *macro_data = macros->hash_table[n];
 
-      if (strcmp(macro_data->data, name) == 0)
-      {
-        value = macro_data->data + macro_data->name_len;
-        *param_count = macro_data->param_count;
-        return value;
-      }
-      ptr += macro_data->name_len + macro_data->value_len + sizeof(MacroData);
+    if (strcmp(macro_data->data, name) == 0)
+    {
+      *param_count = macro_data->param_count;
+      return macro_data->data + macro_data->name_len;
     }
 
-    memory_pool = memory_pool->next;
+    n = (n + 1) & mask;
   }
 
   return NULL;
@@ -272,8 +313,6 @@ char *macros_lookup(Macros *macros, char *name, int *param_count)
 
 int macros_iterate(Macros *macros, MacrosIter *iter)
 {
-  MemoryPool *memory_pool = macros->memory_pool;
-
   if (iter->end_flag == 1) { return -1; }
   if (iter->memory_pool == NULL)
   {
@@ -281,8 +320,10 @@ int macros_iterate(Macros *macros, MacrosIter *iter)
     iter->ptr = 0;
   }
 
-  while (memory_pool != NULL)
+  while (iter->memory_pool != NULL)
   {
+    MemoryPool *memory_pool = iter->memory_pool;
+
     if (iter->ptr < memory_pool->ptr)
     {
       MacroData *macro_data = (MacroData *)(memory_pool->buffer + iter->ptr);
@@ -297,7 +338,8 @@ int macros_iterate(Macros *macros, MacrosIter *iter)
       return 0;
     }
 
-    memory_pool = memory_pool->next;
+    iter->memory_pool = memory_pool->next;
+    iter->ptr = 0;
   }
 
   iter->end_flag = 1;
@@ -22,6 +22,7 @@ struct AsmContext;
 #define MAX_NESTED_MACROS 128
 #define MAX_MACRO_LEN 1024
 #define MACROS_HEAP_SIZE 32768
+#define MACROS_HASH_INITIAL_SIZE 256
 #define MAX_MACRO_LEN 1024
 #define CHAR_EOF -1
 #define IS_DEFINE 1
@@ -48,6 +49,12 @@ struct MacroData
 struct Macros
 {
   MemoryPool *memory_pool;
+  // Last pool in the list, new macros are always appended here.
+  MemoryPool *memory_pool_tail;
+  // Open addressing index (by name) into the memory_pool records.
+  MacroData **hash_table;
+  uint32_t hash_size;
+  uint32_t hash_count;
   int locked;
   char *stack[MAX_NESTED_MACROS];
   int stack_ptr;
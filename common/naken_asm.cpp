@@ -21,6 +21,8 @@
 #include "common/version.h"
 #include "fileio/file.h"
 
+#define RELAX_MAX_PASSES 16
+
 const char *credits =
   "\n"
   "naken_asm\n\n"
@@ -59,6 +61,52 @@ static void new_extension(char *filename, const char *ext, int len)
   }
 }
 
+static int relax_labels(AsmContext *asm_context)
+{
+  // Pass 1 is repeated with the labels it found so instructions that
+  // had to assume a worst case size for a forward reference can pick a
+  // smaller encoding.  Shrinking code moves labels, so keep going until
+  // nothing moves.
+  asm_context->symbols.relax = 1;
+
+  for (int n = 1; n <= RELAX_MAX_PASSES; n++)
+  {
+    if (asm_context->quiet_output == 0)
+    {
+      printf("Relax pass %d...\n", n);
+    }
+
+    asm_context->symbols.moved = 0;
+    symbols_scope_reset(&asm_context->symbols);
+    asm_context->memory.clear();
+    asm_context->init();
+
+    if (assemble(asm_context) != 0) { return -1; }
+    if (assembler_link(asm_context) != 0) { return -1; }
+
+    if (asm_context->symbols.moved == 0) { return 0; }
+  }
+
+  // -relax only makes code smaller, it shouldn't stop a program that
+  // assembles without it.  Start over with a normal pass 1.
+  printf("Warning: Labels still moving after %d relax passes, "
+         "assembling without -relax.\n", RELAX_MAX_PASSES);
+
+  if (asm_context->quiet_output == 0) { printf("Pass 1...\n"); }
+
+  symbols_free(&asm_context->symbols);
+  symbols_init(&asm_context->symbols);
+  asm_context->memory.clear();
+  asm_context->init();
+
+  if (assemble(asm_context) != 0) { return -1; }
+  if (assembler_link(asm_context) != 0) { return -1; }
+
+  symbols_lock(&asm_context->symbols);
+
+  return 0;
+}
+
 static void output_hex_text(FILE *fp, char *s, int ptr)
 {
   if (ptr == 0) { return; }
@@ -73,6 +121,7 @@ int main(int argc, char *argv[])
   int i;
   int file_type = FILE_TYPE_HEX;
   int create_list = 0;
+  int relax = 0;
   const char *infile = NULL;
   const char *outfile = NULL;
   AsmContext asm_context;
@@ -91,6 +140,8 @@ int main(int argc, char *argv[])
            "   -dump_symbols  Dump all symbols at end of assembly\n"
            "   -dump_macros   Dump all macros at end of assembly\n"
            "   -optimize      Optimize instructions (see docs for info)\n"
+           "   -relax         Repeat pass 1 until labels stop moving so forward\n"
+           "                  references can use short instruction forms\n"
            "   -cpu_list      List supported CPUs\n"
            "\n");
     exit(0);
@@ -247,6 +298,11 @@ int main(int argc, char *argv[])
       asm_context.optimize = 1;
     }
       else
+    if (strcmp(argv[i], "-relax") == 0)
+    {
+      relax = 1;
+    }
+      else
     {
       if (argv[i][0] == '-')
       {
@@ -375,6 +431,17 @@ int main(int argc, char *argv[])
     symbols_scope_reset(&asm_context.symbols);
     // macros_lock(&asm_context.defines_heap);
 
+    if (relax == 1 && relax_labels(&asm_context) != 0)
+    {
+      error_flag = 1;
+      printf("** Errors... bailing out\n");
+      unlink(outfile);
+      break;
+    }
+
+    asm_context.symbols.moved = 0;
+    symbols_scope_reset(&asm_context.symbols);
+
     if (asm_context.quiet_output == 0) { printf("Pass 2...\n"); }
     asm_context.pass = 2;
     asm_context.init();
@@ -391,6 +458,15 @@ int main(int argc, char *argv[])
       break;
     }
 
+    // Pass 2 has to lay out code exactly like the last relax pass did.
+    if (asm_context.symbols.moved != 0)
+    {
+      printf("Error: %u labels moved between relax passes and pass 2.\n",
+        asm_context.symbols.moved);
+      error_flag = 1;
+      break;
+    }
+
     int retcode = file_write(outfile, &asm_context, file_type);
 
     if (retcode == -1)
@@ -405,41 +481,60 @@ int main(int argc, char *argv[])
     int ch = 0;
     char str[17];
     int ptr = 0;
-    uint32_t i;
+    uint32_t i, n;
+    uint32_t next = 0;
+    MemoryIter iter;
 
     fprintf(asm_context.list, "data sections:");
 
-    for (i = asm_context.memory.low_address; i <= asm_context.memory.high_address; i++)
+    memset(&iter, 0, sizeof(iter));
+
+    while (asm_context.memory.iterate(&iter) != -1)
     {
-      if (asm_context.read_debug(i) == -2)
+      // A gap between runs ends the current line of data.
+      if (iter.address != next)
       {
-        if (ch == 0)
+        output_hex_text(asm_context.list, str, ptr);
+        ch = 0;
+        ptr = 0;
+      }
+
+      for (n = 0; n < iter.length; n++)
+      {
+        i = iter.address + n;
+
+        if (asm_context.read_debug(i) == DL_DATA)
         {
-          if (ptr != 0)
+          if (ch == 0)
           {
-            output_hex_text(asm_context.list, str, ptr);
+            if (ptr != 0)
+            {
+              output_hex_text(asm_context.list, str, ptr);
+            }
+            fprintf(asm_context.list, "\n%04x:", i/asm_context.bytes_per_address);
+            ptr = 0;
           }
-          fprintf(asm_context.list, "\n%04x:", i/asm_context.bytes_per_address);
-          ptr = 0;
-        }
 
-        uint8_t data = asm_context.memory_read(i);
-        fprintf(asm_context.list, " %02x", data);
+          uint8_t data = iter.data[n];
+          fprintf(asm_context.list, " %02x", data);
 
-        if (data >= ' ' && data <= 120)
-        { str[ptr++] = data; }
-          else
-        { str[ptr++] = '.'; }
+          if (data >= ' ' && data <= 120)
+          { str[ptr++] = data; }
+            else
+          { str[ptr++] = '.'; }
 
-        ch++;
-        if (ch == 16) { ch = 0; }
-      }
-        else
-      {
-        output_hex_text(asm_context.list, str, ptr);
-        ch = 0;
-        ptr = 0;
+          ch++;
+          if (ch == 16) { ch = 0; }
+        }
+          else
+        {
+          output_hex_text(asm_context.list, str, ptr);
+          ch = 0;
+          ptr = 0;
+        }
       }
+
+      next = iter.address + iter.length;
     }
     output_hex_text(asm_context.list, str, ptr);
     fprintf(asm_context.list, "\n\n");
@@ -450,7 +545,7 @@ int main(int argc, char *argv[])
   asm_context.print_info(stdout);
 
   if (asm_context.list != NULL) { fclose(asm_context.list); }
-  fclose(asm_context.tokens.in);
+  tokens_close(&asm_context);
 
   if (error_flag != 0)
   {
@@ -9,10 +9,14 @@
  *
  */
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <inttypes.h>
+#include <sys/time.h>
 
 #ifdef READLINE
 #include <readline/readline.h>
@@ -22,6 +26,7 @@
 #include "common/assembler.h"
 #include "common/UtilContext.h"
 #include "common/util_disasm.h"
+#include "common/util_profile.h"
 #include "common/util_sim.h"
 #include "common/version.h"
 #include "fileio/file.h"
@@ -36,6 +41,16 @@ enum
 static const char *state_stopped = "stopped";
 static const char *state_running = "running";
 
+// Exit codes for -run -quiet.
+enum
+{
+  BATCH_EXIT_END = 0,
+  BATCH_EXIT_ERROR = 1,
+  BATCH_EXIT_BREAK_POINT = 2,
+  BATCH_EXIT_MAX_CYCLES = 3,
+  BATCH_EXIT_INTERRUPTED = 4,
+};
+
 static void print_usage()
 {
   printf("Usage: naken_util [options] <infile>\n"
@@ -94,9 +109,23 @@ static void print_usage()
          "   -disasm                      (Disassemble all of program)\n"
          "   -disasm_range <start>-<end>  (Disassemble a range of executable code)\n"
          "   -run                         (Simulate program and dump registers)\n"
+         "   -quiet                       (In -run mode run at full speed with no\n"
+         "                                 display and report speed at the end)\n"
+         "   -max_cycles <count>          (In -run mode stop after count cycles)\n"
+         "   -break_point <address>       (In -run mode stop at address)\n"
+         "   -packet <file>               (Load file as the packet a program runs on)\n"
+         "   -repeat <count>              (In -run -quiet mode run the program on the\n"
+         "                                 packet count times and report packets/sec)\n"
          "   -address <start_address>     (For bin files: binary placed at this address)\n"
          "   -set_pc <address>            (Sets program counter after loading program)\n"
          "   -break_io <address>          (In -run mode writing to an i/o port exits sim)\n"
+         "   -trace <file>                (Save the last instructions run to file)\n"
+         "   -trace_size <count>          (Number of instructions -trace keeps)\n"
+         "   -decode_trace <file>         (Disassemble a file saved with -trace)\n"
+         "   -profile                     (In -run mode report cycles per address\n"
+         "                                 and per function at the end)\n"
+         "   -profile_callgrind <file>    (In -run mode save the profile in\n"
+         "                                 callgrind format)\n"
          "\n");
 }
 
@@ -112,6 +141,10 @@ static const char *command_names[] =
   "stop",
   "reset",
   "break",
+  "watch",
+  "rwatch",
+  "awatch",
+  "delete",
   "push",
   "set",
   "clear",
@@ -132,6 +165,10 @@ static const char *command_names[] =
   "registers",
   "display",
   "read",
+  "trace",
+  "profile",
+  "snapshot",
+  "restore",
 };
 
 static const char *find_partial_command(const char *text, int *index)
@@ -227,6 +264,118 @@ static char **command_name_completion(const char *text, int start, int end)
 }
 #endif
 
+// Parses a count of at least 1 that has to be the whole argument.
+static int get_count(const char *text, int *count)
+{
+  char *end;
+
+  errno = 0;
+  long value = strtol(text, &end, 0);
+
+  if (end == text || *end != 0 || errno == ERANGE || value < 1 || value > INT_MAX)
+  {
+    return -1;
+  }
+
+  *count = value;
+
+  return 0;
+}
+
+static int run_batch(Simulate *simulate, int64_t max_cycles)
+{
+  struct timeval start, end;
+
+  gettimeofday(&start, NULL);
+
+  int ret = simulate->run(max_cycles, 0);
+
+  gettimeofday(&end, NULL);
+
+  double seconds =
+    (end.tv_sec - start.tv_sec) + ((end.tv_usec - start.tv_usec) / 1000000.0);
+  uint64_t instructions = simulate->get_instruction_count();
+
+  printf("\n");
+  printf("      Cycles: %" PRIu64 "\n", simulate->get_cycles());
+  printf("Instructions: %" PRIu64 "\n", instructions);
+  printf("   Wall time: %.3f seconds\n", seconds);
+
+  if (seconds > 0)
+  {
+    printf("        MIPS: %.2f\n", (double)instructions / seconds / 1000000);
+    printf("         MHz: %.2f\n",
+      (double)simulate->get_cycles() / seconds / 1000000);
+  }
+
+  uint64_t packets = simulate->get_packet_count();
+
+  if (packets != 0)
+  {
+    printf("     Packets: %" PRIu64 "\n", packets);
+
+    if (seconds > 0)
+    {
+      printf(" Packets/sec: %.0f\n", (double)packets / seconds);
+    }
+  }
+
+  if (ret != 0) { return BATCH_EXIT_ERROR; }
+
+  switch (simulate->get_stop_reason())
+  {
+    case SIMULATE_STOP_END:        return BATCH_EXIT_END;
+    case SIMULATE_STOP_BREAKPOINT: return BATCH_EXIT_BREAK_POINT;
+    case SIMULATE_STOP_MAX_CYCLES: return BATCH_EXIT_MAX_CYCLES;
+    case SIMULATE_STOP_ILLEGAL:    return BATCH_EXIT_ERROR;
+    default:                       return BATCH_EXIT_INTERRUPTED;
+  }
+}
+
+static int load_packet(Simulate *simulate, const char *filename)
+{
+  FILE *in = fopen(filename, "rb");
+
+  if (in == NULL)
+  {
+    printf("Error: Cannot open packet file %s.\n", filename);
+    return -1;
+  }
+
+  fseek(in, 0, SEEK_END);
+  long length = ftell(in);
+  fseek(in, 0, SEEK_SET);
+
+  uint8_t *data = (uint8_t *)malloc(length + 1);
+
+  if (data == NULL)
+  {
+    printf("Error: Cannot allocate %ld bytes for packet file %s.\n", length, filename);
+    fclose(in);
+    return -1;
+  }
+
+  if (fread(data, 1, length, in) != (size_t)length)
+  {
+    printf("Error: Cannot read packet file %s.\n", filename);
+    free(data);
+    fclose(in);
+    return -1;
+  }
+
+  fclose(in);
+
+  int ret = simulate->load_packet(data, length);
+
+  free(data);
+
+  if (ret != 0) { return -1; }
+
+  printf("Loaded packet %s (%ld bytes)\n", filename, length);
+
+  return 0;
+}
+
 static void print_help()
 {
   printf("Commands:\n");
@@ -246,12 +395,21 @@ static void print_help()
   printf("  reset                     [ reset program ]\n");
   printf("  display                   [ toggle display cpu info while simulating ]\n");
   printf("  speed <speed in Hz>       [ simulation speed or 0 for single step ]\n");
-  printf("  break <address>           [ break at address ]\n");
+  printf("  break                     [ list break points and watch points ]\n");
+  printf("  break <address> <count>   [ break at address (opt. on hit count) ]\n");
+  printf("  watch <address> <count>   [ break on write to address ]\n");
+  printf("  rwatch <address> <count>  [ break on read from address ]\n");
+  printf("  awatch <address> <count>  [ break on read or write of address ]\n");
+  printf("  delete <address>          [ delete break point (or all if no address) ]\n");
   //printf("  flash                    [ flash device ]\n");
   printf("  info                      [ general info ]\n");
   printf("  disasm                    [ disassemble at address ]\n");
   printf("  disasm <start>-<end>      [ disassemble range of addresses ]\n");
   printf("  symbols                   [ show symbols ]\n");
+  printf("  trace <file>              [ disassemble a trace saved with -trace ]\n");
+  printf("  profile                   [ show hot spots (needs -profile) ]\n");
+  printf("  snapshot                  [ save registers and memory ]\n");
+  printf("  restore                   [ go back to the last snapshot ]\n");
   //printf("  list <start>-<end>       [ disassemble wth debug listing ]\n");
 }
 
@@ -269,6 +427,15 @@ int main(int argc, char *argv[])
   int i;
   int mode = MODE_INTERACTIVE;
   int break_io = -1;
+  int break_point = -1;
+  int64_t max_cycles = -1;
+  int repeat = 1;
+  bool quiet = false;
+  const char *packet_filename = NULL;
+  const char *trace_filename = NULL;
+  int trace_size = 1000000;
+  bool profile = false;
+  const char *callgrind_filename = NULL;
   int error_flag = 0;
   const char *filename = NULL;
   const char *cpu_name = NULL;
@@ -355,6 +522,124 @@ int main(int argc, char *argv[])
        mode = MODE_RUN;
     }
       else
+    if (strcmp(argv[i], "-quiet") == 0)
+    {
+      quiet = true;
+    }
+      else
+    if (strcmp(argv[i], "-max_cycles") == 0)
+    {
+      i++;
+      if (i >= argc)
+      {
+        printf("Error: -max_cycles needs a count\n");
+        exit(1);
+      }
+
+      char *end;
+      errno = 0;
+      max_cycles = strtoll(argv[i], &end, 0);
+
+      if (end == argv[i] || *end != 0 || errno == ERANGE || max_cycles < 0)
+      {
+        printf("Error: Invalid -max_cycles count '%s'\n", argv[i]);
+        exit(1);
+      }
+    }
+      else
+    if (strcmp(argv[i], "-break_point") == 0)
+    {
+      i++;
+      if (i >= argc)
+      {
+        printf("Error: -break_point needs an address\n");
+        exit(1);
+      }
+      break_point = strtol(argv[i], NULL, 0);
+    }
+      else
+    if (strcmp(argv[i], "-packet") == 0)
+    {
+      i++;
+      if (i >= argc)
+      {
+        printf("Error: -packet needs a filename\n");
+        exit(1);
+      }
+      packet_filename = argv[i];
+    }
+      else
+    if (strcmp(argv[i], "-repeat") == 0)
+    {
+      i++;
+      if (i >= argc)
+      {
+        printf("Error: -repeat needs a count\n");
+        exit(1);
+      }
+
+      if (get_count(argv[i], &repeat) != 0)
+      {
+        printf("Error: Invalid -repeat count '%s'\n", argv[i]);
+        exit(1);
+      }
+    }
+      else
+    if (strcmp(argv[i], "-trace") == 0)
+    {
+      i++;
+      if (i >= argc)
+      {
+        printf("Error: -trace needs a filename\n");
+        exit(1);
+      }
+      trace_filename = argv[i];
+    }
+      else
+    if (strcmp(argv[i], "-trace_size") == 0)
+    {
+      i++;
+      if (i >= argc)
+      {
+        printf("Error: -trace_size needs a count\n");
+        exit(1);
+      }
+
+      if (get_count(argv[i], &trace_size) != 0)
+      {
+        printf("Error: Invalid -trace_size count '%s'\n", argv[i]);
+        exit(1);
+      }
+    }
+      else
+    if (strcmp(argv[i], "-decode_trace") == 0)
+    {
+      i++;
+      if (i >= argc)
+      {
+        printf("Error: -decode_trace needs a filename\n");
+        exit(1);
+      }
+      snprintf(command, sizeof(command), "trace %s", argv[i]);
+      mode = MODE_DISASM;
+    }
+      else
+    if (strcmp(argv[i], "-profile") == 0)
+    {
+      profile = true;
+    }
+      else
+    if (strcmp(argv[i], "-profile_callgrind") == 0)
+    {
+      i++;
+      if (i >= argc)
+      {
+        printf("Error: -profile_callgrind needs a filename\n");
+        exit(1);
+      }
+      callgrind_filename = argv[i];
+    }
+      else
     if (argv[i][0] == '-')
     {
       printf("Unknown option %s\n", argv[i]);
@@ -408,15 +693,47 @@ int main(int argc, char *argv[])
 
   util_context.simulate->reset();
 
+  if (packet_filename != NULL)
+  {
+    if (load_packet(util_context.simulate, packet_filename) != 0) { exit(1); }
+  }
+
+  util_context.simulate->set_packet_repeat(repeat);
+
   if (mode == MODE_RUN)
   {
     util_context.simulate->set_delay(1);
     util_context.simulate->enable_show();
     util_context.simulate->enable_auto_run();
+
+    if (quiet) { util_context.simulate->enable_batch_mode(); }
+
+    if (max_cycles != -1)
+    {
+      snprintf(command, sizeof(command), "run %" PRId64, max_cycles);
+    }
+
+    if (break_point != -1)
+    {
+      util_context.simulate->add_break_point(break_point, BREAK_POINT_EXEC, 0);
+    }
   }
 
   util_context.simulate->set_break_io(break_io);
 
+  if (trace_filename != NULL)
+  {
+    if (util_context.simulate->enable_trace(trace_filename, trace_size) != 0)
+    {
+      exit(1);
+    }
+  }
+
+  if (profile == true || callgrind_filename != NULL)
+  {
+    if (util_context.simulate->enable_profile() != 0) { exit(1); }
+  }
+
   if (set_pc != 0xffffffff)
   {
     util_context.simulate->set_pc(set_pc);
@@ -506,10 +823,23 @@ int main(int argc, char *argv[])
         util_context.simulate->enable_step_mode();
       }
 
+      if (util_context.simulate->in_batch_mode())
+      {
+        error_flag = run_batch(
+          util_context.simulate,
+          command[3] == 0 ? -1 : strtoll(command + 4, NULL, 0));
+
+        util_context.simulate->save_trace();
+
+        break;
+      }
+
       int ret = util_context.simulate->run(
-        command[3] == 0 ? -1 : atoi(command + 4),
+        command[3] == 0 ? -1 : strtoll(command + 4, NULL, 0),
         0);
 
+      util_context.simulate->save_trace();
+
       state = state_stopped;
 
       if (util_context.simulate->in_auto_run() && ret != 0)
@@ -556,6 +886,7 @@ int main(int argc, char *argv[])
       util_context.simulate->push(0xffff);
       util_context.simulate->set_reg("r0", num);
       util_context.simulate->run(-1, 0);
+      util_context.simulate->save_trace();
       state = state_stopped;
       continue;
     }
@@ -575,6 +906,29 @@ int main(int argc, char *argv[])
       sim_set_breakpoint(&util_context, command);
     }
       else
+    if (strncmp(command, "watch", 5) == 0)
+    {
+      sim_set_watchpoint(&util_context, command, BREAK_POINT_WRITE);
+    }
+      else
+    if (strncmp(command, "rwatch", 6) == 0)
+    {
+      sim_set_watchpoint(&util_context, command, BREAK_POINT_READ);
+    }
+      else
+    if (strncmp(command, "awatch", 6) == 0)
+    {
+      sim_set_watchpoint(
+        &util_context,
+        command,
+        BREAK_POINT_READ | BREAK_POINT_WRITE);
+    }
+      else
+    if (strncmp(command, "delete", 6) == 0)
+    {
+      sim_delete_breakpoint(&util_context, command);
+    }
+      else
     if (strncmp(command, "push", 4) == 0)
     {
       sim_stack_push(&util_context, command);
@@ -674,6 +1028,35 @@ int main(int argc, char *argv[])
       symbols_print(&util_context.symbols, stdout);
     }
       else
+    if (strcmp(command, "profile") == 0)
+    {
+      util_profile_report(&util_context, 20);
+    }
+      else
+    if (strcmp(command, "snapshot") == 0)
+    {
+      if (util_context.simulate->save_snapshot() == 0)
+      {
+        printf("Snapshot saved.\n");
+      }
+    }
+      else
+    if (strcmp(command, "restore") == 0)
+    {
+      if (util_context.simulate->restore_snapshot() == 0)
+      {
+        printf("Snapshot restored.\n");
+      }
+    }
+      else
+    if (strncmp(command, "trace ", 6) == 0)
+    {
+      if (util_context.simulate->decode_trace(command + 6) != 0)
+      {
+        error_flag = 1;
+      }
+    }
+      else
     if (strncmp(command, "dumpram", 7)  == 0 ||
         strncmp(command, "dump_ram", 8) == 0)
     {
@@ -740,16 +1123,21 @@ int main(int argc, char *argv[])
   if (mode == MODE_RUN)
   {
     util_context.simulate->dump_registers();
+
+    if (profile == true) { util_profile_report(&util_context, 20); }
+
+    if (callgrind_filename != NULL)
+    {
+      util_profile_callgrind(&util_context, callgrind_filename);
+    }
   }
 
   if (src != NULL) { fclose(src); }
 
-  symbols_free(&util_context.symbols);
+  // util_context's destructor frees the symbols and the simulator.
 
-  if (util_context.simulate != NULL)
-  {
-    delete util_context.simulate;
-  }
+  // In batch mode error_flag holds the exit code from run_batch().
+  if (mode == MODE_RUN && quiet) { return error_flag; }
 
   return error_flag == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
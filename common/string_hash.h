@@ -0,0 +1,51 @@
+/**
+ *  naken_asm assembler.
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: https://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2010-2023 by Michael Kohn
+ *
+ */
+
+#ifndef NAKEN_ASM_STRING_HASH_H
+#define NAKEN_ASM_STRING_HASH_H
+
+#include <stdint.h>
+
+// FNV-1a, used for the symbol, macro and mnemonic hash tables.
+#define STRING_HASH_INIT 2166136261u
+
+static inline uint32_t string_hash_add(uint32_t hash, uint32_t value)
+{
+  return (hash ^ value) * 16777619u;
+}
+
+static inline uint32_t string_hash_len(const char *name, int len)
+{
+  uint32_t hash = STRING_HASH_INIT;
+
+  for (int n = 0; n < len; n++)
+  {
+    hash = string_hash_add(hash, (uint8_t)name[n]);
+  }
+
+  return hash;
+}
+
+static inline uint32_t string_hash(const char *name)
+{
+  uint32_t hash = STRING_HASH_INIT;
+
+  while (*name != 0)
+  {
+    hash = string_hash_add(hash, (uint8_t)*name);
+    name++;
+  }
+
+  return hash;
+}
+
+#endif
+
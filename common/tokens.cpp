@@ -23,15 +23,112 @@
 
 //#define assert(a) if (! a) { printf("assert failed on line %s:%d\n", __FILE__, __LINE__); raise(SIGABRT); }
 
+static char *tokens_resolve_path(const char *filename)
+{
+#ifdef _WIN32
+  return _fullpath(NULL, filename, 0);
+#else
+  return realpath(filename, NULL);
+#endif
+}
+
+static SourceFile *tokens_add_file(
+  AsmContext *asm_context,
+  const char *filename)
+{
+  SourceFile *source_file =
+    (SourceFile *)malloc(sizeof(SourceFile) + strlen(filename) + 1);
+
+  strcpy(source_file->filename, filename);
+  source_file->code = NULL;
+  source_file->len = 0;
+  source_file->next = asm_context->tokens.source_files;
+  asm_context->tokens.source_files = source_file;
+
+  return source_file;
+}
+
+static SourceFile *tokens_load_file(
+  AsmContext *asm_context,
+  const char *filename)
+{
+  SourceFile *source_file = asm_context->tokens.source_files;
+
+  while (source_file != NULL)
+  {
+    if (source_file->code == NULL &&
+        strcmp(source_file->filename, filename) == 0)
+    {
+      return source_file;
+    }
+
+    source_file = source_file->next;
+  }
+
+  char *path = tokens_resolve_path(filename);
+
+  if (path == NULL) { return tokens_add_file(asm_context, filename); }
+
+  source_file = asm_context->tokens.source_files;
+
+  while (source_file != NULL)
+  {
+    if (source_file->code != NULL &&
+        strcmp(source_file->filename, path) == 0)
+    {
+      free(path);
+      return source_file;
+    }
+
+    source_file = source_file->next;
+  }
+
+  FILE *in = fopen(path, "rb");
+
+  if (in == NULL)
+  {
+    free(path);
+    return tokens_add_file(asm_context, filename);
+  }
+
+  source_file = tokens_add_file(asm_context, path);
+  free(path);
+
+  int size = 0;
+
+  while (true)
+  {
+    if (source_file->len + 8192 + 1 > size)
+    {
+      size = size == 0 ? 65536 : size * 2;
+      source_file->code = (char *)realloc(source_file->code, size);
+    }
+
+    int len = fread(source_file->code + source_file->len, 1, 8192, in);
+    if (len <= 0) { break; }
+
+    source_file->len += len;
+  }
+
+  source_file->code[source_file->len] = 0;
+
+  fclose(in);
+
+  return source_file;
+}
+
 int tokens_open_file(AsmContext *asm_context, const char *filename)
 {
-  asm_context->tokens.in = fopen(filename, "rb");
+  SourceFile *source_file = tokens_load_file(asm_context, filename);
 
-  if (asm_context->tokens.in == NULL)
+  if (source_file->code == NULL)
   {
     return -1;
   }
 
+  asm_context->tokens.token_buffer.code = source_file->code;
+  asm_context->tokens.token_buffer.ptr = source_file->code;
+  asm_context->tokens.token_buffer.end = source_file->code + source_file->len;
   asm_context->tokens.filename = filename;
 
   return 0;
@@ -40,25 +137,35 @@ int tokens_open_file(AsmContext *asm_context, const char *filename)
 void tokens_open_buffer(AsmContext *asm_context, const char *buffer)
 {
   asm_context->tokens.token_buffer.code = buffer;
-  asm_context->tokens.token_buffer.ptr = 0;
+  asm_context->tokens.token_buffer.ptr = buffer;
+  asm_context->tokens.token_buffer.end = buffer + strlen(buffer);
 }
 
 void tokens_close(AsmContext *asm_context)
 {
-  if (asm_context->tokens.in != NULL)
-  {
-    fclose(asm_context->tokens.in);
-  }
+  asm_context->tokens.token_buffer.code = NULL;
+  asm_context->tokens.token_buffer.ptr = NULL;
+  asm_context->tokens.token_buffer.end = NULL;
 }
 
-void tokens_reset(AsmContext *asm_context)
+void tokens_free(AsmContext *asm_context)
 {
-  if (asm_context->tokens.in != NULL)
+  SourceFile *source_file = asm_context->tokens.source_files;
+
+  while (source_file != NULL)
   {
-    fseek(asm_context->tokens.in, 0, SEEK_SET);
+    SourceFile *next = source_file->next;
+    free(source_file->code);
+    free(source_file);
+    source_file = next;
   }
 
-  asm_context->tokens.token_buffer.ptr = 0;
+  asm_context->tokens.source_files = NULL;
+}
+
+void tokens_reset(AsmContext *asm_context)
+{
+  asm_context->tokens.token_buffer.ptr = asm_context->tokens.token_buffer.code;
 
   asm_context->tokens.line = 1;
   asm_context->tokens.pushback[0] = 0;
@@ -176,8 +283,54 @@ int token_is_not_number(const char *token, int ptr)
   return 1;
 }
 
+// Chars can be taken straight from the source buffer when nothing was
+// ungotten, no macro is being expanded and nothing has to be echoed to
+// the listing file.  Returns the cursor or NULL.
+static inline const char *tokens_direct(AsmContext *asm_context)
+{
+  Tokens *tokens = &asm_context->tokens;
+
+  if (tokens->unget_ptr > tokens->unget_stack[tokens->unget_stack_ptr] ||
+      asm_context->macros.stack_ptr != 0 ||
+      (asm_context->list != NULL && asm_context->write_list_file == 1))
+  {
+    return NULL;
+  }
+
+  return tokens->token_buffer.ptr;
+}
+
+static inline int tokens_read_buffer(TokenBuffer *token_buffer)
+{
+  int ch;
+
+  if (token_buffer->ptr == NULL) { return EOF; }
+
+  // Why do people still use DOS :(
+  do
+  {
+    if (token_buffer->ptr == token_buffer->end) { return EOF; }
+    ch = (uint8_t)*token_buffer->ptr;
+    token_buffer->ptr++;
+  } while (ch == '\r');
+
+  return ch;
+}
+
+static void tokens_skip_to_eol(AsmContext *asm_context)
+{
+  const char *s = tokens_direct(asm_context);
+
+  if (s == NULL) { return; }
+
+  while (*s != '\n' && *s != 0) { s++; }
+
+  asm_context->tokens.token_buffer.ptr = s;
+}
+
 int tokens_get_char(AsmContext *asm_context)
 {
+  Tokens *tokens = &asm_context->tokens;
   int ch;
 
 #ifdef DEBUG
@@ -185,55 +338,40 @@ int tokens_get_char(AsmContext *asm_context)
 #endif
 
   // Check if something need to be ungetted
-  if (asm_context->tokens.unget_ptr > asm_context->tokens.unget_stack[asm_context->tokens.unget_stack_ptr])
+  if (tokens->unget_ptr > tokens->unget_stack[tokens->unget_stack_ptr])
   {
 #ifdef DEBUG
-//printf("debug> tokens_get_char(?) ungetc %d %d '%c'\n", asm_context->tokens.unget_stack_ptr, asm_context->tokens.unget_stack[asm_context->tokens.unget_stack_ptr], asm_context->tokens.unget[asm_context->tokens.unget_ptr - 1]);
+//printf("debug> tokens_get_char(?) ungetc %d %d '%c'\n", tokens->unget_stack_ptr, tokens->unget_stack[tokens->unget_stack_ptr], tokens->unget[tokens->unget_ptr - 1]);
 #endif
-    return asm_context->tokens.unget[--asm_context->tokens.unget_ptr];
+    return tokens->unget[--tokens->unget_ptr];
   }
 
-  ch = macros_get_char(asm_context);
-
-  // Check if defines is empty
-  if (ch == CHAR_EOF)
+  if (asm_context->macros.stack_ptr != 0)
   {
-    if (asm_context->tokens.unget_ptr > asm_context->tokens.unget_stack[asm_context->tokens.unget_stack_ptr])
-    {
-#ifdef DEBUG
-//printf("debug> tokens_get_char(FILE ungetc %d %d '%c'\n", asm_context->tokens.unget_stack_ptr, asm_context->tokens.unget_stack[asm_context->tokens.unget_stack_ptr], asm_context->tokens.unget[asm_context->tokens.unget_ptr - 1]);
-#endif
-      return asm_context->tokens.unget[--asm_context->tokens.unget_ptr];
-    }
+    ch = macros_get_char(asm_context);
+
 #ifdef DEBUG
-//printf("debug> tokens_get_char(FILE)='%c'\n", ch);
+//printf("debug> tokens_get_char(DEFINE)='%c'\n", ch);
 #endif
 
-    // Why do people still use DOS :(
-    do
-    {
-      if (asm_context->tokens.token_buffer.code != NULL)
-      {
-        ch = asm_context->tokens.token_buffer.code[asm_context->tokens.token_buffer.ptr];
-        if (ch == 0) { ch = EOF; }
-        else { asm_context->tokens.token_buffer.ptr++; }
-      }
-        else
-      {
-        ch = getc(asm_context->tokens.in);
-      }
-    } while (ch == '\r');
+    if (ch != CHAR_EOF) { return ch; }
 
-    if (asm_context->list != NULL && asm_context->write_list_file == 1)
+    // Finishing a macro can leave chars to be ungetted.
+    if (tokens->unget_ptr > tokens->unget_stack[tokens->unget_stack_ptr])
     {
-      if (ch != EOF) { putc(ch, asm_context->list); }
+      return tokens->unget[--tokens->unget_ptr];
     }
   }
-    else
-  {
+
+  ch = tokens_read_buffer(&tokens->token_buffer);
+
 #ifdef DEBUG
-//printf("debug> tokens_get_char(DEFINE)='%c'\n", ch);
+//printf("debug> tokens_get_char(FILE)='%c'\n", ch);
 #endif
+
+  if (asm_context->list != NULL && asm_context->write_list_file == 1)
+  {
+    if (ch != EOF) { putc(ch, asm_context->list); }
   }
 
   return ch;
@@ -273,6 +411,38 @@ int tokens_get(AsmContext *asm_context, char *token, int len)
 
   while (1)
   {
+    const char *s = tokens_direct(asm_context);
+
+    // Leading white space and the rest of a name or number can be
+    // copied straight from the source buffer.
+    if (s != NULL)
+    {
+      if (ptr == 0)
+      {
+        while (*s == ' ' || *s == '\t') { s++; }
+      }
+        else
+      if (token_type == TOKEN_STRING)
+      {
+        while (ptr < len - 1 &&
+               ((*s >= 'a' && *s <= 'z') || (*s >= 'A' && *s <= 'Z') ||
+                (*s >= '0' && *s <= '9') || *s == '_'))
+        {
+          token[ptr++] = *s++;
+        }
+      }
+        else
+      if (token_type == TOKEN_NUMBER)
+      {
+        while (ptr < len - 1 && *s >= '0' && *s <= '9')
+        {
+          token[ptr++] = *s++;
+        }
+      }
+
+      asm_context->tokens.token_buffer.ptr = s;
+    }
+
 #ifdef DEBUG
 //printf("debug> tokens_get, grabbing next char ptr=%d\n", ptr);
 #endif
@@ -309,6 +479,8 @@ int tokens_get(AsmContext *asm_context, char *token, int len)
         break;
       }
 
+      tokens_skip_to_eol(asm_context);
+
       while (1)
       {
         ch = tokens_get_char(asm_context);
@@ -550,6 +722,8 @@ int tokens_get(AsmContext *asm_context, char *token, int len)
               else
             if (ch == '/')
             {
+              tokens_skip_to_eol(asm_context);
+
               while (1)
               {
                 ch = tokens_get_char(asm_context);
@@ -25,12 +25,31 @@
 typedef struct _token_buffer
 {
   const char *code;
-  int ptr;
+  // Cursor into code of the next char to read.
+  const char *ptr;
+  // End of the code.  There is always a 0 here, but a file can have 0's
+  // before it too.
+  const char *end;
 } TokenBuffer;
 
+// Every source file (main file and includes) is read into memory once
+// and both passes tokenize it from there.  Files are found by the path
+// that was opened after resolving it with realpath(), so the same file
+// included with different paths is only read once.  Files that couldn't
+// be opened are remembered too (code is NULL) by the name they were
+// looked up with so include path searches don't have to go back to the
+// disk.
+typedef struct _source_file
+{
+  struct _source_file *next;
+  char *code;
+  int len;
+  char filename[];
+} SourceFile;
+
 typedef struct _tokens
 {
-  FILE *in;
+  SourceFile *source_files;
   int line;
   const char *filename;
   TokenBuffer token_buffer;
@@ -47,6 +66,7 @@ typedef struct _tokens
 int tokens_open_file(AsmContext *asm_context, const char *filename);
 void tokens_open_buffer(AsmContext *asm_context, const char *buffer);
 void tokens_close(AsmContext *asm_context);
+void tokens_free(AsmContext *asm_context);
 void tokens_reset(AsmContext *asm_context);
 int tokens_get_char(AsmContext *asm_context);
 int tokens_unget_char(AsmContext *asm_context, int ch);
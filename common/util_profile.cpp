@@ -0,0 +1,343 @@
+/**
+ *  naken_asm assembler.
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: https://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2010-2023 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+
+#include "common/util_profile.h"
+
+struct ProfileFunction
+{
+  const char *name;
+  uint32_t address;
+  uint64_t count;
+  uint64_t cycles;
+};
+
+struct ProfileAddress
+{
+  uint32_t address;
+  uint64_t count;
+  uint64_t cycles;
+  int function;
+};
+
+struct ProfileData
+{
+  // Sorted by address.  The last entry is for code before the first
+  // symbol (or all code when the file had no symbols).
+  ProfileFunction *functions;
+  int function_count;
+
+  // In address order.
+  ProfileAddress *addresses;
+  int address_count;
+
+  uint64_t total_count;
+  uint64_t total_cycles;
+};
+
+static int compare_function_address(const void *a, const void *b)
+{
+  const ProfileFunction *f1 = (const ProfileFunction *)a;
+  const ProfileFunction *f2 = (const ProfileFunction *)b;
+
+  if (f1->address < f2->address) { return -1; }
+  if (f1->address > f2->address) { return 1; }
+
+  return 0;
+}
+
+static int compare_function_cycles(const void *a, const void *b)
+{
+  const ProfileFunction *f1 = (const ProfileFunction *)a;
+  const ProfileFunction *f2 = (const ProfileFunction *)b;
+
+  if (f1->cycles > f2->cycles) { return -1; }
+  if (f1->cycles < f2->cycles) { return 1; }
+
+  return 0;
+}
+
+static int compare_address_cycles(const void *a, const void *b)
+{
+  const ProfileAddress *a1 = (const ProfileAddress *)a;
+  const ProfileAddress *a2 = (const ProfileAddress *)b;
+
+  if (a1->cycles > a2->cycles) { return -1; }
+  if (a1->cycles < a2->cycles) { return 1; }
+  if (a1->address < a2->address) { return -1; }
+  if (a1->address > a2->address) { return 1; }
+
+  return 0;
+}
+
+static int find_function(ProfileData *data, uint32_t address)
+{
+  // The function is the last symbol at or before address.
+  int low = 0;
+  int high = data->function_count - 1;
+  int found = data->function_count;
+
+  while (low <= high)
+  {
+    int mid = (low + high) / 2;
+
+    if (data->functions[mid].address <= address)
+    {
+      found = mid;
+      low = mid + 1;
+    }
+      else
+    {
+      high = mid - 1;
+    }
+  }
+
+  return found;
+}
+
+static int load_functions(UtilContext *util_context, ProfileData *data)
+{
+  SymbolsIter iter;
+  int count = 0;
+
+  memset(&iter, 0, sizeof(iter));
+
+  while (symbols_iterate(&util_context->symbols, &iter) != -1) { count++; }
+
+  // One extra for code that isn't after any symbol.
+  data->functions =
+    (ProfileFunction *)calloc(count + 1, sizeof(ProfileFunction));
+
+  if (data->functions == NULL) { return -1; }
+
+  memset(&iter, 0, sizeof(iter));
+
+  // Local labels would split functions up so only global ones are used.
+  while (symbols_iterate(&util_context->symbols, &iter) != -1)
+  {
+    if (iter.scope != 0) { continue; }
+
+    ProfileFunction *function = &data->functions[data->function_count++];
+
+    function->name = iter.name;
+    function->address = iter.address;
+  }
+
+  qsort(
+    data->functions,
+    data->function_count,
+    sizeof(ProfileFunction),
+    compare_function_address);
+
+  data->functions[data->function_count].name = "<unknown>";
+
+  return 0;
+}
+
+static int load_profile(UtilContext *util_context, ProfileData *data)
+{
+  Profile *profile = util_context->simulate->get_profile();
+
+  memset(data, 0, sizeof(ProfileData));
+
+  if (profile == NULL)
+  {
+    printf("Error: Profiling isn't enabled (run naken_util with -profile).\n");
+    return -1;
+  }
+
+  if (load_functions(util_context, data) != 0) { return -1; }
+
+  ProfileIter iter;
+  int size = 0;
+
+  memset(&iter, 0, sizeof(iter));
+
+  while (profile->iterate(&iter) == 0)
+  {
+    if (data->address_count == size)
+    {
+      size = size == 0 ? 1024 : size * 2;
+
+      data->addresses = (ProfileAddress *)realloc(
+        data->addresses,
+        size * sizeof(ProfileAddress));
+    }
+
+    ProfileAddress *address = &data->addresses[data->address_count++];
+    const int function = find_function(data, iter.address);
+
+    address->address = iter.address;
+    address->count = iter.count;
+    address->cycles = iter.cycles;
+    address->function = function;
+
+    data->functions[function].count += iter.count;
+    data->functions[function].cycles += iter.cycles;
+    data->total_count += iter.count;
+    data->total_cycles += iter.cycles;
+  }
+
+  return 0;
+}
+
+static void free_profile(ProfileData *data)
+{
+  free(data->functions);
+  free(data->addresses);
+}
+
+static double get_percent(ProfileData *data, uint64_t cycles)
+{
+  if (data->total_cycles == 0) { return 0; }
+
+  return (double)cycles * 100 / data->total_cycles;
+}
+
+int util_profile_report(UtilContext *util_context, int max_lines)
+{
+  ProfileData data;
+
+  if (load_profile(util_context, &data) != 0)
+  {
+    free_profile(&data);
+    return -1;
+  }
+
+  printf("\nProfile: %" PRIu64 " instructions, %" PRIu64 " cycles\n",
+    data.total_count,
+    data.total_cycles);
+
+  qsort(
+    data.addresses,
+    data.address_count,
+    sizeof(ProfileAddress),
+    compare_address_cycles);
+
+  printf("\n%-10s %12s %7s %12s  %s\n",
+    "Address", "Cycles", "%", "Count", "Function");
+  printf("---------- ------------ ------- ------------  --------\n");
+
+  for (int n = 0; n < data.address_count && n < max_lines; n++)
+  {
+    ProfileAddress *address = &data.addresses[n];
+    ProfileFunction *function = &data.functions[address->function];
+
+    printf("0x%08x %12" PRIu64 " %6.2f%% %12" PRIu64 "  %s",
+      address->address,
+      address->cycles,
+      get_percent(&data, address->cycles),
+      address->count,
+      function->name);
+
+    if (address->function != data.function_count)
+    {
+      printf("+0x%x", address->address - function->address);
+    }
+
+    printf("\n");
+  }
+
+  // Addresses refer to functions by index so these can only be sorted
+  // once the address report is done.
+  qsort(
+    data.functions,
+    data.function_count + 1,
+    sizeof(ProfileFunction),
+    compare_function_cycles);
+
+  printf("\n%-10s %12s %7s %12s  %s\n",
+    "Address", "Cycles", "%", "Count", "Function");
+  printf("---------- ------------ ------- ------------  --------\n");
+
+  for (int n = 0; n <= data.function_count && n < max_lines; n++)
+  {
+    ProfileFunction *function = &data.functions[n];
+
+    if (function->count == 0) { break; }
+
+    printf("0x%08x %12" PRIu64 " %6.2f%% %12" PRIu64 "  %s\n",
+      function->address,
+      function->cycles,
+      get_percent(&data, function->cycles),
+      function->count,
+      function->name);
+  }
+
+  printf("\n");
+
+  free_profile(&data);
+
+  return 0;
+}
+
+int util_profile_callgrind(UtilContext *util_context, const char *filename)
+{
+  ProfileData data;
+
+  if (load_profile(util_context, &data) != 0)
+  {
+    free_profile(&data);
+    return -1;
+  }
+
+  FILE *out = fopen(filename, "wb");
+
+  if (out == NULL)
+  {
+    printf("Error: Cannot open %s for writing.\n", filename);
+    free_profile(&data);
+    return -1;
+  }
+
+  // Costs are given per instruction address so tools like kcachegrind
+  // can show them next to the disassembly.
+  fprintf(out, "# callgrind format\n");
+  fprintf(out, "version: 1\n");
+  fprintf(out, "creator: naken_util\n");
+  fprintf(out, "cmd: %s\n", util_context->cpu_name);
+  fprintf(out, "positions: instr\n");
+  fprintf(out, "events: Instructions Cycles\n");
+  fprintf(out, "summary: %" PRIu64 " %" PRIu64 "\n",
+    data.total_count,
+    data.total_cycles);
+
+  int function = -1;
+
+  for (int n = 0; n < data.address_count; n++)
+  {
+    ProfileAddress *address = &data.addresses[n];
+
+    if (address->function != function)
+    {
+      function = address->function;
+      fprintf(out, "\nfn=%s\n", data.functions[function].name);
+    }
+
+    fprintf(out, "0x%x %" PRIu64 " %" PRIu64 "\n",
+      address->address,
+      address->count,
+      address->cycles);
+  }
+
+  fclose(out);
+
+  printf("Wrote callgrind profile to %s\n", filename);
+
+  free_profile(&data);
+
+  return 0;
+}
@@ -0,0 +1,21 @@
+/**
+ *  naken_asm assembler.
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: https://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2010-2023 by Michael Kohn
+ *
+ */
+
+#ifndef UTIL_PROFILE_H
+#define UTIL_PROFILE_H
+
+#include "common/UtilContext.h"
+
+int util_profile_report(UtilContext *util_context, int max_lines);
+int util_profile_callgrind(UtilContext *util_context, const char *filename);
+
+#endif
+
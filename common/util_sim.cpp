@@ -24,17 +24,16 @@ void sim_show_info(UtilContext *util_context)
 
   printf("Start address: 0x%04x (%d)\n", start, start);
   printf("  End address: 0x%04x (%d)\n", end, end);
-  printf("  Break Point: ");
+  printf(" Break Points: ");
 
-  if (simulate->is_break_point_set())
+  if (simulate->get_break_point_count() == 0)
   {
     printf("<not set>\n");
   }
     else
   {
-    printf("0x%04x (%d)\n",
-      simulate->get_break_point(),
-      simulate->get_break_point());
+    printf("%d\n", simulate->get_break_point_count());
+    simulate->list_break_points();
   }
 
   printf("  Instr Delay: ");
@@ -161,27 +160,118 @@ int sim_stack_push(UtilContext *util_context, char *command)
   return 0;
 }
 
+static int sim_add_break_point(
+  UtilContext *util_context,
+  const char *token,
+  int type)
+{
+  char name[128];
+  uint32_t address;
+  uint32_t count = 0;
+  int length = 0;
+
+  // The address could be a symbol so it's split from the hit count.
+  while (*token == ' ') { token++; }
+  while (token[length] != ' ' && token[length] != 0) { length++; }
+
+  if (length >= (int)sizeof(name)) { length = sizeof(name) - 1; }
+
+  memcpy(name, token, length);
+  name[length] = 0;
+
+  if (util_get_address(util_context, name, &address) == NULL)
+  {
+    printf("Error: Unknown address '%s'\n", name);
+    return -1;
+  }
+
+  const char *end = token + length;
+
+  while (*end == ' ') { end++; }
+
+  if (*end != 0)
+  {
+    if (util_get_num(end, &count) == NULL)
+    {
+      printf("Error: Unknown hit count '%s'\n", end);
+      return -1;
+    }
+  }
+
+  if (util_context->simulate->add_break_point(address, type, count) != 0)
+  {
+    return -1;
+  }
+
+  if (type == BREAK_POINT_EXEC)
+  {
+    printf("Breakpoint added at 0x%04x", address);
+  }
+    else
+  {
+    printf("Watch point added at 0x%04x", address);
+  }
+
+  if (count > 1) { printf(" stopping on hit %d", count); }
+
+  printf(".\n");
+
+  return 0;
+}
+
 int sim_set_breakpoint(UtilContext *util_context, char *command)
 {
   if (command[5] == 0)
   {
-    printf("Breakpoint removed.\n");
-    util_context->simulate->remove_break_point();
+    util_context->simulate->list_break_points();
+    return 0;
+  }
+
+  return sim_add_break_point(util_context, command + 6, BREAK_POINT_EXEC);
+}
+
+int sim_set_watchpoint(UtilContext *util_context, char *command, int type)
+{
+  // Skip over watch, rwatch or awatch.
+  char *token = command;
+
+  while (*token != ' ' && *token != 0) { token++; }
+
+  if (*token == 0)
+  {
+    printf("Syntax error: %s requires an address\n", command);
+    return -1;
+  }
+
+  return sim_add_break_point(util_context, token + 1, type);
+}
+
+int sim_delete_breakpoint(UtilContext *util_context, char *command)
+{
+  if (command[6] == 0)
+  {
+    util_context->simulate->clear_break_points();
+    printf("All break points deleted.\n");
     return 0;
   }
 
   uint32_t address;
 
-  const char *end = util_get_address(util_context, command + 6, &address);
+  const char *end = util_get_address(util_context, command + 7, &address);
 
   if (end == NULL)
   {
-    printf("Error: Unknown address '%s'\n", command + 6);
+    printf("Error: Unknown address '%s'\n", command + 7);
+    return -1;
+  }
+
+  if (util_context->simulate->delete_break_point(address) != 0)
+  {
+    printf("Error: No break point at 0x%04x\n", address);
     return -1;
   }
 
-  printf("Breakpoint added at 0x%04x.\n", address);
-  util_context->simulate->set_break_point(address);
+  printf("Break point at 0x%04x deleted.\n", address);
 
   return 0;
 }
@@ -0,0 +1,241 @@
+# Generated include file
+# ./configure 
+
+CC=gcc
+CXX=g++
+COMPILER_PREFIX=
+LDFLAGS= -s
+LDFLAGS_UTIL= -lreadline
+CFLAGS=-Wall -DREADLINE -O3
+DFLAGS=-DENABLE_1802 -DENABLE_4004 -DENABLE_6502 -DENABLE_6800 -DENABLE_6809 -DENABLE_65816 -DENABLE_68HC08 -DENABLE_68000 -DENABLE_8008 -DENABLE_8048 -DENABLE_8051 -DENABLE_86000 -DENABLE_ARC -DENABLE_ARM -DENABLE_ARM64 -DENABLE_AVR8 -DENABLE_CELL -DENABLE_COPPER -DENABLE_CP1610 -DENABLE_DOTNET -DENABLE_DSPIC -DENABLE_EBPF -DENABLE_EMOTION_ENGINE -DENABLE_EPIPHANY -DENABLE_JAVA -DENABLE_LC3 -DENABLE_M8C -DENABLE_MIPS -DENABLE_MSP430 -DENABLE_PADAUK -DENABLE_PDP8 -DENABLE_PIC14 -DENABLE_PIC18 -DENABLE_POWERPC -DENABLE_PROPELLER -DENABLE_PROPELLER2 -DENABLE_RISCV -DENABLE_SH4 -DENABLE_SPARC -DENABLE_STM8 -DENABLE_SUPER_FX -DENABLE_SWEET16 -DENABLE_THUMB -DENABLE_TMS340 -DENABLE_TMS1000 -DENABLE_TMS9900 -DENABLE_UNSP -DENABLE_WEBASM -DENABLE_XTENSA -DENABLE_Z80
+INSTALL_BIN=/usr/local/bin
+INSTALL_INCLUDES=/usr/local/share/naken_asm
+INSTALL_PREFIX=/usr/local
+INCLUDE_PATH=/usr/local/share/naken_asm/include
+CONFIG_EXT=
+ASM_OBJS= \
+  asm/1802.o \
+  asm/4004.o \
+  asm/6502.o \
+  asm/65816.o \
+  asm/6800.o \
+  asm/68000.o \
+  asm/6809.o \
+  asm/68hc08.o \
+  asm/8008.o \
+  asm/8048.o \
+  asm/8051.o \
+  asm/86000.o \
+  asm/arc.o \
+  asm/arm.o \
+  asm/arm64.o \
+  asm/avr8.o \
+  asm/cell.o \
+  asm/common.o \
+  asm/copper.o \
+  asm/cp1610.o \
+  asm/dotnet.o \
+  asm/dspic.o \
+  asm/ebpf.o \
+  asm/epiphany.o \
+  asm/java.o \
+  asm/lc3.o \
+  asm/m8c.o \
+  asm/mips.o \
+  asm/msp430.o \
+  asm/pdk13.o \
+  asm/pdk14.o \
+  asm/pdk15.o \
+  asm/pdk16.o \
+  asm/pdk_parse.o \
+  asm/pdp8.o \
+  asm/pic14.o \
+  asm/pic18.o \
+  asm/powerpc.o \
+  asm/propeller.o \
+  asm/propeller2.o \
+  asm/ps2_ee_vu.o \
+  asm/riscv.o \
+  asm/sh4.o \
+  asm/sparc.o \
+  asm/stm8.o \
+  asm/super_fx.o \
+  asm/sweet16.o \
+  asm/thumb.o \
+  asm/tms1000.o \
+  asm/tms340.o \
+  asm/tms9900.o \
+  asm/unsp.o \
+  asm/webasm.o \
+  asm/xtensa.o \
+  asm/z80.o
+DISASM_OBJS= \
+  disasm/1802.o \
+  disasm/4004.o \
+  disasm/6502.o \
+  disasm/65816.o \
+  disasm/6800.o \
+  disasm/68000.o \
+  disasm/6809.o \
+  disasm/68hc08.o \
+  disasm/8008.o \
+  disasm/8048.o \
+  disasm/8051.o \
+  disasm/86000.o \
+  disasm/arc.o \
+  disasm/arm.o \
+  disasm/arm64.o \
+  disasm/avr8.o \
+  disasm/cell.o \
+  disasm/copper.o \
+  disasm/cp1610.o \
+  disasm/dotnet.o \
+  disasm/dspic.o \
+  disasm/ebpf.o \
+  disasm/epiphany.o \
+  disasm/java.o \
+  disasm/lc3.o \
+  disasm/m8c.o \
+  disasm/mips.o \
+  disasm/msp430.o \
+  disasm/pdk13.o \
+  disasm/pdk14.o \
+  disasm/pdk15.o \
+  disasm/pdk16.o \
+  disasm/pdp8.o \
+  disasm/pic14.o \
+  disasm/pic18.o \
+  disasm/powerpc.o \
+  disasm/propeller.o \
+  disasm/propeller2.o \
+  disasm/ps2_ee_vu.o \
+  disasm/riscv.o \
+  disasm/sh4.o \
+  disasm/sparc.o \
+  disasm/stm8.o \
+  disasm/super_fx.o \
+  disasm/sweet16.o \
+  disasm/thumb.o \
+  disasm/tms1000.o \
+  disasm/tms340.o \
+  disasm/tms9900.o \
+  disasm/unsp.o \
+  disasm/webasm.o \
+  disasm/xtensa.o \
+  disasm/z80.o
+TABLE_OBJS= \
+  table/1802.o \
+  table/4004.o \
+  table/6502.o \
+  table/65816.o \
+  table/6800.o \
+  table/68000.o \
+  table/6809.o \
+  table/68hc08.o \
+  table/8008.o \
+  table/8048.o \
+  table/8051.o \
+  table/86000.o \
+  table/arc.o \
+  table/arm.o \
+  table/arm64.o \
+  table/avr8.o \
+  table/cell.o \
+  table/cp1610.o \
+  table/dotnet.o \
+  table/dspic.o \
+  table/ebpf.o \
+  table/epiphany.o \
+  table/java.o \
+  table/lc3.o \
+  table/m8c.o \
+  table/mips.o \
+  table/msp430.o \
+  table/pdk13.o \
+  table/pdk14.o \
+  table/pdk15.o \
+  table/pdk16.o \
+  table/pdp8.o \
+  table/pic14.o \
+  table/pic18.o \
+  table/powerpc.o \
+  table/propeller.o \
+  table/propeller2.o \
+  table/ps2_ee_vu.o \
+  table/riscv.o \
+  table/sh4.o \
+  table/sparc.o \
+  table/stm8.o \
+  table/super_fx.o \
+  table/sweet16.o \
+  table/thumb.o \
+  table/tms1000.o \
+  table/tms340.o \
+  table/tms9900.o \
+  table/unsp.o \
+  table/webasm.o \
+  table/xtensa.o \
+  table/z80.o
+UTIL_OBJS= \
+  common/UtilContext.o \
+  common/util_disasm.o \
+  common/util_profile.o \
+  common/util_sim.o
+COMMON_OBJS= \
+  common/add_bin.o \
+  common/assembler.o \
+  common/cpu_list.o \
+  common/directives.o \
+  common/directives_data.o \
+  common/directives_if.o \
+  common/directives_include.o \
+  common/eval_expression.o \
+  common/eval_expression_ex.o \
+  common/ifdef_expression.o \
+  common/imports_ar.o \
+  common/imports_get_int.o \
+  common/imports_obj.o \
+  common/Linker.o \
+  common/print_error.o \
+  common/macros.o \
+  common/Memory.o \
+  common/MemoryPage.o \
+  common/MemoryPool.o \
+  common/Symbols.o \
+  common/tokens.o \
+  common/Var.o
+SIM_OBJS= \
+  simulate/1802.o \
+  simulate/6502.o \
+  simulate/65816.o \
+  simulate/68000.o \
+  simulate/8008.o \
+  simulate/Profile.o \
+  simulate/Simulate.o \
+  simulate/arm.o \
+  simulate/avr8.o \
+  simulate/ebpf.o \
+  simulate/lc3.o \
+  simulate/mips.o \
+  simulate/msp430.o \
+  simulate/null.o \
+  simulate/riscv.o \
+  simulate/stm8.o \
+  simulate/tms9900.o \
+  simulate/z80.o
+FILEIO_OBJS= \
+  fileio/file.o \
+  fileio/read_amiga.o \
+  fileio/read_bin.o \
+  fileio/read_elf.o \
+  fileio/read_hex.o \
+  fileio/read_srec.o \
+  fileio/read_ti_txt.o \
+  fileio/read_wdc.o \
+  fileio/write_amiga.o \
+  fileio/write_bin.o \
+  fileio/write_elf.o \
+  fileio/write_hex.o \
+  fileio/write_srec.o \
+  fileio/write_wdc.o
+
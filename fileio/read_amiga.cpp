@@ -70,15 +70,19 @@ static long read_hunk_header(FILE *in)
 
 static int read_code(FILE *in, Memory *memory)
 {
-  uint32_t n;
+  uint8_t buffer[8192];
+  uint32_t n = 0;
   uint32_t length = read_int32(in) * 4;
 
-  for (n = 0; n < length; n++)
+  while (n < length)
   {
-    int ch = getc(in);
-    if (ch == EOF) { break; }
+    int count = length - n < sizeof(buffer) ? length - n : sizeof(buffer);
+
+    count = fread(buffer, 1, count, in);
+    if (count <= 0) { break; }
 
-    memory->write8(n, ch);
+    memory->write_block(n, buffer, count);
+    n += count;
   }
 
   return length;
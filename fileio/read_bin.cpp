@@ -18,7 +18,8 @@
 int read_bin(const char *filename, Memory *memory, uint32_t start_address)
 {
   FILE *in;
-  int ch;
+  uint8_t buffer[8192];
+  int len;
   uint32_t address = start_address;
 
   memory->clear();
@@ -30,12 +31,13 @@ int read_bin(const char *filename, Memory *memory, uint32_t start_address)
     return -1;
   }
 
-  while(1)
+  while (true)
   {
-    ch = getc(in);
-    if (ch == EOF) break;
+    len = fread(buffer, 1, sizeof(buffer), in);
+    if (len <= 0) { break; }
 
-    memory->write8(address++, ch);
+    memory->write_block(address, buffer, len);
+    address += len;
   }
 
   fclose(in);
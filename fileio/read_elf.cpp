@@ -473,11 +473,20 @@ int read_elf(
       long marker = ftell(in);
       fseek(in, elf_shdr.sh_offset, SEEK_SET);
 
-      uint32_t i;
-      for (i = 0; i < elf_shdr.sh_size; i++)
+      uint8_t buffer[8192];
+      uint32_t i = 0;
+
+      while (i < elf_shdr.sh_size)
       {
-        //if (elf_shdr.sh_addr + i >= memory->size) { break; }
-        memory->write8(elf_shdr.sh_addr + i, getc(in));
+        int count = elf_shdr.sh_size - i < sizeof(buffer) ?
+          elf_shdr.sh_size - i : sizeof(buffer);
+
+        // Match the old getc() behavior of writing 0xff past EOF.
+        int len = fread(buffer, 1, count, in);
+        if (len < count) { memset(buffer + len, 0xff, count - len); }
+
+        memory->write_block(elf_shdr.sh_addr + i, buffer, count);
+        i += count;
       }
 
       fseek(in, marker, SEEK_SET);
@@ -42,6 +42,7 @@ static int get_hex(FILE *in, int len)
 int read_hex(const char *filename, Memory *memory)
 {
   FILE *in;
+  uint8_t data[256];
   int ch;
   int byte_count;
   int address;
@@ -110,13 +111,15 @@ int read_hex(const char *filename, Memory *memory)
         for (n = 0; n < byte_count; n++)
         {
           ch = get_hex(in, 2);
-          //dirty[address]=1;
-          memory->write8(address++, ch);
+          data[n] = ch;
           checksum_calc += ch;
 #ifdef DEBUG1
           printf(" %02x",ch);
 #endif
         }
+
+        memory->write_block(address, data, byte_count);
+        address += byte_count;
         break;
 
       /* End Of File */
@@ -55,6 +55,7 @@ static void ignore_line(FILE *in)
 int read_srec(const char *filename, Memory *memory)
 {
   FILE *in;
+  uint8_t data[256];
   int ch;
   int byte_count;
   int address;
@@ -153,13 +154,16 @@ int read_srec(const char *filename, Memory *memory)
     for (n = 0; n < byte_count; n++)
     {
       ch = get_hex(in, 2);
-      memory->write8(address++, ch);
+      data[n] = ch;
       checksum_calc += ch;
 #ifdef DEBUG1
       printf(" %02x",ch);
 #endif
     }
 
+    memory->write_block(address, data, byte_count);
+    address += byte_count;
+
 #ifdef DEBUG1
     printf("\n");
 #endif
@@ -32,6 +32,7 @@ int read_int24(FILE *in)
 int read_wdc(const char *filename, Memory *memory)
 {
   FILE *in;
+  uint8_t buffer[8192];
   int ch, n;
   //int address = start_address;
 
@@ -63,18 +64,25 @@ int read_wdc(const char *filename, Memory *memory)
       memory->low_address = address;
     }
 
-    for (n = 0; n < length; n++)
+    n = 0;
+
+    while (n < length)
     {
-      ch = getc(in);
+      int count = length - n < (int)sizeof(buffer) ?
+        length - n : (int)sizeof(buffer);
+
+      count = fread(buffer, 1, count, in);
 
-      if (ch == EOF) { break; }
+      if (count <= 0) { break; }
 
-      if (address > memory->high_address)
+      if (address + count - 1 > memory->high_address)
       {
-        memory->high_address = address;
+        memory->high_address = address + count - 1;
       }
 
-      memory->write8(address++, ch);
+      memory->write_block(address, buffer, count);
+      address += count;
+      n += count;
     }
   }
 
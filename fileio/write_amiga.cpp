@@ -28,7 +28,9 @@ static void write_uint32(FILE *out, uint32_t value)
 
 int write_amiga(Memory *memory, FILE *out)
 {
-  uint32_t n;
+  uint8_t buffer[8192];
+  uint64_t address = memory->low_address;
+  uint64_t end = (uint64_t)memory->high_address + 1;
   uint32_t length = (memory->high_address + 1) - memory->low_address;
 
   // Hunk file header.
@@ -43,9 +45,14 @@ int write_amiga(Memory *memory, FILE *out)
   write_uint32(out, HUNK_CODE);   // hunk_code
   write_uint32(out, length / 4);  // length of code
 
-  for (n = memory->low_address; n <= memory->high_address; n++)
+  while (address < end)
   {
-    putc(memory->read8(n), out);
+    int len = end - address < sizeof(buffer) ? end - address : sizeof(buffer);
+
+    memory->read_block(address, buffer, len);
+    fwrite(buffer, 1, len, out);
+
+    address += len;
   }
 
   // Hunk end.
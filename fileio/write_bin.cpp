@@ -19,11 +19,19 @@
 
 int write_bin(Memory *memory, FILE *out)
 {
-  uint32_t n;
+  uint8_t buffer[8192];
+  uint64_t address = memory->low_address;
+  uint64_t end = (uint64_t)memory->high_address + 1;
 
-  for (n = memory->low_address; n <= memory->high_address; n++)
+  // Unwritten areas between pages come back from read_block() as 0's.
+  while (address < end)
   {
-    putc(memory->read8(n), out);
+    int len = end - address < sizeof(buffer) ? end - address : sizeof(buffer);
+
+    memory->read_block(address, buffer, len);
+    fwrite(buffer, 1, len, out);
+
+    address += len;
   }
 
   return 0;
@@ -326,15 +326,22 @@ static void write_elf_text_and_data(
   int alignment)
 {
   const char *name = ".text";
-  uint32_t i;
+  uint8_t buffer[8192];
+  uint64_t address = memory->low_address;
+  uint64_t end = (uint64_t)memory->high_address + 1;
 
   elf->text_addr = memory->low_address;
   string_table_append(elf, name);
   elf->sections_offset.text = ftell(out);
 
-  for (i = memory->low_address; i <= memory->high_address; i++)
+  while (address < end)
   {
-    putc(memory->read8(i), out);
+    int len = end - address < sizeof(buffer) ? end - address : sizeof(buffer);
+
+    memory->read_block(address, buffer, len);
+    fwrite(buffer, 1, len, out);
+
+    address += len;
   }
 
   if (alignment > 1)
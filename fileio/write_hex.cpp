@@ -68,49 +68,46 @@ static void write_hex_line(
   fprintf(out,"%02X\n", (((checksum & 0xff) ^ 0xff) + 1) & 0xff);
 }
 
-// NOTE: (to self) - This is kind of slowish.  I wonder if it would be
-// better to request pages from the memory module and just dump the memory
-// pages instead of treating it as one big memory thing.
 int write_hex(Memory *memory, FILE *out)
 {
+  MemoryIter iter;
   uint8_t data[16];
   int len;
-  uint32_t n;
-  uint32_t address = 0,segment = 0;
+  uint32_t n, i;
+  uint32_t address = 0, segment = 0;
+  uint32_t next = 0;
 
   len = -1;
 
-  for (n = memory->low_address; n <= memory->high_address; n++)
+  memset(&iter, 0, sizeof(iter));
+
+  while (memory->iterate(&iter) != -1)
   {
-    if (memory->read_debug(n) == DL_EMPTY)
+    for (i = 0; i < iter.length; i++)
     {
-      if (len > 0)
+      n = iter.address + i;
+
+      // Start a new line after a gap or when crossing a 64k segment.
+      if (len > 0 && (n != next || (n & 0x0ffff) == 0))
       {
         write_hex_line(out, address, data, len, &segment);
         len = -1;
       }
 
-      continue;
-    }
-
-    if ((n & 0x0ffff) == 0 && len > 0)
-    {
-      write_hex_line(out, address, data, len, &segment);
-      len = -1;
-    }
-
-    if (len == -1)
-    {
-      address = n;
-      len = 0;
-    }
+      if (len == -1)
+      {
+        address = n;
+        len = 0;
+      }
 
-    data[len++] = memory->read8(n);
+      data[len++] = iter.data[i];
+      next = n + 1;
 
-    if (len == 16)
-    {
-      write_hex_line(out, address, data, len, &segment);
-      len = -1;
+      if (len == 16)
+      {
+        write_hex_line(out, address, data, len, &segment);
+        len = -1;
+      }
     }
   }
 
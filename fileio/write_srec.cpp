@@ -114,9 +114,11 @@ static void write_srec_header(FILE *out)
 
 int write_srec(Memory *memory, FILE *out, int srec_size)
 {
+  MemoryIter iter;
   uint8_t data[LINE_LENGTH];
   uint32_t address = 0;
-  uint32_t n;
+  uint32_t next = 0;
+  uint32_t n, i;
   int len, type;
 
   if (srec_size == SREC_24)
@@ -137,37 +139,35 @@ int write_srec(Memory *memory, FILE *out, int srec_size)
 
   len = -1;
 
-  for (n = memory->low_address; n <= memory->high_address; n++)
+  memset(&iter, 0, sizeof(iter));
+
+  while (memory->iterate(&iter) != -1)
   {
-    if (memory->read_debug(n) == DL_EMPTY)
+    for (i = 0; i < iter.length; i++)
     {
-      if (len > 0)
+      n = iter.address + i;
+
+      // Start a new line after a gap or when crossing a 64k boundary.
+      if (len > 0 && (n != next || (n & 0xffff) == 0))
       {
         write_srec_line(out, type, address, data, len);
         len = -1;
       }
 
-      continue;
-    }
-
-    if ((n & 0xffff) == 0 && len > 0)
-    {
-      write_srec_line(out, type, address, data, len);
-      len = -1;
-    }
-
-    if (len == -1)
-    {
-      address = n;
-      len = 0;
-    }
+      if (len == -1)
+      {
+        address = n;
+        len = 0;
+      }
 
-    data[len++] = memory->read8(n);
+      data[len++] = iter.data[i];
+      next = n + 1;
 
-    if (len == LINE_LENGTH)
-    {
-      write_srec_line(out, type, address, data, len);
-      len = -1;
+      if (len == LINE_LENGTH)
+      {
+        write_srec_line(out, type, address, data, len);
+        len = -1;
+      }
     }
   }
 
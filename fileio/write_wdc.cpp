@@ -28,18 +28,24 @@ int write_int24(FILE *out, int value)
 
 int write_wdc(Memory *memory, FILE *out)
 {
-  uint32_t n;
+  MemoryIter iter;
+  uint32_t n, i;
+  uint32_t next = 0;
   int address = -1;
   int length = 0;
   uint8_t buffer[65536];
 
   putc('Z', out);
 
-  for (n = memory->low_address; n <= memory->high_address; n++)
+  memset(&iter, 0, sizeof(iter));
+
+  while (memory->iterate(&iter) != -1)
   {
-    if (memory->read_debug(n) == DL_EMPTY || length == 65536)
+    for (i = 0; i < iter.length; i++)
     {
-      if (length != 0)
+      n = iter.address + i;
+
+      if (length != 0 && (n != next || length == 65536))
       {
         write_int24(out, address);
         write_int24(out, length);
@@ -48,12 +54,11 @@ int write_wdc(Memory *memory, FILE *out)
         length = 0;
         address = -1;
       }
-    }
-      else
-    {
+
       if (address == -1) { address = n; }
 
-      buffer[length++] = memory->read8(n);
+      buffer[length++] = iter.data[i];
+      next = n + 1;
     }
   }
 
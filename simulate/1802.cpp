@@ -20,13 +20,8 @@
 #include "simulate/1802.h"
 #include "table/1802.h"
 
-#define READ_RAM(a) memory->read8(a)
-#define WRITE_RAM(a, b) \
-  if (a == break_io) \
-  { \
-  exit(b); \
-  } \
-  memory->write8(a, b)
+#define READ_RAM(a) read_ram8(a)
+#define WRITE_RAM(a, b) write_ram8(a, b)
 #define READ_IND(a) READ_RAM(reg_r[a])
 #define WRITE_IND(a, b) WRITE_RAM(reg_r[a], b)
 #define REG(a) reg_r[a]
@@ -57,6 +52,7 @@
 
 Simulate1802::Simulate1802(Memory *memory) : Simulate(memory)
 {
+  enable_flat_ram(16);
   reset();
 }
 
@@ -98,7 +94,6 @@ void Simulate1802::reset()
   FLAG_XIE = 1;
   FLAG_CIL = 0;
   FLAG_Q = 0;
-  break_point = -1;
 }
 
 void Simulate1802::push(uint32_t value)
@@ -233,7 +228,7 @@ void Simulate1802::dump_registers()
     PC);
 
   printf("\n\n");
-  printf("%d clock cycles have passed since last reset.\n\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
 int Simulate1802::dump_ram(int start, int end)
@@ -250,7 +245,7 @@ int Simulate1802::dump_ram(int start, int end)
       printf("%04x:", start + i);
     }
 
-    printf("  %02x", READ_RAM(start + i));
+    printf("  %02x", peek_ram8(start + i));
 
     if (i % 16 == 15)
     {
@@ -263,15 +258,20 @@ int Simulate1802::dump_ram(int start, int end)
   return 0;
 }
 
-int Simulate1802::run(int cycles, int step)
+int Simulate1802::run(int64_t max_cycles, int step)
 {
   char instruction[128];
   char bytes[16];
+  const uint64_t cycles_start = cycle_count;
 
   printf("Running... Press Ctl-C to break.\n");
 
+  stop_reason = SIMULATE_STOP_NONE;
+
   while (stop_running == false)
   {
+    instruction_count++;
+
     int pc = PC;
     int opcode = READ_RAM(pc);
     int ret = operand_exe(opcode);
@@ -279,6 +279,7 @@ int Simulate1802::run(int cycles, int step)
     if (ret == -1)
     {
       printf("Illegal instruction at address 0x%04x\n", pc);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
 
@@ -305,13 +306,13 @@ int Simulate1802::run(int cycles, int step)
         for (i = 0; i < count; i++)
         {
           char temp[4];
-          snprintf(temp, sizeof(temp), "%02x ", READ_RAM(pc + i));
+          snprintf(temp, sizeof(temp), "%02x ", peek_ram8(pc + i));
           strcat(bytes, temp);
         }
 
         if (cycles_min == -1) break;
 
-        if (pc == break_point) { printf("*"); }
+        if (has_break_point(pc)) { printf("*"); }
         else { printf(" "); }
 
         if (n == 0)
@@ -330,9 +331,15 @@ int Simulate1802::run(int cycles, int step)
       }
     }
 
-    if (break_point == PC)
+    if (max_cycles != -1 && (int64_t)(cycle_count - cycles_start) >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    if (break_hit(PC))
     {
-      printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
@@ -341,13 +348,13 @@ int Simulate1802::run(int cycles, int step)
       disable_signal_handler();
       return 0;
     }
-    usleep(usec > 999999 ? 999999 : usec);
+    delay();
   }
 
   disable_signal_handler();
 
   printf("Stopped.  PC=0x%04x.\n", PC);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
@@ -33,7 +33,7 @@ public:
   virtual void set_pc(uint32_t value);
   virtual int dump_ram(int start, int end);
   virtual void dump_registers();
-  virtual int run(int max_cycles, int step);
+  virtual int run(int64_t max_cycles, int step);
 
 private:
   int operand_exe(int opcode);
@@ -20,14 +20,9 @@
 #include "simulate/6502.h"
 #include "table/6502.h"
 
-#define SHOW_STACK 0x100 + sp, memory->read8(0x100 + sp)
-#define READ_RAM(a) memory->read8(a)
-#define WRITE_RAM(a, b) \
-  if (a == break_io) \
-  { \
-    exit(b); \
-  } \
-  memory->write8(a, b)
+#define SHOW_STACK 0x100 + sp, peek_ram8(0x100 + sp)
+#define READ_RAM(a) read_ram8(a)
+#define WRITE_RAM(a, b) write_ram8(a, b)
 
 #define REG_A reg_a
 #define REG_X reg_x
@@ -59,6 +54,8 @@
 
 Simulate6502::Simulate6502(Memory *memory) : Simulate(memory)
 {
+  enable_flat_ram(16);
+  build_handlers();
   reset();
 }
 
@@ -81,7 +78,6 @@ void Simulate6502::reset()
   REG_SR = 0;
   REG_PC = 0;
   REG_SP = 0xFF;
-  break_point = -1;
 }
 
 void Simulate6502::push(uint32_t value)
@@ -174,27 +170,40 @@ void Simulate6502::dump_registers()
   printf(" SR=0x%02x  SP=0x%02x  PC=0x%04x                     0x%03x: 0x%02x\n", REG_SR, REG_SP, REG_PC, SHOW_STACK);
 
   printf("\n\n");
-  printf("%d clock cycles have passed since last reset.\n\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
-int Simulate6502::run(int max_cycles, int step)
+int Simulate6502::run(int64_t max_cycles, int step)
 {
   char instruction[128];
   char bytes[16];
 
+  const uint64_t cycles_start = cycle_count;
+
   printf("Running... Press Ctl-C to break.\n");
 
+  stop_reason = SIMULATE_STOP_NONE;
+
+  // Nothing is shown or delayed in batch mode.
+  if (batch_mode == true && step == 0) { return run_fast(max_cycles); }
+
   while (stop_running == false)
   {
+    instruction_count++;
+
     int pc = REG_PC;
     int cycles_min, cycles_max;
     int opcode = READ_RAM(pc);
+    uint64_t cycles_before = cycle_count;
+
+    trace_instruction(pc);
 
     int ret = operand_exe(opcode);
 
     // stop simulation on BRK instruction
     if (ret == -1)
     {
+      stop_reason = SIMULATE_STOP_END;
       break;
     }
 
@@ -208,6 +217,9 @@ int Simulate6502::run(int max_cycles, int step)
         &cycles_min,
         &cycles_max);
 
+    trace_state();
+    profile_instruction(pc, cycle_count - cycles_before);
+
     if (show == true)
     {
       printf("\x1b[1J\x1b[1;1H");
@@ -230,13 +242,13 @@ int Simulate6502::run(int max_cycles, int step)
         for (i = 0; i < count; i++)
         {
           char temp[4];
-          snprintf(temp, sizeof(temp), "%02x ", READ_RAM(pc + i));
+          snprintf(temp, sizeof(temp), "%02x ", peek_ram8(pc + i));
           strcat(bytes, temp);
         }
 
         if (cycles_min == -1) break;
 
-        if (pc == break_point) { printf("*"); }
+        if (has_break_point(pc)) { printf("*"); }
         else { printf(" "); }
 
         if (n == 0)
@@ -257,9 +269,9 @@ int Simulate6502::run(int max_cycles, int step)
         count--;
         while (count > 0)
         {
-          if (pc == break_point) { printf("*"); }
+          if (has_break_point(pc)) { printf("*"); }
           else { printf(" "); }
-          printf("  0x%04x: 0x%04x\n", pc, READ_RAM(pc));
+          printf("  0x%04x: 0x%04x\n", pc, peek_ram8(pc));
           pc += count;
           count--;
         }
@@ -270,12 +282,19 @@ int Simulate6502::run(int max_cycles, int step)
     if (ret == -1)
     {
       printf("Illegal instruction at address 0x%04x\n", pc);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
 
-    if (break_point == REG_PC)
+    if (max_cycles != -1 && (int64_t)(cycle_count - cycles_start) >= max_cycles)
     {
-      printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    if (break_hit(REG_PC))
+    {
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
@@ -287,7 +306,8 @@ int Simulate6502::run(int max_cycles, int step)
 
     if (REG_PC == 0xFFFF)
     {
-      printf("Function ended.  Total cycles: %d\n", cycle_count);
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
       step_mode = 0;
       REG_PC = READ_RAM(0xFFFC) + READ_RAM(0xFFFD) * 256;
 
@@ -295,18 +315,71 @@ int Simulate6502::run(int max_cycles, int step)
       return 0;
     }
 
-    usleep(usec > 999999 ? 999999 : usec);
+    delay();
   }
 
   disable_signal_handler();
 
   printf("Stopped.  PC=0x%04x.\n", REG_PC);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
 
 // Return calculated address for each mode.
+int Simulate6502::disassemble(
+  Memory *memory,
+  uint32_t address,
+  char *instruction,
+  int length)
+{
+  int cycles_min, cycles_max;
+
+  return disasm_6502(
+    memory,
+    address,
+    instruction,
+    length,
+    &cycles_min,
+    &cycles_max);
+}
+
+const char *Simulate6502::get_trace_reg_name(int index)
+{
+  const char *names[] = { "a", "x", "y", "sr", "sp" };
+
+  if (index < 0 || index >= (int)(sizeof(names) / sizeof(char *)))
+  {
+    return "?";
+  }
+
+  return names[index];
+}
+
+void Simulate6502::save_state(uint8_t *state)
+{
+  int *regs = (int *)state;
+
+  regs[0] = reg_a;
+  regs[1] = reg_x;
+  regs[2] = reg_y;
+  regs[3] = reg_sr;
+  regs[4] = reg_pc;
+  regs[5] = reg_sp;
+}
+
+void Simulate6502::load_state(const uint8_t *state)
+{
+  const int *regs = (const int *)state;
+
+  reg_a = regs[0];
+  reg_x = regs[1];
+  reg_y = regs[2];
+  reg_sr = regs[3];
+  reg_pc = regs[4];
+  reg_sp = regs[5];
+}
+
 int Simulate6502::calc_address(int address, int mode)
 {
   int lo = READ_RAM(address);
@@ -326,7 +399,7 @@ int Simulate6502::calc_address(int address, int mode)
     case OP_INDEXED8_X:
       return (lo + REG_X) & 0xFF;
     case OP_INDEXED8_Y:
-      return (lo + REG_Y) & 0xFFFF;
+      return (lo + REG_Y) & 0xFF;
     case OP_INDEXED16_X:
       return ((lo | (hi << 8)) + REG_X) & 0xFFFF;
     case OP_INDEXED16_Y:
@@ -335,7 +408,7 @@ int Simulate6502::calc_address(int address, int mode)
       indirect = (lo | (hi << 8)) & 0xFFFF;
       return (READ_RAM(indirect) | ((READ_RAM((indirect + 1) & 0xFFFF) << 8) & 0xFFFF));
     case OP_X_INDIRECT8:
-      indirect = ((READ_RAM(lo + REG_X)) & 0xFF) | (READ_RAM((lo + 1 + REG_X) & 0xFF) << 8);
+      indirect = READ_RAM((lo + REG_X) & 0xFF) | (READ_RAM((lo + 1 + REG_X) & 0xFF) << 8);
       return (indirect) & 0xFFFF;
     case OP_INDIRECT8_Y:
       indirect = READ_RAM(lo) | (READ_RAM((lo + 1) & 0xFF) << 8);
@@ -364,7 +437,6 @@ int Simulate6502::operand_exe(int opcode)
   int m = READ_RAM(address);
   int temp;
   int pc_lo, pc_hi;
-  int temp_a = REG_A;
 
   CYCLE_COUNT += table_6502_opcodes[opcode].cycles_min;
 
@@ -380,29 +452,7 @@ int Simulate6502::operand_exe(int opcode)
     case 0x75:
     case 0x79:
     case 0x7D:
-      if (READ_FLAG(flag_d))
-      {
-        int bcd_a = (REG_A & 15) + 10 * (REG_A >> 4);
-        int bcd_m = (m & 15) + 10 * (m >> 4);
-        int result = bcd_a + bcd_m + READ_FLAG(flag_c);
-
-        FLAG(result > 99, flag_c);
-        result %= 100;
-
-        REG_A = (result % 10) + ((result / 10) << 4);
-      }
-        else
-      {
-        REG_A += m + READ_FLAG(flag_c);
-
-        FLAG(REG_A > 255, flag_c);
-      }
-
-      REG_A &= 0xFF;
-      FLAG((temp_a ^ REG_A) & (m ^ REG_A) & 0x80, flag_v);
-      FLAG(REG_A > 127, flag_n);
-      FLAG(REG_A == 0, flag_z);
-
+      adc(m);
       break;
     // AND
     case 0x21:
@@ -425,19 +475,11 @@ int Simulate6502::operand_exe(int opcode)
     case 0x1E:
       if (mode == OP_NONE)
       {
-        FLAG(READ_BIT(REG_A, 7), flag_c);
-        REG_A <<= 1;
-        REG_A &= 0xFF;
-        FLAG(REG_A > 127, flag_n);
-        FLAG(REG_A == 0, flag_z);
+        REG_A = asl(REG_A);
       }
         else
       {
-        FLAG(READ_BIT(m, 7), flag_c);
-        m <<= 1;
-        m &= 0xFF;
-        FLAG(m > 127, flag_n);
-        FLAG(m == 0, flag_z);
+        m = asl(m);
         WRITE_RAM(address, m);
       }
       break;
@@ -541,31 +583,19 @@ int Simulate6502::operand_exe(int opcode)
     case 0xD5:
     case 0xD9:
     case 0xDD:
-      temp = (REG_A - m);
-      FLAG(temp >= 0, flag_c);
-      temp &= 0xFF;
-      FLAG(temp > 127, flag_n);
-      FLAG(temp == 0, flag_z);
+      compare(REG_A, m);
       break;
     // CPX
     case 0xE0:
     case 0xE4:
     case 0xEC:
-      temp = (REG_X - m);
-      FLAG(temp >= 0, flag_c);
-      temp &= 0xFF;
-      FLAG(temp > 127, flag_n);
-      FLAG(temp == 0, flag_z);
+      compare(REG_X, m);
       break;
     // CPY
     case 0xC0:
     case 0xC4:
     case 0xCC:
-      temp = (REG_Y - m);
-      FLAG(temp >= 0, flag_c);
-      temp &= 0xFF;
-      FLAG(temp > 127, flag_n);
-      FLAG(temp == 0, flag_z);
+      compare(REG_Y, m);
       break;
     // DEC
     case 0xC6:
@@ -621,8 +651,8 @@ int Simulate6502::operand_exe(int opcode)
     // INY
     case 0xC8:
       REG_Y = (REG_Y + 1) & 0xFF;
-      FLAG(REG_X > 127, flag_n);
-      FLAG(REG_X == 0, flag_z);
+      FLAG(REG_Y > 127, flag_n);
+      FLAG(REG_Y == 0, flag_z);
       break;
     // JMP
     case 0x4C:
@@ -680,19 +710,11 @@ int Simulate6502::operand_exe(int opcode)
     case 0x5E:
       if (mode == OP_NONE)
       {
-        FLAG(READ_BIT(REG_A, 0), flag_c);
-        REG_A >>= 1;
-        CLEAR_BIT(REG_A, 7);
-        FLAG(REG_A > 127, flag_n);
-        FLAG(REG_A == 0, flag_z);
+        REG_A = lsr(REG_A);
       }
         else
       {
-        FLAG(READ_BIT(m, 0), flag_c);
-        m >>= 1;
-        CLEAR_BIT(m, 7);
-        FLAG(m > 127, flag_n);
-        FLAG(m == 0, flag_z);
+        m = lsr(m);
         WRITE_RAM(address, m);
       }
       break;
@@ -729,6 +751,8 @@ int Simulate6502::operand_exe(int opcode)
       REG_SP++;
       REG_SP &= 0xFF;
       REG_A = READ_RAM(0x100 + REG_SP);
+      FLAG(REG_A > 127, flag_n);
+      FLAG(REG_A == 0, flag_z);
       break;
     // PLP
     case 0x28:
@@ -744,23 +768,11 @@ int Simulate6502::operand_exe(int opcode)
     case 0x3E:
       if (mode == OP_NONE)
       {
-        temp = READ_FLAG(flag_c);
-        FLAG(READ_BIT(REG_A, 7), flag_c);
-        REG_A <<= 1;
-        REG_A |= temp;
-        REG_A &= 0xFF;
-        FLAG(REG_A > 127, flag_n);
-        FLAG(REG_A == 0, flag_z);
+        REG_A = rol(REG_A);
       }
         else
       {
-        temp = READ_FLAG(flag_c);
-        FLAG(READ_BIT(m, 7), flag_c);
-        m <<= 1;
-        m |= temp;
-        m &= 0xFF;
-        FLAG(m > 127, flag_n);
-        FLAG(m == 0, flag_z);
+        m = rol(m);
         WRITE_RAM(address, m);
       }
       break;
@@ -772,21 +784,11 @@ int Simulate6502::operand_exe(int opcode)
     case 0x7E:
       if (mode == OP_NONE)
       {
-        temp = READ_BIT(REG_A, 0);
-        REG_A >>= 1;
-        REG_A |= READ_FLAG(flag_c) << 7;
-        FLAG(temp, flag_c);
-        FLAG(REG_A > 127, flag_n);
-        FLAG(REG_A == 0, flag_z);
+        REG_A = ror(REG_A);
       }
         else
       {
-        temp = READ_BIT(m, 0);
-        m >>= 1;
-        m |= READ_FLAG(flag_c) << 7;
-        FLAG(temp, flag_c);
-        FLAG(m > 127, flag_n);
-        FLAG(m == 0, flag_z);
+        m = ror(m);
         WRITE_RAM(address, m);
       }
       break;
@@ -824,30 +826,7 @@ int Simulate6502::operand_exe(int opcode)
     case 0xF5:
     case 0xF9:
     case 0xFD:
-      if (READ_FLAG(flag_d))
-      {
-        int bcd_a = (REG_A & 15) + 10 * (REG_A >> 4);
-        int bcd_m = (m & 15) + 10 * (m >> 4);
-        int result = bcd_a - bcd_m - (1 - READ_FLAG(flag_c));
-
-        // clear carry if < 0
-        FLAG(result >= 0, flag_c);
-        result %= 100;
-
-        REG_A = (result % 10) + ((result / 10) << 4);
-      }
-        else
-      {
-        REG_A -= m - (1 - READ_FLAG(flag_c));
-
-        FLAG(REG_A >= 0, flag_c);
-      }
-
-      REG_A &= 0xFF;
-      FLAG((temp_a ^ REG_A) & (m ^ REG_A) & 0x80, flag_v);
-      FLAG(REG_A > 127, flag_n);
-      FLAG(REG_A == 0, flag_z);
-
+      sbc(m);
       break;
     // SEC
     case 0x38:
@@ -887,19 +866,19 @@ int Simulate6502::operand_exe(int opcode)
     case 0xAA:
       REG_X = REG_A;
       FLAG(REG_X == 0, flag_z);
-      FLAG(m > 127, flag_n);
+      FLAG(REG_X > 127, flag_n);
       break;
     // TAY
     case 0xA8:
       REG_Y = REG_A;
       FLAG(REG_Y == 0, flag_z);
-      FLAG(m > 127, flag_n);
+      FLAG(REG_Y > 127, flag_n);
       break;
     // TSX
     case 0xBA:
       REG_X = REG_SP;
       FLAG(REG_X == 0, flag_z);
-      FLAG(m > 127, flag_n);
+      FLAG(REG_X > 127, flag_n);
       break;
     // TXA
     case 0x8A:
@@ -922,3 +901,589 @@ int Simulate6502::operand_exe(int opcode)
   return 0;
 }
 
+void Simulate6502::adc(int m)
+{
+  const int temp_a = REG_A;
+
+  if (READ_FLAG(flag_d))
+  {
+    int bcd_a = (REG_A & 15) + 10 * (REG_A >> 4);
+    int bcd_m = (m & 15) + 10 * (m >> 4);
+    int result = bcd_a + bcd_m + READ_FLAG(flag_c);
+
+    FLAG(result > 99, flag_c);
+    result %= 100;
+
+    REG_A = (result % 10) + ((result / 10) << 4);
+  }
+    else
+  {
+    REG_A += m + READ_FLAG(flag_c);
+
+    FLAG(REG_A > 255, flag_c);
+  }
+
+  REG_A &= 0xFF;
+  FLAG((temp_a ^ REG_A) & (m ^ REG_A) & 0x80, flag_v);
+  FLAG(REG_A > 127, flag_n);
+  FLAG(REG_A == 0, flag_z);
+}
+
+void Simulate6502::sbc(int m)
+{
+  const int temp_a = REG_A;
+
+  if (READ_FLAG(flag_d))
+  {
+    int bcd_a = (REG_A & 15) + 10 * (REG_A >> 4);
+    int bcd_m = (m & 15) + 10 * (m >> 4);
+    int result = bcd_a - bcd_m - (1 - READ_FLAG(flag_c));
+
+    // clear carry if < 0
+    FLAG(result >= 0, flag_c);
+    if (result < 0) { result += 100; }
+
+    REG_A = (result % 10) + ((result / 10) << 4);
+  }
+    else
+  {
+    REG_A -= m + (1 - READ_FLAG(flag_c));
+
+    FLAG(REG_A >= 0, flag_c);
+  }
+
+  REG_A &= 0xFF;
+  FLAG((temp_a ^ REG_A) & (temp_a ^ m) & 0x80, flag_v);
+  FLAG(REG_A > 127, flag_n);
+  FLAG(REG_A == 0, flag_z);
+}
+
+void Simulate6502::compare(int value, int m)
+{
+  int temp = value - m;
+
+  FLAG(temp >= 0, flag_c);
+  temp &= 0xFF;
+  FLAG(temp > 127, flag_n);
+  FLAG(temp == 0, flag_z);
+}
+
+int Simulate6502::asl(int m)
+{
+  FLAG(READ_BIT(m, 7), flag_c);
+  m = (m << 1) & 0xFF;
+  FLAG(m > 127, flag_n);
+  FLAG(m == 0, flag_z);
+
+  return m;
+}
+
+int Simulate6502::lsr(int m)
+{
+  FLAG(READ_BIT(m, 0), flag_c);
+  m >>= 1;
+  FLAG(m > 127, flag_n);
+  FLAG(m == 0, flag_z);
+
+  return m;
+}
+
+int Simulate6502::rol(int m)
+{
+  int temp = READ_FLAG(flag_c);
+
+  FLAG(READ_BIT(m, 7), flag_c);
+  m = ((m << 1) | temp) & 0xFF;
+  FLAG(m > 127, flag_n);
+  FLAG(m == 0, flag_z);
+
+  return m;
+}
+
+int Simulate6502::ror(int m)
+{
+  int temp = READ_BIT(m, 0);
+
+  m = (m >> 1) | (READ_FLAG(flag_c) << 7);
+  FLAG(temp, flag_c);
+  FLAG(m > 127, flag_n);
+  FLAG(m == 0, flag_z);
+
+  return m;
+}
+
+// Instruction length for each addressing mode up to OP_RELATIVE.
+static const int mode_length[] = { 1, 2, 2, 3, 2, 2, 3, 3, 3, 2, 2, 2, 3, 2 };
+
+int Simulate6502::run_fast(int64_t max_cycles)
+{
+  const uint64_t cycles_start = cycle_count;
+
+  REG_PC &= 0xFFFF;
+
+  while (stop_running == false && stop_reason == SIMULATE_STOP_NONE)
+  {
+    // Come back out to check for Ctrl-C every so often.
+    for (int n = 0; n < 0x10000; n++)
+    {
+      const int pc = REG_PC;
+      const int opcode = read_ram8(pc);
+      const uint64_t cycles_before = cycle_count;
+
+      trace_instruction(pc);
+
+      instruction_count++;
+      CYCLE_COUNT += table_6502_opcodes[opcode].cycles_min;
+
+      // stop simulation on BRK instruction
+      if ((this->*handlers[opcode])() == -1)
+      {
+        stop_reason = SIMULATE_STOP_END;
+        break;
+      }
+
+      trace_state();
+      profile_instruction(pc, cycle_count - cycles_before);
+
+      if (max_cycles != -1 && (int64_t)(cycle_count - cycles_start) >= max_cycles)
+      {
+        stop_reason = SIMULATE_STOP_MAX_CYCLES;
+        break;
+      }
+
+      if (break_hit(REG_PC))
+      {
+        stop_reason = SIMULATE_STOP_BREAKPOINT;
+        break;
+      }
+
+      if (REG_PC == 0xFFFF)
+      {
+        printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+        stop_reason = SIMULATE_STOP_END;
+        step_mode = 0;
+        REG_PC = READ_RAM(0xFFFC) + READ_RAM(0xFFFD) * 256;
+
+        disable_signal_handler();
+        return 0;
+      }
+    }
+  }
+
+  disable_signal_handler();
+
+  printf("Stopped.  PC=0x%04x.\n", REG_PC);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
+
+  return 0;
+}
+
+#define HANDLER(instr) \
+  case instr: handlers[n] = get_handler<instr>(mode); break;
+
+void Simulate6502::build_handlers()
+{
+  for (int n = 0; n < 256; n++)
+  {
+    const int mode = table_6502_opcodes[n].op;
+
+    switch (table_6502_opcodes[n].instr)
+    {
+      HANDLER(M65XX_ADC)
+      HANDLER(M65XX_AND)
+      HANDLER(M65XX_ASL)
+      HANDLER(M65XX_BCC)
+      HANDLER(M65XX_BCS)
+      HANDLER(M65XX_BEQ)
+      HANDLER(M65XX_BIT)
+      HANDLER(M65XX_BMI)
+      HANDLER(M65XX_BNE)
+      HANDLER(M65XX_BPL)
+      HANDLER(M65XX_BVC)
+      HANDLER(M65XX_BVS)
+      HANDLER(M65XX_CLC)
+      HANDLER(M65XX_CLD)
+      HANDLER(M65XX_CLI)
+      HANDLER(M65XX_CLV)
+      HANDLER(M65XX_CMP)
+      HANDLER(M65XX_CPX)
+      HANDLER(M65XX_CPY)
+      HANDLER(M65XX_DEC)
+      HANDLER(M65XX_DEX)
+      HANDLER(M65XX_DEY)
+      HANDLER(M65XX_EOR)
+      HANDLER(M65XX_INC)
+      HANDLER(M65XX_INX)
+      HANDLER(M65XX_INY)
+      HANDLER(M65XX_JMP)
+      HANDLER(M65XX_JSR)
+      HANDLER(M65XX_LDA)
+      HANDLER(M65XX_LDX)
+      HANDLER(M65XX_LDY)
+      HANDLER(M65XX_LSR)
+      HANDLER(M65XX_ORA)
+      HANDLER(M65XX_PHA)
+      HANDLER(M65XX_PHP)
+      HANDLER(M65XX_PLA)
+      HANDLER(M65XX_PLP)
+      HANDLER(M65XX_ROL)
+      HANDLER(M65XX_ROR)
+      HANDLER(M65XX_RTI)
+      HANDLER(M65XX_RTS)
+      HANDLER(M65XX_SBC)
+      HANDLER(M65XX_SEC)
+      HANDLER(M65XX_SED)
+      HANDLER(M65XX_SEI)
+      HANDLER(M65XX_STA)
+      HANDLER(M65XX_STX)
+      HANDLER(M65XX_STY)
+      HANDLER(M65XX_TAX)
+      HANDLER(M65XX_TAY)
+      HANDLER(M65XX_TSX)
+      HANDLER(M65XX_TXA)
+      HANDLER(M65XX_TXS)
+      HANDLER(M65XX_TYA)
+      case M65XX_BRK:
+      case M65XX_ERROR:
+        handlers[n] = &Simulate6502::execute_stop;
+        break;
+      default:
+        // 65C02 instructions aren't simulated and run as a NOP.
+        handlers[n] = get_handler<M65XX_NOP>(mode);
+        break;
+    }
+  }
+}
+
+template<int INSTR>
+Simulate6502::Handler Simulate6502::get_handler(int mode)
+{
+  switch (mode)
+  {
+    case OP_NONE:        return &Simulate6502::execute<INSTR, OP_NONE>;
+    case OP_IMMEDIATE:   return &Simulate6502::execute<INSTR, OP_IMMEDIATE>;
+    case OP_ADDRESS8:    return &Simulate6502::execute<INSTR, OP_ADDRESS8>;
+    case OP_ADDRESS16:   return &Simulate6502::execute<INSTR, OP_ADDRESS16>;
+    case OP_INDEXED8_X:  return &Simulate6502::execute<INSTR, OP_INDEXED8_X>;
+    case OP_INDEXED8_Y:  return &Simulate6502::execute<INSTR, OP_INDEXED8_Y>;
+    case OP_INDEXED16_X: return &Simulate6502::execute<INSTR, OP_INDEXED16_X>;
+    case OP_INDEXED16_Y: return &Simulate6502::execute<INSTR, OP_INDEXED16_Y>;
+    case OP_INDIRECT16:  return &Simulate6502::execute<INSTR, OP_INDIRECT16>;
+    case OP_X_INDIRECT8: return &Simulate6502::execute<INSTR, OP_X_INDIRECT8>;
+    case OP_INDIRECT8_Y: return &Simulate6502::execute<INSTR, OP_INDIRECT8_Y>;
+    case OP_RELATIVE:    return &Simulate6502::execute<INSTR, OP_RELATIVE>;
+    default:
+      // Same as calc_address() not knowing the mode.
+      return &Simulate6502::execute_stop;
+  }
+}
+
+// Same as calc_address(REG_PC + 1, MODE) with the mode known at compile
+// time.  Reads go through read_ram8() so watch points and I/O see the
+// same accesses as they do with calc_address().
+template<int MODE>
+inline int Simulate6502::get_address()
+{
+  const int lo = read_ram8((REG_PC + 1) & 0xFFFF);
+  const int hi = read_ram8((REG_PC + 2) & 0xFFFF);
+  int indirect;
+
+  switch (MODE)
+  {
+    case OP_NONE:
+    case OP_IMMEDIATE:
+      return (REG_PC + 1) & 0xFFFF;
+    case OP_ADDRESS8:
+      return lo;
+    case OP_ADDRESS16:
+      return lo | (hi << 8);
+    case OP_INDEXED8_X:
+      return (lo + REG_X) & 0xFF;
+    case OP_INDEXED8_Y:
+      return (lo + REG_Y) & 0xFF;
+    case OP_INDEXED16_X:
+      return ((lo | (hi << 8)) + REG_X) & 0xFFFF;
+    case OP_INDEXED16_Y:
+      return ((lo | (hi << 8)) + REG_Y) & 0xFFFF;
+    case OP_INDIRECT16:
+      indirect = lo | (hi << 8);
+      return read_ram8(indirect) | (read_ram8((indirect + 1) & 0xFFFF) << 8);
+    case OP_X_INDIRECT8:
+      return read_ram8((lo + REG_X) & 0xFF) | (read_ram8((lo + 1 + REG_X) & 0xFF) << 8);
+    case OP_INDIRECT8_Y:
+      indirect = read_ram8(lo) | (read_ram8((lo + 1) & 0xFF) << 8);
+      return (indirect + REG_Y) & 0xFFFF;
+    case OP_RELATIVE:
+      return (REG_PC + 2 + (int8_t)lo) & 0xFFFF;
+    default:
+      return -1;
+  }
+}
+
+inline void Simulate6502::push_byte(int value)
+{
+  write_ram8(0x100 + REG_SP, value & 0xFF);
+  REG_SP = (REG_SP - 1) & 0xFF;
+}
+
+inline void Simulate6502::trace_state()
+{
+  if (trace == NULL) { return; }
+
+  const uint32_t regs[] =
+  {
+    (uint32_t)REG_A,
+    (uint32_t)REG_X,
+    (uint32_t)REG_Y,
+    (uint32_t)REG_SR,
+    (uint32_t)REG_SP
+  };
+
+  trace_registers(regs, 5);
+}
+
+inline int Simulate6502::pull_byte()
+{
+  REG_SP = (REG_SP + 1) & 0xFF;
+
+  return read_ram8(0x100 + REG_SP);
+}
+
+// Each instantiation is one opcode: INSTR and MODE are constants so the
+// switch and the address calculation fold away.
+template<int INSTR, int MODE>
+int Simulate6502::execute()
+{
+  const int address = get_address<MODE>();
+  int next_pc = (REG_PC + mode_length[MODE]) & 0xFFFF;
+  int temp;
+
+  switch (INSTR)
+  {
+    case M65XX_ADC:
+      adc(read_ram8(address));
+      break;
+    case M65XX_AND:
+      REG_A &= read_ram8(address);
+      FLAG(REG_A > 127, flag_n);
+      FLAG(REG_A == 0, flag_z);
+      break;
+    case M65XX_ASL:
+      if (MODE == OP_NONE) { REG_A = asl(REG_A); }
+      else { write_ram8(address, asl(read_ram8(address))); }
+      break;
+    case M65XX_BCC:
+      if (READ_FLAG(flag_c) == 0) { next_pc = address; }
+      break;
+    case M65XX_BCS:
+      if (READ_FLAG(flag_c) == 1) { next_pc = address; }
+      break;
+    case M65XX_BEQ:
+      if (READ_FLAG(flag_z) == 1) { next_pc = address; }
+      break;
+    case M65XX_BMI:
+      if (READ_FLAG(flag_n) == 1) { next_pc = address; }
+      break;
+    case M65XX_BNE:
+      if (READ_FLAG(flag_z) == 0) { next_pc = address; }
+      break;
+    case M65XX_BPL:
+      if (READ_FLAG(flag_n) == 0) { next_pc = address; }
+      break;
+    case M65XX_BVC:
+      if (READ_FLAG(flag_v) == 0) { next_pc = address; }
+      break;
+    case M65XX_BVS:
+      if (READ_FLAG(flag_v) == 1) { next_pc = address; }
+      break;
+    case M65XX_BIT:
+      temp = read_ram8(address);
+      FLAG((REG_A & temp) == 0, flag_z);
+      FLAG(READ_BIT(temp, 6), flag_v);
+      FLAG(READ_BIT(temp, 7), flag_n);
+      break;
+    case M65XX_CLC:
+      CLEAR_FLAG(flag_c);
+      break;
+    case M65XX_CLD:
+      CLEAR_FLAG(flag_d);
+      break;
+    case M65XX_CLI:
+      CLEAR_FLAG(flag_i);
+      break;
+    case M65XX_CLV:
+      CLEAR_FLAG(flag_v);
+      break;
+    case M65XX_CMP:
+      compare(REG_A, read_ram8(address));
+      break;
+    case M65XX_CPX:
+      compare(REG_X, read_ram8(address));
+      break;
+    case M65XX_CPY:
+      compare(REG_Y, read_ram8(address));
+      break;
+    case M65XX_DEC:
+      temp = (read_ram8(address) - 1) & 0xFF;
+      write_ram8(address, temp);
+      FLAG(temp > 127, flag_n);
+      FLAG(temp == 0, flag_z);
+      break;
+    case M65XX_DEX:
+      REG_X = (REG_X - 1) & 0xFF;
+      FLAG(REG_X > 127, flag_n);
+      FLAG(REG_X == 0, flag_z);
+      break;
+    case M65XX_DEY:
+      REG_Y = (REG_Y - 1) & 0xFF;
+      FLAG(REG_Y > 127, flag_n);
+      FLAG(REG_Y == 0, flag_z);
+      break;
+    case M65XX_EOR:
+      REG_A ^= read_ram8(address);
+      FLAG(REG_A > 127, flag_n);
+      FLAG(REG_A == 0, flag_z);
+      break;
+    case M65XX_INC:
+      temp = (read_ram8(address) + 1) & 0xFF;
+      write_ram8(address, temp);
+      FLAG(temp > 127, flag_n);
+      FLAG(temp == 0, flag_z);
+      break;
+    case M65XX_INX:
+      REG_X = (REG_X + 1) & 0xFF;
+      FLAG(REG_X > 127, flag_n);
+      FLAG(REG_X == 0, flag_z);
+      break;
+    case M65XX_INY:
+      REG_Y = (REG_Y + 1) & 0xFF;
+      FLAG(REG_Y > 127, flag_n);
+      FLAG(REG_Y == 0, flag_z);
+      break;
+    case M65XX_JMP:
+      next_pc = address;
+      break;
+    case M65XX_JSR:
+      push_byte((REG_PC + 2) >> 8);
+      push_byte(REG_PC + 2);
+      next_pc = address;
+      break;
+    case M65XX_LDA:
+      REG_A = read_ram8(address);
+      FLAG(REG_A > 127, flag_n);
+      FLAG(REG_A == 0, flag_z);
+      break;
+    case M65XX_LDX:
+      REG_X = read_ram8(address);
+      FLAG(REG_X > 127, flag_n);
+      FLAG(REG_X == 0, flag_z);
+      break;
+    case M65XX_LDY:
+      REG_Y = read_ram8(address);
+      FLAG(REG_Y > 127, flag_n);
+      FLAG(REG_Y == 0, flag_z);
+      break;
+    case M65XX_LSR:
+      if (MODE == OP_NONE) { REG_A = lsr(REG_A); }
+      else { write_ram8(address, lsr(read_ram8(address))); }
+      break;
+    case M65XX_ORA:
+      REG_A |= read_ram8(address);
+      FLAG(REG_A > 127, flag_n);
+      FLAG(REG_A == 0, flag_z);
+      break;
+    case M65XX_PHA:
+      push_byte(REG_A);
+      break;
+    case M65XX_PHP:
+      push_byte(REG_SR);
+      break;
+    case M65XX_PLA:
+      REG_A = pull_byte();
+      FLAG(REG_A > 127, flag_n);
+      FLAG(REG_A == 0, flag_z);
+      break;
+    case M65XX_PLP:
+      REG_SR = pull_byte();
+      break;
+    case M65XX_ROL:
+      if (MODE == OP_NONE) { REG_A = rol(REG_A); }
+      else { write_ram8(address, rol(read_ram8(address))); }
+      break;
+    case M65XX_ROR:
+      if (MODE == OP_NONE) { REG_A = ror(REG_A); }
+      else { write_ram8(address, ror(read_ram8(address))); }
+      break;
+    case M65XX_RTI:
+      REG_SR = pull_byte();
+      temp = pull_byte();
+      next_pc = ((temp | (pull_byte() << 8)) + 1) & 0xFFFF;
+      break;
+    case M65XX_RTS:
+      temp = pull_byte();
+      next_pc = ((temp | (pull_byte() << 8)) + 1) & 0xFFFF;
+      break;
+    case M65XX_SBC:
+      sbc(read_ram8(address));
+      break;
+    case M65XX_SEC:
+      SET_FLAG(flag_c);
+      break;
+    case M65XX_SED:
+      SET_FLAG(flag_d);
+      break;
+    case M65XX_SEI:
+      SET_FLAG(flag_i);
+      break;
+    case M65XX_STA:
+      write_ram8(address, REG_A);
+      break;
+    case M65XX_STX:
+      write_ram8(address, REG_X);
+      break;
+    case M65XX_STY:
+      write_ram8(address, REG_Y);
+      break;
+    case M65XX_TAX:
+      REG_X = REG_A;
+      FLAG(REG_X > 127, flag_n);
+      FLAG(REG_X == 0, flag_z);
+      break;
+    case M65XX_TAY:
+      REG_Y = REG_A;
+      FLAG(REG_Y > 127, flag_n);
+      FLAG(REG_Y == 0, flag_z);
+      break;
+    case M65XX_TSX:
+      REG_X = REG_SP;
+      FLAG(REG_X > 127, flag_n);
+      FLAG(REG_X == 0, flag_z);
+      break;
+    case M65XX_TXA:
+      REG_A = REG_X;
+      FLAG(REG_A > 127, flag_n);
+      FLAG(REG_A == 0, flag_z);
+      break;
+    case M65XX_TXS:
+      REG_SP = REG_X;
+      break;
+    case M65XX_TYA:
+      REG_A = REG_Y;
+      FLAG(REG_A > 127, flag_n);
+      FLAG(REG_A == 0, flag_z);
+      break;
+    default:
+      break;
+  }
+
+  REG_PC = next_pc;
+
+  return 0;
+}
+
+// BRK, opcodes that don't exist and addressing modes that aren't
+// simulated all stop the simulation.
+int Simulate6502::execute_stop()
+{
+  return -1;
+}
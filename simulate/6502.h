@@ -32,14 +32,50 @@ public:
   virtual uint32_t get_reg(const char *reg_string);
   virtual void set_pc(uint32_t value);
   virtual void dump_registers();
-  virtual int run(int max_cycles, int step);
+  virtual int run(int64_t max_cycles, int step);
+  virtual bool can_trace() { return true; }
+  virtual bool can_profile() { return true; }
+  virtual bool can_snapshot() { return true; }
+  virtual int disassemble(
+    Memory *memory,
+    uint32_t address,
+    char *instruction,
+    int length);
+  virtual const char *get_trace_reg_name(int index);
 
 private:
+  typedef int (Simulate6502::*Handler)();
+
   int calc_address(int address, int mode);
   int operand_exe(int opcode);
 
+  // Batch mode runs each opcode through a handler built for its
+  // instruction and addressing mode that works on RAM directly.
+  int run_fast(int64_t max_cycles);
+  void build_handlers();
+  template<int INSTR> static Handler get_handler(int mode);
+  template<int INSTR, int MODE> int execute();
+  template<int MODE> int get_address();
+  int execute_stop();
+
+  void adc(int m);
+  void sbc(int m);
+  void compare(int value, int m);
+  int asl(int m);
+  int lsr(int m);
+  int rol(int m);
+  int ror(int m);
+  void push_byte(int value);
+  int pull_byte();
+  void trace_state();
+  virtual int get_state_length() { return sizeof(int) * 6; }
+  virtual void save_state(uint8_t *state);
+  virtual void load_state(const uint8_t *state);
+
   // Define registers and anything 6502 specific here
   int reg_a, reg_x, reg_y, reg_sr, reg_pc, reg_sp;
+
+  Handler handlers[256];
 };
 
 #endif
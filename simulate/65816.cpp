@@ -22,7 +22,9 @@
 
 #define SHOW_STACK sp, memory->read8(sp)
 #define READ_RAM(a) memory->read8(a)
-#define WRITE_RAM(a, b) memory->write8(a, b)
+#define WRITE_RAM(a, b) \
+  watch_access(a, BREAK_POINT_WRITE); \
+  memory->write8(a, b)
 
 #define REG_A reg_a
 #define REG_X reg_x
@@ -73,7 +75,6 @@ void Simulate65816::reset()
 {
   cycle_count = 0;
   nested_call_count = 0;
-  break_point = -1;
 
   REG_A = 0;
   REG_X = 0;
@@ -180,17 +181,23 @@ void Simulate65816::dump_registers()
   printf(" DB=0x%02x     PB=0x%02x                             0x%04x: 0x%04x\n", REG_DB, REG_PB, SHOW_STACK);
 
   printf("\n\n");
-  printf("%d clock cycles have passed since last reset.\n\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
-int Simulate65816::run(int max_cycles, int step)
+int Simulate65816::run(int64_t max_cycles, int step)
 {
   char instruction[128];
 
+  const uint64_t cycles_start = cycle_count;
+
   printf("Running... Press Ctl-C to break.\n");
 
+  stop_reason = SIMULATE_STOP_NONE;
+
   while (stop_running == false)
   {
+    instruction_count++;
+
     int pc = REG_PC;
     int cycles_min, cycles_max;
     int opcode = READ_RAM(pc);
@@ -199,7 +206,10 @@ int Simulate65816::run(int max_cycles, int step)
 
     // stop simulation on BRK instruction
     if (ret == -1)
+    {
+      stop_reason = SIMULATE_STOP_END;
       break;
+    }
 
     // only increment if REG_PC not touched
     if (ret == 0)
@@ -233,7 +243,7 @@ int Simulate65816::run(int max_cycles, int step)
 
         if (cycles_min == -1) break;
 
-        if (pc == break_point) { printf("*"); }
+        if (has_break_point(pc)) { printf("*"); }
         else { printf(" "); }
 
         if (n == 0)
@@ -250,7 +260,7 @@ int Simulate65816::run(int max_cycles, int step)
         count--;
         while (count > 0)
         {
-          if (pc == break_point) { printf("*"); }
+          if (has_break_point(pc)) { printf("*"); }
           else { printf(" "); }
           printf("  0x%04x: 0x%04x\n", pc, READ_RAM(pc));
           pc += count;
@@ -262,12 +272,19 @@ int Simulate65816::run(int max_cycles, int step)
     if (ret == -1)
     {
       printf("Illegal instruction at address 0x%04x\n", pc);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
 
-    if (break_point == REG_PC)
+    if (max_cycles != -1 && (int64_t)(cycle_count - cycles_start) >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    if (break_hit(REG_PC))
     {
-      printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
@@ -279,7 +296,8 @@ int Simulate65816::run(int max_cycles, int step)
 
     if (REG_PC == 0xFFFF)
     {
-      printf("Function ended.  Total cycles: %d\n", cycle_count);
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
       step_mode = 0;
       REG_PC = READ_RAM(0xFFFC) + READ_RAM(0xFFFD) * 256;
 
@@ -287,13 +305,13 @@ int Simulate65816::run(int max_cycles, int step)
       return 0;
     }
 
-    usleep(usec > 999999 ? 999999 : usec);
+    delay();
   }
 
   disable_signal_handler();
 
   printf("Stopped.  PC=0x%04x.\n", REG_PC);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
@@ -32,7 +32,7 @@ public:
   virtual uint32_t get_reg(const char *reg_string);
   virtual void set_pc(uint32_t value);
   virtual void dump_registers();
-  virtual int run(int max_cycles, int step);
+  virtual int run(int64_t max_cycles, int step);
 
 private:
   int calc_address(int address, int mode);
@@ -0,0 +1,2126 @@
+/**
+ *  naken_asm assembler.
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: https://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2010-2023 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "simulate/68000.h"
+#include "disasm/68000.h"
+
+// Effective address modes.  Mode 7 is split up by its register field
+// so every mode is its own template instance.
+enum
+{
+  EA_DN,
+  EA_AN,
+  EA_AN_INDIRECT,
+  EA_AN_POST,
+  EA_AN_PRE,
+  EA_AN_D16,
+  EA_AN_INDEX,
+  EA_ABS_W,
+  EA_ABS_L,
+  EA_PC_D16,
+  EA_PC_INDEX,
+  EA_IMMEDIATE,
+  EA_INVALID,
+};
+
+// Bit n is set if mode n can be used.
+#define EA_ALL 0x0fff
+#define EA_DATA 0x0ffd
+#define EA_MEMORY_ALTERABLE 0x01fc
+#define EA_DATA_ALTERABLE 0x01fd
+#define EA_ALTERABLE 0x01ff
+#define EA_CONTROL 0x07e4
+#define EA_MOVEM_TO_MEMORY 0x01f4
+#define EA_MOVEM_TO_REGS 0x07ec
+
+enum
+{
+  M68000_ILLEGAL,
+  M68000_LINE_A,
+  M68000_LINE_F,
+  M68000_ADD_TO_DN,
+  M68000_SUB_TO_DN,
+  M68000_AND_TO_DN,
+  M68000_OR_TO_DN,
+  M68000_CMP,
+  M68000_ADD_TO_EA,
+  M68000_SUB_TO_EA,
+  M68000_AND_TO_EA,
+  M68000_OR_TO_EA,
+  M68000_EOR,
+  M68000_ADDA,
+  M68000_SUBA,
+  M68000_CMPA,
+  M68000_ADDI,
+  M68000_SUBI,
+  M68000_ANDI,
+  M68000_ORI,
+  M68000_EORI,
+  M68000_CMPI,
+  M68000_ADDQ,
+  M68000_SUBQ,
+  M68000_CLR,
+  M68000_NEG,
+  M68000_NEGX,
+  M68000_NOT,
+  M68000_TST,
+  M68000_BTST_REG,
+  M68000_BCHG_REG,
+  M68000_BCLR_REG,
+  M68000_BSET_REG,
+  M68000_BTST_IMM,
+  M68000_BCHG_IMM,
+  M68000_BCLR_IMM,
+  M68000_BSET_IMM,
+  M68000_SHIFT_MEMORY,
+  M68000_MULU,
+  M68000_MULS,
+  M68000_DIVU,
+  M68000_DIVS,
+  M68000_CHK,
+  M68000_LEA,
+  M68000_PEA,
+  M68000_JMP,
+  M68000_JSR,
+  M68000_SCC,
+  M68000_NBCD,
+  M68000_TAS,
+  M68000_MOVE_FROM_SR,
+  M68000_MOVE_TO_CCR,
+  M68000_MOVE_TO_SR,
+  M68000_MOVEM_TO_MEMORY,
+  M68000_MOVEM_TO_REGS,
+  M68000_SHIFT_REG,
+  M68000_MOVEQ,
+  M68000_BRA,
+  M68000_BSR,
+  M68000_BCC,
+  M68000_DBCC,
+  M68000_SWAP,
+  M68000_EXT_W,
+  M68000_EXT_L,
+  M68000_LINK,
+  M68000_UNLK,
+  M68000_MOVE_TO_USP,
+  M68000_MOVE_FROM_USP,
+  M68000_RESET,
+  M68000_NOP,
+  M68000_STOP,
+  M68000_RTE,
+  M68000_RTS,
+  M68000_TRAPV,
+  M68000_RTR,
+  M68000_TRAP,
+  M68000_ABCD_REG,
+  M68000_ABCD_MEMORY,
+  M68000_SBCD_REG,
+  M68000_SBCD_MEMORY,
+  M68000_ADDX_REG,
+  M68000_ADDX_MEMORY,
+  M68000_SUBX_REG,
+  M68000_SUBX_MEMORY,
+  M68000_CMPM,
+  M68000_EXG_DD,
+  M68000_EXG_AA,
+  M68000_EXG_DA,
+  M68000_MOVEP_TO_REG,
+  M68000_MOVEP_TO_MEMORY,
+  M68000_ANDI_CCR,
+  M68000_ORI_CCR,
+  M68000_EORI_CCR,
+  M68000_ANDI_SR,
+  M68000_ORI_SR,
+  M68000_EORI_SR,
+};
+
+// Shift types from bits 9 and 10 (memory) or 3 and 4 (register).
+enum
+{
+  SHIFT_AS,
+  SHIFT_LS,
+  SHIFT_ROX,
+  SHIFT_RO,
+};
+
+// Cycles to calculate each effective address for a byte or word.  A
+// long takes 4 more for the modes that access memory.
+static const int ea_cycles[] = { 0, 0, 4, 4, 6, 8, 10, 8, 12, 8, 10, 4, 0 };
+
+// lea, pea, jmp and jsr take the time for their control mode.
+static const int lea_cycles[] = { 0, 0, 4, 0, 0, 8, 12, 8, 12, 8, 12, 0, 0 };
+static const int jmp_cycles[] = { 0, 0, 8, 0, 0, 10, 14, 10, 12, 10, 14, 0, 0 };
+
+// movem takes these plus 4 cycles per word or 8 per long moved.
+static const int movem_to_memory_cycles[] = { 0, 0, 8, 0, 8, 12, 14, 12, 16, 0, 0, 0, 0 };
+static const int movem_to_regs_cycles[] = { 0, 0, 12, 12, 0, 16, 18, 16, 20, 16, 18, 0, 0 };
+
+template<int MODE, int SIZE>
+static inline int ea_time()
+{
+  return ea_cycles[MODE] + (SIZE == 4 && MODE >= EA_AN_INDIRECT ? 4 : 0);
+}
+
+template<int SIZE>
+static inline uint32_t size_mask()
+{
+  return SIZE == 1 ? 0xff : (SIZE == 2 ? 0xffff : 0xffffffff);
+}
+
+template<int SIZE>
+static inline uint32_t sign_bit()
+{
+  return SIZE == 1 ? 0x80 : (SIZE == 2 ? 0x8000 : 0x80000000);
+}
+
+static int get_ea_mode(uint16_t opcode)
+{
+  const int mode = (opcode >> 3) & 0x7;
+  const int index = opcode & 0x7;
+
+  if (mode < 7) { return mode; }
+
+  return index <= 4 ? EA_ABS_W + index : EA_INVALID;
+}
+
+#define EA_HANDLERS(function, ...) \
+  { \
+    &Simulate68000::function<__VA_ARGS__, EA_DN>, \
+    &Simulate68000::function<__VA_ARGS__, EA_AN>, \
+    &Simulate68000::function<__VA_ARGS__, EA_AN_INDIRECT>, \
+    &Simulate68000::function<__VA_ARGS__, EA_AN_POST>, \
+    &Simulate68000::function<__VA_ARGS__, EA_AN_PRE>, \
+    &Simulate68000::function<__VA_ARGS__, EA_AN_D16>, \
+    &Simulate68000::function<__VA_ARGS__, EA_AN_INDEX>, \
+    &Simulate68000::function<__VA_ARGS__, EA_ABS_W>, \
+    &Simulate68000::function<__VA_ARGS__, EA_ABS_L>, \
+    &Simulate68000::function<__VA_ARGS__, EA_PC_D16>, \
+    &Simulate68000::function<__VA_ARGS__, EA_PC_INDEX>, \
+    &Simulate68000::function<__VA_ARGS__, EA_IMMEDIATE>, \
+  }
+
+Simulate68000::Handler Simulate68000::handlers[65536];
+uint16_t Simulate68000::condition_table[16];
+
+Simulate68000::Simulate68000(Memory *memory) : Simulate(memory)
+{
+  if (handlers[0] == NULL)
+  {
+    for (int n = 0; n < 65536; n++) { handlers[n] = decode(n); }
+
+    // Bit n of condition_table[cond] is set if cond passes when NZVC
+    // (the low 4 bits of SR) is n.
+    for (int flags = 0; flags < 16; flags++)
+    {
+      const bool n = (flags & M68000_SR_N) != 0;
+      const bool z = (flags & M68000_SR_Z) != 0;
+      const bool v = (flags & M68000_SR_V) != 0;
+      const bool c = (flags & M68000_SR_C) != 0;
+
+      const bool passed[16] =
+      {
+        true, false, !c && !z, c || z, !c, c, !z, z,
+        !v, v, !n, n, n == v, n != v, !z && n == v, z || n != v
+      };
+
+      for (int cond = 0; cond < 16; cond++)
+      {
+        if (passed[cond]) { condition_table[cond] |= 1 << flags; }
+      }
+    }
+  }
+
+  reset();
+}
+
+Simulate68000::~Simulate68000()
+{
+}
+
+Simulate *Simulate68000::init(Memory *memory)
+{
+  return new Simulate68000(memory);
+}
+
+void Simulate68000::reset()
+{
+  memset(reg, 0, sizeof(reg));
+  other_sp = 0;
+  sr = M68000_SR_S | M68000_SR_I;
+  halted = false;
+
+  // A program at address 0 starting with a vector table (a Genesis ROM
+  // for example) is started the way the CPU would: the stack pointer
+  // and PC come from the first two vectors.  Otherwise the program is
+  // run as a function and returning from it ends the simulation.
+  if (memory->low_address == 0 && memory->read32(4) != 0)
+  {
+    reg[15] = memory->read32(0);
+    pc = memory->read32(4);
+    return_sp = 0xffffffff;
+  }
+    else
+  {
+    pc = memory->low_address;
+    reg[15] = M68000_STACK_TOP;
+    return_sp = M68000_STACK_TOP;
+  }
+
+  cycle_count = 0;
+}
+
+void Simulate68000::push(uint32_t value)
+{
+  push32(value);
+}
+
+int Simulate68000::set_reg(const char *reg_string, uint32_t value)
+{
+  while (*reg_string == ' ') { reg_string++; }
+
+  if (strcmp(reg_string, "pc") == 0) { set_pc(value); return 0; }
+  if (strcmp(reg_string, "sr") == 0) { set_sr(value); return 0; }
+  if (strcmp(reg_string, "sp") == 0) { reg[15] = value; return 0; }
+
+  if (strcmp(reg_string, "ccr") == 0)
+  {
+    sr = (sr & 0xff00) | (value & 0x1f);
+    return 0;
+  }
+
+  if (strcmp(reg_string, "usp") == 0)
+  {
+    if ((sr & M68000_SR_S) != 0) { other_sp = value; }
+    else { reg[15] = value; }
+    return 0;
+  }
+
+  if (strcmp(reg_string, "ssp") == 0)
+  {
+    if ((sr & M68000_SR_S) != 0) { reg[15] = value; }
+    else { other_sp = value; }
+    return 0;
+  }
+
+  if ((reg_string[0] == 'd' || reg_string[0] == 'a') &&
+       reg_string[1] >= '0' && reg_string[1] <= '7' &&
+       reg_string[2] == 0)
+  {
+    int index = (reg_string[1] - '0') + (reg_string[0] == 'a' ? 8 : 0);
+
+    reg[index] = value;
+    return 0;
+  }
+
+  return -1;
+}
+
+uint32_t Simulate68000::get_reg(const char *reg_string)
+{
+  while (*reg_string == ' ') { reg_string++; }
+
+  if (strcmp(reg_string, "pc") == 0) { return pc; }
+  if (strcmp(reg_string, "sr") == 0) { return sr; }
+  if (strcmp(reg_string, "ccr") == 0) { return sr & 0x1f; }
+  if (strcmp(reg_string, "sp") == 0) { return reg[15]; }
+
+  if (strcmp(reg_string, "usp") == 0)
+  {
+    return (sr & M68000_SR_S) != 0 ? other_sp : reg[15];
+  }
+
+  if (strcmp(reg_string, "ssp") == 0)
+  {
+    return (sr & M68000_SR_S) != 0 ? reg[15] : other_sp;
+  }
+
+  if ((reg_string[0] == 'd' || reg_string[0] == 'a') &&
+       reg_string[1] >= '0' && reg_string[1] <= '7' &&
+       reg_string[2] == 0)
+  {
+    return reg[(reg_string[1] - '0') + (reg_string[0] == 'a' ? 8 : 0)];
+  }
+
+  return 0;
+}
+
+void Simulate68000::set_pc(uint32_t value)
+{
+  pc = value;
+}
+
+void Simulate68000::dump_registers()
+{
+  int n;
+
+  printf("\nSimulation Register Dump\n");
+  printf("-------------------------------------------------------------------\n");
+  printf(" PC: 0x%08x  SR: 0x%04x %c%c%d %c%c%c%c%c  USP: 0x%08x  SSP: 0x%08x\n",
+    pc,
+    sr,
+    (sr & M68000_SR_T) != 0 ? 'T' : '-',
+    (sr & M68000_SR_S) != 0 ? 'S' : '-',
+    (sr & M68000_SR_I) >> 8,
+    (sr & M68000_SR_X) != 0 ? 'X' : '-',
+    (sr & M68000_SR_N) != 0 ? 'N' : '-',
+    (sr & M68000_SR_Z) != 0 ? 'Z' : '-',
+    (sr & M68000_SR_V) != 0 ? 'V' : '-',
+    (sr & M68000_SR_C) != 0 ? 'C' : '-',
+    (sr & M68000_SR_S) != 0 ? other_sp : reg[15],
+    (sr & M68000_SR_S) != 0 ? reg[15] : other_sp);
+
+  for (n = 0; n < 16; n++)
+  {
+    printf("%c %c%d: 0x%08x",
+      (n & 0x3) == 0 ? '\n' : ' ',
+      n < 8 ? 'd' : 'a',
+      n & 0x7,
+      reg[n]);
+  }
+
+  printf("\n\n");
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
+}
+
+int Simulate68000::run(int64_t max_cycles, int step)
+{
+  int64_t cycles = 0;
+
+  printf("Running... Press Ctl-C to break.\n");
+
+  stop_reason = SIMULATE_STOP_NONE;
+  halted = false;
+
+  while (stop_running == false)
+  {
+    uint32_t current_pc = pc;
+
+    if (max_cycles != -1 && cycles >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    // Outside of batch mode instructions are run one at a time so each
+    // can be shown or delayed.  Break points and watch points are
+    // checked after every instruction.
+    int count = 1;
+    uint64_t end_cycles = UINT64_MAX;
+
+    if (batch_mode == true && step == false && break_point_count == 0)
+    {
+      count = 4096;
+
+      // Instructions take a varying number of cycles, so the batch also
+      // has to stop once max_cycles have run.
+      if (max_cycles != -1) { end_cycles = cycle_count + (max_cycles - cycles); }
+    }
+
+    const uint64_t start_cycles = cycle_count;
+
+    if (execute_instructions(count, end_cycles) == -1)
+    {
+      stop_reason = SIMULATE_STOP_ILLEGAL;
+      disable_signal_handler();
+      return -1;
+    }
+
+    cycles += cycle_count - start_cycles;
+
+    if (show == true)
+    {
+      printf("\x1b[1J\x1b[1;1H");
+      dump_registers();
+      show_instructions(current_pc);
+    }
+
+    if (halted == true)
+    {
+      printf("Halted at 0x%08x.  Total cycles: %" PRIu64 "\n", pc, cycle_count);
+      stop_reason = SIMULATE_STOP_END;
+      disable_signal_handler();
+      return 0;
+    }
+
+    if (pc == M68000_RETURN_ADDRESS)
+    {
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
+      step_mode = false;
+      disable_signal_handler();
+      return 0;
+    }
+
+    if (break_hit(pc))
+    {
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
+      break;
+    }
+
+    if (usec == 0 || step == true)
+    {
+      disable_signal_handler();
+      return 0;
+    }
+
+    delay();
+  }
+
+  disable_signal_handler();
+
+  printf("Stopped.  PC=0x%08x.\n", pc);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
+
+  return 0;
+}
+
+// Runs up to count instructions, stopping early once cycle_count reaches
+// end_cycles.  Returns -1 if an instruction with no handler stopped the
+// simulation.
+int Simulate68000::execute_instructions(int count, uint64_t end_cycles)
+{
+  for (int n = 0; n < count; n++)
+  {
+    instruction_pc = pc;
+
+    const uint16_t opcode = fetch16();
+    const int cycles = (this->*handlers[opcode])(opcode);
+
+    if (cycles == -1) { return -1; }
+
+    cycle_count += cycles;
+    instruction_count++;
+
+    if (halted == true || pc == M68000_RETURN_ADDRESS) { break; }
+    if (cycle_count >= end_cycles) { break; }
+  }
+
+  return 0;
+}
+
+template<int OP>
+Simulate68000::Handler Simulate68000::get_handler(int size)
+{
+  switch (size)
+  {
+    case 0: return &Simulate68000::execute<OP, 1, EA_DN>;
+    case 1: return &Simulate68000::execute<OP, 2, EA_DN>;
+    case 2: return &Simulate68000::execute<OP, 4, EA_DN>;
+    default: return &Simulate68000::execute<M68000_ILLEGAL, 0, EA_DN>;
+  }
+}
+
+template<int OP, int SIZE>
+Simulate68000::Handler Simulate68000::get_ea_handler(int mode, int valid)
+{
+  static const Handler table[] = EA_HANDLERS(execute, OP, SIZE);
+
+  // Byte operations can't use an address register.
+  if (SIZE == 1) { valid &= ~(1 << EA_AN); }
+
+  if (mode == EA_INVALID || (valid & (1 << mode)) == 0)
+  {
+    return &Simulate68000::execute<M68000_ILLEGAL, 0, EA_DN>;
+  }
+
+  return table[mode];
+}
+
+template<int OP>
+Simulate68000::Handler Simulate68000::get_sized_ea_handler(int size, int mode, int valid)
+{
+  switch (size)
+  {
+    case 0: return get_ea_handler<OP, 1>(mode, valid);
+    case 1: return get_ea_handler<OP, 2>(mode, valid);
+    case 2: return get_ea_handler<OP, 4>(mode, valid);
+    default: return &Simulate68000::execute<M68000_ILLEGAL, 0, EA_DN>;
+  }
+}
+
+template<int SIZE, int DST>
+Simulate68000::Handler Simulate68000::get_move_handler(int src)
+{
+  static const Handler table[] = EA_HANDLERS(execute_move, SIZE, DST);
+
+  return table[src];
+}
+
+// Picks the handler for an opcode.  This only runs when the handler
+// table is built.
+Simulate68000::Handler Simulate68000::decode(uint16_t opcode)
+{
+  const int mode = get_ea_mode(opcode);
+  const int size = (opcode >> 6) & 0x3;
+  const Handler illegal = &Simulate68000::execute<M68000_ILLEGAL, 0, EA_DN>;
+
+  switch (opcode >> 12)
+  {
+    case 0x0:
+      if ((opcode & 0x0138) == 0x0108)
+      {
+        return (opcode & 0x0080) != 0 ?
+          get_handler<M68000_MOVEP_TO_MEMORY>((opcode >> 6) & 1) :
+          get_handler<M68000_MOVEP_TO_REG>((opcode >> 6) & 1);
+      }
+
+      if ((opcode & 0x0100) != 0)
+      {
+        switch (size)
+        {
+          case 0: return get_ea_handler<M68000_BTST_REG, 1>(mode, EA_DATA);
+          case 1: return get_ea_handler<M68000_BCHG_REG, 1>(mode, EA_DATA_ALTERABLE);
+          case 2: return get_ea_handler<M68000_BCLR_REG, 1>(mode, EA_DATA_ALTERABLE);
+          default: return get_ea_handler<M68000_BSET_REG, 1>(mode, EA_DATA_ALTERABLE);
+        }
+      }
+
+      switch (opcode)
+      {
+        case 0x003c: return &Simulate68000::execute<M68000_ORI_CCR, 0, EA_DN>;
+        case 0x007c: return &Simulate68000::execute<M68000_ORI_SR, 0, EA_DN>;
+        case 0x023c: return &Simulate68000::execute<M68000_ANDI_CCR, 0, EA_DN>;
+        case 0x027c: return &Simulate68000::execute<M68000_ANDI_SR, 0, EA_DN>;
+        case 0x0a3c: return &Simulate68000::execute<M68000_EORI_CCR, 0, EA_DN>;
+        case 0x0a7c: return &Simulate68000::execute<M68000_EORI_SR, 0, EA_DN>;
+      }
+
+      switch ((opcode >> 9) & 0x7)
+      {
+        case 0: return get_sized_ea_handler<M68000_ORI>(size, mode, EA_DATA_ALTERABLE);
+        case 1: return get_sized_ea_handler<M68000_ANDI>(size, mode, EA_DATA_ALTERABLE);
+        case 2: return get_sized_ea_handler<M68000_SUBI>(size, mode, EA_DATA_ALTERABLE);
+        case 3: return get_sized_ea_handler<M68000_ADDI>(size, mode, EA_DATA_ALTERABLE);
+        case 4:
+          switch (size)
+          {
+            case 0: return get_ea_handler<M68000_BTST_IMM, 1>(mode, EA_DATA & ~(1 << EA_IMMEDIATE));
+            case 1: return get_ea_handler<M68000_BCHG_IMM, 1>(mode, EA_DATA_ALTERABLE);
+            case 2: return get_ea_handler<M68000_BCLR_IMM, 1>(mode, EA_DATA_ALTERABLE);
+            default: return get_ea_handler<M68000_BSET_IMM, 1>(mode, EA_DATA_ALTERABLE);
+          }
+        case 5: return get_sized_ea_handler<M68000_EORI>(size, mode, EA_DATA_ALTERABLE);
+        case 6: return get_sized_ea_handler<M68000_CMPI>(size, mode, EA_DATA_ALTERABLE);
+        default: return illegal;
+      }
+    case 0x1:
+    case 0x2:
+    case 0x3:
+    {
+      const int src = mode;
+      const int dst_mode = (opcode >> 6) & 0x7;
+      const int dst_index = (opcode >> 9) & 0x7;
+      int dst = dst_mode;
+
+      if (dst_mode == 7) { dst = dst_index <= 1 ? EA_ABS_W + dst_index : EA_INVALID; }
+
+      if (src == EA_INVALID || dst == EA_INVALID) { return illegal; }
+
+      switch (opcode >> 12)
+      {
+        case 1:
+          if (src == EA_AN || dst == EA_AN) { return illegal; }
+
+          switch (dst)
+          {
+            case EA_DN: return get_move_handler<1, EA_DN>(src);
+            case EA_AN_INDIRECT: return get_move_handler<1, EA_AN_INDIRECT>(src);
+            case EA_AN_POST: return get_move_handler<1, EA_AN_POST>(src);
+            case EA_AN_PRE: return get_move_handler<1, EA_AN_PRE>(src);
+            case EA_AN_D16: return get_move_handler<1, EA_AN_D16>(src);
+            case EA_AN_INDEX: return get_move_handler<1, EA_AN_INDEX>(src);
+            case EA_ABS_W: return get_move_handler<1, EA_ABS_W>(src);
+            default: return get_move_handler<1, EA_ABS_L>(src);
+          }
+        case 2:
+          switch (dst)
+          {
+            case EA_DN: return get_move_handler<4, EA_DN>(src);
+            case EA_AN: return get_move_handler<4, EA_AN>(src);
+            case EA_AN_INDIRECT: return get_move_handler<4, EA_AN_INDIRECT>(src);
+            case EA_AN_POST: return get_move_handler<4, EA_AN_POST>(src);
+            case EA_AN_PRE: return get_move_handler<4, EA_AN_PRE>(src);
+            case EA_AN_D16: return get_move_handler<4, EA_AN_D16>(src);
+            case EA_AN_INDEX: return get_move_handler<4, EA_AN_INDEX>(src);
+            case EA_ABS_W: return get_move_handler<4, EA_ABS_W>(src);
+            default: return get_move_handler<4, EA_ABS_L>(src);
+          }
+        default:
+          switch (dst)
+          {
+            case EA_DN: return get_move_handler<2, EA_DN>(src);
+            case EA_AN: return get_move_handler<2, EA_AN>(src);
+            case EA_AN_INDIRECT: return get_move_handler<2, EA_AN_INDIRECT>(src);
+            case EA_AN_POST: return get_move_handler<2, EA_AN_POST>(src);
+            case EA_AN_PRE: return get_move_handler<2, EA_AN_PRE>(src);
+            case EA_AN_D16: return get_move_handler<2, EA_AN_D16>(src);
+            case EA_AN_INDEX: return get_move_handler<2, EA_AN_INDEX>(src);
+            case EA_ABS_W: return get_move_handler<2, EA_ABS_W>(src);
+            default: return get_move_handler<2, EA_ABS_L>(src);
+          }
+      }
+    }
+    case 0x4:
+      if ((opcode & 0x01c0) == 0x01c0)
+      {
+        return get_ea_handler<M68000_LEA, 4>(mode, EA_CONTROL);
+      }
+
+      if ((opcode & 0x01c0) == 0x0180)
+      {
+        return get_ea_handler<M68000_CHK, 2>(mode, EA_DATA);
+      }
+
+      switch (opcode)
+      {
+        case 0x4afc: return illegal;
+        case 0x4e70: return &Simulate68000::execute<M68000_RESET, 0, EA_DN>;
+        case 0x4e71: return &Simulate68000::execute<M68000_NOP, 0, EA_DN>;
+        case 0x4e72: return &Simulate68000::execute<M68000_STOP, 0, EA_DN>;
+        case 0x4e73: return &Simulate68000::execute<M68000_RTE, 0, EA_DN>;
+        case 0x4e75: return &Simulate68000::execute<M68000_RTS, 0, EA_DN>;
+        case 0x4e76: return &Simulate68000::execute<M68000_TRAPV, 0, EA_DN>;
+        case 0x4e77: return &Simulate68000::execute<M68000_RTR, 0, EA_DN>;
+      }
+
+      switch (opcode & 0xfff8)
+      {
+        case 0x4840: return &Simulate68000::execute<M68000_SWAP, 0, EA_DN>;
+        case 0x4880: return &Simulate68000::execute<M68000_EXT_W, 0, EA_DN>;
+        case 0x48c0: return &Simulate68000::execute<M68000_EXT_L, 0, EA_DN>;
+        case 0x4e50: return &Simulate68000::execute<M68000_LINK, 0, EA_DN>;
+        case 0x4e58: return &Simulate68000::execute<M68000_UNLK, 0, EA_DN>;
+        case 0x4e60: return &Simulate68000::execute<M68000_MOVE_TO_USP, 0, EA_DN>;
+        case 0x4e68: return &Simulate68000::execute<M68000_MOVE_FROM_USP, 0, EA_DN>;
+      }
+
+      if ((opcode & 0xfff0) == 0x4e40)
+      {
+        return &Simulate68000::execute<M68000_TRAP, 0, EA_DN>;
+      }
+
+      switch (opcode & 0xffc0)
+      {
+        case 0x40c0: return get_ea_handler<M68000_MOVE_FROM_SR, 2>(mode, EA_DATA_ALTERABLE);
+        case 0x44c0: return get_ea_handler<M68000_MOVE_TO_CCR, 2>(mode, EA_DATA);
+        case 0x46c0: return get_ea_handler<M68000_MOVE_TO_SR, 2>(mode, EA_DATA);
+        case 0x4800: return get_ea_handler<M68000_NBCD, 1>(mode, EA_DATA_ALTERABLE);
+        case 0x4840: return get_ea_handler<M68000_PEA, 4>(mode, EA_CONTROL);
+        case 0x4ac0: return get_ea_handler<M68000_TAS, 1>(mode, EA_DATA_ALTERABLE);
+        case 0x4e80: return get_ea_handler<M68000_JSR, 4>(mode, EA_CONTROL);
+        case 0x4ec0: return get_ea_handler<M68000_JMP, 4>(mode, EA_CONTROL);
+      }
+
+      if ((opcode & 0xfb80) == 0x4880)
+      {
+        const bool is_long = (opcode & 0x0040) != 0;
+
+        if ((opcode & 0x0400) != 0)
+        {
+          return is_long ?
+            get_ea_handler<M68000_MOVEM_TO_REGS, 4>(mode, EA_MOVEM_TO_REGS) :
+            get_ea_handler<M68000_MOVEM_TO_REGS, 2>(mode, EA_MOVEM_TO_REGS);
+        }
+
+        return is_long ?
+          get_ea_handler<M68000_MOVEM_TO_MEMORY, 4>(mode, EA_MOVEM_TO_MEMORY) :
+          get_ea_handler<M68000_MOVEM_TO_MEMORY, 2>(mode, EA_MOVEM_TO_MEMORY);
+      }
+
+      switch (opcode & 0xff00)
+      {
+        case 0x4000: return get_sized_ea_handler<M68000_NEGX>(size, mode, EA_DATA_ALTERABLE);
+        case 0x4200: return get_sized_ea_handler<M68000_CLR>(size, mode, EA_DATA_ALTERABLE);
+        case 0x4400: return get_sized_ea_handler<M68000_NEG>(size, mode, EA_DATA_ALTERABLE);
+        case 0x4600: return get_sized_ea_handler<M68000_NOT>(size, mode, EA_DATA_ALTERABLE);
+        case 0x4a00: return get_sized_ea_handler<M68000_TST>(size, mode, EA_DATA_ALTERABLE);
+      }
+
+      return illegal;
+    case 0x5:
+      if (size == 3)
+      {
+        if ((opcode & 0x0038) == 0x0008)
+        {
+          return &Simulate68000::execute<M68000_DBCC, 0, EA_DN>;
+        }
+
+        return get_ea_handler<M68000_SCC, 1>(mode, EA_DATA_ALTERABLE);
+      }
+
+      if ((opcode & 0x0100) != 0)
+      {
+        return get_sized_ea_handler<M68000_SUBQ>(size, mode, EA_ALTERABLE);
+      }
+
+      return get_sized_ea_handler<M68000_ADDQ>(size, mode, EA_ALTERABLE);
+    case 0x6:
+      switch ((opcode >> 8) & 0xf)
+      {
+        case 0: return &Simulate68000::execute<M68000_BRA, 0, EA_DN>;
+        case 1: return &Simulate68000::execute<M68000_BSR, 0, EA_DN>;
+        default: return &Simulate68000::execute<M68000_BCC, 0, EA_DN>;
+      }
+    case 0x7:
+      if ((opcode & 0x0100) != 0) { return illegal; }
+
+      return &Simulate68000::execute<M68000_MOVEQ, 0, EA_DN>;
+    case 0x8:
+      if ((opcode & 0x01c0) == 0x00c0) { return get_ea_handler<M68000_DIVU, 2>(mode, EA_DATA); }
+      if ((opcode & 0x01c0) == 0x01c0) { return get_ea_handler<M68000_DIVS, 2>(mode, EA_DATA); }
+
+      if ((opcode & 0x01f0) == 0x0100)
+      {
+        return (opcode & 0x0008) != 0 ?
+          &Simulate68000::execute<M68000_SBCD_MEMORY, 0, EA_DN> :
+          &Simulate68000::execute<M68000_SBCD_REG, 0, EA_DN>;
+      }
+
+      if ((opcode & 0x0100) != 0)
+      {
+        return get_sized_ea_handler<M68000_OR_TO_EA>(size, mode, EA_MEMORY_ALTERABLE);
+      }
+
+      return get_sized_ea_handler<M68000_OR_TO_DN>(size, mode, EA_DATA);
+    case 0x9:
+    case 0xd:
+    {
+      const bool is_add = (opcode >> 12) == 0xd;
+
+      if (size == 3)
+      {
+        return is_add ?
+          ((opcode & 0x0100) != 0 ?
+            get_ea_handler<M68000_ADDA, 4>(mode, EA_ALL) :
+            get_ea_handler<M68000_ADDA, 2>(mode, EA_ALL)) :
+          ((opcode & 0x0100) != 0 ?
+            get_ea_handler<M68000_SUBA, 4>(mode, EA_ALL) :
+            get_ea_handler<M68000_SUBA, 2>(mode, EA_ALL));
+      }
+
+      if ((opcode & 0x0130) == 0x0100)
+      {
+        if ((opcode & 0x0008) != 0)
+        {
+          return is_add ?
+            get_handler<M68000_ADDX_MEMORY>(size) :
+            get_handler<M68000_SUBX_MEMORY>(size);
+        }
+
+        return is_add ?
+          get_handler<M68000_ADDX_REG>(size) :
+          get_handler<M68000_SUBX_REG>(size);
+      }
+
+      if ((opcode & 0x0100) != 0)
+      {
+        return is_add ?
+          get_sized_ea_handler<M68000_ADD_TO_EA>(size, mode, EA_MEMORY_ALTERABLE) :
+          get_sized_ea_handler<M68000_SUB_TO_EA>(size, mode, EA_MEMORY_ALTERABLE);
+      }
+
+      return is_add ?
+        get_sized_ea_handler<M68000_ADD_TO_DN>(size, mode, EA_ALL) :
+        get_sized_ea_handler<M68000_SUB_TO_DN>(size, mode, EA_ALL);
+    }
+    case 0xb:
+      if (size == 3)
+      {
+        return (opcode & 0x0100) != 0 ?
+          get_ea_handler<M68000_CMPA, 4>(mode, EA_ALL) :
+          get_ea_handler<M68000_CMPA, 2>(mode, EA_ALL);
+      }
+
+      if ((opcode & 0x0100) == 0)
+      {
+        return get_sized_ea_handler<M68000_CMP>(size, mode, EA_ALL);
+      }
+
+      if ((opcode & 0x0038) == 0x0008) { return get_handler<M68000_CMPM>(size); }
+
+      return get_sized_ea_handler<M68000_EOR>(size, mode, EA_DATA_ALTERABLE);
+    case 0xc:
+      if ((opcode & 0x01c0) == 0x00c0) { return get_ea_handler<M68000_MULU, 2>(mode, EA_DATA); }
+      if ((opcode & 0x01c0) == 0x01c0) { return get_ea_handler<M68000_MULS, 2>(mode, EA_DATA); }
+
+      if ((opcode & 0x01f0) == 0x0100)
+      {
+        return (opcode & 0x0008) != 0 ?
+          &Simulate68000::execute<M68000_ABCD_MEMORY, 0, EA_DN> :
+          &Simulate68000::execute<M68000_ABCD_REG, 0, EA_DN>;
+      }
+
+      switch (opcode & 0x01f8)
+      {
+        case 0x0140: return &Simulate68000::execute<M68000_EXG_DD, 0, EA_DN>;
+        case 0x0148: return &Simulate68000::execute<M68000_EXG_AA, 0, EA_DN>;
+        case 0x0188: return &Simulate68000::execute<M68000_EXG_DA, 0, EA_DN>;
+      }
+
+      if ((opcode & 0x0100) != 0)
+      {
+        return get_sized_ea_handler<M68000_AND_TO_EA>(size, mode, EA_MEMORY_ALTERABLE);
+      }
+
+      return get_sized_ea_handler<M68000_AND_TO_DN>(size, mode, EA_DATA);
+    case 0xe:
+      if (size == 3)
+      {
+        if ((opcode & 0x0800) != 0) { return illegal; }
+
+        return get_ea_handler<M68000_SHIFT_MEMORY, 2>(mode, EA_MEMORY_ALTERABLE);
+      }
+
+      return get_handler<M68000_SHIFT_REG>(size);
+    case 0xa:
+      return &Simulate68000::execute<M68000_LINE_A, 0, EA_DN>;
+    default:
+      return &Simulate68000::execute<M68000_LINE_F, 0, EA_DN>;
+  }
+}
+
+// Takes the exception if its vector is set.  Without a handler a trap
+// ends the program the way ecall does on RISC-V and the rest stop the
+// simulation with an error.
+int Simulate68000::exception(int vector, uint32_t return_address)
+{
+  const uint32_t handler = memory->read32(vector * 4);
+
+  if (handler == 0)
+  {
+    pc = instruction_pc;
+
+    if (vector >= M68000_VECTOR_TRAP && vector < M68000_VECTOR_TRAP + 16)
+    {
+      halted = true;
+      return 4;
+    }
+
+    switch (vector)
+    {
+      case M68000_VECTOR_ZERO_DIVIDE:
+        printf("Divide by zero at address 0x%08x\n", pc);
+        break;
+      case M68000_VECTOR_CHK:
+        printf("CHK out of bounds at address 0x%08x\n", pc);
+        break;
+      case M68000_VECTOR_TRAPV:
+        printf("Overflow trap at address 0x%08x\n", pc);
+        break;
+      case M68000_VECTOR_PRIVILEGE:
+        printf("Privilege violation at address 0x%08x\n", pc);
+        break;
+      default:
+        printf("Illegal instruction at address 0x%08x\n", pc);
+        break;
+    }
+
+    return -1;
+  }
+
+  const uint16_t old_sr = sr;
+
+  set_sr((sr | M68000_SR_S) & ~M68000_SR_T);
+  push32(return_address);
+  push16(old_sr);
+
+  pc = handler;
+
+  switch (vector)
+  {
+    case M68000_VECTOR_ZERO_DIVIDE: return 38;
+    case M68000_VECTOR_CHK: return 40;
+    default: return 34;
+  }
+}
+
+// For the brief extension word of (d8,An,Xn) and (d8,PC,Xn).
+uint32_t Simulate68000::get_index_address(uint32_t base)
+{
+  const uint16_t extension = fetch16();
+  uint32_t index = reg[extension >> 12];
+
+  if ((extension & 0x0800) == 0) { index = (int16_t)index; }
+
+  return base + index + (int8_t)(extension & 0xff);
+}
+
+uint8_t Simulate68000::bcd_add(uint8_t src, uint8_t dst)
+{
+  uint32_t result = (src & 0x0f) + (dst & 0x0f) + ((sr >> 4) & 1);
+
+  if (result > 9) { result += 6; }
+
+  result += (src & 0xf0) + (dst & 0xf0);
+
+  const bool carry = result > 0x99;
+
+  if (carry) { result -= 0xa0; }
+
+  result &= 0xff;
+
+  // Z is only cleared so it can be tested after a multi-byte add.
+  sr &= ~(M68000_SR_X | M68000_SR_N | M68000_SR_V | M68000_SR_C);
+  if (carry) { sr |= M68000_SR_X | M68000_SR_C; }
+  if ((result & 0x80) != 0) { sr |= M68000_SR_N; }
+  if (result != 0) { sr &= ~M68000_SR_Z; }
+
+  return result;
+}
+
+uint8_t Simulate68000::bcd_sub(uint8_t src, uint8_t dst)
+{
+  uint32_t result = (dst & 0x0f) - (src & 0x0f) - ((sr >> 4) & 1);
+
+  if (result > 9) { result -= 6; }
+
+  result += (dst & 0xf0) - (src & 0xf0);
+
+  const bool borrow = result > 0x99;
+
+  if (borrow) { result += 0xa0; }
+
+  result &= 0xff;
+
+  sr &= ~(M68000_SR_X | M68000_SR_N | M68000_SR_V | M68000_SR_C);
+  if (borrow) { sr |= M68000_SR_X | M68000_SR_C; }
+  if ((result & 0x80) != 0) { sr |= M68000_SR_N; }
+  if (result != 0) { sr &= ~M68000_SR_Z; }
+
+  return result;
+}
+
+// Changing S swaps the user and supervisor stack pointers.
+void Simulate68000::set_sr(uint16_t value)
+{
+  value &= 0xa71f;
+
+  if (((value ^ sr) & M68000_SR_S) != 0)
+  {
+    uint32_t temp = reg[15];
+    reg[15] = other_sp;
+    other_sp = temp;
+  }
+
+  sr = value;
+}
+
+void Simulate68000::show_instructions(uint32_t address)
+{
+  char instruction[128];
+  int cycles_min, cycles_max;
+  int n;
+
+  for (n = 0; n < 6; n++)
+  {
+    printf("%c", has_break_point(address) ? '*' : ' ');
+
+    if (n == 0) { printf("! "); }
+    else if (address == pc) { printf("> "); }
+    else { printf("  "); }
+
+    int count = disasm_68000(
+      memory,
+      address,
+      instruction,
+      sizeof(instruction),
+      &cycles_min,
+      &cycles_max);
+
+    printf("0x%08x: 0x%04x %-40s\n",
+      address, memory->read16(address), instruction);
+
+    address += count < 2 ? 2 : count;
+  }
+}
+
+// The 68000 has a 24 bit address bus so the top 8 bits of an address
+// are ignored.
+template<int SIZE>
+uint32_t Simulate68000::read_memory(uint32_t address)
+{
+  address &= 0x00ffffff;
+
+  watch_access(address, BREAK_POINT_READ);
+
+  switch (SIZE)
+  {
+    case 1: return memory->read8(address);
+    case 2: return memory->read16(address);
+    default: return memory->read32(address);
+  }
+}
+
+template<int SIZE>
+void Simulate68000::write_memory(uint32_t address, uint32_t value)
+{
+  address &= 0x00ffffff;
+
+  watch_access(address, BREAK_POINT_WRITE);
+
+  switch (SIZE)
+  {
+    case 1: memory->write8(address, value); break;
+    case 2: memory->write16(address, value); break;
+    default: memory->write32(address, value); break;
+  }
+}
+
+template<int MODE, int SIZE>
+uint32_t Simulate68000::get_address(int index)
+{
+  // (An)+ and -(An) on a7 keep the stack word aligned for bytes.
+  const int step = SIZE == 1 && index == 7 ? 2 : SIZE;
+
+  switch (MODE)
+  {
+    case EA_AN_INDIRECT:
+      return reg[8 + index];
+    case EA_AN_POST:
+    {
+      const uint32_t address = reg[8 + index];
+      reg[8 + index] += step;
+      return address;
+    }
+    case EA_AN_PRE:
+      reg[8 + index] -= step;
+      return reg[8 + index];
+    case EA_AN_D16:
+      return reg[8 + index] + (int16_t)fetch16();
+    case EA_AN_INDEX:
+      return get_index_address(reg[8 + index]);
+    case EA_ABS_W:
+      return (int16_t)fetch16();
+    case EA_ABS_L:
+      return fetch32();
+    case EA_PC_D16:
+    {
+      const uint32_t base = pc;
+      return base + (int16_t)fetch16();
+    }
+    case EA_PC_INDEX:
+      return get_index_address(pc);
+    default:
+      return 0;
+  }
+}
+
+template<int MODE, int SIZE>
+uint32_t Simulate68000::read_ea(int index, uint32_t *address)
+{
+  switch (MODE)
+  {
+    case EA_DN:
+      return reg[index] & size_mask<SIZE>();
+    case EA_AN:
+      return reg[8 + index] & size_mask<SIZE>();
+    case EA_IMMEDIATE:
+      if (SIZE == 4) { return fetch32(); }
+      return fetch16() & size_mask<SIZE>();
+    default:
+      *address = get_address<MODE, SIZE>(index);
+      return read_memory<SIZE>(*address);
+  }
+}
+
+// Writes to the effective address read_ea() found.
+template<int MODE, int SIZE>
+void Simulate68000::write_ea(int index, uint32_t address, uint32_t value)
+{
+  switch (MODE)
+  {
+    case EA_DN:
+      reg[index] = (reg[index] & ~size_mask<SIZE>()) | (value & size_mask<SIZE>());
+      break;
+    case EA_AN:
+      reg[8 + index] = value;
+      break;
+    case EA_PC_D16:
+    case EA_PC_INDEX:
+    case EA_IMMEDIATE:
+      break;
+    default:
+      write_memory<SIZE>(address, value);
+      break;
+  }
+}
+
+// Writes to an effective address that wasn't read first.
+template<int MODE, int SIZE>
+void Simulate68000::store_ea(int index, uint32_t value)
+{
+  if (MODE == EA_DN || MODE == EA_AN)
+  {
+    write_ea<MODE, SIZE>(index, 0, value);
+  }
+    else
+  {
+    write_ea<MODE, SIZE>(index, get_address<MODE, SIZE>(index), value);
+  }
+}
+
+template<int SIZE>
+void Simulate68000::set_logic_flags(uint32_t result)
+{
+  result &= size_mask<SIZE>();
+
+  sr &= ~(M68000_SR_N | M68000_SR_Z | M68000_SR_V | M68000_SR_C);
+  if ((result & sign_bit<SIZE>()) != 0) { sr |= M68000_SR_N; }
+  if (result == 0) { sr |= M68000_SR_Z; }
+}
+
+// a + b + x setting X, N, Z, V and C.  With extend (addx) Z is only
+// cleared so it can be tested after a multi-precision add.
+template<int SIZE>
+uint32_t Simulate68000::add_with_flags(uint32_t a, uint32_t b, int x, bool extend)
+{
+  const uint32_t mask = size_mask<SIZE>();
+
+  a &= mask;
+  b &= mask;
+
+  const uint64_t sum = (uint64_t)a + b + x;
+  const uint32_t result = sum & mask;
+
+  sr &= ~(M68000_SR_X | M68000_SR_N | M68000_SR_V | M68000_SR_C);
+  if (sum > mask) { sr |= M68000_SR_X | M68000_SR_C; }
+  if ((result & sign_bit<SIZE>()) != 0) { sr |= M68000_SR_N; }
+  if (((a ^ result) & (b ^ result) & sign_bit<SIZE>()) != 0) { sr |= M68000_SR_V; }
+
+  if (extend)
+  {
+    if (result != 0) { sr &= ~M68000_SR_Z; }
+  }
+    else
+  {
+    if (result == 0) { sr |= M68000_SR_Z; } else { sr &= ~M68000_SR_Z; }
+  }
+
+  return result;
+}
+
+// a - b - x setting N, Z, V, C and, unless it's a compare, X.
+template<int SIZE>
+uint32_t Simulate68000::sub_with_flags(uint32_t a, uint32_t b, int x, bool extend, bool set_x)
+{
+  const uint32_t mask = size_mask<SIZE>();
+
+  a &= mask;
+  b &= mask;
+
+  const uint32_t result = (a - b - x) & mask;
+  const bool borrow = (uint64_t)b + x > a;
+
+  sr &= ~(M68000_SR_N | M68000_SR_V | M68000_SR_C);
+  if (set_x) { sr &= ~M68000_SR_X; }
+
+  if (borrow)
+  {
+    sr |= M68000_SR_C;
+    if (set_x) { sr |= M68000_SR_X; }
+  }
+
+  if ((result & sign_bit<SIZE>()) != 0) { sr |= M68000_SR_N; }
+  if (((a ^ b) & (a ^ result) & sign_bit<SIZE>()) != 0) { sr |= M68000_SR_V; }
+
+  if (extend)
+  {
+    if (result != 0) { sr &= ~M68000_SR_Z; }
+  }
+    else
+  {
+    if (result == 0) { sr |= M68000_SR_Z; } else { sr &= ~M68000_SR_Z; }
+  }
+
+  return result;
+}
+
+// Shifts and rotates one bit at a time since the flags depend on every
+// bit shifted out.
+template<int SIZE>
+uint32_t Simulate68000::shift(int type, bool left, uint32_t value, int count)
+{
+  const uint32_t mask = size_mask<SIZE>();
+  const uint32_t msb = sign_bit<SIZE>();
+  int x = (sr >> 4) & 1;
+  int c = 0;
+  bool v = false;
+
+  value &= mask;
+
+  for (int n = 0; n < count; n++)
+  {
+    if (left)
+    {
+      c = (value & msb) != 0;
+      value = (value << 1) & mask;
+
+      if (type == SHIFT_ROX) { value |= x; }
+      else if (type == SHIFT_RO) { value |= c; }
+      else if (type == SHIFT_AS && ((value & msb) != 0) != (c != 0)) { v = true; }
+    }
+      else
+    {
+      c = value & 1;
+
+      switch (type)
+      {
+        case SHIFT_AS: value = (value >> 1) | (value & msb); break;
+        case SHIFT_LS: value = value >> 1; break;
+        case SHIFT_ROX: value = (value >> 1) | (x != 0 ? msb : 0); break;
+        default: value = (value >> 1) | (c != 0 ? msb : 0); break;
+      }
+    }
+
+    if (type == SHIFT_ROX) { x = c; }
+  }
+
+  set_logic_flags<SIZE>(value);
+
+  if (v) { sr |= M68000_SR_V; }
+
+  if (count == 0)
+  {
+    // Only roxl / roxr change C (to X) when nothing is shifted.
+    if (type == SHIFT_ROX && x != 0) { sr |= M68000_SR_C; }
+  }
+    else
+  {
+    if (type == SHIFT_ROX) { c = x; }
+    if (c != 0) { sr |= M68000_SR_C; }
+
+    if (type != SHIFT_RO)
+    {
+      sr = (sr & ~M68000_SR_X) | (c != 0 ? M68000_SR_X : 0);
+    }
+  }
+
+  return value;
+}
+
+template<int SIZE, int DST, int SRC>
+int Simulate68000::execute_move(uint16_t opcode)
+{
+  const int dst_index = (opcode >> 9) & 0x7;
+  uint32_t address = 0;
+  uint32_t value = read_ea<SRC, SIZE>(opcode & 0x7, &address);
+
+  // movea sign extends a word and doesn't change the flags.
+  if (DST == EA_AN)
+  {
+    reg[8 + dst_index] = SIZE == 2 ? (int16_t)value : value;
+    return 4 + ea_time<SRC, SIZE>();
+  }
+
+  set_logic_flags<SIZE>(value);
+  store_ea<DST, SIZE>(dst_index, value);
+
+  // Writing to -(An) doesn't take the 2 extra cycles reading does.
+  const int dst_cycles = DST == EA_AN_PRE ?
+    ea_time<EA_AN_INDIRECT, SIZE>() :
+    ea_time<DST, SIZE>();
+
+  return 4 + ea_time<SRC, SIZE>() + dst_cycles;
+}
+
+// OP, SIZE and MODE are constants so the switch and the effective
+// address calculation reduce to the code for the one instruction.
+template<int OP, int SIZE, int MODE>
+int Simulate68000::execute(uint16_t opcode)
+{
+  const int index = opcode & 0x7;
+  const int dn = (opcode >> 9) & 0x7;
+  const uint32_t mask = size_mask<SIZE>();
+  uint32_t address = 0;
+
+  switch (OP)
+  {
+    case M68000_ILLEGAL:
+      return exception(M68000_VECTOR_ILLEGAL, instruction_pc);
+    case M68000_LINE_A:
+      return exception(M68000_VECTOR_LINE_A, instruction_pc);
+    case M68000_LINE_F:
+      return exception(M68000_VECTOR_LINE_F, instruction_pc);
+    case M68000_ADD_TO_DN:
+    case M68000_SUB_TO_DN:
+    case M68000_AND_TO_DN:
+    case M68000_OR_TO_DN:
+    case M68000_CMP:
+    {
+      const uint32_t src = read_ea<MODE, SIZE>(index, &address);
+      const uint32_t dst = reg[dn] & mask;
+      uint32_t result;
+
+      switch (OP)
+      {
+        case M68000_ADD_TO_DN:
+          result = add_with_flags<SIZE>(dst, src, 0, false);
+          break;
+        case M68000_SUB_TO_DN:
+          result = sub_with_flags<SIZE>(dst, src, 0, false, true);
+          break;
+        case M68000_AND_TO_DN:
+          result = dst & src;
+          set_logic_flags<SIZE>(result);
+          break;
+        case M68000_OR_TO_DN:
+          result = dst | src;
+          set_logic_flags<SIZE>(result);
+          break;
+        default:
+          sub_with_flags<SIZE>(dst, src, 0, false, false);
+          return (SIZE == 4 ? 6 : 4) + ea_time<MODE, SIZE>();
+      }
+
+      write_ea<EA_DN, SIZE>(dn, 0, result);
+
+      if (SIZE == 4)
+      {
+        return (MODE <= EA_AN || MODE == EA_IMMEDIATE ? 8 : 6) + ea_time<MODE, SIZE>();
+      }
+
+      return 4 + ea_time<MODE, SIZE>();
+    }
+    case M68000_ADD_TO_EA:
+    case M68000_SUB_TO_EA:
+    case M68000_AND_TO_EA:
+    case M68000_OR_TO_EA:
+    case M68000_EOR:
+    {
+      const uint32_t dst = read_ea<MODE, SIZE>(index, &address);
+      const uint32_t src = reg[dn] & mask;
+      uint32_t result;
+
+      switch (OP)
+      {
+        case M68000_ADD_TO_EA:
+          result = add_with_flags<SIZE>(dst, src, 0, false);
+          break;
+        case M68000_SUB_TO_EA:
+          result = sub_with_flags<SIZE>(dst, src, 0, false, true);
+          break;
+        case M68000_AND_TO_EA:
+          result = dst & src;
+          set_logic_flags<SIZE>(result);
+          break;
+        case M68000_OR_TO_EA:
+          result = dst | src;
+          set_logic_flags<SIZE>(result);
+          break;
+        default:
+          result = dst ^ src;
+          set_logic_flags<SIZE>(result);
+          break;
+      }
+
+      write_ea<MODE, SIZE>(index, address, result);
+
+      if (MODE == EA_DN) { return SIZE == 4 ? 8 : 4; }
+
+      return (SIZE == 4 ? 12 : 8) + ea_time<MODE, SIZE>();
+    }
+    case M68000_ADDA:
+    case M68000_SUBA:
+    case M68000_CMPA:
+    {
+      uint32_t src = read_ea<MODE, SIZE>(index, &address);
+
+      if (SIZE == 2) { src = (int16_t)src; }
+
+      switch (OP)
+      {
+        case M68000_ADDA: reg[8 + dn] += src; break;
+        case M68000_SUBA: reg[8 + dn] -= src; break;
+        default:
+          sub_with_flags<4>(reg[8 + dn], src, 0, false, false);
+          return 6 + ea_time<MODE, SIZE>();
+      }
+
+      if (SIZE == 2) { return 8 + ea_time<MODE, SIZE>(); }
+
+      return (MODE <= EA_AN || MODE == EA_IMMEDIATE ? 8 : 6) + ea_time<MODE, SIZE>();
+    }
+    case M68000_ADDI:
+    case M68000_SUBI:
+    case M68000_ANDI:
+    case M68000_ORI:
+    case M68000_EORI:
+    case M68000_CMPI:
+    {
+      const uint32_t src = SIZE == 4 ? fetch32() : fetch16() & mask;
+      const uint32_t dst = read_ea<MODE, SIZE>(index, &address);
+      uint32_t result;
+
+      switch (OP)
+      {
+        case M68000_ADDI:
+          result = add_with_flags<SIZE>(dst, src, 0, false);
+          break;
+        case M68000_SUBI:
+          result = sub_with_flags<SIZE>(dst, src, 0, false, true);
+          break;
+        case M68000_ANDI:
+          result = dst & src;
+          set_logic_flags<SIZE>(result);
+          break;
+        case M68000_ORI:
+          result = dst | src;
+          set_logic_flags<SIZE>(result);
+          break;
+        case M68000_EORI:
+          result = dst ^ src;
+          set_logic_flags<SIZE>(result);
+          break;
+        default:
+          sub_with_flags<SIZE>(dst, src, 0, false, false);
+
+          if (MODE == EA_DN) { return SIZE == 4 ? 14 : 8; }
+          return (SIZE == 4 ? 12 : 8) + ea_time<MODE, SIZE>();
+      }
+
+      write_ea<MODE, SIZE>(index, address, result);
+
+      if (MODE == EA_DN) { return SIZE == 4 ? 16 : 8; }
+
+      return (SIZE == 4 ? 20 : 12) + ea_time<MODE, SIZE>();
+    }
+    case M68000_ADDQ:
+    case M68000_SUBQ:
+    {
+      const uint32_t data = dn == 0 ? 8 : dn;
+
+      // On an address register the whole register is changed and the
+      // flags aren't.
+      if (MODE == EA_AN)
+      {
+        if (OP == M68000_ADDQ) { reg[8 + index] += data; }
+        else { reg[8 + index] -= data; }
+
+        return 8;
+      }
+
+      const uint32_t dst = read_ea<MODE, SIZE>(index, &address);
+      const uint32_t result = OP == M68000_ADDQ ?
+        add_with_flags<SIZE>(dst, data, 0, false) :
+        sub_with_flags<SIZE>(dst, data, 0, false, true);
+
+      write_ea<MODE, SIZE>(index, address, result);
+
+      if (MODE == EA_DN) { return SIZE == 4 ? 8 : 4; }
+
+      return (SIZE == 4 ? 12 : 8) + ea_time<MODE, SIZE>();
+    }
+    case M68000_CLR:
+    case M68000_NEG:
+    case M68000_NEGX:
+    case M68000_NOT:
+    {
+      uint32_t result = 0;
+
+      if (OP == M68000_CLR)
+      {
+        store_ea<MODE, SIZE>(index, 0);
+        sr = (sr & ~(M68000_SR_N | M68000_SR_V | M68000_SR_C)) | M68000_SR_Z;
+      }
+        else
+      {
+        const uint32_t dst = read_ea<MODE, SIZE>(index, &address);
+
+        switch (OP)
+        {
+          case M68000_NEG:
+            result = sub_with_flags<SIZE>(0, dst, 0, false, true);
+            break;
+          case M68000_NEGX:
+            result = sub_with_flags<SIZE>(0, dst, (sr >> 4) & 1, true, true);
+            break;
+          default:
+            result = ~dst;
+            set_logic_flags<SIZE>(result);
+            break;
+        }
+
+        write_ea<MODE, SIZE>(index, address, result);
+      }
+
+      if (MODE == EA_DN) { return SIZE == 4 ? 6 : 4; }
+
+      return (SIZE == 4 ? 12 : 8) + ea_time<MODE, SIZE>();
+    }
+    case M68000_TST:
+      set_logic_flags<SIZE>(read_ea<MODE, SIZE>(index, &address));
+      return 4 + ea_time<MODE, SIZE>();
+    case M68000_BTST_REG:
+    case M68000_BCHG_REG:
+    case M68000_BCLR_REG:
+    case M68000_BSET_REG:
+    case M68000_BTST_IMM:
+    case M68000_BCHG_IMM:
+    case M68000_BCLR_IMM:
+    case M68000_BSET_IMM:
+    {
+      const bool is_imm = OP >= M68000_BTST_IMM;
+      const int type = OP - (is_imm ? M68000_BTST_IMM : M68000_BTST_REG);
+      int bit = is_imm ? fetch16() & 0xff : reg[dn];
+
+      // A data register is tested as a long and memory as a byte.
+      uint32_t value;
+
+      if (MODE == EA_DN)
+      {
+        bit &= 31;
+        value = reg[index];
+      }
+        else
+      {
+        bit &= 7;
+        value = read_ea<MODE, 1>(index, &address);
+      }
+
+      if ((value & (1 << bit)) == 0) { sr |= M68000_SR_Z; }
+      else { sr &= ~M68000_SR_Z; }
+
+      switch (type)
+      {
+        case 1: value ^= 1 << bit; break;
+        case 2: value &= ~(1 << bit); break;
+        case 3: value |= 1 << bit; break;
+      }
+
+      if (type != 0)
+      {
+        if (MODE == EA_DN) { reg[index] = value; }
+        else { write_ea<MODE, 1>(index, address, value); }
+      }
+
+      if (MODE == EA_DN)
+      {
+        static const int cycles[] = { 6, 8, 10, 8 };
+        return cycles[type] + (is_imm ? 4 : 0);
+      }
+
+      return (type == 0 ? 4 : 8) + (is_imm ? 4 : 0) + ea_time<MODE, 1>();
+    }
+    case M68000_SHIFT_MEMORY:
+    {
+      const uint32_t value = read_ea<MODE, 2>(index, &address);
+      const uint32_t result =
+        shift<2>((opcode >> 9) & 0x3, (opcode & 0x0100) != 0, value, 1);
+
+      write_ea<MODE, 2>(index, address, result);
+
+      return 8 + ea_time<MODE, 2>();
+    }
+    case M68000_MULU:
+    case M68000_MULS:
+    {
+      const uint32_t src = read_ea<MODE, 2>(index, &address);
+      uint32_t result;
+      int cycles;
+
+      // The time depends on the bits in the source.
+      if (OP == M68000_MULU)
+      {
+        result = (reg[dn] & 0xffff) * src;
+        cycles = 38 + 2 * __builtin_popcount(src);
+      }
+        else
+      {
+        result = (int32_t)(int16_t)reg[dn] * (int32_t)(int16_t)src;
+        cycles = 38 + 2 * __builtin_popcount((src ^ (src << 1)) & 0xffff);
+      }
+
+      reg[dn] = result;
+      set_logic_flags<4>(result);
+
+      return cycles + ea_time<MODE, 2>();
+    }
+    case M68000_DIVU:
+    case M68000_DIVS:
+    {
+      const uint32_t src = read_ea<MODE, 2>(index, &address);
+
+      if (src == 0)
+      {
+        return exception(M68000_VECTOR_ZERO_DIVIDE, pc) + ea_time<MODE, 2>();
+      }
+
+      // The time of a divide depends on the operands.  This is the worst
+      // case, which the manual says is within 10% of the best.
+      int32_t quotient, remainder;
+
+      if (OP == M68000_DIVU)
+      {
+        quotient = reg[dn] / src;
+        remainder = reg[dn] % src;
+
+        if ((uint32_t)quotient > 0xffff)
+        {
+          sr = (sr & ~M68000_SR_C) | M68000_SR_V;
+          return 10 + ea_time<MODE, 2>();
+        }
+      }
+        else
+      {
+        const int32_t dividend = reg[dn];
+        const int32_t divisor = (int16_t)src;
+
+        if (dividend == INT32_MIN && divisor == -1)
+        {
+          sr = (sr & ~M68000_SR_C) | M68000_SR_V;
+          return 16 + ea_time<MODE, 2>();
+        }
+
+        quotient = dividend / divisor;
+        remainder = dividend % divisor;
+
+        if (quotient < -32768 || quotient > 32767)
+        {
+          sr = (sr & ~M68000_SR_C) | M68000_SR_V;
+          return 16 + ea_time<MODE, 2>();
+        }
+      }
+
+      reg[dn] = ((remainder & 0xffff) << 16) | (quotient & 0xffff);
+      set_logic_flags<2>(quotient);
+
+      return (OP == M68000_DIVU ? 140 : 158) + ea_time<MODE, 2>();
+    }
+    case M68000_CHK:
+    {
+      const int16_t bound = read_ea<MODE, 2>(index, &address);
+      const int16_t value = reg[dn];
+
+      if (value < 0)
+      {
+        sr |= M68000_SR_N;
+        return exception(M68000_VECTOR_CHK, pc) + ea_time<MODE, 2>();
+      }
+
+      if (value > bound)
+      {
+        sr &= ~M68000_SR_N;
+        return exception(M68000_VECTOR_CHK, pc) + ea_time<MODE, 2>();
+      }
+
+      return 10 + ea_time<MODE, 2>();
+    }
+    case M68000_LEA:
+      reg[8 + dn] = get_address<MODE, 4>(index);
+      return lea_cycles[MODE];
+    case M68000_PEA:
+      address = get_address<MODE, 4>(index);
+      push32(address);
+      return lea_cycles[MODE] + 8;
+    case M68000_JMP:
+      pc = get_address<MODE, 4>(index);
+      return jmp_cycles[MODE];
+    case M68000_JSR:
+      address = get_address<MODE, 4>(index);
+      push32(pc);
+      pc = address;
+      return jmp_cycles[MODE] + 8;
+    case M68000_SCC:
+    {
+      const bool passed = test_condition((opcode >> 8) & 0xf);
+
+      store_ea<MODE, 1>(index, passed ? 0xff : 0x00);
+
+      if (MODE == EA_DN) { return passed ? 6 : 4; }
+
+      return 8 + ea_time<MODE, 1>();
+    }
+    case M68000_NBCD:
+    {
+      const uint32_t dst = read_ea<MODE, 1>(index, &address);
+
+      write_ea<MODE, 1>(index, address, bcd_sub(dst, 0));
+
+      return MODE == EA_DN ? 6 : 8 + ea_time<MODE, 1>();
+    }
+    case M68000_TAS:
+    {
+      const uint32_t value = read_ea<MODE, 1>(index, &address);
+
+      set_logic_flags<1>(value);
+      write_ea<MODE, 1>(index, address, value | 0x80);
+
+      return MODE == EA_DN ? 4 : 10 + ea_time<MODE, 1>();
+    }
+    case M68000_MOVE_FROM_SR:
+      store_ea<MODE, 2>(index, sr);
+      return MODE == EA_DN ? 6 : 8 + ea_time<MODE, 2>();
+    case M68000_MOVE_TO_CCR:
+    {
+      const uint32_t value = read_ea<MODE, 2>(index, &address);
+
+      sr = (sr & 0xff00) | (value & 0x1f);
+
+      return 12 + ea_time<MODE, 2>();
+    }
+    case M68000_MOVE_TO_SR:
+    {
+      if ((sr & M68000_SR_S) == 0)
+      {
+        return exception(M68000_VECTOR_PRIVILEGE, instruction_pc);
+      }
+
+      set_sr(read_ea<MODE, 2>(index, &address));
+
+      return 12 + ea_time<MODE, 2>();
+    }
+    case M68000_MOVEM_TO_MEMORY:
+    {
+      const uint16_t list = fetch16();
+      int count = 0;
+
+      // For -(An) the list is reversed (bit 0 is a7) and registers are
+      // stored from a7 down to d0.  If An is in the list the value it
+      // had before the instruction is stored.
+      if (MODE == EA_AN_PRE)
+      {
+        address = reg[8 + index];
+
+        for (int n = 0; n < 16; n++)
+        {
+          if ((list & (1 << n)) == 0) { continue; }
+
+          address -= SIZE;
+          write_memory<SIZE>(address, reg[15 - n]);
+          count++;
+        }
+
+        reg[8 + index] = address;
+      }
+        else
+      {
+        address = get_address<MODE, SIZE>(index);
+
+        for (int n = 0; n < 16; n++)
+        {
+          if ((list & (1 << n)) == 0) { continue; }
+
+          write_memory<SIZE>(address, reg[n]);
+          address += SIZE;
+          count++;
+        }
+      }
+
+      return movem_to_memory_cycles[MODE] + count * (SIZE == 4 ? 8 : 4);
+    }
+    case M68000_MOVEM_TO_REGS:
+    {
+      const uint16_t list = fetch16();
+      int count = 0;
+
+      address = MODE == EA_AN_POST ?
+        reg[8 + index] :
+        get_address<MODE, SIZE>(index);
+
+      // Words are sign extended to the whole register.
+      for (int n = 0; n < 16; n++)
+      {
+        if ((list & (1 << n)) == 0) { continue; }
+
+        uint32_t value = read_memory<SIZE>(address);
+        reg[n] = SIZE == 2 ? (int16_t)value : value;
+        address += SIZE;
+        count++;
+      }
+
+      if (MODE == EA_AN_POST) { reg[8 + index] = address; }
+
+      return movem_to_regs_cycles[MODE] + count * (SIZE == 4 ? 8 : 4);
+    }
+    case M68000_SHIFT_REG:
+    {
+      int count = dn;
+
+      if ((opcode & 0x0020) != 0) { count = reg[dn] & 63; }
+      else if (count == 0) { count = 8; }
+
+      const uint32_t result =
+        shift<SIZE>((opcode >> 3) & 0x3, (opcode & 0x0100) != 0, reg[index], count);
+
+      write_ea<EA_DN, SIZE>(index, 0, result);
+
+      return (SIZE == 4 ? 8 : 6) + count * 2;
+    }
+    case M68000_MOVEQ:
+      reg[dn] = (int8_t)(opcode & 0xff);
+      set_logic_flags<4>(reg[dn]);
+      return 4;
+    case M68000_BRA:
+    case M68000_BSR:
+    case M68000_BCC:
+    {
+      // The displacement is from the word after the opcode.  A zero
+      // 8 bit displacement means a 16 bit one follows.
+      const uint32_t base = pc;
+      int32_t displacement = (int8_t)(opcode & 0xff);
+      const bool is_word = displacement == 0;
+
+      if (is_word) { displacement = (int16_t)fetch16(); }
+
+      if (OP == M68000_BCC && test_condition((opcode >> 8) & 0xf) == false)
+      {
+        return is_word ? 12 : 8;
+      }
+
+      if (OP == M68000_BSR) { push32(pc); }
+
+      pc = base + displacement;
+
+      return OP == M68000_BSR ? 18 : 10;
+    }
+    case M68000_DBCC:
+    {
+      const uint32_t base = pc;
+      const int16_t displacement = fetch16();
+
+      if (test_condition((opcode >> 8) & 0xf)) { return 12; }
+
+      const uint16_t counter = reg[index] - 1;
+
+      reg[index] = (reg[index] & 0xffff0000) | counter;
+
+      if (counter == 0xffff) { return 14; }
+
+      pc = base + displacement;
+
+      return 10;
+    }
+    case M68000_SWAP:
+      reg[index] = (reg[index] >> 16) | (reg[index] << 16);
+      set_logic_flags<4>(reg[index]);
+      return 4;
+    case M68000_EXT_W:
+      reg[index] = (reg[index] & 0xffff0000) | ((int8_t)reg[index] & 0xffff);
+      set_logic_flags<2>(reg[index]);
+      return 4;
+    case M68000_EXT_L:
+      reg[index] = (int16_t)reg[index];
+      set_logic_flags<4>(reg[index]);
+      return 4;
+    case M68000_LINK:
+    {
+      const int16_t displacement = fetch16();
+
+      push32(reg[8 + index]);
+      reg[8 + index] = reg[15];
+      reg[15] += displacement;
+
+      return 16;
+    }
+    case M68000_UNLK:
+      reg[15] = reg[8 + index];
+      reg[8 + index] = pop32();
+      return 12;
+    case M68000_MOVE_TO_USP:
+    case M68000_MOVE_FROM_USP:
+      if ((sr & M68000_SR_S) == 0)
+      {
+        return exception(M68000_VECTOR_PRIVILEGE, instruction_pc);
+      }
+
+      if (OP == M68000_MOVE_TO_USP) { other_sp = reg[8 + index]; }
+      else { reg[8 + index] = other_sp; }
+
+      return 4;
+    case M68000_RESET:
+    case M68000_STOP:
+    case M68000_RTE:
+    case M68000_ANDI_SR:
+    case M68000_ORI_SR:
+    case M68000_EORI_SR:
+    {
+      if ((sr & M68000_SR_S) == 0)
+      {
+        return exception(M68000_VECTOR_PRIVILEGE, instruction_pc);
+      }
+
+      switch (OP)
+      {
+        case M68000_RESET:
+          return 132;
+        case M68000_STOP:
+          // Nothing can interrupt the CPU so stop ends the simulation.
+          set_sr(fetch16());
+          halted = true;
+          return 4;
+        case M68000_RTE:
+        {
+          const uint16_t value = pop16();
+
+          pc = pop32();
+          set_sr(value);
+
+          return 20;
+        }
+        case M68000_ANDI_SR: set_sr(sr & fetch16()); break;
+        case M68000_ORI_SR: set_sr(sr | fetch16()); break;
+        default: set_sr(sr ^ fetch16()); break;
+      }
+
+      return 20;
+    }
+    case M68000_NOP:
+      return 4;
+    case M68000_RTS:
+      // The stack starts out as if the simulator called the program, so
+      // a return with the stack back where it started ends it.
+      if (reg[15] == return_sp)
+      {
+        pc = M68000_RETURN_ADDRESS;
+        return 16;
+      }
+
+      pc = pop32();
+      return 16;
+    case M68000_TRAPV:
+      if ((sr & M68000_SR_V) != 0)
+      {
+        return exception(M68000_VECTOR_TRAPV, pc);
+      }
+
+      return 4;
+    case M68000_RTR:
+    {
+      const uint16_t value = pop16();
+
+      sr = (sr & 0xff00) | (value & 0x1f);
+      pc = pop32();
+
+      return 20;
+    }
+    case M68000_TRAP:
+      return exception(M68000_VECTOR_TRAP + (opcode & 0xf), pc);
+    case M68000_ABCD_REG:
+    case M68000_SBCD_REG:
+    {
+      const uint8_t src = reg[index];
+      const uint8_t dst = reg[dn];
+      const uint8_t result = OP == M68000_ABCD_REG ?
+        bcd_add(src, dst) :
+        bcd_sub(src, dst);
+
+      reg[dn] = (reg[dn] & 0xffffff00) | result;
+
+      return 6;
+    }
+    case M68000_ABCD_MEMORY:
+    case M68000_SBCD_MEMORY:
+    {
+      const uint8_t src = read_memory<1>(get_address<EA_AN_PRE, 1>(index));
+      address = get_address<EA_AN_PRE, 1>(dn);
+      const uint8_t dst = read_memory<1>(address);
+
+      write_memory<1>(address, OP == M68000_ABCD_MEMORY ?
+        bcd_add(src, dst) :
+        bcd_sub(src, dst));
+
+      return 18;
+    }
+    case M68000_ADDX_REG:
+    case M68000_SUBX_REG:
+    {
+      const int x = (sr >> 4) & 1;
+      const uint32_t result = OP == M68000_ADDX_REG ?
+        add_with_flags<SIZE>(reg[dn], reg[index], x, true) :
+        sub_with_flags<SIZE>(reg[dn], reg[index], x, true, true);
+
+      write_ea<EA_DN, SIZE>(dn, 0, result);
+
+      return SIZE == 4 ? 8 : 4;
+    }
+    case M68000_ADDX_MEMORY:
+    case M68000_SUBX_MEMORY:
+    {
+      const int x = (sr >> 4) & 1;
+      const uint32_t src = read_memory<SIZE>(get_address<EA_AN_PRE, SIZE>(index));
+      address = get_address<EA_AN_PRE, SIZE>(dn);
+      const uint32_t dst = read_memory<SIZE>(address);
+
+      write_memory<SIZE>(address, OP == M68000_ADDX_MEMORY ?
+        add_with_flags<SIZE>(dst, src, x, true) :
+        sub_with_flags<SIZE>(dst, src, x, true, true));
+
+      return SIZE == 4 ? 30 : 18;
+    }
+    case M68000_CMPM:
+    {
+      const uint32_t src = read_memory<SIZE>(get_address<EA_AN_POST, SIZE>(index));
+      const uint32_t dst = read_memory<SIZE>(get_address<EA_AN_POST, SIZE>(dn));
+
+      sub_with_flags<SIZE>(dst, src, 0, false, false);
+
+      return SIZE == 4 ? 20 : 12;
+    }
+    case M68000_EXG_DD:
+    case M68000_EXG_AA:
+    case M68000_EXG_DA:
+    {
+      const int rx = dn + (OP == M68000_EXG_AA ? 8 : 0);
+      const int ry = index + (OP == M68000_EXG_DD ? 0 : 8);
+      const uint32_t temp = reg[rx];
+
+      reg[rx] = reg[ry];
+      reg[ry] = temp;
+
+      return 6;
+    }
+    case M68000_MOVEP_TO_REG:
+    case M68000_MOVEP_TO_MEMORY:
+    {
+      // Every other byte, for 8 bit peripherals.
+      const int count = SIZE == 4 ? 4 : 2;
+
+      address = reg[8 + index] + (int16_t)fetch16();
+
+      if (OP == M68000_MOVEP_TO_REG)
+      {
+        uint32_t value = 0;
+
+        for (int n = 0; n < count; n++)
+        {
+          value = (value << 8) | read_memory<1>(address + n * 2);
+        }
+
+        write_ea<EA_DN, SIZE>(dn, 0, value);
+      }
+        else
+      {
+        for (int n = 0; n < count; n++)
+        {
+          write_memory<1>(address + n * 2, reg[dn] >> ((count - 1 - n) * 8));
+        }
+      }
+
+      return SIZE == 4 ? 24 : 16;
+    }
+    case M68000_ANDI_CCR:
+      sr &= 0xff00 | (fetch16() & 0x1f);
+      return 20;
+    case M68000_ORI_CCR:
+      sr |= fetch16() & 0x1f;
+      return 20;
+    case M68000_EORI_CCR:
+      sr ^= fetch16() & 0x1f;
+      return 20;
+  }
+
+  return -1;
+}
+
@@ -0,0 +1,157 @@
+/**
+ *  naken_asm assembler.
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: https://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2010-2023 by Michael Kohn
+ *
+ */
+
+#ifndef NAKEN_ASM_SIMULATE_68000_H
+#define NAKEN_ASM_SIMULATE_68000_H
+
+#include <unistd.h>
+
+#include "simulate/Simulate.h"
+
+// Returning from the top level function sets the PC to this.
+#define M68000_RETURN_ADDRESS 0xfffffffe
+
+// Where the stack starts when the program doesn't begin with a vector
+// table (the top of an Amiga 500's 512k of chip RAM).
+#define M68000_STACK_TOP 0x00080000
+
+#define M68000_SR_T 0x8000
+#define M68000_SR_S 0x2000
+#define M68000_SR_I 0x0700
+#define M68000_SR_X 0x0010
+#define M68000_SR_N 0x0008
+#define M68000_SR_Z 0x0004
+#define M68000_SR_V 0x0002
+#define M68000_SR_C 0x0001
+
+// Exception vector numbers.
+#define M68000_VECTOR_ILLEGAL 4
+#define M68000_VECTOR_ZERO_DIVIDE 5
+#define M68000_VECTOR_CHK 6
+#define M68000_VECTOR_TRAPV 7
+#define M68000_VECTOR_PRIVILEGE 8
+#define M68000_VECTOR_LINE_A 10
+#define M68000_VECTOR_LINE_F 11
+#define M68000_VECTOR_TRAP 32
+
+class Simulate68000 : public Simulate
+{
+public:
+  Simulate68000(Memory *memory);
+  virtual ~Simulate68000();
+
+  static Simulate *init(Memory *memory);
+
+  virtual void reset();
+  virtual void push(uint32_t value);
+  virtual int set_reg(const char *reg_string, uint32_t value);
+  virtual uint32_t get_reg(const char *reg_string);
+  virtual void set_pc(uint32_t value);
+  virtual void dump_registers();
+  virtual int run(int64_t max_cycles, int step);
+
+private:
+  typedef int (Simulate68000::*Handler)(uint16_t opcode);
+
+  // The handler for every possible first opcode word is looked up once
+  // when the first simulator is created.  Handlers are templates on the
+  // operation, operand size and effective address mode.
+  static Handler decode(uint16_t opcode);
+  template<int OP> static Handler get_handler(int size);
+  template<int OP, int SIZE> static Handler get_ea_handler(int mode, int valid);
+  template<int OP> static Handler get_sized_ea_handler(int size, int mode, int valid);
+  template<int SIZE, int DST> static Handler get_move_handler(int src);
+
+  template<int OP, int SIZE, int MODE> int execute(uint16_t opcode);
+  template<int SIZE, int DST, int SRC> int execute_move(uint16_t opcode);
+
+  template<int MODE, int SIZE> uint32_t get_address(int index);
+  template<int MODE, int SIZE> uint32_t read_ea(int index, uint32_t *address);
+  template<int MODE, int SIZE> void write_ea(int index, uint32_t address, uint32_t value);
+  template<int MODE, int SIZE> void store_ea(int index, uint32_t value);
+  template<int SIZE> uint32_t read_memory(uint32_t address);
+  template<int SIZE> void write_memory(uint32_t address, uint32_t value);
+
+  template<int SIZE> uint32_t add_with_flags(uint32_t a, uint32_t b, int x, bool extend);
+  template<int SIZE> uint32_t sub_with_flags(uint32_t a, uint32_t b, int x, bool extend, bool set_x);
+  template<int SIZE> uint32_t shift(int type, bool left, uint32_t value, int count);
+  template<int SIZE> void set_logic_flags(uint32_t result);
+
+  int execute_instructions(int count, uint64_t end_cycles);
+  int exception(int vector, uint32_t return_address);
+  uint32_t get_index_address(uint32_t base);
+  uint8_t bcd_add(uint8_t src, uint8_t dst);
+  uint8_t bcd_sub(uint8_t src, uint8_t dst);
+  void set_sr(uint16_t value);
+  void show_instructions(uint32_t address);
+
+  uint16_t fetch16()
+  {
+    uint16_t value = memory->read16(pc & 0x00ffffff);
+    pc += 2;
+    return value;
+  }
+
+  uint32_t fetch32()
+  {
+    uint32_t value = memory->read32(pc & 0x00ffffff);
+    pc += 4;
+    return value;
+  }
+
+  bool test_condition(int cond)
+  {
+    return ((condition_table[cond] >> (sr & 0xf)) & 1) != 0;
+  }
+
+  void push16(uint16_t value)
+  {
+    reg[15] -= 2;
+    write_memory<2>(reg[15], value);
+  }
+
+  void push32(uint32_t value)
+  {
+    reg[15] -= 4;
+    write_memory<4>(reg[15], value);
+  }
+
+  uint16_t pop16()
+  {
+    uint16_t value = read_memory<2>(reg[15]);
+    reg[15] += 2;
+    return value;
+  }
+
+  uint32_t pop32()
+  {
+    uint32_t value = read_memory<4>(reg[15]);
+    reg[15] += 4;
+    return value;
+  }
+
+  // d0 to d7 are reg[0] to reg[7] and a0 to a7 are reg[8] to reg[15].
+  // a7 is the stack pointer for the current mode and other_sp is the
+  // one for the other mode.
+  uint32_t reg[16];
+  uint32_t other_sp;
+  uint32_t pc;
+  uint32_t instruction_pc;
+  uint32_t return_sp;
+  uint16_t sr;
+  bool halted;
+
+  static Handler handlers[65536];
+  static uint16_t condition_table[16];
+};
+
+#endif
+
@@ -17,11 +17,12 @@
 #include "disasm/8008.h"
 #include "simulate/8008.h"
 
-#define READ_RAM(a) memory->read8(a)
-#define WRITE_RAM(a,b) memory->write8(a, b);
+#define READ_RAM(a) read_ram8(a)
+#define WRITE_RAM(a,b) write_ram8(a, b);
 
 Simulate8008::Simulate8008(Memory *memory) : Simulate(memory)
 {
+  enable_flat_ram(14);
   reset();
 }
 
@@ -76,19 +77,26 @@ void Simulate8008::dump_registers()
   printf("\n");
 }
 
-int Simulate8008::run(int max_cycles, int step)
+int Simulate8008::run(int64_t max_cycles, int step)
 {
   char instruction[128];
   uint16_t opcode;
-  int cycles = 0;
+  int64_t cycles = 0;
   int ret;
   int pc_current;
   int n;
 
   printf("Running... Press Ctl-C to break.\n");
 
+  stop_reason = SIMULATE_STOP_NONE;
+
   while (stop_running == false)
   {
+    instruction_count++;
+
+    // Instructions aren't timed yet so max_cycles counts instructions.
+    cycles++;
+
     pc_current = pc;
 
     opcode = READ_RAM(pc_current);
@@ -116,7 +124,7 @@ int Simulate8008::run(int max_cycles, int step)
         int cycles_min,cycles_max;
         int num, count;
 
-        num = READ_RAM(pc_current);
+        num = peek_ram8(pc_current);
 
         count = disasm_8008(
           memory,
@@ -126,7 +134,7 @@ int Simulate8008::run(int max_cycles, int step)
           &cycles_min,
           &cycles_max);
 
-        if (pc_current == break_point) { printf("*"); }
+        if (has_break_point(pc_current)) { printf("*"); }
         else { printf(" "); }
 
         if (n == 0) { printf("! "); }
@@ -141,10 +149,10 @@ int Simulate8008::run(int max_cycles, int step)
 
         while (count > 0)
         {
-          if (pc_current == break_point) { printf("*"); }
+          if (has_break_point(pc_current)) { printf("*"); }
           else { printf(" "); }
 
-          num = READ_RAM(pc_current);
+          num = peek_ram8(pc_current);
           printf("  0x%04x: 0x%02x\n", pc_current, num);
           pc_current += 1;
           count -= 2;
@@ -154,22 +162,28 @@ int Simulate8008::run(int max_cycles, int step)
 
     if (auto_run == true && nested_call_count < 0)
     {
+      stop_reason = SIMULATE_STOP_END;
       return 0;
     }
 
     if (ret == -1)
     {
       printf("Illegal instruction 0x%04x at address 0x%04x\n", opcode, pc_current);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
 
-    if (max_cycles != -1 && cycles > max_cycles) { break; }
+    if (max_cycles != -1 && cycles >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
 
-    printf("\n");
+    if (batch_mode == false) { printf("\n"); }
 
-    if (break_point == pc)
+    if (break_hit(pc))
     {
-      printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
@@ -182,7 +196,8 @@ int Simulate8008::run(int max_cycles, int step)
 
     if (reg[0] == 0xffff)
     {
-      printf("Function ended.  Total cycles: %d\n", cycle_count);
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
       step_mode = 0;
       pc = READ_RAM(0xfffe) | (READ_RAM(0xffff) << 8);
 
@@ -190,13 +205,13 @@ int Simulate8008::run(int max_cycles, int step)
       return 0;
     }
 
-    usleep(usec);
+    delay();
   }
 
   disable_signal_handler();
 
   printf("Stopped.  PC=0x%04x.\n", pc);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
@@ -0,0 +1,137 @@
+/**
+ *  naken_asm assembler.
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: https://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2010-2023 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulate/Profile.h"
+
+Profile::Profile() :
+  last_page  (NULL),
+  last_index (0xffffffff)
+{
+  memset(directory, 0, sizeof(directory));
+}
+
+Profile::~Profile()
+{
+  for (int n = 0; n < PROFILE_DIRECTORY_LEN; n++)
+  {
+    if (directory[n] == NULL) { continue; }
+
+    for (int i = 0; i < PROFILE_TABLE_LEN; i++)
+    {
+      free(directory[n][i]);
+    }
+
+    free(directory[n]);
+  }
+}
+
+void Profile::clear()
+{
+  for (int n = 0; n < PROFILE_DIRECTORY_LEN; n++)
+  {
+    if (directory[n] == NULL) { continue; }
+
+    for (int i = 0; i < PROFILE_TABLE_LEN; i++)
+    {
+      if (directory[n][i] == NULL) { continue; }
+
+      memset(directory[n][i], 0, PROFILE_PAGE_LEN * sizeof(ProfileCounts));
+    }
+  }
+}
+
+int Profile::iterate(ProfileIter *iter)
+{
+  while (iter->next <= 0xffffffff)
+  {
+    const uint32_t address = iter->next;
+    ProfileCounts *page = find_page(address);
+
+    if (page == NULL)
+    {
+      // Skip the rest of the page.
+      iter->next = (iter->next | (PROFILE_PAGE_LEN - 1)) + 1;
+      continue;
+    }
+
+    iter->next++;
+
+    ProfileCounts *counts = &page[address & (PROFILE_PAGE_LEN - 1)];
+
+    if (counts->count == 0) { continue; }
+
+    iter->address = address;
+    iter->count = counts->count;
+    iter->cycles = counts->cycles;
+
+    return 0;
+  }
+
+  return -1;
+}
+
+void Profile::get_totals(uint64_t *count, uint64_t *cycles)
+{
+  ProfileIter iter;
+
+  memset(&iter, 0, sizeof(iter));
+
+  *count = 0;
+  *cycles = 0;
+
+  while (iterate(&iter) == 0)
+  {
+    *count += iter.count;
+    *cycles += iter.cycles;
+  }
+}
+
+ProfileCounts *Profile::find_page(uint32_t address)
+{
+  const uint32_t index = address >> PROFILE_PAGE_BITS;
+  ProfileCounts **table = directory[index >> PROFILE_TABLE_BITS];
+
+  if (table == NULL) { return NULL; }
+
+  return table[index & (PROFILE_TABLE_LEN - 1)];
+}
+
+// Finds the page for address, allocating it if needed, and makes it
+// the one get_page() checks first.
+ProfileCounts *Profile::load_page(uint32_t address)
+{
+  const uint32_t index = address >> PROFILE_PAGE_BITS;
+  ProfileCounts **table = directory[index >> PROFILE_TABLE_BITS];
+
+  if (table == NULL)
+  {
+    table =
+      (ProfileCounts **)calloc(PROFILE_TABLE_LEN, sizeof(ProfileCounts *));
+    directory[index >> PROFILE_TABLE_BITS] = table;
+  }
+
+  ProfileCounts *page = table[index & (PROFILE_TABLE_LEN - 1)];
+
+  if (page == NULL)
+  {
+    page = (ProfileCounts *)calloc(PROFILE_PAGE_LEN, sizeof(ProfileCounts));
+    table[index & (PROFILE_TABLE_LEN - 1)] = page;
+  }
+
+  last_index = index;
+  last_page = page;
+
+  return page;
+}
@@ -0,0 +1,80 @@
+/**
+ *  naken_asm assembler.
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: https://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2010-2023 by Michael Kohn
+ *
+ */
+
+#ifndef NAKEN_ASM_SIMULATE_PROFILE_H
+#define NAKEN_ASM_SIMULATE_PROFILE_H
+
+#include <stdint.h>
+
+// Counts are kept in pages of PROFILE_PAGE_LEN addresses found through a
+// two level table so only the parts of the address space that run code
+// use memory.
+#define PROFILE_PAGE_BITS 12
+#define PROFILE_PAGE_LEN (1 << PROFILE_PAGE_BITS)
+#define PROFILE_TABLE_BITS 10
+#define PROFILE_TABLE_LEN (1 << PROFILE_TABLE_BITS)
+#define PROFILE_DIRECTORY_LEN \
+  (1 << (32 - PROFILE_PAGE_BITS - PROFILE_TABLE_BITS))
+
+struct ProfileCounts
+{
+  uint64_t count;
+  uint64_t cycles;
+};
+
+// Used with Profile::iterate() to walk the addresses that have run in
+// address order.  Set to all 0's before the first call.
+struct ProfileIter
+{
+  uint32_t address;
+  uint64_t count;
+  uint64_t cycles;
+  uint64_t next;
+};
+
+class Profile
+{
+public:
+  Profile();
+  ~Profile();
+
+  void record(uint32_t address, int cycles)
+  {
+    ProfileCounts *page = get_page(address);
+
+    page[address & (PROFILE_PAGE_LEN - 1)].count++;
+    page[address & (PROFILE_PAGE_LEN - 1)].cycles += cycles;
+  }
+
+  void clear();
+  int iterate(ProfileIter *iter);
+  void get_totals(uint64_t *count, uint64_t *cycles);
+
+private:
+  ProfileCounts *get_page(uint32_t address)
+  {
+    const uint32_t index = address >> PROFILE_PAGE_BITS;
+
+    if (index == last_index) { return last_page; }
+
+    return load_page(address);
+  }
+
+  ProfileCounts *load_page(uint32_t address);
+  ProfileCounts *find_page(uint32_t address);
+
+  ProfileCounts **directory[PROFILE_DIRECTORY_LEN];
+  ProfileCounts *last_page;
+  uint32_t last_index;
+};
+
+#endif
+
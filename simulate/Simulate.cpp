@@ -35,6 +35,692 @@ int Simulate::dump_ram(int start, int end)
   return 0;
 }
 
+int Simulate::load_packet(const uint8_t *data, int length)
+{
+  printf("Error: This arch doesn't run programs on packets.\n");
+
+  return -1;
+}
+
+int Simulate::add_io_range(uint32_t start, uint32_t end)
+{
+  if (io_range_count == SIMULATE_IO_RANGES_MAX)
+  {
+    printf("Error: Too many I/O ranges.\n");
+    return -1;
+  }
+
+  io_ranges[io_range_count].start = start;
+  io_ranges[io_range_count].end = end;
+  io_range_count++;
+
+  update_access_map();
+
+  return 0;
+}
+
+static uint32_t get_break_point_hash(uint32_t address)
+{
+  return (address * 0x9e3779b1) >> 24;
+}
+
+int Simulate::add_break_point(uint32_t address, int type, int hit_count)
+{
+  SimulateBreakPoint *break_point = find_break_point(address);
+
+  if (break_point == NULL)
+  {
+    if (break_point_count == SIMULATE_BREAK_POINTS_MAX)
+    {
+      printf("Error: Too many break points.\n");
+      return -1;
+    }
+
+    uint32_t index = get_break_point_hash(address);
+
+    while (break_points[index].type != 0)
+    {
+      index = (index + 1) % SIMULATE_BREAK_POINTS_LEN;
+    }
+
+    break_point = &break_points[index];
+    break_point->address = address;
+    break_point->type = 0;
+    break_point_count++;
+  }
+
+  if ((break_point->type & BREAK_POINT_EXEC) != 0) { exec_count--; }
+  if ((break_point->type & ~BREAK_POINT_EXEC) != 0) { watch_count--; }
+
+  break_point->type |= type;
+  break_point->hit_count = hit_count;
+  break_point->hits = 0;
+
+  if ((break_point->type & BREAK_POINT_EXEC) != 0) { exec_count++; }
+  if ((break_point->type & ~BREAK_POINT_EXEC) != 0) { watch_count++; }
+
+  update_access_map();
+
+  return 0;
+}
+
+int Simulate::delete_break_point(uint32_t address)
+{
+  SimulateBreakPoint *break_point = find_break_point(address);
+
+  if (break_point == NULL) { return -1; }
+
+  break_point->type = 0;
+
+  // Open addressing can't leave a hole in a chain so everything is put
+  // back in again.
+  SimulateBreakPoint old[SIMULATE_BREAK_POINTS_LEN];
+
+  memcpy(old, break_points, sizeof(old));
+  clear_break_points();
+
+  for (int n = 0; n < SIMULATE_BREAK_POINTS_LEN; n++)
+  {
+    if (old[n].type == 0) { continue; }
+
+    add_break_point(old[n].address, old[n].type, old[n].hit_count);
+    find_break_point(old[n].address)->hits = old[n].hits;
+  }
+
+  return 0;
+}
+
+void Simulate::clear_break_points()
+{
+  memset(break_points, 0, sizeof(break_points));
+
+  break_point_count = 0;
+  exec_count = 0;
+  watch_count = 0;
+  watch_type = 0;
+
+  update_access_map();
+}
+
+void Simulate::list_break_points()
+{
+  if (break_point_count == 0)
+  {
+    printf("No break points.\n");
+    return;
+  }
+
+  for (int n = 0; n < SIMULATE_BREAK_POINTS_LEN; n++)
+  {
+    SimulateBreakPoint *break_point = &break_points[n];
+
+    if (break_point->type == 0) { continue; }
+
+    printf("  0x%04x %c%c%c",
+      break_point->address,
+      (break_point->type & BREAK_POINT_EXEC) != 0 ? 'x' : '-',
+      (break_point->type & BREAK_POINT_READ) != 0 ? 'r' : '-',
+      (break_point->type & BREAK_POINT_WRITE) != 0 ? 'w' : '-');
+
+    printf("  hits: %u", break_point->hits);
+
+    if (break_point->hit_count > 1)
+    {
+      printf(" (stops at %u)", break_point->hit_count);
+    }
+
+    printf("\n");
+  }
+}
+
+int Simulate::enable_flat_ram(int address_bits)
+{
+  if (address_bits > 16)
+  {
+    printf("Internal Error: Flat RAM is limited to 16 bit addresses.\n");
+    return -1;
+  }
+
+  ram = memory->get_page_data(0);
+  ram_mask = (1 << address_bits) - 1;
+
+  return 0;
+}
+
+void Simulate::update_access_map()
+{
+  memset(access_map, 0, sizeof(access_map));
+
+  for (int n = 0; n < io_range_count; n++)
+  {
+    uint32_t start = io_ranges[n].start >> 8;
+    uint32_t end = io_ranges[n].end >> 8;
+
+    for (uint32_t i = start; i <= end && i < 256; i++) { access_map[i] = 1; }
+  }
+
+  for (int n = 0; n < SIMULATE_BREAK_POINTS_LEN; n++)
+  {
+    if ((break_points[n].type & ~BREAK_POINT_EXEC) == 0) { continue; }
+
+    access_map[(break_points[n].address >> 8) & 0xff] = 1;
+  }
+
+  for (int n = 0; n < 256; n++)
+  {
+    write_map[n] = access_map[n];
+
+    if (snapshot != NULL &&
+       (snapshot->blocks[n] & SIMULATE_SNAPSHOT_DIRTY) == 0)
+    {
+      write_map[n] = 1;
+    }
+  }
+}
+
+bool Simulate::is_io(uint32_t address)
+{
+  for (int n = 0; n < io_range_count; n++)
+  {
+    if (address >= io_ranges[n].start && address <= io_ranges[n].end)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+uint8_t Simulate::read_ram8_slow(uint32_t address)
+{
+  watch_access(address, BREAK_POINT_READ);
+
+  if (is_io(address)) { return io_read(address); }
+
+  return ram[address];
+}
+
+void Simulate::write_ram8_slow(uint32_t address, uint8_t value)
+{
+  if (snapshot != NULL &&
+     (snapshot->blocks[address >> 8] & SIMULATE_SNAPSHOT_DIRTY) == 0)
+  {
+    save_snapshot_block(address >> 8);
+  }
+
+  watch_access(address, BREAK_POINT_WRITE);
+
+  if (is_io(address))
+  {
+    io_write(address, value);
+    return;
+  }
+
+  ram[address] = value;
+}
+
+SimulateBreakPoint *Simulate::find_break_point(uint32_t address)
+{
+  uint32_t index = get_break_point_hash(address);
+
+  while (break_points[index].type != 0)
+  {
+    if (break_points[index].address == address)
+    {
+      return &break_points[index];
+    }
+
+    index = (index + 1) % SIMULATE_BREAK_POINTS_LEN;
+  }
+
+  return NULL;
+}
+
+bool Simulate::check_break_points(uint32_t pc)
+{
+  if (watch_type != 0)
+  {
+    printf("Watch point hit on %s of 0x%04x\n",
+      watch_type == BREAK_POINT_READ ? "read" : "write",
+      watch_address);
+
+    watch_type = 0;
+
+    return true;
+  }
+
+  if (exec_count == 0) { return false; }
+
+  SimulateBreakPoint *break_point = find_break_point(pc);
+
+  if (break_point == NULL || (break_point->type & BREAK_POINT_EXEC) == 0)
+  {
+    return false;
+  }
+
+  break_point->hits++;
+
+  if (break_point->hits < break_point->hit_count) { return false; }
+
+  printf("Breakpoint hit at 0x%04x\n", pc);
+
+  return true;
+}
+
+void Simulate::check_watch(uint32_t address, int type)
+{
+  SimulateBreakPoint *break_point = find_break_point(address);
+
+  if (break_point == NULL || (break_point->type & type) == 0) { return; }
+
+  break_point->hits++;
+
+  if (break_point->hits < break_point->hit_count) { return; }
+
+  // Only the first access is reported.  The run loop stops once the
+  // instruction is done.
+  if (watch_type == 0)
+  {
+    watch_type = type;
+    watch_address = address;
+  }
+}
+
+void Simulate::io_write(uint32_t address, uint8_t value)
+{
+  if (address == (uint32_t)break_io)
+  {
+    save_trace();
+    exit(value);
+  }
+
+  ram[address] = value;
+}
+
+int Simulate::enable_trace(const char *filename, int count)
+{
+  if (can_trace() == false)
+  {
+    printf("Error: This arch doesn't support tracing.\n");
+    return -1;
+  }
+
+  if (count <= 0)
+  {
+    printf("Error: Trace size must be at least 1.\n");
+    return -1;
+  }
+
+  free(trace);
+
+  trace = (SimulateTraceEntry *)malloc(count * sizeof(SimulateTraceEntry));
+
+  if (trace == NULL)
+  {
+    printf("Error: Cannot allocate trace buffer of %d entries.\n", count);
+    return -1;
+  }
+
+  trace_current = NULL;
+  trace_filename = filename;
+  trace_size = count;
+  trace_next = 0;
+  trace_count = 0;
+
+  memset(trace_regs, 0, sizeof(trace_regs));
+
+  return 0;
+}
+
+int Simulate::save_trace()
+{
+  if (trace == NULL) { return 0; }
+
+  FILE *out = fopen(trace_filename, "wb");
+
+  if (out == NULL)
+  {
+    printf("Error: Cannot open trace file %s for writing.\n", trace_filename);
+    return -1;
+  }
+
+  SimulateTraceHeader header;
+
+  memcpy(header.magic, "NAKTRACE", sizeof(header.magic));
+  header.entry_size = sizeof(SimulateTraceEntry);
+  header.count = trace_count;
+
+  fwrite(&header, sizeof(header), 1, out);
+
+  // Once the ring buffer has wrapped the oldest entry is the next one
+  // to be overwritten.
+  if (trace_count == trace_size)
+  {
+    fwrite(
+      trace + trace_next,
+      sizeof(SimulateTraceEntry),
+      trace_size - trace_next,
+      out);
+  }
+
+  fwrite(trace, sizeof(SimulateTraceEntry), trace_next, out);
+
+  fclose(out);
+
+  printf("Saved %u instructions to trace file %s\n",
+    trace_count,
+    trace_filename);
+
+  return 0;
+}
+
+int Simulate::decode_trace(const char *filename)
+{
+  FILE *in = fopen(filename, "rb");
+
+  if (in == NULL)
+  {
+    printf("Error: Cannot open trace file %s.\n", filename);
+    return -1;
+  }
+
+  SimulateTraceHeader header;
+
+  if (fread(&header, sizeof(header), 1, in) != 1 ||
+      memcmp(header.magic, "NAKTRACE", sizeof(header.magic)) != 0 ||
+      header.entry_size != sizeof(SimulateTraceEntry))
+  {
+    printf("Error: %s is not a trace file.\n", filename);
+    fclose(in);
+    return -1;
+  }
+
+  // Each instruction is put back in a scratch memory at its address so
+  // the disassembler sees the bytes that were run.
+  Memory scratch;
+  SimulateTraceEntry entry;
+  char instruction[128];
+
+  scratch.endian = memory->endian;
+
+  printf("\n%-10s %-10s %-32s Changes\n", "Addr", "Cycles", "Instruction");
+  printf("---------- ---------- -------------------------------- -------\n");
+
+  for (uint32_t n = 0; n < header.count; n++)
+  {
+    if (fread(&entry, sizeof(entry), 1, in) != 1)
+    {
+      printf("Error: Trace file %s is truncated.\n", filename);
+      fclose(in);
+      return -1;
+    }
+
+    scratch.write_block(entry.pc, entry.opcode, sizeof(entry.opcode));
+
+    if (disassemble(&scratch, entry.pc, instruction, sizeof(instruction)) < 0)
+    {
+      snprintf(instruction, sizeof(instruction), "<unknown>");
+    }
+
+    printf("0x%08x %10" PRIu64 " %-32s", entry.pc, entry.cycles, instruction);
+
+    for (int i = 0; i < SIMULATE_TRACE_REGS; i++)
+    {
+      if (entry.reg[i] == SIMULATE_TRACE_NO_REG) { break; }
+
+      printf(" %s=0x%x",
+        get_trace_reg_name(entry.reg[i]),
+        entry.reg_value[i]);
+    }
+
+    if (entry.write_length != 0)
+    {
+      printf(" [0x%04x]=", entry.write_address);
+
+      for (int i = 0; i < entry.write_length; i++)
+      {
+        printf("%02x", (entry.write_value >> (i * 8)) & 0xff);
+      }
+    }
+
+    printf("\n");
+  }
+
+  fclose(in);
+
+  return 0;
+}
+
+int Simulate::enable_profile()
+{
+  if (can_profile() == false)
+  {
+    printf("Error: This arch doesn't support profiling.\n");
+    return -1;
+  }
+
+  if (profile == NULL) { profile = new Profile(); }
+
+  return 0;
+}
+
+int Simulate::save_snapshot()
+{
+  if (can_snapshot() == false)
+  {
+    printf("Error: Snapshots aren't supported for this CPU.\n");
+    return -1;
+  }
+
+  free_snapshot();
+
+  snapshot = (SimulateSnapshot *)calloc(1, sizeof(SimulateSnapshot));
+
+  if (snapshot == NULL)
+  {
+    printf("Error: Cannot allocate snapshot.\n");
+    return -1;
+  }
+
+  snapshot->cycle_count = cycle_count;
+  snapshot->instruction_count = instruction_count;
+  snapshot->packet_count = packet_count;
+  snapshot->nested_call_count = nested_call_count;
+
+  // One extra byte so a simulator with no state doesn't get NULL from
+  // malloc(0).
+  snapshot->state = (uint8_t *)malloc(get_state_length() + 1);
+
+  if (snapshot->state == NULL)
+  {
+    printf("Error: Cannot allocate snapshot.\n");
+    free_snapshot();
+    return -1;
+  }
+
+  save_state(snapshot->state);
+
+  if (ram != NULL)
+  {
+    // Nothing is copied yet.  All blocks are marked in write_map so
+    // the first write to each one saves it.
+    snapshot->ram = (uint8_t *)malloc(ram_mask + 1);
+
+    if (snapshot->ram == NULL)
+    {
+      printf("Error: Cannot allocate snapshot.\n");
+      free_snapshot();
+      return -1;
+    }
+  }
+    else
+  {
+    if (memory->save_snapshot() != 0)
+    {
+      printf("Error: Cannot allocate snapshot.\n");
+      free_snapshot();
+      return -1;
+    }
+  }
+
+  update_access_map();
+
+  return 0;
+}
+
+int Simulate::restore_snapshot()
+{
+  if (snapshot == NULL)
+  {
+    printf("Error: No snapshot has been saved.\n");
+    return -1;
+  }
+
+  cycle_count = snapshot->cycle_count;
+  instruction_count = snapshot->instruction_count;
+  packet_count = snapshot->packet_count;
+  nested_call_count = snapshot->nested_call_count;
+  stop_reason = SIMULATE_STOP_NONE;
+
+  load_state(snapshot->state);
+
+  if (ram != NULL)
+  {
+    for (int n = 0; n < 256; n++)
+    {
+      if ((snapshot->blocks[n] & SIMULATE_SNAPSHOT_DIRTY) == 0) { continue; }
+
+      memcpy(ram + (n * 256), snapshot->ram + (n * 256), 256);
+
+      snapshot->blocks[n] = SIMULATE_SNAPSHOT_SAVED;
+      write_map[n] = 1;
+    }
+  }
+    else
+  {
+    memory->restore_snapshot();
+  }
+
+  return 0;
+}
+
+void Simulate::prepare_write(uint32_t address, int length)
+{
+  if (snapshot == NULL || ram == NULL) { return; }
+
+  for (int n = 0; n < length; n++)
+  {
+    uint32_t block = ((address + n) & ram_mask) >> 8;
+
+    if ((snapshot->blocks[block] & SIMULATE_SNAPSHOT_DIRTY) == 0)
+    {
+      save_snapshot_block(block);
+    }
+  }
+}
+
+void Simulate::save_snapshot_block(uint32_t block)
+{
+  if ((snapshot->blocks[block] & SIMULATE_SNAPSHOT_SAVED) == 0)
+  {
+    memcpy(snapshot->ram + (block * 256), ram + (block * 256), 256);
+  }
+
+  snapshot->blocks[block] = SIMULATE_SNAPSHOT_SAVED | SIMULATE_SNAPSHOT_DIRTY;
+  write_map[block] = access_map[block];
+}
+
+void Simulate::free_snapshot()
+{
+  if (snapshot == NULL) { return; }
+
+  if (ram == NULL) { memory->free_snapshot(); }
+
+  free(snapshot->state);
+  free(snapshot->ram);
+  free(snapshot);
+
+  snapshot = NULL;
+}
+
+void Simulate::record_instruction(uint32_t pc)
+{
+  SimulateTraceEntry *entry = trace + trace_next;
+
+  trace_next++;
+  if (trace_next == trace_size) { trace_next = 0; }
+  if (trace_count < trace_size) { trace_count++; }
+
+  entry->pc = pc;
+  entry->cycles = cycle_count;
+  entry->write_length = 0;
+  entry->reserved = 0;
+  entry->write_address = 0;
+  entry->write_value = 0;
+
+  for (int n = 0; n < SIMULATE_TRACE_REGS; n++)
+  {
+    entry->reg[n] = SIMULATE_TRACE_NO_REG;
+    entry->reg_value[n] = 0;
+  }
+
+  for (int n = 0; n < (int)sizeof(entry->opcode); n++)
+  {
+    if (ram != NULL)
+    {
+      entry->opcode[n] = ram[(pc + n) & ram_mask];
+    }
+      else
+    {
+      entry->opcode[n] = memory->read8(pc + n);
+    }
+  }
+
+  trace_current = entry;
+}
+
+void Simulate::record_registers(const uint32_t *regs, int count)
+{
+  int changed = 0;
+
+  if (count > SIMULATE_TRACE_REGS_MAX) { count = SIMULATE_TRACE_REGS_MAX; }
+
+  for (int n = 0; n < count; n++)
+  {
+    if (regs[n] == trace_regs[n]) { continue; }
+
+    trace_regs[n] = regs[n];
+
+    if (trace_current != NULL && changed < SIMULATE_TRACE_REGS)
+    {
+      trace_current->reg[changed] = n;
+      trace_current->reg_value[changed] = regs[n];
+      changed++;
+    }
+  }
+}
+
+void Simulate::record_write(uint32_t address, uint32_t value, int length)
+{
+  if (trace_current == NULL) { return; }
+
+  SimulateTraceEntry *entry = trace_current;
+
+  if (entry->write_length == 0)
+  {
+    entry->write_address = address;
+    entry->write_value = value;
+    entry->write_length = length;
+  }
+    else
+  if (address == entry->write_address + entry->write_length &&
+      entry->write_length + length <= 4)
+  {
+    entry->write_value |= value << (entry->write_length * 8);
+    entry->write_length += length;
+  }
+}
+
 void Simulate::handle_signal(int sig)
 {
   stop_running = true;
@@ -12,10 +12,104 @@
 #ifndef NAKEN_ASM_SIMULATE_SIMULATE_H
 #define NAKEN_ASM_SIMULATE_SIMULATE_H
 
+#include <inttypes.h>
 #include <signal.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "common/Memory.h"
+#include "simulate/Profile.h"
+
+#define SIMULATE_IO_RANGES_MAX 8
+#define SIMULATE_BREAK_POINTS_LEN 256
+#define SIMULATE_BREAK_POINTS_MAX (SIMULATE_BREAK_POINTS_LEN / 2)
+#define SIMULATE_TRACE_REGS 2
+#define SIMULATE_TRACE_REGS_MAX 32
+#define SIMULATE_TRACE_NO_REG 0xff
+#define SIMULATE_SNAPSHOT_SAVED 1
+#define SIMULATE_SNAPSHOT_DIRTY 2
+
+// Why the last call to run() returned.
+enum
+{
+  SIMULATE_STOP_NONE,
+  SIMULATE_STOP_END,
+  SIMULATE_STOP_BREAKPOINT,
+  SIMULATE_STOP_MAX_CYCLES,
+  SIMULATE_STOP_ILLEGAL,
+};
+
+// Types of break point, which can be or'ed together.  Read and write
+// (watch points) are checked on memory accesses the simulator makes
+// through read_ram8() / write_ram8() or watch_access().
+enum
+{
+  BREAK_POINT_EXEC = 1,
+  BREAK_POINT_READ = 2,
+  BREAK_POINT_WRITE = 4,
+};
+
+// A slot in the break point hash table (type is 0 if it's empty).  A
+// break point with a hit_count only stops once it has been hit that
+// many times.
+struct SimulateBreakPoint
+{
+  uint32_t address;
+  uint32_t hit_count;
+  uint32_t hits;
+  uint8_t type;
+};
+
+// Inclusive range of addresses that read_ram8() / write_ram8() hand to
+// io_read() / io_write() instead of RAM.
+struct SimulateIoRange
+{
+  uint32_t start;
+  uint32_t end;
+};
+
+// One instruction in a trace.  Only the first SIMULATE_TRACE_REGS
+// registers that changed and the first run of up to 4 bytes written are
+// kept.  write_value holds the bytes in address order starting with the
+// low 8 bits.
+struct SimulateTraceEntry
+{
+  uint64_t cycles;
+  uint32_t pc;
+  uint8_t opcode[8];
+  uint8_t reg[SIMULATE_TRACE_REGS];
+  uint8_t write_length;
+  uint8_t reserved;
+  uint32_t reg_value[SIMULATE_TRACE_REGS];
+  uint32_t write_address;
+  uint32_t write_value;
+};
+
+// Start of a trace file, followed by count entries oldest first.  Both
+// are written in the byte order of the host.
+struct SimulateTraceHeader
+{
+  char magic[8];
+  uint32_t entry_size;
+  uint32_t count;
+};
+
+// Saved by save_snapshot().  Flat RAM is copy-on-write in blocks of 256
+// bytes: a block is copied to ram the first time it's written after the
+// snapshot is saved or restored, so a restore only copies back the
+// blocks that were written.  Other simulators keep their memory in
+// Memory, which does the same for each page.
+struct SimulateSnapshot
+{
+  uint64_t cycle_count;
+  uint64_t instruction_count;
+  uint64_t packet_count;
+  int nested_call_count;
+  uint8_t *state;
+  uint8_t *ram;
+  uint8_t blocks[256];
+};
 
 class Simulate
 {
@@ -23,20 +117,46 @@ public:
   Simulate(Memory *memory) :
     memory            (memory),
     cycle_count       (0),
+    instruction_count (0),
+    packet_count      (0),
+    packet_repeat     (1),
     nested_call_count (0),
     usec              (1000000),
-    break_point       (0xffffffff),
     break_io          (0),
+    stop_reason       (SIMULATE_STOP_NONE),
     step_mode         (false),
     show              (true),
-    auto_run          (true)
+    auto_run          (true),
+    batch_mode        (false),
+    ram               (NULL),
+    ram_mask          (0),
+    io_range_count    (0),
+    break_point_count (0),
+    exec_count        (0),
+    watch_count       (0),
+    watch_type        (0),
+    watch_address     (0),
+    trace             (NULL),
+    trace_current     (NULL),
+    trace_filename    (NULL),
+    trace_size        (0),
+    trace_next        (0),
+    trace_count       (0),
+    profile           (NULL),
+    snapshot          (NULL)
   {
+    memset(access_map, 0, sizeof(access_map));
+    memset(write_map, 0, sizeof(write_map));
+    memset(break_points, 0, sizeof(break_points));
     enable_signal_handler();
   }
 
   virtual ~Simulate()
   {
     disable_signal_handler();
+    free(trace);
+    delete profile;
+    free_snapshot();
   }
 
   //static Simulate *init(Memory *memory);
@@ -47,22 +167,74 @@ public:
   virtual uint32_t get_reg(const char *reg_string) = 0;
   virtual void set_pc(uint32_t value) = 0;
   virtual void dump_registers() = 0;
-  virtual int run(int max_cycles, int step) = 0;
+  virtual int run(int64_t max_cycles, int step) = 0;
 
   // For chips that don't have RAM in the same address space as
   // instruction memory.
   virtual int dump_ram(int start, int end);
 
-  int get_break_point() { return break_point; }
+  // For chips that run a program once per block of input data, such
+  // as eBPF running on network packets.
+  virtual int load_packet(const uint8_t *data, int length);
+
+  // For simulators that record traces: the disassembler for the CPU and
+  // the names of the registers passed to trace_registers().
+  virtual bool can_trace() { return false; }
+
+  virtual int disassemble(
+    Memory *memory,
+    uint32_t address,
+    char *instruction,
+    int length)
+  {
+    return -1;
+  }
+
+  virtual const char *get_trace_reg_name(int index) { return "?"; }
+
+  // Keep the last count instructions run and write them to filename
+  // when save_trace() is called after the simulation stops.
+  int enable_trace(const char *filename, int count);
+  int save_trace();
+  int decode_trace(const char *filename);
+
+  // Count executions and cycles for each address the PC reaches.
+  virtual bool can_profile() { return false; }
+  int enable_profile();
+  Profile *get_profile() { return profile; }
+
+  // Save registers, cycle counts and memory so the simulation can be
+  // sent back to this point any number of times with restore_snapshot().
+  virtual bool can_snapshot() { return false; }
+  int save_snapshot();
+  int restore_snapshot();
+
+  // Called before memory is changed from outside of the simulation so
+  // the snapshot can keep what was there.
+  void prepare_write(uint32_t address, int length);
+
+  int add_break_point(uint32_t address, int type, int hit_count);
+  int delete_break_point(uint32_t address);
+  void clear_break_points();
+  void list_break_points();
+  int get_break_point_count() { return break_point_count; }
+
   int get_delay() { return usec; }
   bool get_show() { return show; }
+  uint64_t get_cycles() { return cycle_count; }
+  uint64_t get_instruction_count() { return instruction_count; }
+  int get_stop_reason() { return stop_reason; }
+  uint64_t get_packet_count() { return packet_count; }
 
-  void set_break_point(int value) { break_point = value; }
   void set_delay(useconds_t value) { usec = value; }
-  void set_break_io(int value) { break_io = value; }
+  void set_break_io(int value)
+  {
+    break_io = value;
+    if (value >= 0) { add_io_range(value, value); }
+  }
+
+  void set_packet_repeat(int value) { packet_repeat = value; }
 
-  void remove_break_point() { break_point = -1; }
-  bool is_break_point_set() { return break_point == -1; }
   bool in_step_mode() { return usec == 0; }
   bool in_auto_run() { return auto_run == 0; }
 
@@ -70,6 +242,17 @@ public:
   void enable_show() { show = true; }
   void enable_auto_run() { auto_run = true; }
 
+  // Batch mode runs at full speed with no output per instruction.
+  void enable_batch_mode()
+  {
+    batch_mode = true;
+    show = false;
+  }
+
+  bool in_batch_mode() { return batch_mode; }
+
+  int add_io_range(uint32_t start, uint32_t end);
+
   void disable_step_mode()
   {
     step_mode = false;
@@ -91,15 +274,167 @@ protected:
   void enable_signal_handler();
   void disable_signal_handler();
 
+  void delay()
+  {
+    if (batch_mode == false) { usleep(usec > 999999 ? 999999 : usec); }
+  }
+
+  // For CPUs with an address space of up to 16 bits.  The whole space
+  // is a single Memory page so ram points straight at its bytes: the
+  // program loaded into Memory is already there and anything written
+  // is seen by Memory without copying back.
+  int enable_flat_ram(int address_bits);
+
+  uint8_t read_ram8(uint32_t address)
+  {
+    address &= ram_mask;
+
+    if (access_map[address >> 8] != 0) { return read_ram8_slow(address); }
+
+    return ram[address];
+  }
+
+  void write_ram8(uint32_t address, uint8_t value)
+  {
+    address &= ram_mask;
+
+    trace_write(address, value, 1);
+
+    if (write_map[address >> 8] != 0)
+    {
+      write_ram8_slow(address, value);
+      return;
+    }
+
+    ram[address] = value;
+  }
+
+  // For showing memory.  Doesn't count as an access for watch points
+  // or I/O.
+  uint8_t peek_ram8(uint32_t address) { return ram[address & ram_mask]; }
+
+  // Called for accesses in a range added with add_io_range().  By
+  // default these act like RAM except a write to break_io exits.
+  virtual uint8_t io_read(uint32_t address) { return ram[address]; }
+  virtual void io_write(uint32_t address, uint8_t value);
+
+  bool is_io(uint32_t address);
+  uint8_t read_ram8_slow(uint32_t address);
+  void write_ram8_slow(uint32_t address, uint8_t value);
+  void update_access_map();
+
+  // Simulators that can snapshot copy their registers (and any memory
+  // that isn't in Memory) to and from get_state_length() bytes.
+  virtual int get_state_length() { return 0; }
+  virtual void save_state(uint8_t *state) { }
+  virtual void load_state(const uint8_t *state) { }
+
+  void save_snapshot_block(uint32_t block);
+  void free_snapshot();
+
+  // Run loops call break_hit() with the PC after each instruction.  It
+  // prints and returns true if a watch point was hit by the instruction
+  // or there is an exec break point at pc.  has_break_point() is for
+  // showing break points and doesn't count as a hit.
+  bool break_hit(uint32_t pc)
+  {
+    if (break_point_count == 0) { return false; }
+
+    return check_break_points(pc);
+  }
+
+  bool has_break_point(uint32_t address)
+  {
+    if (exec_count == 0) { return false; }
+
+    SimulateBreakPoint *break_point = find_break_point(address);
+
+    return break_point != NULL && (break_point->type & BREAK_POINT_EXEC) != 0;
+  }
+
+  // For memory accesses that don't go through read_ram8() / write_ram8().
+  void watch_access(uint32_t address, int type)
+  {
+    if (watch_count != 0) { check_watch(address, type); }
+  }
+
+  SimulateBreakPoint *find_break_point(uint32_t address);
+  bool check_break_points(uint32_t pc);
+  void check_watch(uint32_t address, int type);
+
+  // Simulators call trace_instruction() before running the instruction
+  // at pc and trace_registers() after.  Writes through write_ram8() are
+  // recorded already, others call trace_write().  With tracing off each
+  // of these is only a test of trace.
+  void trace_instruction(uint32_t pc)
+  {
+    if (trace != NULL) { record_instruction(pc); }
+  }
+
+  void trace_registers(const uint32_t *regs, int count)
+  {
+    if (trace != NULL) { record_registers(regs, count); }
+  }
+
+  void trace_write(uint32_t address, uint32_t value, int length)
+  {
+    if (trace != NULL) { record_write(address, value, length); }
+  }
+
+  void record_instruction(uint32_t pc);
+  void record_registers(const uint32_t *regs, int count);
+  void record_write(uint32_t address, uint32_t value, int length);
+
+  // Simulators that can profile call this after each instruction with
+  // its address and the cycles it took.
+  void profile_instruction(uint32_t pc, int cycles)
+  {
+    if (profile != NULL) { profile->record(pc, cycles); }
+  }
+
   Memory *memory;
-  int cycle_count;
+  uint64_t cycle_count;
+  uint64_t instruction_count;
+  uint64_t packet_count;
+  int packet_repeat;
   int nested_call_count;
   useconds_t usec;
-  int break_point;
   int break_io;
+  int stop_reason;
   bool step_mode : 1;
   bool show : 1;
   bool auto_run : 1;
+  bool batch_mode : 1;
+
+  uint8_t *ram;
+  uint32_t ram_mask;
+
+  // One entry per 256 bytes of RAM that is non-zero if any address
+  // in it is in an I/O range or has a watch point, so RAM accesses only
+  // need one check.  write_map also marks blocks that still need to be
+  // saved for a snapshot.
+  uint8_t access_map[256];
+  uint8_t write_map[256];
+  SimulateIoRange io_ranges[SIMULATE_IO_RANGES_MAX];
+  int io_range_count;
+
+  SimulateBreakPoint break_points[SIMULATE_BREAK_POINTS_LEN];
+  int break_point_count;
+  int exec_count;
+  int watch_count;
+  int watch_type;
+  uint32_t watch_address;
+
+  SimulateTraceEntry *trace;
+  SimulateTraceEntry *trace_current;
+  const char *trace_filename;
+  uint32_t trace_size;
+  uint32_t trace_next;
+  uint32_t trace_count;
+  uint32_t trace_regs[SIMULATE_TRACE_REGS_MAX];
+
+  Profile *profile;
+  SimulateSnapshot *snapshot;
 };
 
 #endif
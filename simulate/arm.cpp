@@ -0,0 +1,1722 @@
+/**
+ *  naken_asm assembler.
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: https://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2010-2023 by Michael Kohn
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "simulate/arm.h"
+#include "disasm/arm.h"
+#include "disasm/thumb.h"
+
+// Handlers 0 to 63 are the data processing instructions: the opcode
+// (AND to MVN) times 4 plus how the second operand is found.
+enum
+{
+  OPERAND_IMM,
+  OPERAND_REG,
+  OPERAND_SHIFT_IMM,
+  OPERAND_SHIFT_REG,
+};
+
+enum
+{
+  ALU_AND,
+  ALU_EOR,
+  ALU_SUB,
+  ALU_RSB,
+  ALU_ADD,
+  ALU_ADC,
+  ALU_SBC,
+  ALU_RSC,
+  ALU_TST,
+  ALU_TEQ,
+  ALU_CMP,
+  ALU_CMN,
+  ALU_ORR,
+  ALU_MOV,
+  ALU_BIC,
+  ALU_MVN,
+};
+
+enum
+{
+  ARM_DATA = 0,
+  ARM_MUL = 64,
+  ARM_MLA,
+  ARM_UMULL,
+  ARM_UMLAL,
+  ARM_SMULL,
+  ARM_SMLAL,
+  ARM_SWP,
+  ARM_SWPB,
+  ARM_MRS,
+  ARM_MSR,
+  ARM_LDR,
+  ARM_STR,
+  ARM_LDRB,
+  ARM_STRB,
+  ARM_LDRH,
+  ARM_STRH,
+  ARM_LDRSB,
+  ARM_LDRSH,
+  ARM_LDM,
+  ARM_STM,
+  ARM_B,
+  ARM_BL,
+  ARM_BX,
+  ARM_SWI,
+  ARM_UNDEFINED,
+  THUMB_BL_HIGH,
+  THUMB_BL_LOW,
+  ARM_HANDLER_COUNT
+};
+
+enum
+{
+  SHIFT_LSL,
+  SHIFT_LSR,
+  SHIFT_ASR,
+  SHIFT_ROR,
+  SHIFT_RRX,
+};
+
+#define DATA(op, operand) (ARM_DATA + ((op) << 2) + (operand))
+
+SimulateArm::Handler SimulateArm::handlers[ARM_HANDLER_COUNT];
+uint16_t SimulateArm::condition_table[16];
+
+template<>
+void SimulateArm::build_handlers<ARM_HANDLER_COUNT>()
+{
+}
+
+template<int OP>
+void SimulateArm::build_handlers()
+{
+  handlers[OP] = &SimulateArm::execute<OP>;
+  build_handlers<OP + 1>();
+}
+
+SimulateArm::SimulateArm(Memory *memory) : Simulate(memory)
+{
+  if (handlers[0] == NULL)
+  {
+    build_handlers<0>();
+
+    // Bit n of condition_table[cond] is set if cond passes when NZCV
+    // (the top 4 bits of CPSR) is n.
+    for (int flags = 0; flags < 16; flags++)
+    {
+      const bool n = (flags & 8) != 0;
+      const bool z = (flags & 4) != 0;
+      const bool c = (flags & 2) != 0;
+      const bool v = (flags & 1) != 0;
+
+      const bool passed[16] =
+      {
+        z, !z, c, !c, n, !n, v, !v,
+        c && !z, !c || z, n == v, n != v,
+        !z && n == v, z || n != v, true, false
+      };
+
+      for (int cond = 0; cond < 16; cond++)
+      {
+        if (passed[cond]) { condition_table[cond] |= 1 << flags; }
+      }
+    }
+  }
+
+  start_thumb = false;
+
+  reset();
+}
+
+SimulateArm::~SimulateArm()
+{
+}
+
+Simulate *SimulateArm::init(Memory *memory)
+{
+  return new SimulateArm(memory);
+}
+
+Simulate *SimulateArm::init_thumb(Memory *memory)
+{
+  SimulateArm *simulate = new SimulateArm(memory);
+
+  simulate->start_thumb = true;
+  simulate->reset();
+
+  return simulate;
+}
+
+void SimulateArm::reset()
+{
+  memset(reg, 0, sizeof(reg));
+  memset(bank_r13, 0, sizeof(bank_r13));
+  memset(bank_r14, 0, sizeof(bank_r14));
+  memset(bank_spsr, 0, sizeof(bank_spsr));
+  memset(bank_fiq, 0, sizeof(bank_fiq));
+  memset(bank_usr, 0, sizeof(bank_usr));
+
+  // ARM code starts the way the CPU comes out of reset, in supervisor
+  // mode with interrupts off.  Thumb code is expected to be a routine
+  // being tested so it starts in system mode.
+  if (start_thumb)
+  {
+    cpsr = ARM_MODE_SYS | ARM_CPSR_T;
+  }
+    else
+  {
+    cpsr = ARM_MODE_SVC | ARM_CPSR_I | ARM_CPSR_F;
+  }
+
+  pc = memory->low_address & (start_thumb ? 0xfffffffe : 0xfffffffc);
+  reg[13] = 0x40000000;
+  reg[14] = ARM_RETURN_ADDRESS;
+
+  cycle_count = 0;
+  halted = false;
+
+  flush_decode_cache();
+}
+
+void SimulateArm::push(uint32_t value)
+{
+  reg[13] -= 4;
+  memory->write32(reg[13], value);
+}
+
+int SimulateArm::set_reg(const char *reg_string, uint32_t value)
+{
+  while (*reg_string == ' ') { reg_string++; }
+
+  if (strcmp(reg_string, "pc") == 0 || strcmp(reg_string, "r15") == 0)
+  {
+    set_pc(value);
+    return 0;
+  }
+
+  if (strcmp(reg_string, "cpsr") == 0)
+  {
+    switch_mode(value & ARM_CPSR_MODE);
+    cpsr = value;
+    return 0;
+  }
+
+  if (strcmp(reg_string, "sp") == 0) { reg_string = "r13"; }
+  if (strcmp(reg_string, "lr") == 0) { reg_string = "r14"; }
+
+  if (reg_string[0] == 'r')
+  {
+    int index = atoi(reg_string + 1);
+    if (index < 0 || index > 14) { return -1; }
+
+    reg[index] = value;
+    return 0;
+  }
+
+  return -1;
+}
+
+uint32_t SimulateArm::get_reg(const char *reg_string)
+{
+  while (*reg_string == ' ') { reg_string++; }
+
+  if (strcmp(reg_string, "pc") == 0 || strcmp(reg_string, "r15") == 0)
+  {
+    return pc;
+  }
+
+  if (strcmp(reg_string, "cpsr") == 0) { return cpsr; }
+  if (strcmp(reg_string, "sp") == 0) { reg_string = "r13"; }
+  if (strcmp(reg_string, "lr") == 0) { reg_string = "r14"; }
+
+  if (reg_string[0] == 'r')
+  {
+    int index = atoi(reg_string + 1);
+    if (index < 0 || index > 14) { return 0; }
+
+    return reg[index];
+  }
+
+  return 0;
+}
+
+void SimulateArm::set_pc(uint32_t value)
+{
+  // Bit 0 picks Thumb the same as BX.
+  if ((value & 1) != 0) { cpsr |= ARM_CPSR_T; }
+
+  pc = value & ((cpsr & ARM_CPSR_T) != 0 ? 0xfffffffe : 0xfffffffc);
+}
+
+void SimulateArm::dump_registers()
+{
+  const char *mode;
+  int n;
+
+  switch (cpsr & ARM_CPSR_MODE)
+  {
+    case ARM_MODE_USR: mode = "usr"; break;
+    case ARM_MODE_FIQ: mode = "fiq"; break;
+    case ARM_MODE_IRQ: mode = "irq"; break;
+    case ARM_MODE_SVC: mode = "svc"; break;
+    case ARM_MODE_ABT: mode = "abt"; break;
+    case ARM_MODE_UND: mode = "und"; break;
+    case ARM_MODE_SYS: mode = "sys"; break;
+    default: mode = "???"; break;
+  }
+
+  printf("\nSimulation Register Dump\n");
+  printf("-------------------------------------------------------------------\n");
+  printf(" PC: 0x%08x  CPSR: 0x%08x %c%c%c%c %s %s  SPSR: 0x%08x\n",
+    pc,
+    cpsr,
+    (cpsr & ARM_CPSR_N) != 0 ? 'N' : '-',
+    (cpsr & ARM_CPSR_Z) != 0 ? 'Z' : '-',
+    (cpsr & ARM_CPSR_C) != 0 ? 'C' : '-',
+    (cpsr & ARM_CPSR_V) != 0 ? 'V' : '-',
+    (cpsr & ARM_CPSR_T) != 0 ? "thumb" : "arm",
+    mode,
+    get_spsr());
+
+  for (n = 0; n < 15; n++)
+  {
+    char name[4];
+
+    if (n == 13) { strcpy(name, "sp"); }
+    else if (n == 14) { strcpy(name, "lr"); }
+    else { snprintf(name, sizeof(name), "r%d", n); }
+
+    printf("%c%3s: 0x%08x", (n & 0x3) == 0 ? '\n' : ' ', name, reg[n]);
+  }
+
+  printf("\n\n");
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
+}
+
+int SimulateArm::run(int64_t max_cycles, int step)
+{
+  int64_t cycles = 0;
+
+  printf("Running... Press Ctl-C to break.\n");
+
+  stop_reason = SIMULATE_STOP_NONE;
+  halted = false;
+
+  // Memory could have been changed from outside since the last run.
+  flush_decode_cache();
+
+  while (stop_running == false)
+  {
+    uint32_t current_pc = pc;
+
+    if (max_cycles != -1 && cycles >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    // Outside of batch mode instructions are run one at a time so each
+    // can be shown or delayed.  Break points and watch points are
+    // checked after every instruction.
+    int count = 1;
+    uint64_t end_cycles = UINT64_MAX;
+
+    if (batch_mode == true && step == false && break_point_count == 0)
+    {
+      count = 4096;
+
+      // Instructions take a varying number of cycles, so the batch also
+      // has to stop once max_cycles have run.
+      if (max_cycles != -1) { end_cycles = cycle_count + (max_cycles - cycles); }
+    }
+
+    const uint64_t start_cycles = cycle_count;
+
+    if (execute_instructions(count, end_cycles) == -1)
+    {
+      stop_reason = SIMULATE_STOP_ILLEGAL;
+      disable_signal_handler();
+      return -1;
+    }
+
+    cycles += cycle_count - start_cycles;
+
+    if (show == true)
+    {
+      printf("\x1b[1J\x1b[1;1H");
+      dump_registers();
+      show_instructions(current_pc);
+    }
+
+    if (halted == true)
+    {
+      printf("Halted at 0x%08x.  Total cycles: %" PRIu64 "\n", pc, cycle_count);
+      stop_reason = SIMULATE_STOP_END;
+      disable_signal_handler();
+      return 0;
+    }
+
+    if (pc == ARM_RETURN_ADDRESS)
+    {
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
+      step_mode = false;
+      disable_signal_handler();
+      return 0;
+    }
+
+    if (break_hit(pc))
+    {
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
+      break;
+    }
+
+    if (usec == 0 || step == true)
+    {
+      disable_signal_handler();
+      return 0;
+    }
+
+    delay();
+  }
+
+  disable_signal_handler();
+
+  printf("Stopped.  PC=0x%08x.\n", pc);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
+
+  return 0;
+}
+
+// Runs up to count instructions, stopping early once cycle_count reaches
+// end_cycles.  Returns -1 if an instruction with no handler stopped the
+// simulation.
+int SimulateArm::execute_instructions(int count, uint64_t end_cycles)
+{
+  for (int n = 0; n < count; n++)
+  {
+    const uint32_t address = pc | ((cpsr & ARM_CPSR_T) >> 5);
+    ArmDecode *entry = &decode_cache[(address >> 1) & ARM_DECODE_CACHE_MASK];
+
+    if (entry->address != address) { decode(entry, address); }
+
+    // Reading r15 gives the address of the instruction plus 8 for ARM
+    // or plus 4 for Thumb.
+    reg[15] = pc + entry->size * 2;
+    pc += entry->size;
+
+    int cycles = 1;
+
+    if (entry->cond == ARM_COND_AL || condition_passed(entry->cond))
+    {
+      cycles = (this->*entry->execute)(entry);
+
+      if (cycles == -1) { return -1; }
+
+      if ((entry->flags & ARM_FLAG_PC) != 0)
+      {
+        pc = reg[15] & ((cpsr & ARM_CPSR_T) != 0 ? 0xfffffffe : 0xfffffffc);
+        cycles += 2;
+      }
+    }
+
+    cycle_count += cycles;
+    instruction_count++;
+
+    if (halted == true || pc == ARM_RETURN_ADDRESS) { break; }
+    if (cycle_count >= end_cycles) { break; }
+  }
+
+  return 0;
+}
+
+void SimulateArm::decode(ArmDecode *decode, uint32_t address)
+{
+  decode->address = address;
+  decode->imm = 0;
+  decode->reg_list = 0;
+  decode->cond = ARM_COND_AL;
+  decode->rd = 0;
+  decode->rn = 0;
+  decode->rm = 0;
+  decode->rs = 0;
+  decode->shift_type = SHIFT_LSL;
+  decode->shift = 0;
+  decode->flags = 0;
+  decode->cycles = 1;
+
+  if ((address & 1) != 0)
+  {
+    decode->size = 2;
+    decode_thumb(decode, memory->read16(address & 0xfffffffe));
+  }
+    else
+  {
+    decode->size = 4;
+    decode_arm(decode, memory->read32(address));
+  }
+}
+
+// Shifts by an immediate are stored as the equivalent shift by a
+// register: LSR #0 and ASR #0 mean 32 and ROR #0 is RRX.
+static void decode_shift_imm(ArmDecode *decode, int type, int amount)
+{
+  if (amount == 0)
+  {
+    if (type == SHIFT_LSR || type == SHIFT_ASR) { amount = 32; }
+    if (type == SHIFT_ROR) { type = SHIFT_RRX; amount = 1; }
+  }
+
+  decode->shift_type = type;
+  decode->shift = amount;
+}
+
+void SimulateArm::decode_arm(ArmDecode *decode, uint32_t opcode)
+{
+  const uint32_t address = decode->address;
+  const int rn = (opcode >> 16) & 0xf;
+  const int rd = (opcode >> 12) & 0xf;
+  const int rs = (opcode >> 8) & 0xf;
+  const int rm = opcode & 0xf;
+  int n = ARM_UNDEFINED;
+
+  // Condition 15 (NV) is never true on ARMv4.
+  decode->cond = opcode >> 28;
+  decode->rn = rn;
+  decode->rd = rd;
+  decode->rs = rs;
+  decode->rm = rm;
+
+  if ((opcode & 0x01000000) != 0) { decode->flags |= ARM_FLAG_P; }
+  if ((opcode & 0x00800000) != 0) { decode->flags |= ARM_FLAG_U; }
+  if ((opcode & 0x00200000) != 0) { decode->flags |= ARM_FLAG_W; }
+
+  if ((opcode & BRANCH_EXCH_MASK) == BRANCH_EXCH_OPCODE)
+  {
+    n = ARM_BX;
+    decode->cycles = 3;
+  }
+    else
+  if ((opcode & MUL_MASK) == MUL_OPCODE)
+  {
+    // Multiplies have Rd in bits 16 to 19 and Rn (RdLo) in 12 to 15.
+    decode->rd = rn;
+    decode->rn = rd;
+
+    n = (opcode & 0x00200000) != 0 ? ARM_MLA : ARM_MUL;
+    if ((opcode & 0x00100000) != 0) { decode->flags |= ARM_FLAG_S; }
+  }
+    else
+  if ((opcode & 0x0f8000f0) == 0x00800090)
+  {
+    const bool is_signed = (opcode & 0x00400000) != 0;
+
+    decode->rd = rn;
+    decode->rn = rd;
+
+    if ((opcode & 0x00200000) != 0) { n = is_signed ? ARM_SMLAL : ARM_UMLAL; }
+    else { n = is_signed ? ARM_SMULL : ARM_UMULL; }
+
+    if ((opcode & 0x00100000) != 0) { decode->flags |= ARM_FLAG_S; }
+  }
+    else
+  if ((opcode & SWAP_MASK) == SWAP_OPCODE)
+  {
+    n = (opcode & 0x00400000) != 0 ? ARM_SWPB : ARM_SWP;
+    decode->cycles = 4;
+  }
+    else
+  if ((opcode & 0x0e000090) == 0x00000090 && (opcode & 0x60) != 0)
+  {
+    // Halfword and signed transfers.
+    const bool load = (opcode & 0x00100000) != 0;
+
+    switch ((opcode >> 5) & 3)
+    {
+      case 1: n = load ? ARM_LDRH : ARM_STRH; break;
+      case 2: if (load) { n = ARM_LDRSB; } break;
+      case 3: if (load) { n = ARM_LDRSH; } break;
+    }
+
+    if ((opcode & 0x00400000) != 0)
+    {
+      decode->imm = ((opcode >> 4) & 0xf0) | (opcode & 0xf);
+    }
+      else
+    {
+      decode->flags |= ARM_FLAG_R;
+    }
+
+    decode->cycles = load ? 3 : 2;
+    if (load && rd == 15) { decode->flags |= ARM_FLAG_PC; }
+  }
+    else
+  if ((opcode & MRS_MASK) == MRS_OPCODE)
+  {
+    n = ARM_MRS;
+    if ((opcode & 0x00400000) != 0) { decode->flags |= ARM_FLAG_SPSR; }
+  }
+    else
+  if ((opcode & 0x0db0f000) == 0x0120f000)
+  {
+    n = ARM_MSR;
+    if ((opcode & 0x00400000) != 0) { decode->flags |= ARM_FLAG_SPSR; }
+
+    // rs holds the fields (c, x, s, f) to write.
+    decode->rs = rn;
+
+    if ((opcode & 0x02000000) != 0)
+    {
+      const int rotate = ((opcode >> 8) & 0xf) * 2;
+      const uint32_t imm = opcode & 0xff;
+      decode->imm = rotate == 0 ? imm : (imm >> rotate) | (imm << (32 - rotate));
+    }
+      else
+    {
+      decode->flags |= ARM_FLAG_R;
+    }
+  }
+    else
+  if ((opcode & ALU_MASK) == ALU_OPCODE)
+  {
+    const int op = (opcode >> 21) & 0xf;
+    int operand;
+
+    // TST, TEQ, CMP and CMN without S are other instructions.
+    if (op >= ALU_TST && op <= ALU_CMN && (opcode & 0x00100000) == 0)
+    {
+      decode->execute = handlers[ARM_UNDEFINED];
+      return;
+    }
+
+    if ((opcode & 0x00100000) != 0) { decode->flags |= ARM_FLAG_S; }
+
+    if ((opcode & 0x02000000) != 0)
+    {
+      const int rotate = ((opcode >> 8) & 0xf) * 2;
+      const uint32_t imm = opcode & 0xff;
+
+      operand = OPERAND_IMM;
+      decode->imm = rotate == 0 ? imm : (imm >> rotate) | (imm << (32 - rotate));
+
+      // A rotated immediate sets C from bit 31 for logical instructions.
+      decode->shift = rotate != 0;
+    }
+      else
+    if ((opcode & 0x10) == 0)
+    {
+      const int type = (opcode >> 5) & 3;
+      const int amount = (opcode >> 7) & 0x1f;
+
+      if (type == SHIFT_LSL && amount == 0)
+      {
+        operand = OPERAND_REG;
+      }
+        else
+      {
+        operand = OPERAND_SHIFT_IMM;
+        decode_shift_imm(decode, type, amount);
+      }
+    }
+      else
+    {
+      operand = OPERAND_SHIFT_REG;
+      decode->shift_type = (opcode >> 5) & 3;
+      decode->cycles = 2;
+    }
+
+    n = DATA(op, operand);
+
+    if (rd == 15 && (op < ALU_TST || op > ALU_CMN))
+    {
+      decode->flags |= ARM_FLAG_PC;
+    }
+  }
+    else
+  if ((opcode & UNDEF_MASK) == UNDEF_OPCODE)
+  {
+    n = ARM_UNDEFINED;
+  }
+    else
+  if ((opcode & LDR_STR_MASK) == LDR_STR_OPCODE)
+  {
+    const bool load = (opcode & 0x00100000) != 0;
+
+    if ((opcode & 0x00400000) != 0) { n = load ? ARM_LDRB : ARM_STRB; }
+    else { n = load ? ARM_LDR : ARM_STR; }
+
+    if ((opcode & 0x02000000) != 0)
+    {
+      decode->flags |= ARM_FLAG_R;
+      decode_shift_imm(decode, (opcode >> 5) & 3, (opcode >> 7) & 0x1f);
+    }
+      else
+    {
+      decode->imm = opcode & 0xfff;
+    }
+
+    decode->cycles = load ? 3 : 2;
+    if (load && rd == 15) { decode->flags |= ARM_FLAG_PC; }
+  }
+    else
+  if ((opcode & LDM_STM_MASK) == LDM_STM_OPCODE)
+  {
+    const bool load = (opcode & 0x00100000) != 0;
+    const int count = __builtin_popcount(opcode & 0xffff);
+
+    n = load ? ARM_LDM : ARM_STM;
+    decode->reg_list = opcode & 0xffff;
+
+    if ((opcode & 0x00400000) != 0) { decode->flags |= ARM_FLAG_S; }
+
+    decode->cycles = load ? count + 2 : count + 1;
+    if (load && (opcode & 0x8000) != 0) { decode->flags |= ARM_FLAG_PC; }
+  }
+    else
+  if ((opcode & BRANCH_MASK) == BRANCH_OPCODE)
+  {
+    int32_t offset = (int32_t)(opcode << 8) >> 6;
+
+    n = (opcode & 0x01000000) != 0 ? ARM_BL : ARM_B;
+    decode->imm = address + 8 + offset;
+    decode->cycles = 3;
+  }
+    else
+  if ((opcode & CO_SWI_MASK) == CO_SWI_OPCODE)
+  {
+    n = ARM_SWI;
+    decode->cycles = 3;
+  }
+
+  decode->execute = handlers[n];
+}
+
+void SimulateArm::decode_thumb(ArmDecode *decode, uint16_t opcode)
+{
+  const uint32_t address = decode->address & 0xfffffffe;
+  const int rd = opcode & 0x7;
+  const int rs = (opcode >> 3) & 0x7;
+  const int rn = (opcode >> 6) & 0x7;
+  int n = ARM_UNDEFINED;
+
+  // Most Thumb instructions are ARM data processing instructions that
+  // always set the flags.
+  decode->rd = rd;
+  decode->rn = rs;
+  decode->rm = rs;
+  decode->flags = ARM_FLAG_S;
+
+  switch (opcode >> 13)
+  {
+    case 0:
+      if ((opcode & 0x1800) != 0x1800)
+      {
+        // lsl, lsr, asr Rd, Rs, #offset5
+        const int type = (opcode >> 11) & 3;
+        const int amount = (opcode >> 6) & 0x1f;
+
+        if (type == SHIFT_LSL && amount == 0)
+        {
+          n = DATA(ALU_MOV, OPERAND_REG);
+        }
+          else
+        {
+          n = DATA(ALU_MOV, OPERAND_SHIFT_IMM);
+          decode_shift_imm(decode, type, amount);
+        }
+      }
+        else
+      {
+        // add, sub Rd, Rs, Rn / #imm3
+        const int op = (opcode & 0x0200) != 0 ? ALU_SUB : ALU_ADD;
+
+        if ((opcode & 0x0400) != 0)
+        {
+          n = DATA(op, OPERAND_IMM);
+          decode->imm = rn;
+        }
+          else
+        {
+          n = DATA(op, OPERAND_REG);
+          decode->rm = rn;
+        }
+      }
+      break;
+    case 1:
+    {
+      // mov, cmp, add, sub Rd, #imm8
+      static const int ops[] = { ALU_MOV, ALU_CMP, ALU_ADD, ALU_SUB };
+
+      decode->rd = (opcode >> 8) & 0x7;
+      decode->rn = decode->rd;
+      decode->imm = opcode & 0xff;
+      n = DATA(ops[(opcode >> 11) & 3], OPERAND_IMM);
+      break;
+    }
+    case 2:
+      if ((opcode & 0xfc00) == 0x4000)
+      {
+        // ALU operations: Rd = Rd op Rs.
+        decode->rn = rd;
+
+        switch ((opcode >> 6) & 0xf)
+        {
+          case 0x0: n = DATA(ALU_AND, OPERAND_REG); break;
+          case 0x1: n = DATA(ALU_EOR, OPERAND_REG); break;
+          case 0x2:
+          case 0x3:
+          case 0x4:
+          case 0x7:
+          {
+            static const int types[] =
+            {
+              0, 0, SHIFT_LSL, SHIFT_LSR, SHIFT_ASR, 0, 0, SHIFT_ROR
+            };
+
+            n = DATA(ALU_MOV, OPERAND_SHIFT_REG);
+            decode->shift_type = types[(opcode >> 6) & 0x7];
+            decode->rm = rd;
+            decode->rs = rs;
+            decode->cycles = 2;
+            break;
+          }
+          case 0x5: n = DATA(ALU_ADC, OPERAND_REG); break;
+          case 0x6: n = DATA(ALU_SBC, OPERAND_REG); break;
+          case 0x8: n = DATA(ALU_TST, OPERAND_REG); break;
+          case 0x9:
+            // neg is rsb Rd, Rs, #0.
+            n = DATA(ALU_RSB, OPERAND_IMM);
+            decode->rn = rs;
+            break;
+          case 0xa: n = DATA(ALU_CMP, OPERAND_REG); break;
+          case 0xb: n = DATA(ALU_CMN, OPERAND_REG); break;
+          case 0xc: n = DATA(ALU_ORR, OPERAND_REG); break;
+          case 0xd:
+            n = ARM_MUL;
+            decode->rd = rd;
+            decode->rm = rd;
+            decode->rs = rs;
+            break;
+          case 0xe: n = DATA(ALU_BIC, OPERAND_REG); break;
+          case 0xf: n = DATA(ALU_MVN, OPERAND_REG); break;
+        }
+      }
+        else
+      if ((opcode & 0xfc00) == 0x4400)
+      {
+        // Hi register operations and bx.  Only cmp sets the flags.
+        const int hd = rd | ((opcode >> 4) & 0x8);
+        const int hs = rs | ((opcode >> 3) & 0x8);
+
+        decode->rd = hd;
+        decode->rn = hd;
+        decode->rm = hs;
+        decode->flags = 0;
+
+        switch ((opcode >> 8) & 3)
+        {
+          case 0: n = DATA(ALU_ADD, OPERAND_REG); break;
+          case 1:
+            n = DATA(ALU_CMP, OPERAND_REG);
+            decode->flags = ARM_FLAG_S;
+            break;
+          case 2: n = DATA(ALU_MOV, OPERAND_REG); break;
+          case 3:
+            n = ARM_BX;
+            decode->cycles = 3;
+            break;
+        }
+
+        if (hd == 15 && (n == DATA(ALU_ADD, OPERAND_REG) || n == DATA(ALU_MOV, OPERAND_REG)))
+        {
+          decode->flags |= ARM_FLAG_PC;
+        }
+      }
+        else
+      if ((opcode & 0xf800) == 0x4800)
+      {
+        // ldr Rd, [pc, #imm8 * 4].  PC is read as (address + 4) & ~3.
+        const uint32_t target = ((address + 4) & 0xfffffffc) + (opcode & 0xff) * 4;
+
+        n = ARM_LDR;
+        decode->rd = (opcode >> 8) & 0x7;
+        decode->rn = 15;
+        decode->imm = target - (address + 4);
+        decode->flags = ARM_FLAG_P | ARM_FLAG_U;
+        decode->cycles = 3;
+      }
+        else
+      {
+        // Load / store with a register offset.
+        static const int ops[] =
+        {
+          ARM_STR, ARM_STRB, ARM_LDR, ARM_LDRB,
+          ARM_STRH, ARM_LDRSB, ARM_LDRH, ARM_LDRSH
+        };
+
+        n = ops[((opcode >> 10) & 0x3) | ((opcode >> 7) & 0x4)];
+        decode->rn = rs;
+        decode->rm = rn;
+        decode->flags = ARM_FLAG_P | ARM_FLAG_U | ARM_FLAG_R;
+        decode->cycles = n == ARM_STR || n == ARM_STRB || n == ARM_STRH ? 2 : 3;
+      }
+      break;
+    case 3:
+    {
+      // ldr, str, ldrb, strb Rd, [Rb, #offset5]
+      const bool is_byte = (opcode & 0x1000) != 0;
+      const bool load = (opcode & 0x0800) != 0;
+      const int offset = (opcode >> 6) & 0x1f;
+
+      if (is_byte) { n = load ? ARM_LDRB : ARM_STRB; }
+      else { n = load ? ARM_LDR : ARM_STR; }
+
+      decode->imm = is_byte ? offset : offset * 4;
+      decode->flags = ARM_FLAG_P | ARM_FLAG_U;
+      decode->cycles = load ? 3 : 2;
+      break;
+    }
+    case 4:
+    {
+      const bool load = (opcode & 0x0800) != 0;
+
+      if ((opcode & 0x1000) == 0)
+      {
+        // ldrh, strh Rd, [Rb, #offset5 * 2]
+        n = load ? ARM_LDRH : ARM_STRH;
+        decode->imm = ((opcode >> 6) & 0x1f) * 2;
+      }
+        else
+      {
+        // ldr, str Rd, [sp, #imm8 * 4]
+        n = load ? ARM_LDR : ARM_STR;
+        decode->rd = (opcode >> 8) & 0x7;
+        decode->rn = 13;
+        decode->imm = (opcode & 0xff) * 4;
+      }
+
+      decode->flags = ARM_FLAG_P | ARM_FLAG_U;
+      decode->cycles = load ? 3 : 2;
+      break;
+    }
+    case 5:
+      if ((opcode & 0x1000) == 0)
+      {
+        // add Rd, pc / sp, #imm8 * 4
+        decode->rd = (opcode >> 8) & 0x7;
+        decode->flags = 0;
+
+        if ((opcode & 0x0800) != 0)
+        {
+          n = DATA(ALU_ADD, OPERAND_IMM);
+          decode->rn = 13;
+          decode->imm = (opcode & 0xff) * 4;
+        }
+          else
+        {
+          n = DATA(ALU_MOV, OPERAND_IMM);
+          decode->imm = ((address + 4) & 0xfffffffc) + (opcode & 0xff) * 4;
+        }
+      }
+        else
+      if ((opcode & 0x0f00) == 0x0000)
+      {
+        // add sp, #+/-imm7 * 4
+        n = DATA((opcode & 0x80) != 0 ? ALU_SUB : ALU_ADD, OPERAND_IMM);
+        decode->rd = 13;
+        decode->rn = 13;
+        decode->imm = (opcode & 0x7f) * 4;
+        decode->flags = 0;
+      }
+        else
+      if ((opcode & 0x0600) == 0x0400)
+      {
+        // push is stmdb sp!, pop is ldmia sp!
+        const bool load = (opcode & 0x0800) != 0;
+        uint16_t reg_list = opcode & 0xff;
+
+        if ((opcode & 0x0100) != 0) { reg_list |= load ? 0x8000 : 0x4000; }
+
+        n = load ? ARM_LDM : ARM_STM;
+        decode->rn = 13;
+        decode->reg_list = reg_list;
+        decode->flags = ARM_FLAG_W | (load ? ARM_FLAG_U : ARM_FLAG_P);
+
+        const int count = __builtin_popcount(reg_list);
+        decode->cycles = load ? count + 2 : count + 1;
+        if ((reg_list & 0x8000) != 0) { decode->flags |= ARM_FLAG_PC; }
+      }
+      break;
+    case 6:
+      if ((opcode & 0x1000) == 0)
+      {
+        // ldmia, stmia Rb!, { Rlist }
+        const bool load = (opcode & 0x0800) != 0;
+        const int count = __builtin_popcount(opcode & 0xff);
+
+        n = load ? ARM_LDM : ARM_STM;
+        decode->rn = (opcode >> 8) & 0x7;
+        decode->reg_list = opcode & 0xff;
+        decode->flags = ARM_FLAG_U | ARM_FLAG_W;
+        decode->cycles = load ? count + 2 : count + 1;
+      }
+        else
+      {
+        const int cond = (opcode >> 8) & 0xf;
+
+        if (cond == 0xf)
+        {
+          n = ARM_SWI;
+          decode->cycles = 3;
+        }
+          else
+        if (cond != 0xe)
+        {
+          n = ARM_B;
+          decode->cond = cond;
+          decode->imm = address + 4 + (int8_t)(opcode & 0xff) * 2;
+          decode->cycles = 3;
+        }
+      }
+      break;
+    case 7:
+    {
+      const int32_t offset = (int32_t)((uint32_t)opcode << 21) >> 21;
+
+      switch ((opcode >> 11) & 3)
+      {
+        case 0:
+          n = ARM_B;
+          decode->imm = address + 4 + offset * 2;
+          decode->cycles = 3;
+          break;
+        case 2:
+          // The first half of bl puts the upper part of the offset in lr.
+          n = THUMB_BL_HIGH;
+          decode->imm = address + 4 + (offset << 12);
+          break;
+        case 3:
+          n = THUMB_BL_LOW;
+          decode->imm = (opcode & 0x7ff) << 1;
+          decode->cycles = 3;
+          break;
+      }
+      break;
+    }
+  }
+
+  decode->execute = handlers[n];
+}
+
+void SimulateArm::flush_decode_cache()
+{
+  // Each entry gets an address that belongs to a different entry so
+  // nothing matches until it's decoded again.
+  for (int n = 0; n < ARM_DECODE_CACHE_SIZE; n++)
+  {
+    decode_cache[n].address = (n + 1) << 1;
+  }
+}
+
+bool SimulateArm::has_code(uint32_t address)
+{
+  if (memory->in_use(address) == false) { return false; }
+
+  return address >= memory->get_page_address_min(address) &&
+         address <= memory->get_page_address_max(address);
+}
+
+void SimulateArm::enter_exception(int mode, uint32_t vector, uint32_t return_address)
+{
+  uint32_t old_cpsr = cpsr;
+
+  switch_mode(mode);
+  set_spsr(old_cpsr);
+
+  reg[14] = return_address;
+  cpsr = (cpsr & ~ARM_CPSR_T) | ARM_CPSR_I;
+  pc = vector;
+}
+
+int SimulateArm::get_bank(int mode)
+{
+  switch (mode)
+  {
+    case ARM_MODE_FIQ: return 1;
+    case ARM_MODE_IRQ: return 2;
+    case ARM_MODE_SVC: return 3;
+    case ARM_MODE_ABT: return 4;
+    case ARM_MODE_UND: return 5;
+    default: return 0;
+  }
+}
+
+void SimulateArm::switch_mode(int mode)
+{
+  const int old_mode = cpsr & ARM_CPSR_MODE;
+  const int old_bank = get_bank(old_mode);
+  const int new_bank = get_bank(mode);
+
+  if (old_bank != new_bank)
+  {
+    bank_r13[old_bank] = reg[13];
+    bank_r14[old_bank] = reg[14];
+    reg[13] = bank_r13[new_bank];
+    reg[14] = bank_r14[new_bank];
+
+    if (old_mode == ARM_MODE_FIQ)
+    {
+      memcpy(bank_fiq, reg + 8, sizeof(bank_fiq));
+      memcpy(reg + 8, bank_usr, sizeof(bank_usr));
+    }
+
+    if (mode == ARM_MODE_FIQ)
+    {
+      memcpy(bank_usr, reg + 8, sizeof(bank_usr));
+      memcpy(reg + 8, bank_fiq, sizeof(bank_fiq));
+    }
+  }
+
+  cpsr = (cpsr & ~ARM_CPSR_MODE) | mode;
+}
+
+// User and system mode have no SPSR so reading it gives the CPSR.
+uint32_t SimulateArm::get_spsr()
+{
+  const int bank = get_bank(cpsr & ARM_CPSR_MODE);
+
+  return bank == 0 ? cpsr : bank_spsr[bank];
+}
+
+void SimulateArm::set_spsr(uint32_t value)
+{
+  const int bank = get_bank(cpsr & ARM_CPSR_MODE);
+
+  if (bank != 0) { bank_spsr[bank] = value; }
+}
+
+// Returning from an exception copies SPSR back to CPSR.
+void SimulateArm::restore_cpsr()
+{
+  uint32_t value = get_spsr();
+
+  switch_mode(value & ARM_CPSR_MODE);
+  cpsr = value;
+}
+
+// For ldm / stm with the S bit, which use the user mode registers.
+uint32_t SimulateArm::get_user_reg(int index)
+{
+  const int mode = cpsr & ARM_CPSR_MODE;
+
+  if (index < 8 || index == 15 || get_bank(mode) == 0) { return reg[index]; }
+  if (index < 13) { return mode == ARM_MODE_FIQ ? bank_usr[index - 8] : reg[index]; }
+
+  return index == 13 ? bank_r13[0] : bank_r14[0];
+}
+
+void SimulateArm::set_user_reg(int index, uint32_t value)
+{
+  const int mode = cpsr & ARM_CPSR_MODE;
+
+  if (index < 8 || index == 15 || get_bank(mode) == 0)
+  {
+    reg[index] = value;
+  }
+    else
+  if (index < 13)
+  {
+    if (mode == ARM_MODE_FIQ) { bank_usr[index - 8] = value; }
+    else { reg[index] = value; }
+  }
+    else
+  if (index == 13)
+  {
+    bank_r13[0] = value;
+  }
+    else
+  {
+    bank_r14[0] = value;
+  }
+}
+
+// Shifts the way a shift by a register does, with the carry out put in
+// carry.  A shift of 0 leaves value and carry alone.
+uint32_t SimulateArm::shift_value(uint32_t value, int type, int amount, int *carry)
+{
+  if (amount == 0) { return value; }
+
+  switch (type)
+  {
+    case SHIFT_LSL:
+      if (amount < 32)
+      {
+        *carry = (value >> (32 - amount)) & 1;
+        return value << amount;
+      }
+
+      *carry = amount == 32 ? value & 1 : 0;
+      return 0;
+    case SHIFT_LSR:
+      if (amount < 32)
+      {
+        *carry = (value >> (amount - 1)) & 1;
+        return value >> amount;
+      }
+
+      *carry = amount == 32 ? value >> 31 : 0;
+      return 0;
+    case SHIFT_ASR:
+      if (amount < 32)
+      {
+        *carry = ((int32_t)value >> (amount - 1)) & 1;
+        return (int32_t)value >> amount;
+      }
+
+      *carry = value >> 31;
+      return (int32_t)value >> 31;
+    case SHIFT_ROR:
+      amount &= 31;
+
+      if (amount != 0)
+      {
+        value = (value >> amount) | (value << (32 - amount));
+      }
+
+      *carry = value >> 31;
+      return value;
+    case SHIFT_RRX:
+    {
+      uint32_t result = (value >> 1) | ((uint32_t)*carry << 31);
+      *carry = value & 1;
+      return result;
+    }
+  }
+
+  return value;
+}
+
+// Subtraction is done as a + ~b + 1 so C is the ARM "not borrow".
+uint32_t SimulateArm::add_with_flags(uint32_t a, uint32_t b, int carry)
+{
+  uint64_t result = (uint64_t)a + b + carry;
+  uint32_t value = (uint32_t)result;
+
+  cpsr &= ~(ARM_CPSR_N | ARM_CPSR_Z | ARM_CPSR_C | ARM_CPSR_V);
+  cpsr |= value & ARM_CPSR_N;
+
+  if (value == 0) { cpsr |= ARM_CPSR_Z; }
+  if ((result >> 32) != 0) { cpsr |= ARM_CPSR_C; }
+  if ((((a ^ value) & (b ^ value)) >> 31) != 0) { cpsr |= ARM_CPSR_V; }
+
+  return value;
+}
+
+// A word load from an address that isn't aligned rotates the word
+// it's in.
+uint32_t SimulateArm::load32(uint32_t address)
+{
+  uint32_t value = memory->read32(address & 0xfffffffc);
+  int rotate = (address & 3) * 8;
+
+  if (rotate != 0) { value = (value >> rotate) | (value << (32 - rotate)); }
+
+  return value;
+}
+
+void SimulateArm::show_instructions(uint32_t address)
+{
+  char instruction[128];
+  int cycles_min, cycles_max;
+  int n;
+
+  const bool thumb = (cpsr & ARM_CPSR_T) != 0;
+
+  for (n = 0; n < 6; n++)
+  {
+    int count;
+
+    printf("%c", has_break_point(address) ? '*' : ' ');
+
+    if (n == 0) { printf("! "); }
+    else if (address == pc) { printf("> "); }
+    else { printf("  "); }
+
+    if (thumb)
+    {
+      count = disasm_thumb(
+        memory,
+        address,
+        instruction,
+        sizeof(instruction),
+        &cycles_min,
+        &cycles_max);
+
+      printf("0x%08x:     0x%04x %-40s\n",
+        address, memory->read16(address), instruction);
+    }
+      else
+    {
+      count = disasm_arm(
+        memory,
+        address,
+        instruction,
+        sizeof(instruction),
+        &cycles_min,
+        &cycles_max);
+
+      printf("0x%08x: 0x%08x %-40s\n",
+        address, memory->read32(address), instruction);
+    }
+
+    address += count < 2 ? (thumb ? 2 : 4) : count;
+  }
+}
+
+template<int OPERAND>
+inline uint32_t SimulateArm::get_operand(const ArmDecode *decode, int *carry)
+{
+  switch (OPERAND)
+  {
+    case OPERAND_IMM:
+      if (decode->shift != 0) { *carry = decode->imm >> 31; }
+      return decode->imm;
+    case OPERAND_REG:
+      return reg[decode->rm];
+    case OPERAND_SHIFT_IMM:
+      return shift_value(reg[decode->rm], decode->shift_type, decode->shift, carry);
+    default:
+      return shift_value(reg[decode->rm], decode->shift_type, reg[decode->rs] & 0xff, carry);
+  }
+}
+
+// OP and OPERAND are constants so each handler is one instruction with
+// one kind of second operand.
+template<int OP, int OPERAND>
+int SimulateArm::execute_data(const ArmDecode *decode)
+{
+  const int c = (cpsr >> 29) & 1;
+  const bool set_flags = (decode->flags & ARM_FLAG_S) != 0;
+  const uint32_t a = reg[decode->rn];
+  int carry = c;
+  const uint32_t b = get_operand<OPERAND>(decode, &carry);
+  uint32_t result;
+
+  // With S an instruction that writes pc returns from an exception
+  // instead of setting the flags.
+  const bool flags = set_flags && decode->rd != 15;
+
+  switch (OP)
+  {
+    case ALU_AND:
+    case ALU_TST:
+      result = a & b;
+      break;
+    case ALU_EOR:
+    case ALU_TEQ:
+      result = a ^ b;
+      break;
+    case ALU_ORR:
+      result = a | b;
+      break;
+    case ALU_MOV:
+      result = b;
+      break;
+    case ALU_BIC:
+      result = a & ~b;
+      break;
+    case ALU_MVN:
+      result = ~b;
+      break;
+    case ALU_SUB:
+    case ALU_CMP:
+      if (flags) { result = add_with_flags(a, ~b, 1); }
+      else { result = a - b; }
+      break;
+    case ALU_RSB:
+      if (flags) { result = add_with_flags(b, ~a, 1); }
+      else { result = b - a; }
+      break;
+    case ALU_ADD:
+    case ALU_CMN:
+      if (flags) { result = add_with_flags(a, b, 0); }
+      else { result = a + b; }
+      break;
+    case ALU_ADC:
+      if (flags) { result = add_with_flags(a, b, c); }
+      else { result = a + b + c; }
+      break;
+    case ALU_SBC:
+      if (flags) { result = add_with_flags(a, ~b, c); }
+      else { result = a - b - (c ^ 1); }
+      break;
+    default:
+      if (flags) { result = add_with_flags(b, ~a, c); }
+      else { result = b - a - (c ^ 1); }
+      break;
+  }
+
+  const bool logical =
+    OP == ALU_AND || OP == ALU_EOR || OP == ALU_TST || OP == ALU_TEQ ||
+    OP == ALU_ORR || OP == ALU_MOV || OP == ALU_BIC || OP == ALU_MVN;
+
+  if (logical && flags)
+  {
+    set_nz(result);
+    cpsr = (cpsr & ~ARM_CPSR_C) | (carry << 29);
+  }
+
+  if (OP < ALU_TST || OP > ALU_CMN)
+  {
+    reg[decode->rd] = result;
+
+    if (set_flags && decode->rd == 15) { restore_cpsr(); }
+  }
+
+  return decode->cycles;
+}
+
+// The number of internal cycles a multiply takes depends on how many
+// bytes of the multiplier are significant.
+static int get_multiply_cycles(uint32_t value, bool is_signed)
+{
+  if ((value & 0xffffff00) == 0) { return 1; }
+  if ((value & 0xffff0000) == 0) { return 2; }
+  if ((value & 0xff000000) == 0) { return 3; }
+
+  if (is_signed)
+  {
+    if ((value & 0xffffff00) == 0xffffff00) { return 1; }
+    if ((value & 0xffff0000) == 0xffff0000) { return 2; }
+    if ((value & 0xff000000) == 0xff000000) { return 3; }
+  }
+
+  return 4;
+}
+
+// OP is a constant so the switch is reduced to the one instruction.
+template<int OP>
+int SimulateArm::execute(const ArmDecode *decode)
+{
+  if (OP < ARM_MUL)
+  {
+    return execute_data<(OP < ARM_MUL ? OP >> 2 : 0), OP & 3>(decode);
+  }
+
+  const int rd = decode->rd;
+  const int rn = decode->rn;
+  const int flags = decode->flags;
+  const uint32_t next_address = pc;
+
+  switch (OP)
+  {
+    case ARM_MUL:
+    case ARM_MLA:
+    {
+      uint32_t result = reg[decode->rm] * reg[decode->rs];
+
+      if (OP == ARM_MLA) { result += reg[rn]; }
+
+      reg[rd] = result;
+
+      if ((flags & ARM_FLAG_S) != 0) { set_nz(result); }
+
+      return (OP == ARM_MLA ? 2 : 1) + get_multiply_cycles(reg[decode->rs], true);
+    }
+    case ARM_UMULL:
+    case ARM_UMLAL:
+    case ARM_SMULL:
+    case ARM_SMLAL:
+    {
+      // rd is RdHi and rn is RdLo.
+      const bool is_signed = OP == ARM_SMULL || OP == ARM_SMLAL;
+      const bool accumulate = OP == ARM_UMLAL || OP == ARM_SMLAL;
+      uint64_t result;
+
+      if (is_signed)
+      {
+        result = (uint64_t)((int64_t)(int32_t)reg[decode->rm] *
+                            (int64_t)(int32_t)reg[decode->rs]);
+      }
+        else
+      {
+        result = (uint64_t)reg[decode->rm] * reg[decode->rs];
+      }
+
+      if (accumulate) { result += ((uint64_t)reg[rd] << 32) | reg[rn]; }
+
+      reg[rn] = result & 0xffffffff;
+      reg[rd] = result >> 32;
+
+      if ((flags & ARM_FLAG_S) != 0)
+      {
+        cpsr &= ~(ARM_CPSR_N | ARM_CPSR_Z);
+        if ((result >> 63) != 0) { cpsr |= ARM_CPSR_N; }
+        if (result == 0) { cpsr |= ARM_CPSR_Z; }
+      }
+
+      return (accumulate ? 3 : 2) + get_multiply_cycles(reg[decode->rs], is_signed);
+    }
+    case ARM_SWP:
+    case ARM_SWPB:
+    {
+      const uint32_t address = reg[rn];
+      const uint32_t value = reg[decode->rm];
+
+      watch_access(address, BREAK_POINT_READ);
+      watch_access(address, BREAK_POINT_WRITE);
+
+      if (OP == ARM_SWPB)
+      {
+        reg[rd] = memory->read8(address);
+        memory->write8(address, value & 0xff);
+      }
+        else
+      {
+        reg[rd] = load32(address);
+        memory->write32(address & 0xfffffffc, value);
+      }
+
+      check_code_write(address);
+
+      return decode->cycles;
+    }
+    case ARM_MRS:
+      reg[rd] = (flags & ARM_FLAG_SPSR) != 0 ? get_spsr() : cpsr;
+      return 1;
+    case ARM_MSR:
+    {
+      const uint32_t value = (flags & ARM_FLAG_R) != 0 ? reg[decode->rm] : decode->imm;
+      uint32_t mask = 0;
+
+      if ((decode->rs & 1) != 0) { mask |= 0x000000ff; }
+      if ((decode->rs & 2) != 0) { mask |= 0x0000ff00; }
+      if ((decode->rs & 4) != 0) { mask |= 0x00ff0000; }
+      if ((decode->rs & 8) != 0) { mask |= 0xff000000; }
+
+      if ((flags & ARM_FLAG_SPSR) != 0)
+      {
+        set_spsr((get_spsr() & ~mask) | (value & mask));
+        return 1;
+      }
+
+      // User mode can only change the flags.
+      if ((cpsr & ARM_CPSR_MODE) == ARM_MODE_USR) { mask &= 0xff000000; }
+
+      const uint32_t new_cpsr = (cpsr & ~mask) | (value & mask);
+
+      switch_mode(new_cpsr & ARM_CPSR_MODE);
+      cpsr = new_cpsr;
+
+      return 1;
+    }
+    case ARM_LDR:
+    case ARM_STR:
+    case ARM_LDRB:
+    case ARM_STRB:
+    case ARM_LDRH:
+    case ARM_STRH:
+    case ARM_LDRSB:
+    case ARM_LDRSH:
+    {
+      const bool load =
+        OP == ARM_LDR || OP == ARM_LDRB || OP == ARM_LDRH ||
+        OP == ARM_LDRSB || OP == ARM_LDRSH;
+      const uint32_t base = reg[rn];
+      uint32_t offset = decode->imm;
+
+      if ((flags & ARM_FLAG_R) != 0)
+      {
+        int carry = 0;
+        offset = shift_value(reg[decode->rm], decode->shift_type, decode->shift, &carry);
+      }
+
+      const uint32_t offset_address =
+        (flags & ARM_FLAG_U) != 0 ? base + offset : base - offset;
+      const uint32_t address = (flags & ARM_FLAG_P) != 0 ? offset_address : base;
+
+      // Post indexed always writes back.  A load into the base
+      // register keeps the value loaded.
+      if ((flags & ARM_FLAG_P) == 0 || (flags & ARM_FLAG_W) != 0)
+      {
+        reg[rn] = offset_address;
+      }
+
+      if (load)
+      {
+        watch_access(address, BREAK_POINT_READ);
+
+        switch (OP)
+        {
+          case ARM_LDR: reg[rd] = load32(address); break;
+          case ARM_LDRB: reg[rd] = memory->read8(address); break;
+          case ARM_LDRH: reg[rd] = memory->read16(address & 0xfffffffe); break;
+          case ARM_LDRSB: reg[rd] = (int8_t)memory->read8(address); break;
+          default: reg[rd] = (int16_t)memory->read16(address & 0xfffffffe); break;
+        }
+      }
+        else
+      {
+        // The base was written back already, so a store of it uses the
+        // value from before.
+        const uint32_t value = rd == rn ? base : reg[rd];
+
+        watch_access(address, BREAK_POINT_WRITE);
+
+        switch (OP)
+        {
+          case ARM_STR: memory->write32(address & 0xfffffffc, value); break;
+          case ARM_STRB: memory->write8(address, value & 0xff); break;
+          default: memory->write16(address & 0xfffffffe, value & 0xffff); break;
+        }
+
+        check_code_write(address);
+      }
+
+      return decode->cycles;
+    }
+    case ARM_LDM:
+    case ARM_STM:
+    {
+      const uint32_t reg_list = decode->reg_list;
+      const uint32_t base = reg[rn];
+      const int count = __builtin_popcount(reg_list);
+      const bool up = (flags & ARM_FLAG_U) != 0;
+      const bool before = (flags & ARM_FLAG_P) != 0;
+      const uint32_t new_base = up ? base + count * 4 : base - count * 4;
+      uint32_t address;
+
+      // Registers always go lowest to highest address.
+      if (up) { address = before ? base + 4 : base; }
+      else { address = before ? new_base : new_base + 4; }
+
+      // With S an ldm that loads pc returns from an exception.  Otherwise
+      // the user mode registers are used.
+      const bool user_bank =
+        (flags & ARM_FLAG_S) != 0 && (OP == ARM_STM || (reg_list & 0x8000) == 0);
+
+      if (OP == ARM_LDM)
+      {
+        if ((flags & ARM_FLAG_W) != 0) { reg[rn] = new_base; }
+
+        for (int n = 0; n < 16; n++)
+        {
+          if ((reg_list & (1 << n)) == 0) { continue; }
+
+          watch_access(address, BREAK_POINT_READ);
+          uint32_t value = memory->read32(address & 0xfffffffc);
+
+          if (user_bank) { set_user_reg(n, value); }
+          else { reg[n] = value; }
+
+          address += 4;
+        }
+
+        if ((flags & ARM_FLAG_S) != 0 && (reg_list & 0x8000) != 0)
+        {
+          restore_cpsr();
+        }
+      }
+        else
+      {
+        const int first = __builtin_ctz(reg_list | 0x10000);
+
+        for (int n = 0; n < 16; n++)
+        {
+          if ((reg_list & (1 << n)) == 0) { continue; }
+
+          uint32_t value = user_bank ? get_user_reg(n) : reg[n];
+
+          // The base is stored written back unless it's the first one.
+          if (n == rn && n != first && (flags & ARM_FLAG_W) != 0)
+          {
+            value = new_base;
+          }
+
+          watch_access(address, BREAK_POINT_WRITE);
+          memory->write32(address & 0xfffffffc, value);
+          check_code_write(address);
+
+          address += 4;
+        }
+
+        if ((flags & ARM_FLAG_W) != 0) { reg[rn] = new_base; }
+      }
+
+      return decode->cycles;
+    }
+    case ARM_B:
+      pc = decode->imm;
+      return decode->cycles;
+    case ARM_BL:
+      reg[14] = next_address;
+      pc = decode->imm;
+      return decode->cycles;
+    case ARM_BX:
+    {
+      const uint32_t target = reg[decode->rm];
+
+      if ((target & 1) != 0)
+      {
+        cpsr |= ARM_CPSR_T;
+        pc = target & 0xfffffffe;
+      }
+        else
+      {
+        cpsr &= ~ARM_CPSR_T;
+        pc = target & 0xfffffffc;
+      }
+
+      return decode->cycles;
+    }
+    case ARM_SWI:
+      // Without a vector table swi ends the program the way ecall does
+      // on RISC-V.
+      if (start_thumb == false && has_code(0x08))
+      {
+        enter_exception(ARM_MODE_SVC, 0x08, next_address);
+        return decode->cycles;
+      }
+
+      halted = true;
+      pc = decode->address & 0xfffffffe;
+      return decode->cycles;
+    case ARM_UNDEFINED:
+      if (start_thumb == false && has_code(0x04))
+      {
+        enter_exception(ARM_MODE_UND, 0x04, next_address);
+        return 3;
+      }
+
+      pc = decode->address & 0xfffffffe;
+      printf("Illegal instruction at address 0x%08x\n", pc);
+      return -1;
+    case THUMB_BL_HIGH:
+      reg[14] = decode->imm;
+      return 1;
+    case THUMB_BL_LOW:
+    {
+      const uint32_t target = reg[14] + decode->imm;
+
+      reg[14] = next_address | 1;
+      pc = target & 0xfffffffe;
+
+      return decode->cycles;
+    }
+  }
+
+  return 1;
+}
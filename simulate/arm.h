@@ -0,0 +1,175 @@
+/**
+ *  naken_asm assembler.
+ *  Author: Michael Kohn
+ *   Email: mike@mikekohn.net
+ *     Web: https://www.mikekohn.net/
+ * License: GPLv3
+ *
+ * Copyright 2010-2023 by Michael Kohn
+ *
+ */
+
+#ifndef NAKEN_ASM_SIMULATE_ARM_H
+#define NAKEN_ASM_SIMULATE_ARM_H
+
+#include <unistd.h>
+
+#include "simulate/Simulate.h"
+
+#define ARM_DECODE_CACHE_SIZE 16384
+#define ARM_DECODE_CACHE_MASK (ARM_DECODE_CACHE_SIZE - 1)
+
+// Returning to this address ends a function started with "call".
+#define ARM_RETURN_ADDRESS 0xfffffffc
+
+#define ARM_CPSR_N 0x80000000
+#define ARM_CPSR_Z 0x40000000
+#define ARM_CPSR_C 0x20000000
+#define ARM_CPSR_V 0x10000000
+#define ARM_CPSR_I 0x00000080
+#define ARM_CPSR_F 0x00000040
+#define ARM_CPSR_T 0x00000020
+#define ARM_CPSR_MODE 0x0000001f
+
+#define ARM_MODE_USR 0x10
+#define ARM_MODE_FIQ 0x11
+#define ARM_MODE_IRQ 0x12
+#define ARM_MODE_SVC 0x13
+#define ARM_MODE_ABT 0x17
+#define ARM_MODE_UND 0x1b
+#define ARM_MODE_SYS 0x1f
+
+#define ARM_COND_AL 14
+
+// ArmDecode.flags
+#define ARM_FLAG_S 0x01
+#define ARM_FLAG_P 0x02
+#define ARM_FLAG_U 0x04
+#define ARM_FLAG_W 0x08
+#define ARM_FLAG_PC 0x10
+#define ARM_FLAG_R 0x20
+#define ARM_FLAG_SPSR 0x40
+
+class SimulateArm;
+
+// An ARM or Thumb instruction decoded once at an address into the
+// function that runs it and its fields.  Thumb instructions are decoded
+// into the ARM instruction that does the same thing.  address has bit 0
+// set for Thumb so the two states never share an entry.  imm is the
+// immediate (already rotated), offset or branch target.
+struct ArmDecode
+{
+  int (SimulateArm::*execute)(const ArmDecode *decode);
+  uint32_t address;
+  uint32_t imm;
+  uint16_t reg_list;
+  uint8_t cond;
+  uint8_t rd;
+  uint8_t rn;
+  uint8_t rm;
+  uint8_t rs;
+  uint8_t shift_type;
+  uint8_t shift;
+  uint8_t flags;
+  uint8_t cycles;
+  uint8_t size;
+};
+
+class SimulateArm : public Simulate
+{
+public:
+  SimulateArm(Memory *memory);
+  virtual ~SimulateArm();
+
+  static Simulate *init(Memory *memory);
+  static Simulate *init_thumb(Memory *memory);
+
+  virtual void reset();
+  virtual void push(uint32_t value);
+  virtual int set_reg(const char *reg_string, uint32_t value);
+  virtual uint32_t get_reg(const char *reg_string);
+  virtual void set_pc(uint32_t value);
+  virtual void dump_registers();
+  virtual int run(int64_t max_cycles, int step);
+
+private:
+  typedef int (SimulateArm::*Handler)(const ArmDecode *decode);
+
+  template<int OP> static void build_handlers();
+  template<int OP> int execute(const ArmDecode *decode);
+  template<int OP, int OPERAND> int execute_data(const ArmDecode *decode);
+  template<int OPERAND> uint32_t get_operand(const ArmDecode *decode, int *carry);
+
+  int execute_instructions(int count, uint64_t end_cycles);
+  void decode(ArmDecode *decode, uint32_t address);
+  void decode_arm(ArmDecode *decode, uint32_t opcode);
+  void decode_thumb(ArmDecode *decode, uint16_t opcode);
+  void flush_decode_cache();
+  bool has_code(uint32_t address);
+  void enter_exception(int mode, uint32_t vector, uint32_t return_address);
+  void switch_mode(int mode);
+  int get_bank(int mode);
+  uint32_t get_spsr();
+  void set_spsr(uint32_t value);
+  void restore_cpsr();
+  uint32_t get_user_reg(int index);
+  void set_user_reg(int index, uint32_t value);
+  uint32_t shift_value(uint32_t value, int type, int amount, int *carry);
+  uint32_t add_with_flags(uint32_t a, uint32_t b, int carry);
+  uint32_t load32(uint32_t address);
+  void show_instructions(uint32_t address);
+
+  bool condition_passed(int cond)
+  {
+    return ((condition_table[cond] >> (cpsr >> 28)) & 1) != 0;
+  }
+
+  void set_nz(uint32_t result)
+  {
+    cpsr = (cpsr & ~(ARM_CPSR_N | ARM_CPSR_Z)) |
+           (result & ARM_CPSR_N) |
+           (result == 0 ? ARM_CPSR_Z : 0);
+  }
+
+  // Stores to memory that has been decoded drop the decoded ARM
+  // instruction or both Thumb instructions in the word.
+  void check_code_write(uint32_t address)
+  {
+    uint32_t index = ((address & 0xfffffffc) >> 1) & ARM_DECODE_CACHE_MASK;
+
+    if ((decode_cache[index].address & 0xfffffffc) == (address & 0xfffffffc))
+    {
+      decode_cache[index].address = (index + 1) << 1;
+    }
+
+    index = (index + 1) & ARM_DECODE_CACHE_MASK;
+
+    if ((decode_cache[index].address & 0xfffffffe) == ((address & 0xfffffffc) | 2))
+    {
+      decode_cache[index].address = (index + 1) << 1;
+    }
+  }
+
+  uint32_t reg[16];
+  uint32_t pc;
+  uint32_t cpsr;
+
+  // Registers that are swapped in when the mode changes.  Index 0 is
+  // user / system mode.
+  uint32_t bank_r13[6];
+  uint32_t bank_r14[6];
+  uint32_t bank_spsr[6];
+  uint32_t bank_fiq[5];
+  uint32_t bank_usr[5];
+
+  bool start_thumb;
+  bool halted;
+
+  static Handler handlers[];
+  static uint16_t condition_table[16];
+
+  ArmDecode decode_cache[ARM_DECODE_CACHE_SIZE];
+};
+
+#endif
+
@@ -72,11 +72,18 @@
 #define READ_FLASH(n) memory->read8(n)
 #define WRITE_FLASH(n,data) memory->write8(n, data)
 
-#define READ_RAM(a) ram[a & RAM_MASK];
-#define WRITE_RAM(a,v) ram[a & RAM_MASK] = v;
+#define READ_RAM(a) \
+  (watch_access((a) & RAM_MASK, BREAK_POINT_READ), ram[(a) & RAM_MASK]);
+#define WRITE_RAM(a,v) \
+  (watch_access((a) & RAM_MASK, BREAK_POINT_WRITE), ram[(a) & RAM_MASK] = v);
+
+Avr8Decode SimulateAvr8::decode_table[65536];
+bool SimulateAvr8::decode_table_built = false;
 
 SimulateAvr8::SimulateAvr8(Memory *memory) : Simulate(memory)
 {
+  if (decode_table_built == false) { build_decode_table(); }
+
   reset();
 }
 
@@ -99,7 +106,30 @@ void SimulateAvr8::reset()
   pc = 0;
   sp = 0;
   sreg = 0;
-  break_point = -1;
+}
+
+void SimulateAvr8::save_state(uint8_t *state)
+{
+  SimulateAvr8State *avr8_state = (SimulateAvr8State *)state;
+
+  memcpy(avr8_state->reg, reg, sizeof(reg));
+  memcpy(avr8_state->ram, ram, sizeof(ram));
+  memcpy(avr8_state->io, io, sizeof(io));
+  avr8_state->pc = pc;
+  avr8_state->sp = sp;
+  avr8_state->sreg = sreg;
+}
+
+void SimulateAvr8::load_state(const uint8_t *state)
+{
+  const SimulateAvr8State *avr8_state = (const SimulateAvr8State *)state;
+
+  memcpy(reg, avr8_state->reg, sizeof(reg));
+  memcpy(ram, avr8_state->ram, sizeof(ram));
+  memcpy(io, avr8_state->io, sizeof(io));
+  pc = avr8_state->pc;
+  sp = avr8_state->sp;
+  sreg = avr8_state->sreg;
 }
 
 void SimulateAvr8::push(uint32_t value)
@@ -204,33 +234,43 @@ void SimulateAvr8::dump_registers()
       printf(" ");
     }
 
-    char reg[4];
-    snprintf(reg, sizeof(reg), "r%d", n);
-    printf("%3s: 0x%02x", reg, reg[n]);
+    char name[4];
+    snprintf(name, sizeof(name), "r%d", n);
+    printf("%3s: 0x%02x", name, reg[n]);
   }
 
   printf(" X=0x%04x, Y=0x%04x, Z=0x%04x\n\n", GET_X(), GET_Y(), GET_Z());
-  printf("%d clock cycles have passed since last reset.\n\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
-int SimulateAvr8::run(int max_cycles, int step)
+int SimulateAvr8::run(int64_t max_cycles, int step)
 {
   char instruction[128];
-  int cycles = 0;
+  int64_t cycles = 0;
   int ret;
   int pc_current;
   int n;
 
   printf("Running... Press Ctl-C to break.\n");
 
+  stop_reason = SIMULATE_STOP_NONE;
+
   while (stop_running == false)
   {
+    instruction_count++;
+
     pc_current = pc;
     ret = execute();
 
     if (show == true) printf("\x1b[1J\x1b[1;1H");
 
-    if (ret > 0) { cycle_count += ret; }
+    if (ret > 0)
+    {
+      cycle_count += ret;
+      cycles += ret;
+    }
+
+    profile_instruction(pc_current, ret > 0 ? ret : 0);
 
     if (show == true)
     {
@@ -254,7 +294,7 @@ int SimulateAvr8::run(int max_cycles, int step)
 
         if (cycles_min == -1) break;
 
-        if (disasm_pc == break_point) { printf("*"); }
+        if (has_break_point(disasm_pc)) { printf("*"); }
         else { printf(" "); }
 
         if (n == 0)
@@ -283,7 +323,7 @@ int SimulateAvr8::run(int max_cycles, int step)
         disasm_pc++;
         while (count > 0)
         {
-          if (disasm_pc == break_point) { printf("*"); }
+          if (has_break_point(disasm_pc)) { printf("*"); }
           else { printf(" "); }
           num = READ_OPCODE(disasm_pc);
           printf("  0x%04x: 0x%04x\n", disasm_pc, num);
@@ -293,18 +333,28 @@ int SimulateAvr8::run(int max_cycles, int step)
       }
     }
 
-    if (auto_run == true && nested_call_count < 0) { return 0; }
+    if (auto_run == true && nested_call_count < 0)
+    {
+      stop_reason = SIMULATE_STOP_END;
+      return 0;
+    }
 
     if (ret == -1)
     {
       printf("Illegal instruction at address 0x%04x\n", pc_current);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
 
-    if (max_cycles != -1 && cycles > max_cycles) break;
-    if (break_point == pc)
+    if (max_cycles != -1 && cycles >= max_cycles)
     {
-       printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    if (break_hit(pc))
+    {
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
@@ -317,48 +367,62 @@ int SimulateAvr8::run(int max_cycles, int step)
 #if 0
     if (pc == 0xffff)
     {
-      printf("Function ended.  Total cycles: %d\n", cycle_count);
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
       step_mode = 0;
       disable_signal_handler();
       return 0;
     }
 #endif
 
-    usleep(usec);
+    delay();
   }
 
   disable_signal_handler();
 
   printf("Stopped.  PC=0x%04x.\n", pc);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
 
 int SimulateAvr8::word_count()
 {
-  uint16_t opcode = READ_OPCODE(pc);
-  int n;
+  return decode_table[READ_OPCODE(pc)].words;
+}
 
-  n = 0;
-  while (table_avr8[n].instr != NULL)
+void SimulateAvr8::build_decode_table()
+{
+  for (int opcode = 0; opcode < 65536; opcode++)
   {
-    if ((opcode & table_avr8[n].mask) == table_avr8[n].opcode)
+    Avr8Decode *decode = &decode_table[opcode];
+
+    decode->index = AVR8_DECODE_NONE;
+    decode->words = 0;
+
+    // The first match wins, the same as scanning the table would.
+    for (int n = 0; table_avr8[n].instr != NULL; n++)
     {
-      switch(table_avr8[n].type)
+      if ((opcode & table_avr8[n].mask) != table_avr8[n].opcode) { continue; }
+
+      decode->index = n;
+
+      switch (table_avr8[n].type)
       {
         case OP_JUMP:
         case OP_REG_SRAM:
         case OP_SRAM_REG:
-          return 2;
+          decode->words = 2;
+          break;
         default:
-          return 1;
+          decode->words = 1;
+          break;
       }
+
+      break;
     }
-    n++;
   }
 
-  return 0;
+  decode_table_built = true;
 }
 
 int SimulateAvr8::execute_op_none(struct _table_avr8 *table_avr8)
@@ -1010,195 +1074,187 @@ int SimulateAvr8::execute()
   //if (c > 0) cycle_count += c;
   pc += 1;
 
-  int n = 0;
-  while (table_avr8[n].instr != NULL)
-  {
-    if ((opcode & table_avr8[n].mask) == table_avr8[n].opcode)
-    {
-      //*cycles_min = table_avr8[n].cycles_min;
-      //*cycles_max = table_avr8[n].cycles_max;
+  const Avr8Decode *decode = &decode_table[opcode];
 
-      switch(table_avr8[n].type)
-      {
-        case OP_NONE:
-          cycles = execute_op_none(&table_avr8[n]);
-          break;
-        case OP_BRANCH_S_K:
-          cycles = execute_op_branch_s_k(&table_avr8[n], opcode);
-          break;
-        case OP_BRANCH_K:
-          cycles = execute_op_branch_k(&table_avr8[n], opcode);
-          break;
-        case OP_TWO_REG:
-          cycles = execute_op_two_reg(&table_avr8[n], opcode);
-          break;
-        case OP_REG_IMM:
-          cycles = execute_op_reg_imm(&table_avr8[n], opcode);
-          break;
-        case OP_ONE_REG:
-          cycles = execute_op_one_reg(&table_avr8[n], opcode);
-          break;
-        case OP_REG_BIT:
-          cycles = execute_op_reg_bit(&table_avr8[n], opcode);
-          break;
-        case OP_REG_IMM_WORD:
-          cycles = execute_op_reg_imm_word(&table_avr8[n], opcode);
-          break;
-        case OP_IOREG_BIT:
-          cycles = execute_op_ioreg_bit(&table_avr8[n], opcode);
-          break;
-        case OP_SREG_BIT:
-          cycles = execute_op_sreg_bit(&table_avr8[n], opcode);
-          break;
-        case OP_REG_4:
-          rd = ((opcode >> 4) & 0xf) + 16;
-          reg[rd] = 0xff;
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_IN:
-          rd = (opcode >> 4) & 0xf;
-          k = ((opcode & 0x600) >> 5) | (opcode & 0xf);
-          reg[rd] = io[k];
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_OUT:
-          rd = (opcode >> 4) & 0x1f;
-          k = ((opcode & 0x600) >> 5) | (opcode & 0xf);
-          io[k] = reg[rd];
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_MOVW:
-          rd = ((opcode >> 4) & 0xf) << 1;
-          rr = (opcode & 0xf) << 1;
-          reg[rd] = reg[rr];
-          reg[rd + 1] = reg[rr + 1];
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_RELATIVE:
-          cycles = execute_op_relative(&table_avr8[n], opcode);
-          break;
-        case OP_JUMP:
-          cycles = execute_op_jump(&table_avr8[n], opcode);
-          break;
-        case OP_SPM_Z_PLUS:
-          WRITE_FLASH(GET_Z(), reg[0]);
-          WRITE_FLASH(GET_Z() + 1, reg[1]);
-          { INC_Z(); }
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_REG_X:
-        case OP_REG_X_PLUS:
-        case OP_REG_MINUS_X:
-          rd = (opcode >> 4) & 0x1f;
-          if (table_avr8[n].type == OP_REG_MINUS_X) { DEC_X(); }
-          reg[rd] = READ_RAM(GET_X());
-          if (table_avr8[n].type == OP_REG_X_PLUS) { INC_X(); }
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_REG_Y:
-        case OP_REG_Y_PLUS:
-        case OP_REG_MINUS_Y:
-          rd = (opcode >> 4) & 0x1f;
-          if (table_avr8[n].type == OP_REG_MINUS_Y) { DEC_Y(); }
-          reg[rd] = READ_RAM(GET_Y());
-          if (table_avr8[n].type == OP_REG_Y_PLUS) { INC_Y(); }
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_REG_Z:
-        case OP_REG_Z_PLUS:
-        case OP_REG_MINUS_Z:
-          rd = (opcode >> 4) & 0x1f;
-          if (table_avr8[n].type == OP_REG_MINUS_Z) { DEC_Z(); }
-          if (table_avr8[n].id == AVR8_LPM)
-            reg[rd] = READ_FLASH(GET_Z());
-          else
-            reg[rd] = READ_RAM(GET_Z());
-          if (table_avr8[n].type == OP_REG_Z_PLUS) { INC_Z(); }
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_X_REG:
-        case OP_X_PLUS_REG:
-        case OP_MINUS_X_REG:
-          rd = (opcode >> 4) & 0x1f;
-          if (table_avr8[n].type == OP_MINUS_X_REG) { DEC_X(); }
-          WRITE_RAM(GET_X(), reg[rd]);
-          if (table_avr8[n].type == OP_X_PLUS_REG) { INC_X(); }
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_Y_REG:
-        case OP_Y_PLUS_REG:
-        case OP_MINUS_Y_REG:
-          rd = (opcode >> 4) & 0x1f;
-          if (table_avr8[n].type == OP_MINUS_Y_REG) { DEC_Y(); }
-          WRITE_RAM(GET_Y(), reg[rd]);
-          if (table_avr8[n].type == OP_Y_PLUS_REG) { INC_Y(); }
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_Z_REG:
-        case OP_Z_PLUS_REG:
-        case OP_MINUS_Z_REG:
-          rd = (opcode >> 4) & 0x1f;
-          if (table_avr8[n].type == OP_MINUS_Z_REG) { DEC_Z(); }
-          WRITE_RAM(GET_Z(), reg[rd]);
-          if (table_avr8[n].type == OP_Z_PLUS_REG) { INC_Z(); }
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_FMUL:
-          // FIXME - implement
-          return -1;
-        case OP_MULS:
-          rd = ((opcode >> 4) & 0xf) + 16;
-          rr = (opcode & 0xf) + 16;
-          t = ((uint32_t)((int8_t)reg[rd])) *
-              ((uint32_t)((int8_t)reg[rd]));
-          reg[0] = ((uint32_t)t) & 0xff;
-          reg[1] = (((uint32_t)t) >> 8) & 0xff;
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_DATA4:
-          // FIXME - implement
-          return -1;
-        case OP_REG_SRAM:
-          rd = (opcode >> 4) & 0x1f;
-          k = READ_OPCODE(pc);
-          pc++;
-          reg[rd] = READ_RAM(k);
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_SRAM_REG:
-          rr = (opcode >> 4) & 0x1f;
-          k = READ_OPCODE(pc);
-          pc++;
-          WRITE_RAM(k, reg[rr]);
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_REG_Y_PLUS_Q:
-        case OP_REG_Z_PLUS_Q:
-          rd = (opcode >> 4) & 0x1f;
-          k = ((opcode & 0x2000) >> 8) | ((opcode & 0xc00) >> 7) | (opcode & 0x7);
-          if (table_avr8[n].type == OP_REG_Y_PLUS_Q) { k += GET_Y(); }
-          if (table_avr8[n].type == OP_REG_Z_PLUS_Q) { k += GET_Z(); }
-          reg[rd] = READ_RAM(k);
-          cycles = table_avr8[n].cycles_min;
-          break;
-        case OP_Y_PLUS_Q_REG:
-        case OP_Z_PLUS_Q_REG:
-          rr = (opcode >> 4) & 0x1f;
-          k = ((opcode & 0x2000) >> 8) | ((opcode & 0xc00) >> 7) | (opcode & 0x7);
-          if (table_avr8[n].type == OP_Y_PLUS_Q_REG) { k += GET_Y(); }
-          if (table_avr8[n].type == OP_Z_PLUS_Q_REG) { k += GET_Z(); }
-          WRITE_RAM(k, reg[rr]);
-          cycles = table_avr8[n].cycles_min;
-          break;
+  if (decode->index == AVR8_DECODE_NONE) { return cycles; }
 
-        default:
-          return -1;
-      }
+  struct _table_avr8 *table = &table_avr8[decode->index];
 
-      return cycles;
-    }
+  switch(table->type)
+  {
+    case OP_NONE:
+      cycles = execute_op_none(table);
+      break;
+    case OP_BRANCH_S_K:
+      cycles = execute_op_branch_s_k(table, opcode);
+      break;
+    case OP_BRANCH_K:
+      cycles = execute_op_branch_k(table, opcode);
+      break;
+    case OP_TWO_REG:
+      cycles = execute_op_two_reg(table, opcode);
+      break;
+    case OP_REG_IMM:
+      cycles = execute_op_reg_imm(table, opcode);
+      break;
+    case OP_ONE_REG:
+      cycles = execute_op_one_reg(table, opcode);
+      break;
+    case OP_REG_BIT:
+      cycles = execute_op_reg_bit(table, opcode);
+      break;
+    case OP_REG_IMM_WORD:
+      cycles = execute_op_reg_imm_word(table, opcode);
+      break;
+    case OP_IOREG_BIT:
+      cycles = execute_op_ioreg_bit(table, opcode);
+      break;
+    case OP_SREG_BIT:
+      cycles = execute_op_sreg_bit(table, opcode);
+      break;
+    case OP_REG_4:
+      rd = ((opcode >> 4) & 0xf) + 16;
+      reg[rd] = 0xff;
+      cycles = table->cycles_min;
+      break;
+    case OP_IN:
+      rd = (opcode >> 4) & 0xf;
+      k = ((opcode & 0x600) >> 5) | (opcode & 0xf);
+      reg[rd] = io[k];
+      cycles = table->cycles_min;
+      break;
+    case OP_OUT:
+      rd = (opcode >> 4) & 0x1f;
+      k = ((opcode & 0x600) >> 5) | (opcode & 0xf);
+      io[k] = reg[rd];
+      cycles = table->cycles_min;
+      break;
+    case OP_MOVW:
+      rd = ((opcode >> 4) & 0xf) << 1;
+      rr = (opcode & 0xf) << 1;
+      reg[rd] = reg[rr];
+      reg[rd + 1] = reg[rr + 1];
+      cycles = table->cycles_min;
+      break;
+    case OP_RELATIVE:
+      cycles = execute_op_relative(table, opcode);
+      break;
+    case OP_JUMP:
+      cycles = execute_op_jump(table, opcode);
+      break;
+    case OP_SPM_Z_PLUS:
+      WRITE_FLASH(GET_Z(), reg[0]);
+      WRITE_FLASH(GET_Z() + 1, reg[1]);
+      { INC_Z(); }
+      cycles = table->cycles_min;
+      break;
+    case OP_REG_X:
+    case OP_REG_X_PLUS:
+    case OP_REG_MINUS_X:
+      rd = (opcode >> 4) & 0x1f;
+      if (table->type == OP_REG_MINUS_X) { DEC_X(); }
+      reg[rd] = READ_RAM(GET_X());
+      if (table->type == OP_REG_X_PLUS) { INC_X(); }
+      cycles = table->cycles_min;
+      break;
+    case OP_REG_Y:
+    case OP_REG_Y_PLUS:
+    case OP_REG_MINUS_Y:
+      rd = (opcode >> 4) & 0x1f;
+      if (table->type == OP_REG_MINUS_Y) { DEC_Y(); }
+      reg[rd] = READ_RAM(GET_Y());
+      if (table->type == OP_REG_Y_PLUS) { INC_Y(); }
+      cycles = table->cycles_min;
+      break;
+    case OP_REG_Z:
+    case OP_REG_Z_PLUS:
+    case OP_REG_MINUS_Z:
+      rd = (opcode >> 4) & 0x1f;
+      if (table->type == OP_REG_MINUS_Z) { DEC_Z(); }
+      if (table->id == AVR8_LPM)
+        reg[rd] = READ_FLASH(GET_Z());
+      else
+        reg[rd] = READ_RAM(GET_Z());
+      if (table->type == OP_REG_Z_PLUS) { INC_Z(); }
+      cycles = table->cycles_min;
+      break;
+    case OP_X_REG:
+    case OP_X_PLUS_REG:
+    case OP_MINUS_X_REG:
+      rd = (opcode >> 4) & 0x1f;
+      if (table->type == OP_MINUS_X_REG) { DEC_X(); }
+      WRITE_RAM(GET_X(), reg[rd]);
+      if (table->type == OP_X_PLUS_REG) { INC_X(); }
+      cycles = table->cycles_min;
+      break;
+    case OP_Y_REG:
+    case OP_Y_PLUS_REG:
+    case OP_MINUS_Y_REG:
+      rd = (opcode >> 4) & 0x1f;
+      if (table->type == OP_MINUS_Y_REG) { DEC_Y(); }
+      WRITE_RAM(GET_Y(), reg[rd]);
+      if (table->type == OP_Y_PLUS_REG) { INC_Y(); }
+      cycles = table->cycles_min;
+      break;
+    case OP_Z_REG:
+    case OP_Z_PLUS_REG:
+    case OP_MINUS_Z_REG:
+      rd = (opcode >> 4) & 0x1f;
+      if (table->type == OP_MINUS_Z_REG) { DEC_Z(); }
+      WRITE_RAM(GET_Z(), reg[rd]);
+      if (table->type == OP_Z_PLUS_REG) { INC_Z(); }
+      cycles = table->cycles_min;
+      break;
+    case OP_FMUL:
+      // FIXME - implement
+      return -1;
+    case OP_MULS:
+      rd = ((opcode >> 4) & 0xf) + 16;
+      rr = (opcode & 0xf) + 16;
+      t = ((uint32_t)((int8_t)reg[rd])) *
+          ((uint32_t)((int8_t)reg[rd]));
+      reg[0] = ((uint32_t)t) & 0xff;
+      reg[1] = (((uint32_t)t) >> 8) & 0xff;
+      cycles = table->cycles_min;
+      break;
+    case OP_DATA4:
+      // FIXME - implement
+      return -1;
+    case OP_REG_SRAM:
+      rd = (opcode >> 4) & 0x1f;
+      k = READ_OPCODE(pc);
+      pc++;
+      reg[rd] = READ_RAM(k);
+      cycles = table->cycles_min;
+      break;
+    case OP_SRAM_REG:
+      rr = (opcode >> 4) & 0x1f;
+      k = READ_OPCODE(pc);
+      pc++;
+      WRITE_RAM(k, reg[rr]);
+      cycles = table->cycles_min;
+      break;
+    case OP_REG_Y_PLUS_Q:
+    case OP_REG_Z_PLUS_Q:
+      rd = (opcode >> 4) & 0x1f;
+      k = ((opcode & 0x2000) >> 8) | ((opcode & 0xc00) >> 7) | (opcode & 0x7);
+      if (table->type == OP_REG_Y_PLUS_Q) { k += GET_Y(); }
+      if (table->type == OP_REG_Z_PLUS_Q) { k += GET_Z(); }
+      reg[rd] = READ_RAM(k);
+      cycles = table->cycles_min;
+      break;
+    case OP_Y_PLUS_Q_REG:
+    case OP_Z_PLUS_Q_REG:
+      rr = (opcode >> 4) & 0x1f;
+      k = ((opcode & 0x2000) >> 8) | ((opcode & 0xc00) >> 7) | (opcode & 0x7);
+      if (table->type == OP_Y_PLUS_Q_REG) { k += GET_Y(); }
+      if (table->type == OP_Z_PLUS_Q_REG) { k += GET_Z(); }
+      WRITE_RAM(k, reg[rr]);
+      cycles = table->cycles_min;
+      break;
 
-    n++;
+    default:
+      return -1;
   }
 
   return cycles;
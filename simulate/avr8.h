@@ -28,6 +28,26 @@
 #define RAM_MASK 0x1fff
 #define RAM_SIZE (RAM_MASK + 1)
 
+#define AVR8_DECODE_NONE 0xff
+
+// An opcode decoded to the index of the table_avr8 entry it matches and
+// the number of words in the instruction.
+struct Avr8Decode
+{
+  uint8_t index;
+  uint8_t words;
+};
+
+struct SimulateAvr8State
+{
+  uint8_t reg[32];
+  uint8_t ram[RAM_SIZE];
+  uint8_t io[64];
+  int pc;
+  int sp;
+  uint8_t sreg;
+};
+
 class SimulateAvr8 : public Simulate
 {
 public:
@@ -43,10 +63,13 @@ public:
   virtual void set_pc(uint32_t value);
   int dump_ram(int start, int end);
   virtual void dump_registers();
-  virtual int run(int max_cycles, int step);
+  virtual int run(int64_t max_cycles, int step);
+  virtual bool can_profile() { return true; }
+  virtual bool can_snapshot() { return true; }
 
 private:
   int word_count();
+  static void build_decode_table();
   int execute_op_none(struct _table_avr8 *table_avr8);
   void execute_set_sreg_arith(uint8_t rd_prev, uint8_t rd, int k);
   void execute_set_sreg_arith_sub(uint8_t rd_prev, uint8_t rd, int k);
@@ -67,6 +90,12 @@ private:
   int execute_op_jump(struct _table_avr8 *table_avr8, uint16_t opcode);
   int execute();
 
+  // Data memory isn't in Memory so it's part of the state along with
+  // the registers.
+  virtual int get_state_length() { return sizeof(SimulateAvr8State); }
+  virtual void save_state(uint8_t *state);
+  virtual void load_state(const uint8_t *state);
+
   uint8_t reg[32];
   uint8_t ram[RAM_SIZE];
   uint8_t io[64];
@@ -74,6 +103,10 @@ private:
   int pc;
   int sp;
   uint8_t sreg;
+
+  // Built once for all instances so decoding is a single lookup.
+  static Avr8Decode decode_table[65536];
+  static bool decode_table_built;
 };
 
 #endif
@@ -14,16 +14,194 @@
 #include <stdint.h>
 #include <inttypes.h>
 #include <string.h>
+#include <time.h>
 
+#include "disasm/ebpf.h"
 #include "simulate/ebpf.h"
 
+enum
+{
+  CLASS_LD,
+  CLASS_LDX,
+  CLASS_ST,
+  CLASS_STX,
+  CLASS_ALU,
+  CLASS_JMP,
+  CLASS_JMP32,
+  CLASS_ALU64,
+};
+
+enum
+{
+  ALU_ADD = 0x00,
+  ALU_SUB = 0x10,
+  ALU_MUL = 0x20,
+  ALU_DIV = 0x30,
+  ALU_OR = 0x40,
+  ALU_AND = 0x50,
+  ALU_LSH = 0x60,
+  ALU_RSH = 0x70,
+  ALU_NEG = 0x80,
+  ALU_MOD = 0x90,
+  ALU_XOR = 0xa0,
+  ALU_MOV = 0xb0,
+  ALU_ARSH = 0xc0,
+  ALU_END = 0xd0,
+};
+
+enum
+{
+  JMP_JA = 0x00,
+  JMP_JEQ = 0x10,
+  JMP_JGT = 0x20,
+  JMP_JGE = 0x30,
+  JMP_JSET = 0x40,
+  JMP_JNE = 0x50,
+  JMP_JSGT = 0x60,
+  JMP_JSGE = 0x70,
+  JMP_CALL = 0x80,
+  JMP_EXIT = 0x90,
+  JMP_JLT = 0xa0,
+  JMP_JLE = 0xb0,
+  JMP_JSLT = 0xc0,
+  JMP_JSLE = 0xd0,
+};
+
+enum
+{
+  SIZE_W = 0x00,
+  SIZE_H = 0x08,
+  SIZE_B = 0x10,
+  SIZE_DW = 0x18,
+};
+
+enum
+{
+  MODE_IMM = 0x00,
+  MODE_ABS = 0x20,
+  MODE_IND = 0x40,
+  MODE_MEM = 0x60,
+  MODE_MEMSX = 0x80,
+  MODE_ATOMIC = 0xc0,
+};
+
+#define SOURCE_K 0x00
+#define SOURCE_X 0x08
+
+#define ATOMIC_FETCH 0x01
+#define ATOMIC_XCHG 0xe1
+#define ATOMIC_CMPXCHG 0xf1
+
+// ALU operations that are just an expression of the destination a and
+// the source b.  32 bit results are zero extended into the register.
+#define ALU64_OP(code, expression) \
+  case CLASS_ALU64 | SOURCE_K | code: \
+  { \
+    const uint64_t a = reg[instr->dst]; \
+    const uint64_t b = instr->imm; \
+    reg[instr->dst] = expression; \
+    break; \
+  } \
+  case CLASS_ALU64 | SOURCE_X | code: \
+  { \
+    const uint64_t a = reg[instr->dst]; \
+    const uint64_t b = reg[instr->src]; \
+    reg[instr->dst] = expression; \
+    break; \
+  }
+
+#define ALU32_OP(code, expression) \
+  case CLASS_ALU | SOURCE_K | code: \
+  { \
+    const uint32_t a = reg[instr->dst]; \
+    const uint32_t b = instr->imm; \
+    reg[instr->dst] = (uint32_t)(expression); \
+    break; \
+  } \
+  case CLASS_ALU | SOURCE_X | code: \
+  { \
+    const uint32_t a = reg[instr->dst]; \
+    const uint32_t b = reg[instr->src]; \
+    reg[instr->dst] = (uint32_t)(expression); \
+    break; \
+  }
+
+// Conditional jumps compare the destination a with the source b as
+// the types given for 64 and 32 bit compares.
+#define JMP_OP(code, condition, type64, type32) \
+  case CLASS_JMP | SOURCE_K | code: \
+  { \
+    const type64 a = reg[instr->dst], b = instr->imm; \
+    if (condition) { ip += instr->offset; } \
+    break; \
+  } \
+  case CLASS_JMP | SOURCE_X | code: \
+  { \
+    const type64 a = reg[instr->dst], b = reg[instr->src]; \
+    if (condition) { ip += instr->offset; } \
+    break; \
+  } \
+  case CLASS_JMP32 | SOURCE_K | code: \
+  { \
+    const type32 a = reg[instr->dst], b = instr->imm; \
+    if (condition) { ip += instr->offset; } \
+    break; \
+  } \
+  case CLASS_JMP32 | SOURCE_X | code: \
+  { \
+    const type32 a = reg[instr->dst], b = reg[instr->src]; \
+    if (condition) { ip += instr->offset; } \
+    break; \
+  }
+
+// Maps aren't simulated: lookups find nothing and updates and deletes
+// always work.
+static const char *helper_names[] =
+{
+  NULL,
+  "map_lookup_elem",
+  "map_update_elem",
+  "map_delete_elem",
+  NULL,
+  "ktime_get_ns",
+  "trace_printk",
+  "get_prandom_u32",
+  "get_smp_processor_id",
+};
+
+// Bytes moved by each of SIZE_W, SIZE_H, SIZE_B and SIZE_DW.
+static const int load_sizes[] = { 4, 2, 1, 8 };
+
+static uint64_t swap_bytes(uint64_t value, int bits)
+{
+  uint64_t result = 0;
+
+  for (int n = 0; n < bits; n += 8)
+  {
+    result = (result << 8) | (value & 0xff);
+    value >>= 8;
+  }
+
+  return result;
+}
+
 SimulateEbpf::SimulateEbpf(Memory *memory) : Simulate(memory)
 {
+  program = NULL;
+  program_count = 0;
+  packet = NULL;
+  packet_original = NULL;
+  packet_length = 0;
+  random_seed = 1;
+
   reset();
 }
 
 SimulateEbpf::~SimulateEbpf()
 {
+  free(program);
+  free(packet);
+  free(packet_original);
 }
 
 Simulate *SimulateEbpf::init(Memory *memory)
@@ -33,8 +211,11 @@ Simulate *SimulateEbpf::init(Memory *memory)
 
 void SimulateEbpf::reset()
 {
-  memset(reg, 0, sizeof(reg));
-  pc = 0;
+  program_start = memory->low_address / 8;
+  cycle_count = 0;
+  packet_count = 0;
+
+  start_program();
 }
 
 void SimulateEbpf::push(uint32_t value)
@@ -43,6 +224,14 @@ void SimulateEbpf::push(uint32_t value)
 
 int SimulateEbpf::set_reg(const char *reg_string, uint32_t value)
 {
+  while (*reg_string == ' ') { reg_string++; }
+
+  if (strcmp(reg_string, "pc") == 0)
+  {
+    pc = value;
+    return 0;
+  }
+
   int r = get_register(reg_string);
 
   if (r == -1) { return -1; }
@@ -53,13 +242,15 @@ int SimulateEbpf::set_reg(const char *reg_string, uint32_t value)
 
 uint32_t SimulateEbpf::get_reg(const char *reg_string)
 {
-  int r = get_register(reg_string);
+  while (*reg_string == ' ') { reg_string++; }
 
-  if (r == -1) { return -1; }
+  if (strcmp(reg_string, "pc") == 0) { return pc; }
 
-  printf(" r%d: 0x%08" PRIx64 "\n", r, reg[r]);
+  int r = get_register(reg_string);
 
-  return 0;
+  if (r == -1) { return 0; }
+
+  return reg[r];
 }
 
 void SimulateEbpf::set_pc(uint32_t value)
@@ -71,24 +262,159 @@ void SimulateEbpf::dump_registers()
 {
   int n;
 
+  printf("\nSimulation Register Dump\n");
+  printf("-------------------------------------------------------------------\n");
+  printf(" PC: 0x%04x  Call depth: %d  Packet: %d bytes\n",
+    pc, call_depth, packet_length);
+
   for (n = 0; n < 11; n++)
   {
-    printf(" r%d: %08" PRIx64 "\n", n, reg[n]);
+    printf("%c r%-2d: 0x%016" PRIx64, (n & 1) == 0 ? '\n' : ' ', n, reg[n]);
   }
+
+  printf("\n\n");
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
-int SimulateEbpf::run(int max_cycles, int step)
+int SimulateEbpf::run(int64_t max_cycles, int step)
 {
-  stop_running = 0;
+  int64_t cycles = 0;
 
-  while (stop_running == 0)
+  printf("Running... Press Ctl-C to break.\n");
+
+  stop_reason = SIMULATE_STOP_NONE;
+
+  if (load_program() != 0)
+  {
+    stop_reason = SIMULATE_STOP_ILLEGAL;
+    disable_signal_handler();
+    return -1;
+  }
+
+  // Running again after the program exited starts it over on the packet.
+  if (exited == true) { start_program(); }
+
+  if (pc - program_start >= program_count)
   {
-    printf("CPU not supported.\n");
-    break;
+    printf("PC 0x%04x is outside of the program.\n", pc);
+    stop_reason = SIMULATE_STOP_ILLEGAL;
+    disable_signal_handler();
+    return -1;
+  }
+
+  while (stop_running == false)
+  {
+    uint32_t current_pc = pc;
+
+    if (max_cycles != -1 && cycles >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    // Outside of batch mode instructions are run one at a time so each
+    // can be shown or delayed.  In batch mode the loop comes back out
+    // every so often to check for Ctrl-C.
+    int count = 1;
+
+    if (batch_mode == true && step == false) { count = 0x10000; }
+
+    if (max_cycles != -1 && count > max_cycles - cycles)
+    {
+      count = max_cycles - cycles;
+    }
+
+    int ret = execute(count);
+
+    // All instructions are counted as a single cycle.
+    cycle_count += ret;
+    instruction_count += ret;
+    cycles += ret;
+
+    if (error != 0)
+    {
+      printf("Stopped on an error at 0x%04x.\n", pc);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
+      disable_signal_handler();
+      return -1;
+    }
+
+    if (show == true)
+    {
+      printf("\x1b[1J\x1b[1;1H");
+      dump_registers();
+      show_instructions(current_pc);
+    }
+
+    if (exited == true)
+    {
+      packet_count++;
+
+      if (batch_mode == true && packet_count < (uint64_t)packet_repeat)
+      {
+        start_program();
+        continue;
+      }
+
+      printf("Program exited with r0=0x%" PRIx64 ".  Total cycles: %" PRIu64 "\n",
+        reg[0], cycle_count);
+
+      stop_reason = SIMULATE_STOP_END;
+      step_mode = false;
+      disable_signal_handler();
+      return 0;
+    }
+
+    if (break_hit(pc))
+    {
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
+      break;
+    }
+
+    if (usec == 0 || step == true)
+    {
+      disable_signal_handler();
+      return 0;
+    }
+
+    delay();
   }
 
   disable_signal_handler();
 
+  printf("Stopped.  PC=0x%04x.\n", pc);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
+
+  return 0;
+}
+
+int SimulateEbpf::load_packet(const uint8_t *data, int length)
+{
+  free(packet);
+  free(packet_original);
+
+  // The copy is kept so each run of the program starts with the packet
+  // as it was loaded, even if the last run changed it.
+  packet = (uint8_t *)malloc(length + 1);
+  packet_original = (uint8_t *)malloc(length + 1);
+
+  if (packet == NULL || packet_original == NULL)
+  {
+    printf("Error: Cannot allocate packet of %d bytes.\n", length);
+    free(packet);
+    free(packet_original);
+    packet = NULL;
+    packet_original = NULL;
+    packet_length = 0;
+    return -1;
+  }
+
+  packet_length = length;
+
+  memcpy(packet_original, data, length);
+
+  start_program();
+
   return 0;
 }
 
@@ -113,3 +439,936 @@ int SimulateEbpf::get_register(const char *s)
   return -1;
 }
 
+int SimulateEbpf::load_program()
+{
+  uint32_t start = program_start * 8;
+  uint32_t n;
+
+  if (memory->high_address < start || memory->low_address > start + 7)
+  {
+    printf("No program loaded.\n");
+    return -1;
+  }
+
+  program_count = (memory->high_address - start + 1) / 8;
+
+  if (program_count == 0)
+  {
+    printf("No program loaded.\n");
+    return -1;
+  }
+
+  if (program_count > EBPF_MAX_INSTRUCTIONS)
+  {
+    printf("Program is larger than %d instructions.\n", EBPF_MAX_INSTRUCTIONS);
+    return -1;
+  }
+
+  EbpfInstruction *instructions =
+    (EbpfInstruction *)realloc(program, program_count * sizeof(EbpfInstruction));
+
+  if (instructions == NULL)
+  {
+    printf("Error: Cannot allocate program of %u instructions.\n", program_count);
+    return -1;
+  }
+
+  program = instructions;
+
+  for (n = 0; n < program_count; n++)
+  {
+    EbpfInstruction *instr = &program[n];
+    uint32_t address = start + n * 8;
+    uint8_t regs = memory->read8(address + 1);
+
+    instr->opcode = memory->read8(address);
+
+    if (memory->endian == ENDIAN_LITTLE)
+    {
+      instr->src = regs >> 4;
+      instr->dst = regs & 0xf;
+    }
+      else
+    {
+      instr->dst = regs >> 4;
+      instr->src = regs & 0xf;
+    }
+
+    instr->offset = memory->read16(address + 2);
+    instr->imm = (int32_t)memory->read32(address + 4);
+  }
+
+  // lddw's upper 32 bits are in the next slot's immediate.
+  for (n = 0; n + 1 < program_count; n++)
+  {
+    if (program[n].opcode == (CLASS_LD | MODE_IMM | SIZE_DW))
+    {
+      program[n].imm = (uint32_t)program[n].imm |
+        ((uint64_t)program[n + 1].imm << 32);
+      n++;
+    }
+  }
+
+  return validate_program();
+}
+
+int SimulateEbpf::validate_program()
+{
+  // Everything that can be checked before running is checked here the
+  // same way the kernel's verifier would, so execute() doesn't have to
+  // check for bad opcodes, registers or jumps outside the program.
+  const char *reason = NULL;
+  uint32_t n;
+
+  for (n = 0; n < program_count && reason == NULL; n++)
+  {
+    const EbpfInstruction *instr = &program[n];
+    const int op = instr->opcode;
+    const int code = op & 0xf0;
+    const int size = op & 0x18;
+    int64_t target = -1;
+
+    if (instr->dst > 10 || instr->src > 10)
+    {
+      reason = "Invalid register";
+      continue;
+    }
+
+    switch (op & 0x07)
+    {
+      case CLASS_ALU:
+      case CLASS_ALU64:
+      {
+        const int bits = (op & 0x07) == CLASS_ALU64 ? 64 : 32;
+
+        if (code > ALU_END) { reason = "Invalid opcode"; break; }
+        if (instr->dst == 10) { reason = "r10 is read only"; break; }
+
+        if ((op & SOURCE_X) == SOURCE_K && instr->src != 0)
+        {
+          reason = "Invalid source register";
+        }
+          else
+        if (code == ALU_END)
+        {
+          if (instr->imm != 16 && instr->imm != 32 && instr->imm != 64)
+          {
+            reason = "Invalid byte swap size";
+          }
+            else
+          if (bits == 64 && (op & SOURCE_X) != 0)
+          {
+            reason = "Invalid opcode";
+          }
+        }
+          else
+        if (code == ALU_NEG && (op & SOURCE_X) != 0)
+        {
+          reason = "Invalid opcode";
+        }
+          else
+        if (code == ALU_DIV || code == ALU_MOD)
+        {
+          if (instr->offset != 0 && instr->offset != 1)
+          {
+            reason = "Invalid offset";
+          }
+            else
+          if ((op & SOURCE_X) == SOURCE_K && instr->imm == 0)
+          {
+            reason = "Division by zero";
+          }
+        }
+          else
+        if (code == ALU_MOV && (op & SOURCE_X) != 0)
+        {
+          if (instr->offset != 0 && instr->offset != 8 &&
+              instr->offset != 16 && (instr->offset != 32 || bits != 64))
+          {
+            reason = "Invalid offset";
+          }
+        }
+          else
+        if (instr->offset != 0)
+        {
+          reason = "Invalid offset";
+        }
+          else
+        if ((code == ALU_LSH || code == ALU_RSH || code == ALU_ARSH) &&
+            (op & SOURCE_X) == SOURCE_K &&
+            (instr->imm < 0 || instr->imm >= bits))
+        {
+          reason = "Invalid shift";
+        }
+
+        break;
+      }
+      case CLASS_JMP:
+      case CLASS_JMP32:
+      {
+        if (code == JMP_CALL || code == JMP_EXIT)
+        {
+          if (op != (CLASS_JMP | code))
+          {
+            reason = "Invalid opcode";
+          }
+            else
+          if (code == JMP_CALL && instr->src == 1)
+          {
+            target = n + 1 + instr->imm;
+          }
+            else
+          if (code == JMP_CALL &&
+              (instr->src != 0 || instr->imm <= 0 ||
+               instr->imm >= (int)(sizeof(helper_names) / sizeof(char *)) ||
+               helper_names[instr->imm] == NULL))
+          {
+            reason = "Unknown helper";
+          }
+        }
+          else
+        if (code == JMP_JA)
+        {
+          if ((op & SOURCE_X) != 0)
+          {
+            reason = "Invalid opcode";
+          }
+            else
+          {
+            target = n + 1 +
+              ((op & 0x07) == CLASS_JMP32 ? instr->imm : instr->offset);
+          }
+        }
+          else
+        if (code > JMP_JSLE)
+        {
+          reason = "Invalid opcode";
+        }
+          else
+        {
+          target = n + 1 + instr->offset;
+        }
+
+        break;
+      }
+      case CLASS_LD:
+      {
+        if (op == (CLASS_LD | MODE_IMM | SIZE_DW))
+        {
+          if (n + 1 >= program_count || program[n + 1].opcode != 0)
+          {
+            reason = "lddw is missing its second half";
+          }
+            else
+          if (instr->src > 1)
+          {
+            reason = "Invalid source register";
+          }
+            else
+          if (instr->dst == 10)
+          {
+            reason = "r10 is read only";
+          }
+
+          if (reason == NULL) { n++; }
+        }
+          else
+        if (((op & 0xe0) != MODE_ABS && (op & 0xe0) != MODE_IND) ||
+            size == SIZE_DW)
+        {
+          reason = "Invalid opcode";
+        }
+
+        break;
+      }
+      case CLASS_LDX:
+      {
+        if ((op & 0xe0) != MODE_MEM &&
+            ((op & 0xe0) != MODE_MEMSX || size == SIZE_DW))
+        {
+          reason = "Invalid opcode";
+        }
+          else
+        if (instr->dst == 10)
+        {
+          reason = "r10 is read only";
+        }
+
+        break;
+      }
+      case CLASS_ST:
+      {
+        if ((op & 0xe0) != MODE_MEM) { reason = "Invalid opcode"; }
+        break;
+      }
+      case CLASS_STX:
+      {
+        if ((op & 0xe0) == MODE_ATOMIC)
+        {
+          const int atomic = instr->imm & ~ATOMIC_FETCH;
+
+          if (size != SIZE_W && size != SIZE_DW)
+          {
+            reason = "Invalid opcode";
+          }
+            else
+          if (atomic != ALU_ADD && atomic != ALU_OR &&
+              atomic != ALU_AND && atomic != ALU_XOR &&
+              instr->imm != ATOMIC_XCHG && instr->imm != ATOMIC_CMPXCHG)
+          {
+            reason = "Invalid atomic operation";
+          }
+        }
+          else
+        if ((op & 0xe0) != MODE_MEM)
+        {
+          reason = "Invalid opcode";
+        }
+
+        break;
+      }
+    }
+
+    if (reason == NULL && target != -1)
+    {
+      if (target < 0 || target >= program_count)
+      {
+        reason = "Jump outside of program";
+      }
+        else
+      if (program[target].opcode == 0)
+      {
+        reason = "Jump into the middle of lddw";
+      }
+    }
+  }
+
+  if (reason == NULL)
+  {
+    const EbpfInstruction *instr = &program[program_count - 1];
+
+    // An lddw as the last instruction runs past the end too.
+    if (instr->opcode != (CLASS_JMP | JMP_EXIT) &&
+        instr->opcode != (CLASS_JMP | JMP_JA) &&
+        instr->opcode != (CLASS_JMP32 | JMP_JA))
+    {
+      n = program_count;
+      reason = "Program can run past its last instruction";
+    }
+  }
+
+  if (reason != NULL)
+  {
+    printf("Error: %s at 0x%04x\n", reason, program_start + n - 1);
+    return -1;
+  }
+
+  return 0;
+}
+
+void SimulateEbpf::start_program()
+{
+  memset(reg, 0, sizeof(reg));
+
+  if (packet_length != 0) { memcpy(packet, packet_original, packet_length); }
+
+  reg[1] = EBPF_PACKET_ADDRESS;
+  reg[2] = packet_length;
+  reg[10] = EBPF_STACK_ADDRESS;
+
+  pc = program_start;
+  call_depth = 0;
+  error = 0;
+  exited = false;
+}
+
+int SimulateEbpf::execute(int count)
+{
+  const EbpfInstruction *instr;
+  uint32_t ip = pc - program_start;
+  int n = 0;
+
+  error = 0;
+
+  while (n < count)
+  {
+    if (n != 0 && has_break_point(program_start + ip)) { break; }
+
+    instr = &program[ip++];
+    n++;
+
+    switch (instr->opcode)
+    {
+      ALU64_OP(ALU_ADD, a + b)
+      ALU64_OP(ALU_SUB, a - b)
+      ALU64_OP(ALU_MUL, a * b)
+      ALU64_OP(ALU_OR, a | b)
+      ALU64_OP(ALU_AND, a & b)
+      ALU64_OP(ALU_LSH, a << (b & 63))
+      ALU64_OP(ALU_RSH, a >> (b & 63))
+      ALU64_OP(ALU_XOR, a ^ b)
+      ALU64_OP(ALU_ARSH, (uint64_t)((int64_t)a >> (b & 63)))
+      ALU32_OP(ALU_ADD, a + b)
+      ALU32_OP(ALU_SUB, a - b)
+      ALU32_OP(ALU_MUL, a * b)
+      ALU32_OP(ALU_OR, a | b)
+      ALU32_OP(ALU_AND, a & b)
+      ALU32_OP(ALU_LSH, a << (b & 31))
+      ALU32_OP(ALU_RSH, a >> (b & 31))
+      ALU32_OP(ALU_XOR, a ^ b)
+      ALU32_OP(ALU_ARSH, (uint32_t)((int32_t)a >> (b & 31)))
+      JMP_OP(JMP_JEQ, a == b, uint64_t, uint32_t)
+      JMP_OP(JMP_JGT, a > b, uint64_t, uint32_t)
+      JMP_OP(JMP_JGE, a >= b, uint64_t, uint32_t)
+      JMP_OP(JMP_JSET, (a & b) != 0, uint64_t, uint32_t)
+      JMP_OP(JMP_JNE, a != b, uint64_t, uint32_t)
+      JMP_OP(JMP_JSGT, a > b, int64_t, int32_t)
+      JMP_OP(JMP_JSGE, a >= b, int64_t, int32_t)
+      JMP_OP(JMP_JLT, a < b, uint64_t, uint32_t)
+      JMP_OP(JMP_JLE, a <= b, uint64_t, uint32_t)
+      JMP_OP(JMP_JSLT, a < b, int64_t, int32_t)
+      JMP_OP(JMP_JSLE, a <= b, int64_t, int32_t)
+      case CLASS_ALU64 | SOURCE_K | ALU_MOV:
+        reg[instr->dst] = instr->imm;
+        break;
+      case CLASS_ALU64 | SOURCE_X | ALU_MOV:
+      {
+        const uint64_t b = reg[instr->src];
+
+        switch (instr->offset)
+        {
+          case 8:  reg[instr->dst] = (int8_t)b; break;
+          case 16: reg[instr->dst] = (int16_t)b; break;
+          case 32: reg[instr->dst] = (int32_t)b; break;
+          default: reg[instr->dst] = b; break;
+        }
+
+        break;
+      }
+      case CLASS_ALU | SOURCE_K | ALU_MOV:
+        reg[instr->dst] = (uint32_t)instr->imm;
+        break;
+      case CLASS_ALU | SOURCE_X | ALU_MOV:
+      {
+        const uint32_t b = reg[instr->src];
+
+        switch (instr->offset)
+        {
+          case 8:  reg[instr->dst] = (uint32_t)(int32_t)(int8_t)b; break;
+          case 16: reg[instr->dst] = (uint32_t)(int32_t)(int16_t)b; break;
+          default: reg[instr->dst] = b; break;
+        }
+
+        break;
+      }
+      case CLASS_ALU64 | ALU_NEG:
+        reg[instr->dst] = -reg[instr->dst];
+        break;
+      case CLASS_ALU | ALU_NEG:
+        reg[instr->dst] = (uint32_t)-(uint32_t)reg[instr->dst];
+        break;
+      case CLASS_ALU64 | SOURCE_K | ALU_DIV:
+      case CLASS_ALU64 | SOURCE_X | ALU_DIV:
+      case CLASS_ALU64 | SOURCE_K | ALU_MOD:
+      case CLASS_ALU64 | SOURCE_X | ALU_MOD:
+      {
+        // Dividing by zero gives 0 and mod by zero leaves dst alone.
+        const uint64_t a = reg[instr->dst];
+        const uint64_t b =
+          (instr->opcode & SOURCE_X) != 0 ? reg[instr->src] : instr->imm;
+        const bool is_div = (instr->opcode & 0xf0) == ALU_DIV;
+        uint64_t result;
+
+        if (b == 0)
+        {
+          result = is_div ? 0 : a;
+        }
+          else
+        if (instr->offset == 0)
+        {
+          result = is_div ? a / b : a % b;
+        }
+          else
+        if ((int64_t)b == -1)
+        {
+          result = is_div ? -a : 0;
+        }
+          else
+        {
+          result = is_div ?
+            (int64_t)a / (int64_t)b :
+            (int64_t)a % (int64_t)b;
+        }
+
+        reg[instr->dst] = result;
+        break;
+      }
+      case CLASS_ALU | SOURCE_K | ALU_DIV:
+      case CLASS_ALU | SOURCE_X | ALU_DIV:
+      case CLASS_ALU | SOURCE_K | ALU_MOD:
+      case CLASS_ALU | SOURCE_X | ALU_MOD:
+      {
+        const uint32_t a = reg[instr->dst];
+        const uint32_t b =
+          (instr->opcode & SOURCE_X) != 0 ? reg[instr->src] : instr->imm;
+        const bool is_div = (instr->opcode & 0xf0) == ALU_DIV;
+        uint32_t result;
+
+        if (b == 0)
+        {
+          result = is_div ? 0 : a;
+        }
+          else
+        if (instr->offset == 0)
+        {
+          result = is_div ? a / b : a % b;
+        }
+          else
+        if ((int32_t)b == -1)
+        {
+          result = is_div ? -a : 0;
+        }
+          else
+        {
+          result = is_div ?
+            (int32_t)a / (int32_t)b :
+            (int32_t)a % (int32_t)b;
+        }
+
+        reg[instr->dst] = result;
+        break;
+      }
+      case CLASS_ALU | SOURCE_K | ALU_END:
+      case CLASS_ALU | SOURCE_X | ALU_END:
+      case CLASS_ALU64 | ALU_END:
+      {
+        // The K form converts to little endian and the X form to big
+        // endian, so only one of them swaps on any given target.
+        // ALU64's form always swaps.
+        const int bits = instr->imm;
+        uint64_t value = reg[instr->dst];
+
+        if (bits != 64) { value &= (1ULL << bits) - 1; }
+
+        if ((instr->opcode & 0x07) == CLASS_ALU64 ||
+            ((instr->opcode & SOURCE_X) != 0) ==
+             (memory->endian == ENDIAN_LITTLE))
+        {
+          value = swap_bytes(value, bits);
+        }
+
+        reg[instr->dst] = value;
+        break;
+      }
+      case CLASS_JMP | JMP_JA:
+        ip += instr->offset;
+        break;
+      case CLASS_JMP32 | JMP_JA:
+        ip += instr->imm;
+        break;
+      case CLASS_JMP | JMP_CALL:
+      {
+        if (instr->src == 0)
+        {
+          if (call_helper(instr->imm) != 0)
+          {
+            ip--;
+            error = 1;
+            count = 0;
+          }
+
+          break;
+        }
+
+        if (call_depth == EBPF_MAX_CALL_DEPTH - 1)
+        {
+          printf("Call stack overflow at 0x%04x\n", program_start + ip - 1);
+          ip--;
+          error = 1;
+          count = 0;
+          break;
+        }
+
+        // r6 to r9 belong to the caller and each function gets its own
+        // stack frame.
+        EbpfFrame *frame = &frames[call_depth++];
+
+        frame->return_pc = ip;
+        memcpy(frame->saved, reg + 6, sizeof(frame->saved));
+        reg[10] -= EBPF_STACK_SIZE;
+
+        ip += instr->imm;
+        break;
+      }
+      case CLASS_JMP | JMP_EXIT:
+      {
+        if (call_depth == 0)
+        {
+          ip--;
+          exited = true;
+          count = 0;
+          break;
+        }
+
+        EbpfFrame *frame = &frames[--call_depth];
+
+        ip = frame->return_pc;
+        memcpy(reg + 6, frame->saved, sizeof(frame->saved));
+        reg[10] += EBPF_STACK_SIZE;
+        break;
+      }
+      case CLASS_LD | MODE_IMM | SIZE_DW:
+        reg[instr->dst] = instr->imm;
+        ip++;
+        break;
+      case CLASS_LD | MODE_ABS | SIZE_W:
+      case CLASS_LD | MODE_ABS | SIZE_H:
+      case CLASS_LD | MODE_ABS | SIZE_B:
+      case CLASS_LD | MODE_IND | SIZE_W:
+      case CLASS_LD | MODE_IND | SIZE_H:
+      case CLASS_LD | MODE_IND | SIZE_B:
+      {
+        // The old socket filter loads read the packet in network order
+        // and end the program returning 0 if they are out of bounds.
+        const int size = (instr->opcode & 0x18) == SIZE_W ? 4 :
+                         (instr->opcode & 0x18) == SIZE_H ? 2 : 1;
+        uint32_t offset = instr->imm;
+
+        if ((instr->opcode & 0xe0) == MODE_IND) { offset += reg[instr->src]; }
+
+        if (offset >= packet_length || size > (int)(packet_length - offset))
+        {
+          reg[0] = 0;
+          ip--;
+          call_depth = 0;
+          exited = true;
+          count = 0;
+          break;
+        }
+
+        uint64_t value = 0;
+
+        for (int i = 0; i < size; i++)
+        {
+          value = (value << 8) | packet[offset + i];
+        }
+
+        reg[0] = value;
+        break;
+      }
+      case CLASS_LDX | MODE_MEM | SIZE_W:
+      case CLASS_LDX | MODE_MEM | SIZE_H:
+      case CLASS_LDX | MODE_MEM | SIZE_B:
+      case CLASS_LDX | MODE_MEM | SIZE_DW:
+      case CLASS_LDX | MODE_MEMSX | SIZE_W:
+      case CLASS_LDX | MODE_MEMSX | SIZE_H:
+      case CLASS_LDX | MODE_MEMSX | SIZE_B:
+      {
+        const int size = load_sizes[(instr->opcode >> 3) & 3];
+        const uint8_t *data =
+          get_pointer(reg[instr->src] + instr->offset, size);
+
+        if (data == NULL)
+        {
+          ip--;
+          error = 1;
+          count = 0;
+          break;
+        }
+
+        uint64_t value = load(data, size);
+
+        if ((instr->opcode & 0xe0) == MODE_MEMSX)
+        {
+          const int shift = 64 - (size * 8);
+          value = (uint64_t)((int64_t)(value << shift) >> shift);
+        }
+
+        reg[instr->dst] = value;
+        break;
+      }
+      case CLASS_ST | MODE_MEM | SIZE_W:
+      case CLASS_ST | MODE_MEM | SIZE_H:
+      case CLASS_ST | MODE_MEM | SIZE_B:
+      case CLASS_ST | MODE_MEM | SIZE_DW:
+      case CLASS_STX | MODE_MEM | SIZE_W:
+      case CLASS_STX | MODE_MEM | SIZE_H:
+      case CLASS_STX | MODE_MEM | SIZE_B:
+      case CLASS_STX | MODE_MEM | SIZE_DW:
+      {
+        const int size = load_sizes[(instr->opcode >> 3) & 3];
+        uint8_t *data = get_pointer(reg[instr->dst] + instr->offset, size);
+
+        if (data == NULL)
+        {
+          ip--;
+          error = 1;
+          count = 0;
+          break;
+        }
+
+        store(data, size,
+          (instr->opcode & 0x07) == CLASS_STX ? reg[instr->src] : instr->imm);
+        break;
+      }
+      case CLASS_STX | MODE_ATOMIC | SIZE_W:
+      case CLASS_STX | MODE_ATOMIC | SIZE_DW:
+      {
+        const int size = (instr->opcode & 0x18) == SIZE_W ? 4 : 8;
+        const uint64_t mask = size == 4 ? 0xffffffffULL : ~0ULL;
+        uint8_t *data = get_pointer(reg[instr->dst] + instr->offset, size);
+
+        if (data == NULL)
+        {
+          ip--;
+          error = 1;
+          count = 0;
+          break;
+        }
+
+        const uint64_t old = load(data, size);
+        const uint64_t b = reg[instr->src] & mask;
+        uint64_t value;
+
+        switch (instr->imm)
+        {
+          case ATOMIC_XCHG:
+            value = b;
+            reg[instr->src] = old;
+            break;
+          case ATOMIC_CMPXCHG:
+            value = (reg[0] & mask) == old ? b : old;
+            reg[0] = old;
+            break;
+          default:
+            switch (instr->imm & ~ATOMIC_FETCH)
+            {
+              case ALU_ADD: value = old + b; break;
+              case ALU_OR:  value = old | b; break;
+              case ALU_AND: value = old & b; break;
+              default:      value = old ^ b; break;
+            }
+
+            if ((instr->imm & ATOMIC_FETCH) != 0) { reg[instr->src] = old; }
+            break;
+        }
+
+        store(data, size, value);
+        break;
+      }
+      default:
+        // validate_program() only lets through opcodes handled above.
+        printf("Internal error: opcode 0x%02x at 0x%04x\n",
+          instr->opcode, program_start + ip - 1);
+        ip--;
+        error = 1;
+        count = 0;
+        break;
+    }
+  }
+
+  pc = program_start + ip;
+
+  return error == 0 ? n : n - 1;
+}
+
+uint8_t *SimulateEbpf::get_pointer(uint64_t address, int size)
+{
+  uint64_t offset = address - EBPF_PACKET_ADDRESS;
+
+  if (offset < packet_length && (uint64_t)size <= packet_length - offset)
+  {
+    return packet + offset;
+  }
+
+  offset = address - (EBPF_STACK_ADDRESS - sizeof(stack));
+
+  if (offset < sizeof(stack) && (uint64_t)size <= sizeof(stack) - offset)
+  {
+    return stack + offset;
+  }
+
+  printf("Invalid %d byte memory access at 0x%" PRIx64 "\n", size, address);
+
+  return NULL;
+}
+
+uint64_t SimulateEbpf::load(const uint8_t *data, int size)
+{
+  uint64_t value = 0;
+  int n;
+
+  if (memory->endian == ENDIAN_LITTLE)
+  {
+    for (n = size - 1; n >= 0; n--) { value = (value << 8) | data[n]; }
+  }
+    else
+  {
+    for (n = 0; n < size; n++) { value = (value << 8) | data[n]; }
+  }
+
+  return value;
+}
+
+void SimulateEbpf::store(uint8_t *data, int size, uint64_t value)
+{
+  int n;
+
+  if (memory->endian == ENDIAN_LITTLE)
+  {
+    for (n = 0; n < size; n++) { data[n] = value >> (n * 8); }
+  }
+    else
+  {
+    for (n = size - 1; n >= 0; n--) { data[n] = value >> ((size - 1 - n) * 8); }
+  }
+}
+
+int SimulateEbpf::call_helper(int id)
+{
+  switch (id)
+  {
+    case 1:
+    case 2:
+    case 3:
+      reg[0] = 0;
+      break;
+    case 5:
+    {
+      struct timespec tp;
+      clock_gettime(CLOCK_MONOTONIC, &tp);
+      reg[0] = (uint64_t)tp.tv_sec * 1000000000 + tp.tv_nsec;
+      break;
+    }
+    case 6:
+      trace_printk(reg[1], reg[2]);
+      if (error != 0) { return -1; }
+      reg[0] = 0;
+      break;
+    case 7:
+      // xorshift32 so runs are repeatable.
+      random_seed ^= random_seed << 13;
+      random_seed ^= random_seed >> 17;
+      random_seed ^= random_seed << 5;
+      reg[0] = random_seed;
+      break;
+    case 8:
+      reg[0] = 0;
+      break;
+    default:
+      return -1;
+  }
+
+  return 0;
+}
+
+void SimulateEbpf::trace_printk(uint64_t format, uint32_t size)
+{
+  const char *s = (const char *)get_pointer(format, size);
+  uint64_t *arg = reg + 3;
+  uint32_t n;
+
+  if (s == NULL || size == 0)
+  {
+    error = 1;
+    return;
+  }
+
+  for (n = 0; n < size && s[n] != 0; n++)
+  {
+    if (s[n] != '%' || n + 1 >= size)
+    {
+      putchar(s[n]);
+      continue;
+    }
+
+    bool is_long = false;
+
+    n++;
+    while (n + 1 < size && s[n] == 'l') { is_long = true; n++; }
+
+    if (s[n] == '%') { putchar('%'); continue; }
+
+    // Only three arguments (r3 to r5) are passed to trace_printk.
+    uint64_t value = arg < reg + 6 ? *arg++ : 0;
+
+    if (is_long == false && s[n] != 'p') { value &= 0xffffffff; }
+
+    switch (s[n])
+    {
+      case 'd':
+      case 'i':
+        if (is_long) { printf("%" PRId64, (int64_t)value); }
+        else { printf("%d", (int32_t)value); }
+        break;
+      case 'u':
+        printf("%" PRIu64, value);
+        break;
+      case 'x':
+        printf("%" PRIx64, value);
+        break;
+      case 'X':
+        printf("%" PRIX64, value);
+        break;
+      case 'p':
+        printf("0x%" PRIx64, value);
+        break;
+      case 'c':
+        putchar((int)value);
+        break;
+      default:
+        printf("%%%c", s[n]);
+        break;
+    }
+  }
+
+  fflush(stdout);
+}
+
+void SimulateEbpf::show_instructions(uint32_t address)
+{
+  char instruction[128];
+  int cycles_min, cycles_max;
+  int n;
+
+  for (n = 0; n < 6; n++)
+  {
+    uint32_t byte_address = address * 8;
+
+    disasm_ebpf(
+      memory,
+      byte_address,
+      instruction,
+      sizeof(instruction),
+      &cycles_min,
+      &cycles_max);
+
+    // The disassembler ends some instructions with a newline.
+    int length = strlen(instruction);
+    if (length > 0 && instruction[length - 1] == '\n')
+    {
+      instruction[length - 1] = 0;
+    }
+
+    printf("%c", has_break_point(address) ? '*' : ' ');
+
+    if (n == 0) { printf("! "); }
+    else if (address == pc) { printf("> "); }
+    else { printf("  "); }
+
+    printf("0x%04x: %02x %02x %02x %02x %02x %02x %02x %02x %-40s\n",
+      address,
+      memory->read8(byte_address + 0),
+      memory->read8(byte_address + 1),
+      memory->read8(byte_address + 2),
+      memory->read8(byte_address + 3),
+      memory->read8(byte_address + 4),
+      memory->read8(byte_address + 5),
+      memory->read8(byte_address + 6),
+      memory->read8(byte_address + 7),
+      instruction);
+
+    address++;
+  }
+}
+
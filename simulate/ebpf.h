@@ -16,6 +16,31 @@
 
 #include "simulate/Simulate.h"
 
+// Registers hold 64 bit addresses so the packet and stack are placed
+// above anything a 32 bit address in the program's memory could reach.
+#define EBPF_PACKET_ADDRESS 0x100000000ULL
+#define EBPF_STACK_ADDRESS 0x200000000ULL
+#define EBPF_STACK_SIZE 512
+#define EBPF_MAX_CALL_DEPTH 8
+#define EBPF_MAX_INSTRUCTIONS (1024 * 1024)
+
+// An instruction as read from memory.  lddw's 64 bit immediate is put
+// together into the first of its two slots.
+struct EbpfInstruction
+{
+  uint8_t opcode;
+  uint8_t dst;
+  uint8_t src;
+  int16_t offset;
+  int64_t imm;
+};
+
+struct EbpfFrame
+{
+  uint32_t return_pc;
+  uint64_t saved[4];
+};
+
 class SimulateEbpf : public Simulate
 {
 public:
@@ -30,14 +55,39 @@ public:
   virtual uint32_t get_reg(const char *reg_string);
   virtual void set_pc(uint32_t value);
   virtual void dump_registers();
-  virtual int run(int max_cycles, int step);
+  virtual int run(int64_t max_cycles, int step);
+  virtual int load_packet(const uint8_t *data, int length);
 
 private:
   int get_register(const char *s);
+  int load_program();
+  int validate_program();
+  void start_program();
+  int execute(int count);
+  uint8_t *get_pointer(uint64_t address, int size);
+  uint64_t load(const uint8_t *data, int size);
+  void store(uint8_t *data, int size, uint64_t value);
+  int call_helper(int id);
+  void trace_printk(uint64_t format, uint32_t size);
+  void show_instructions(uint32_t address);
 
-  int64_t reg[16];
+  uint64_t reg[11];
   uint32_t pc;
+  int error;
+  bool exited;
+
+  EbpfInstruction *program;
+  uint32_t program_start;
+  uint32_t program_count;
+
+  EbpfFrame frames[EBPF_MAX_CALL_DEPTH];
+  int call_depth;
+  uint8_t stack[EBPF_STACK_SIZE * EBPF_MAX_CALL_DEPTH];
 
+  uint8_t *packet;
+  uint8_t *packet_original;
+  uint32_t packet_length;
+  uint32_t random_seed;
 };
 
 #endif
@@ -108,19 +108,26 @@ void SimulateLc3::dump_registers()
   printf("\n");
 }
 
-int SimulateLc3::run(int max_cycles, int step)
+int SimulateLc3::run(int64_t max_cycles, int step)
 {
   char instruction[128];
   uint16_t opcode;
-  int cycles = 0;
+  int64_t cycles = 0;
   int ret;
   int pc_current;
   int n;
 
   printf("Running... Press Ctl-C to break.\n");
 
+  stop_reason = SIMULATE_STOP_NONE;
+
   while (stop_running == false)
   {
+    instruction_count++;
+
+    // Instructions aren't timed yet so max_cycles counts instructions.
+    cycles++;
+
     pc_current = pc;
 
     opcode = READ_RAM(pc_current);
@@ -152,7 +159,7 @@ int SimulateLc3::run(int max_cycles, int step)
           &cycles_min,
           &cycles_max);
 
-        if (pc_current == break_point) { printf("*"); }
+        if (has_break_point(pc_current)) { printf("*"); }
         else { printf(" "); }
 
         if (n == 0)
@@ -170,7 +177,7 @@ int SimulateLc3::run(int max_cycles, int step)
 
         while (count > 0)
         {
-          if (pc_current == break_point) { printf("*"); }
+          if (has_break_point(pc_current)) { printf("*"); }
           else { printf(" "); }
 
           num = (READ_RAM(pc_current + 1) << 8) | READ_RAM(pc_current);
@@ -183,22 +190,28 @@ int SimulateLc3::run(int max_cycles, int step)
 
     if (auto_run == 1 && nested_call_count < 0)
     {
+      stop_reason = SIMULATE_STOP_END;
       return 0;
     }
 
     if (ret == -1)
     {
       printf("Illegal instruction 0x%04x at address 0x%04x\n", opcode, pc_current);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
 
-    if (max_cycles != -1 && cycles > max_cycles) { break; }
+    if (max_cycles != -1 && cycles >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
 
-    printf("\n");
+    if (batch_mode == false) { printf("\n"); }
 
-    if (break_point == pc)
+    if (break_hit(pc))
     {
-      printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
@@ -210,7 +223,8 @@ int SimulateLc3::run(int max_cycles, int step)
 
     if (reg[0] == 0xffff)
     {
-      printf("Function ended.  Total cycles: %d\n", cycle_count);
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
       step_mode = 0;
       pc = READ_RAM(0xfffe) | (READ_RAM(0xffff) << 8);
 
@@ -218,13 +232,13 @@ int SimulateLc3::run(int max_cycles, int step)
       return 0;
     }
 
-    usleep(usec);
+    delay();
   }
 
   disable_signal_handler();
 
   printf("Stopped.  PC=0x%04x.\n", pc);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
@@ -346,6 +360,7 @@ int SimulateLc3::execute(uint16_t opcode)
     if ((offset9 & 0x100) != 0) { offset9 |= 0xff00; }
 
     address = pc + offset9;
+    watch_access(address, BREAK_POINT_READ);
     reg[r0] = READ_RAM(address);
 
     return 0;
@@ -358,7 +373,9 @@ int SimulateLc3::execute(uint16_t opcode)
     if ((offset9 & 0x100) != 0) { offset9 |= 0xff00; }
 
     address = pc + offset9;
+    watch_access(address, BREAK_POINT_READ);
     address = READ_RAM(address);
+    watch_access(address, BREAK_POINT_READ);
     reg[r0] = READ_RAM(address);
 
     return 0;
@@ -371,6 +388,7 @@ int SimulateLc3::execute(uint16_t opcode)
     if ((offset6 & 0x200) != 0) { offset6 |= 0xfe00; }
 
     address = reg[r1] + offset6;
+    watch_access(address, BREAK_POINT_READ);
     reg[r0] = READ_RAM(address);
 
     return 0;
@@ -431,6 +449,7 @@ int SimulateLc3::execute(uint16_t opcode)
     if ((offset9 & 0x100) != 0) { offset9 |= 0xff00; }
 
     address = pc + offset9;
+    watch_access(address, BREAK_POINT_WRITE);
     WRITE_RAM(address, reg[r0]);
 
     return 0;
@@ -443,7 +462,9 @@ int SimulateLc3::execute(uint16_t opcode)
     if ((offset9 & 0x100) != 0) { offset9 |= 0xff00; }
 
     address = pc + offset9;
+    watch_access(address, BREAK_POINT_READ);
     address = READ_RAM(address);
+    watch_access(address, BREAK_POINT_WRITE);
     WRITE_RAM(address, reg[r0]);
 
     return 0;
@@ -456,6 +477,7 @@ int SimulateLc3::execute(uint16_t opcode)
     if ((offset6 & 0x200) != 0) { offset6 |= 0xfe00; }
 
     address = reg[r1] + offset6;
+    watch_access(address, BREAK_POINT_WRITE);
     WRITE_RAM(address, reg[r0]);
 
     return 0;
@@ -13,10 +13,192 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <math.h>
 
 #include "simulate/mips.h"
 #include "disasm/mips.h"
 
+// Each instruction the decoder knows has its own handler.
+enum
+{
+  MIPS_ILLEGAL,
+  MIPS_FETCH_ERROR,
+  MIPS_NOP,
+  MIPS_SLL,
+  MIPS_SRL,
+  MIPS_ROTR,
+  MIPS_SRA,
+  MIPS_SLLV,
+  MIPS_SRLV,
+  MIPS_ROTRV,
+  MIPS_SRAV,
+  MIPS_JR,
+  MIPS_JALR,
+  MIPS_MOVZ,
+  MIPS_MOVN,
+  MIPS_MOVF,
+  MIPS_MOVT,
+  MIPS_SYSCALL,
+  MIPS_BREAK,
+  MIPS_MFHI,
+  MIPS_MTHI,
+  MIPS_MFLO,
+  MIPS_MTLO,
+  MIPS_MULT,
+  MIPS_MULTU,
+  MIPS_DIV,
+  MIPS_DIVU,
+  MIPS_ADD,
+  MIPS_ADDU,
+  MIPS_SUB,
+  MIPS_SUBU,
+  MIPS_AND,
+  MIPS_OR,
+  MIPS_XOR,
+  MIPS_NOR,
+  MIPS_SLT,
+  MIPS_SLTU,
+  MIPS_TGE,
+  MIPS_TGEU,
+  MIPS_TLT,
+  MIPS_TLTU,
+  MIPS_TEQ,
+  MIPS_TNE,
+  MIPS_BLTZ,
+  MIPS_BGEZ,
+  MIPS_BLTZL,
+  MIPS_BGEZL,
+  MIPS_TGEI,
+  MIPS_TGEIU,
+  MIPS_TLTI,
+  MIPS_TLTIU,
+  MIPS_TEQI,
+  MIPS_TNEI,
+  MIPS_BLTZAL,
+  MIPS_BGEZAL,
+  MIPS_BLTZALL,
+  MIPS_BGEZALL,
+  MIPS_J,
+  MIPS_JAL,
+  MIPS_BEQ,
+  MIPS_BNE,
+  MIPS_BLEZ,
+  MIPS_BGTZ,
+  MIPS_BEQL,
+  MIPS_BNEL,
+  MIPS_BLEZL,
+  MIPS_BGTZL,
+  MIPS_ADDI,
+  MIPS_ADDIU,
+  MIPS_SLTI,
+  MIPS_SLTIU,
+  MIPS_ANDI,
+  MIPS_ORI,
+  MIPS_XORI,
+  MIPS_LUI,
+  MIPS_MFC0,
+  MIPS_MTC0,
+  MIPS_DI,
+  MIPS_EI,
+  MIPS_ERET,
+  MIPS_MADD,
+  MIPS_MADDU,
+  MIPS_MUL,
+  MIPS_MSUB,
+  MIPS_MSUBU,
+  MIPS_CLZ,
+  MIPS_CLO,
+  MIPS_EXT,
+  MIPS_INS,
+  MIPS_WSBH,
+  MIPS_SEB,
+  MIPS_SEH,
+  MIPS_LB,
+  MIPS_LH,
+  MIPS_LWL,
+  MIPS_LW,
+  MIPS_LBU,
+  MIPS_LHU,
+  MIPS_LWR,
+  MIPS_SB,
+  MIPS_SH,
+  MIPS_SWL,
+  MIPS_SW,
+  MIPS_SWR,
+  MIPS_LL,
+  MIPS_SC,
+  MIPS_LWC1,
+  MIPS_SWC1,
+  MIPS_LDC1,
+  MIPS_SDC1,
+  MIPS_MFC1,
+  MIPS_MFHC1,
+  MIPS_CFC1,
+  MIPS_MTC1,
+  MIPS_MTHC1,
+  MIPS_CTC1,
+  MIPS_BC1F,
+  MIPS_BC1T,
+  MIPS_BC1FL,
+  MIPS_BC1TL,
+  MIPS_ADD_S,
+  MIPS_SUB_S,
+  MIPS_MUL_S,
+  MIPS_DIV_S,
+  MIPS_SQRT_S,
+  MIPS_ABS_S,
+  MIPS_MOV_S,
+  MIPS_NEG_S,
+  MIPS_ROUND_W_S,
+  MIPS_TRUNC_W_S,
+  MIPS_CEIL_W_S,
+  MIPS_FLOOR_W_S,
+  MIPS_MOVF_S,
+  MIPS_MOVT_S,
+  MIPS_MOVZ_S,
+  MIPS_MOVN_S,
+  MIPS_CVT_D_S,
+  MIPS_CVT_W_S,
+  MIPS_C_S,
+  MIPS_ADD_D,
+  MIPS_SUB_D,
+  MIPS_MUL_D,
+  MIPS_DIV_D,
+  MIPS_SQRT_D,
+  MIPS_ABS_D,
+  MIPS_MOV_D,
+  MIPS_NEG_D,
+  MIPS_ROUND_W_D,
+  MIPS_TRUNC_W_D,
+  MIPS_CEIL_W_D,
+  MIPS_FLOOR_W_D,
+  MIPS_MOVF_D,
+  MIPS_MOVT_D,
+  MIPS_MOVZ_D,
+  MIPS_MOVN_D,
+  MIPS_CVT_S_D,
+  MIPS_CVT_W_D,
+  MIPS_C_D,
+  MIPS_CVT_S_W,
+  MIPS_CVT_D_W,
+  MIPS_HANDLER_COUNT
+};
+
+// FCSR rounding modes, also used for round/trunc/ceil/floor.w.
+enum
+{
+  ROUND_NEAREST,
+  ROUND_ZERO,
+  ROUND_UP,
+  ROUND_DOWN,
+};
+
+#define FCSR_CC0 0x00800000
+#define FCSR_CC1 0x02000000
+
+// Floating point implementation register read with cfc1.
+#define FIR_VALUE 0x00030000
+
 static const char *reg_names[32] =
 {
   "$0",  "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
@@ -25,8 +207,24 @@ static const char *reg_names[32] =
   "$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"
 };
 
+SimulateMips::Handler SimulateMips::handlers[MIPS_HANDLER_COUNT];
+
+template<>
+void SimulateMips::build_handlers<MIPS_HANDLER_COUNT>()
+{
+}
+
+template<int OP>
+void SimulateMips::build_handlers()
+{
+  handlers[OP] = &SimulateMips::execute<OP>;
+  build_handlers<OP + 1>();
+}
+
 SimulateMips::SimulateMips(Memory *memory) : Simulate(memory)
 {
+  if (handlers[0] == NULL) { build_handlers<0>(); }
+
   reset();
 }
 
@@ -42,13 +240,32 @@ Simulate *SimulateMips::init(Memory *memory)
 void SimulateMips::reset()
 {
   memset(reg, 0, sizeof(reg));
+  memset(fpr, 0, sizeof(fpr));
+  memset(cop0, 0, sizeof(cop0));
   hi = 0;
   lo = 0;
-  ra_was_set = false;
-  force_break = false;
+  fcsr = 0;
+  ebase = 0x80000000;
+  count_offset = 0;
+  in_delay_slot = false;
+  delay_slot_next = false;
+  ll_bit = false;
+  halted = false;
+
+  // Exceptions go to the boot vectors until the program clears BEV.
+  cop0[MIPS_COP0_STATUS] = MIPS_STATUS_BEV;
+  cop0[MIPS_COP0_PRID] = 0x00018000;
+  cop0[MIPS_COP0_CONFIG] = 0x80000402;
+
+  if (memory->endian == ENDIAN_BIG)
+  {
+    cop0[MIPS_COP0_CONFIG] |= 0x00008000;
+  }
 
   pc = memory->low_address;
+  next_pc = pc + 4;
   reg[29] = 0x80000000;
+  reg[31] = MIPS_RETURN_ADDRESS;
 
   // PIC32 kind of hack.  Need to figure out a better way to do this
   // later.  Problem is PIC32 has virtual memory (where code addresses)
@@ -76,6 +293,8 @@ void SimulateMips::reset()
     }
   }
 #endif
+
+  flush_decode_cache();
 }
 
 void SimulateMips::push(uint32_t value)
@@ -84,6 +303,10 @@ void SimulateMips::push(uint32_t value)
 
 int SimulateMips::set_reg(const char *reg_string, uint32_t value)
 {
+  if (strcmp(reg_string, "pc") == 0) { set_pc(value); return 0; }
+  if (strcmp(reg_string, "hi") == 0) { hi = value; return 0; }
+  if (strcmp(reg_string, "lo") == 0) { lo = value; return 0; }
+
   if (reg_string[0] != '$') { return -1; }
 
   if (reg_string[1] >= '0' && reg_string[1] <= '9' &&
@@ -111,6 +334,10 @@ int SimulateMips::set_reg(const char *reg_string, uint32_t value)
 
 uint32_t SimulateMips::get_reg(const char *reg_string)
 {
+  if (strcmp(reg_string, "pc") == 0) { return pc; }
+  if (strcmp(reg_string, "hi") == 0) { return hi; }
+  if (strcmp(reg_string, "lo") == 0) { return lo; }
+
   if (reg_string[0] != '$') { return -1; }
 
   if (reg_string[1] >= '0' && reg_string[1] <= '9' &&
@@ -137,6 +364,8 @@ uint32_t SimulateMips::get_reg(const char *reg_string)
 void SimulateMips::set_pc(uint32_t value)
 {
   pc = value;
+  next_pc = value + 4;
+  delay_slot_next = false;
 }
 
 void SimulateMips::dump_registers()
@@ -153,469 +382,1358 @@ void SimulateMips::dump_registers()
   }
 
   printf("\n\n");
-  printf("%d clock cycles have passed since last reset.\n\n", cycle_count);
+  printf(" Status: 0x%08x  Cause: 0x%08x  EPC: 0x%08x  FCSR: 0x%08x\n",
+    cop0[MIPS_COP0_STATUS],
+    cop0[MIPS_COP0_CAUSE],
+    cop0[MIPS_COP0_EPC],
+    fcsr);
+
+  for (n = 0; n < 32; n++)
+  {
+    printf("%c$f%-2d: 0x%08x", (n & 0x3) == 0 ? '\n' : ' ', n, fpr[n]);
+  }
+
+  printf("\n\n");
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
-int SimulateMips::run(int max_cycles, int step)
+int SimulateMips::run(int64_t max_cycles, int step)
 {
-  char instruction[128];
-  uint32_t current_pc;
+  int64_t cycles = 0;
+
+  printf("Running... Press Ctl-C to break.\n");
+
+  stop_reason = SIMULATE_STOP_NONE;
+  halted = false;
+
+  // Memory could have been changed from outside since the last run.
+  flush_decode_cache();
 
   while (stop_running == false)
   {
-    current_pc = pc;
-
-    int ret = execute();
+    uint32_t current_pc = pc;
 
-    if (ret == -1)
+    if (max_cycles != -1 && cycles >= max_cycles)
     {
-      printf("Illegal instruction at address 0x%04x\n", pc);
-      return -1;
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
     }
 
-    cycle_count++;
+    // Outside of batch mode instructions are run one at a time so each
+    // can be shown or delayed.  Break points and watch points are
+    // checked after every instruction.
+    int count = 1;
 
-    if (show == true)
+    if (batch_mode == true && step == false && break_point_count == 0)
     {
-      dump_registers();
+      count = 4096;
 
-      int n = 0;
-      while (n < 6)
+      if (max_cycles != -1 && count > max_cycles - cycles)
       {
-        int cycles_min, cycles_max;
-
-        uint32_t opcode = memory->read32(current_pc);
+        count = max_cycles - cycles;
+      }
+    }
 
-        int count = disasm_mips(
-          memory,
-          MIPS_I | MIPS_II | MIPS_III | MIPS_32,
-          current_pc,
-          instruction,
-          sizeof(instruction),
-          &cycles_min,
-          &cycles_max);
+    int ret = execute_instructions(count);
 
-        if (count < 1) { break; }
+    if (ret == -1)
+    {
+      stop_reason = SIMULATE_STOP_ILLEGAL;
+      disable_signal_handler();
+      return -1;
+    }
 
-        if (current_pc == (uint32_t)break_point)
-        {
-          printf("*");
-        }
-          else
-        {
-          printf(" ");
-        }
+    cycles += ret;
 
-        if (n == 0)
-        {
-          printf("! ");
-        }
-          else
-        if (current_pc == pc)
-        {
-          printf("> ");
-        }
-          else
-        {
-          printf("  ");
-        }
+    if (show == true)
+    {
+      printf("\x1b[1J\x1b[1;1H");
+      dump_registers();
+      show_instructions(current_pc);
+    }
 
-        printf("0x%04x: 0x%08x %-40s %d\n", current_pc, opcode, instruction, cycles_min);
+    if (halted == true)
+    {
+      printf("Halted at 0x%08x.  Total cycles: %" PRIu64 "\n", pc, cycle_count);
+      stop_reason = SIMULATE_STOP_END;
+      disable_signal_handler();
+      return 0;
+    }
 
-        current_pc += 4;
-        n++;
-      }
+    if (pc == MIPS_RETURN_ADDRESS)
+    {
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
+      step_mode = false;
+      disable_signal_handler();
+      return 0;
     }
 
-    if (pc == (uint32_t)break_point)
+    if (break_hit(pc))
     {
-       printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
-    if (usec == 0 || step == true || force_break == true)
+    if (usec == 0 || step == true)
     {
       disable_signal_handler();
       return 0;
     }
+
+    delay();
   }
 
   disable_signal_handler();
 
-  printf("Stopped.  PC=0x%04x.\n", pc);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("Stopped.  PC=0x%08x.\n", pc);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
 
-int32_t SimulateMips::get_offset16(uint32_t opcode)
+// Runs up to count instructions and returns how many ran, or -1 if an
+// exception with no handler stopped the simulation.
+int SimulateMips::execute_instructions(int count)
 {
-  int32_t offset = (int32_t)((int16_t)(opcode & 0x3ffffff));
-  offset = offset << 2;
+  int n;
 
-  return offset;
-}
+  for (n = 0; n < count; n++)
+  {
+    MipsDecode *entry = &decode_cache[(pc >> 2) & MIPS_DECODE_CACHE_MASK];
 
-int SimulateMips::delay_slot()
-{
-  uint32_t old_pc = pc;
+    if (entry->address != pc) { decode(entry, pc); }
 
-  pc += 4;
-  execute();
-  pc = old_pc;
+    // The instruction after a branch runs before the branch is taken,
+    // so branches only change next_pc.
+    in_delay_slot = delay_slot_next;
+    delay_slot_next = false;
+    pc = next_pc;
+    next_pc = pc + 4;
 
-  return 0;
+    if ((this->*entry->execute)(entry) == -1) { return -1; }
+
+    reg[0] = 0;
+
+    // All instructions are counted as a single cycle.  The Count
+    // register is read from cycle_count so it's kept up to date here.
+    cycle_count++;
+    instruction_count++;
+
+    if (halted == true || pc == MIPS_RETURN_ADDRESS) { return n + 1; }
+  }
+
+  return count;
 }
 
-int SimulateMips::execute_shift(uint32_t opcode)
+void SimulateMips::decode(MipsDecode *decode, uint32_t address)
 {
-  int sa = (opcode >> 6) & 0x1f;
-  int rd = (opcode >> 11) & 0x1f;
-  int rt = (opcode >> 16) & 0x1f;
+  int n = MIPS_ILLEGAL;
+
+  decode->address = address;
 
-  switch (opcode & 0x3f)
+  if ((address & 3) != 0)
   {
-    case 0: // sll
-      reg[rd] = reg[rt] << sa;
-      break;
-    case 2: // srl
-      reg[rd] = ((uint32_t)reg[rt]) >> sa;
-      break;
-    case 3: // sra
-      reg[rd] = reg[rt] >> sa;
-      break;
-    default:
-      return -1;
+    decode->rs = 0;
+    decode->rt = 0;
+    decode->rd = 0;
+    decode->sa = 0;
+    decode->imm = 0;
+    decode->execute = handlers[MIPS_FETCH_ERROR];
+    return;
   }
 
-  return 0;
-}
+  uint32_t opcode = memory->read32(address);
 
-int SimulateMips::execute_mips_r(uint32_t opcode)
-{
-  int rd = (opcode >> 11) & 0x1f;
-  int rt = (opcode >> 16) & 0x1f;
-  int rs = (opcode >> 21) & 0x1f;
+  const int rs = (opcode >> 21) & 0x1f;
+  const int rt = (opcode >> 16) & 0x1f;
+  const int rd = (opcode >> 11) & 0x1f;
+  const int sa = (opcode >> 6) & 0x1f;
+  const int funct = opcode & 0x3f;
+  const int32_t offset = (int32_t)((int16_t)(opcode & 0xffff)) * 4;
 
-  opcode = opcode & 0x3f;
+  decode->rs = rs;
+  decode->rt = rt;
+  decode->rd = rd;
+  decode->sa = sa;
+  decode->imm = (int16_t)(opcode & 0xffff);
 
-  switch (opcode)
+  switch (opcode >> 26)
   {
-    case 0x20: // add
-      // FIXME - need to trap on overflow
-      reg[rd] = reg[rs] + reg[rt];
-      break;
-    case 0x21: // addu
-      reg[rd] = reg[rs] + reg[rt];
+    case 0x00: // SPECIAL
+      switch (funct)
+      {
+        case 0x00: n = opcode == 0 ? MIPS_NOP : MIPS_SLL; break;
+        case 0x01:
+          n = (rt & 1) == 0 ? MIPS_MOVF : MIPS_MOVT;
+          decode->sa = rt >> 2;
+          break;
+        case 0x02: n = (rs & 1) == 0 ? MIPS_SRL : MIPS_ROTR; break;
+        case 0x03: n = MIPS_SRA; break;
+        case 0x04: n = MIPS_SLLV; break;
+        case 0x06: n = (sa & 1) == 0 ? MIPS_SRLV : MIPS_ROTRV; break;
+        case 0x07: n = MIPS_SRAV; break;
+        case 0x08: n = MIPS_JR; break;
+        case 0x09: n = MIPS_JALR; break;
+        case 0x0a: n = MIPS_MOVZ; break;
+        case 0x0b: n = MIPS_MOVN; break;
+        case 0x0c: n = MIPS_SYSCALL; break;
+        case 0x0d: n = MIPS_BREAK; break;
+        case 0x0f: n = MIPS_NOP; break; // sync
+        case 0x10: n = MIPS_MFHI; break;
+        case 0x11: n = MIPS_MTHI; break;
+        case 0x12: n = MIPS_MFLO; break;
+        case 0x13: n = MIPS_MTLO; break;
+        case 0x18: n = MIPS_MULT; break;
+        case 0x19: n = MIPS_MULTU; break;
+        case 0x1a: n = MIPS_DIV; break;
+        case 0x1b: n = MIPS_DIVU; break;
+        case 0x20: n = MIPS_ADD; break;
+        case 0x21: n = MIPS_ADDU; break;
+        case 0x22: n = MIPS_SUB; break;
+        case 0x23: n = MIPS_SUBU; break;
+        case 0x24: n = MIPS_AND; break;
+        case 0x25: n = MIPS_OR; break;
+        case 0x26: n = MIPS_XOR; break;
+        case 0x27: n = MIPS_NOR; break;
+        case 0x2a: n = MIPS_SLT; break;
+        case 0x2b: n = MIPS_SLTU; break;
+        case 0x30: n = MIPS_TGE; break;
+        case 0x31: n = MIPS_TGEU; break;
+        case 0x32: n = MIPS_TLT; break;
+        case 0x33: n = MIPS_TLTU; break;
+        case 0x34: n = MIPS_TEQ; break;
+        case 0x36: n = MIPS_TNE; break;
+      }
       break;
-    case 0x22: // sub
-      // FIXME - need to trap on overflow
-      reg[rd] = reg[rs] - reg[rt];
+    case 0x01: // REGIMM
+      switch (rt)
+      {
+        case 0x00: n = MIPS_BLTZ; decode->imm = offset; break;
+        case 0x01: n = MIPS_BGEZ; decode->imm = offset; break;
+        case 0x02: n = MIPS_BLTZL; decode->imm = offset; break;
+        case 0x03: n = MIPS_BGEZL; decode->imm = offset; break;
+        case 0x08: n = MIPS_TGEI; break;
+        case 0x09: n = MIPS_TGEIU; break;
+        case 0x0a: n = MIPS_TLTI; break;
+        case 0x0b: n = MIPS_TLTIU; break;
+        case 0x0c: n = MIPS_TEQI; break;
+        case 0x0e: n = MIPS_TNEI; break;
+        case 0x10: n = MIPS_BLTZAL; decode->imm = offset; break;
+        case 0x11: n = MIPS_BGEZAL; decode->imm = offset; break;
+        case 0x12: n = MIPS_BLTZALL; decode->imm = offset; break;
+        case 0x13: n = MIPS_BGEZALL; decode->imm = offset; break;
+      }
       break;
-    case 0x23: // subu
-      reg[rd] = reg[rs] - reg[rt];
+    case 0x02:
+      n = MIPS_J;
+      decode->imm = (opcode & 0x3ffffff) << 2;
       break;
-    case 0x24: // and
-      // FIXME - need to trap on overflow
-      reg[rd] = reg[rs] & reg[rt];
+    case 0x03:
+      n = MIPS_JAL;
+      decode->imm = (opcode & 0x3ffffff) << 2;
       break;
-    case 0x25: // or
-      reg[rd] = reg[rs] | reg[rt];
+    case 0x04: n = MIPS_BEQ; decode->imm = offset; break;
+    case 0x05: n = MIPS_BNE; decode->imm = offset; break;
+    case 0x06: n = MIPS_BLEZ; decode->imm = offset; break;
+    case 0x07: n = MIPS_BGTZ; decode->imm = offset; break;
+    case 0x08: n = MIPS_ADDI; break;
+    case 0x09: n = MIPS_ADDIU; break;
+    case 0x0a: n = MIPS_SLTI; break;
+    case 0x0b: n = MIPS_SLTIU; break;
+    case 0x0c: n = MIPS_ANDI; decode->imm = opcode & 0xffff; break;
+    case 0x0d: n = MIPS_ORI; decode->imm = opcode & 0xffff; break;
+    case 0x0e: n = MIPS_XORI; decode->imm = opcode & 0xffff; break;
+    case 0x0f:
+      if (rs != 0) { break; }
+      n = MIPS_LUI;
+      decode->imm = opcode << 16;
       break;
-    case 0x26: // xor
-      reg[rd] = reg[rs] ^ reg[rt];
+    case 0x10: // COP0
+      if (rs == 0x00) { n = MIPS_MFC0; decode->sa = opcode & 0x7; }
+        else
+      if (rs == 0x04) { n = MIPS_MTC0; decode->sa = opcode & 0x7; }
+        else
+      if (rs == 0x0b) { n = (opcode & 0x20) == 0 ? MIPS_DI : MIPS_EI; }
+        else
+      if (rs >= 0x10 && funct == 0x18) { n = MIPS_ERET; }
+        else
+      if (rs >= 0x10 && funct == 0x20) { n = MIPS_NOP; } // wait
       break;
-    case 0x27: // nor
-      reg[rd] = ~(reg[rs] | reg[rt]);
+    case 0x11: // COP1
+      switch (rs)
+      {
+        case 0x00: n = MIPS_MFC1; break;
+        case 0x02: n = MIPS_CFC1; break;
+        case 0x03: n = MIPS_MFHC1; break;
+        case 0x04: n = MIPS_MTC1; break;
+        case 0x06: n = MIPS_CTC1; break;
+        case 0x07: n = MIPS_MTHC1; break;
+        case 0x08:
+        {
+          static const int bc1[] = { MIPS_BC1F, MIPS_BC1T, MIPS_BC1FL, MIPS_BC1TL };
+          n = bc1[rt & 0x3];
+          decode->sa = rt >> 2;
+          decode->imm = offset;
+          break;
+        }
+        case 0x10: // S
+        case 0x11: // D
+        {
+          const bool is_double = rs == 0x11;
+
+          switch (funct)
+          {
+            case 0x00: n = is_double ? MIPS_ADD_D : MIPS_ADD_S; break;
+            case 0x01: n = is_double ? MIPS_SUB_D : MIPS_SUB_S; break;
+            case 0x02: n = is_double ? MIPS_MUL_D : MIPS_MUL_S; break;
+            case 0x03: n = is_double ? MIPS_DIV_D : MIPS_DIV_S; break;
+            case 0x04: n = is_double ? MIPS_SQRT_D : MIPS_SQRT_S; break;
+            case 0x05: n = is_double ? MIPS_ABS_D : MIPS_ABS_S; break;
+            case 0x06: n = is_double ? MIPS_MOV_D : MIPS_MOV_S; break;
+            case 0x07: n = is_double ? MIPS_NEG_D : MIPS_NEG_S; break;
+            case 0x0c: n = is_double ? MIPS_ROUND_W_D : MIPS_ROUND_W_S; break;
+            case 0x0d: n = is_double ? MIPS_TRUNC_W_D : MIPS_TRUNC_W_S; break;
+            case 0x0e: n = is_double ? MIPS_CEIL_W_D : MIPS_CEIL_W_S; break;
+            case 0x0f: n = is_double ? MIPS_FLOOR_W_D : MIPS_FLOOR_W_S; break;
+            case 0x11:
+              if ((rt & 1) == 0)
+              {
+                n = is_double ? MIPS_MOVF_D : MIPS_MOVF_S;
+              }
+                else
+              {
+                n = is_double ? MIPS_MOVT_D : MIPS_MOVT_S;
+              }
+              decode->rt = rt >> 2;
+              break;
+            case 0x12: n = is_double ? MIPS_MOVZ_D : MIPS_MOVZ_S; break;
+            case 0x13: n = is_double ? MIPS_MOVN_D : MIPS_MOVN_S; break;
+            case 0x20: if (is_double) { n = MIPS_CVT_S_D; } break;
+            case 0x21: if (!is_double) { n = MIPS_CVT_D_S; } break;
+            case 0x24: n = is_double ? MIPS_CVT_W_D : MIPS_CVT_W_S; break;
+            default:
+              if (funct >= 0x30)
+              {
+                n = is_double ? MIPS_C_D : MIPS_C_S;
+                decode->sa = (opcode >> 8) & 0x7;
+                decode->imm = funct & 0xf;
+              }
+              break;
+          }
+          break;
+        }
+        case 0x14: // W
+          if (funct == 0x20) { n = MIPS_CVT_S_W; }
+          if (funct == 0x21) { n = MIPS_CVT_D_W; }
+          break;
+      }
       break;
-    case 0x2a: // slt
-      reg[rd] = (reg[rs] < reg[rt]) ? 1 : 0;
+    case 0x14: n = MIPS_BEQL; decode->imm = offset; break;
+    case 0x15: n = MIPS_BNEL; decode->imm = offset; break;
+    case 0x16: n = MIPS_BLEZL; decode->imm = offset; break;
+    case 0x17: n = MIPS_BGTZL; decode->imm = offset; break;
+    case 0x1c: // SPECIAL2
+      switch (funct)
+      {
+        case 0x00: n = MIPS_MADD; break;
+        case 0x01: n = MIPS_MADDU; break;
+        case 0x02: n = MIPS_MUL; break;
+        case 0x04: n = MIPS_MSUB; break;
+        case 0x05: n = MIPS_MSUBU; break;
+        case 0x20: n = MIPS_CLZ; break;
+        case 0x21: n = MIPS_CLO; break;
+      }
       break;
-    case 0x2b: // sltu
-      reg[rd] = (reg[rs] < reg[rt]) ? 1 : 0;
+    case 0x1f: // SPECIAL3
+      if (funct == 0x00) { n = MIPS_EXT; }
+        else
+      if (funct == 0x04) { n = MIPS_INS; }
+        else
+      if (funct == 0x20)
+      {
+        if (sa == 0x02) { n = MIPS_WSBH; }
+        if (sa == 0x10) { n = MIPS_SEB; }
+        if (sa == 0x18) { n = MIPS_SEH; }
+      }
       break;
-    default:
-      return -1;
+    case 0x20: n = MIPS_LB; break;
+    case 0x21: n = MIPS_LH; break;
+    case 0x22: n = MIPS_LWL; break;
+    case 0x23: n = MIPS_LW; break;
+    case 0x24: n = MIPS_LBU; break;
+    case 0x25: n = MIPS_LHU; break;
+    case 0x26: n = MIPS_LWR; break;
+    case 0x28: n = MIPS_SB; break;
+    case 0x29: n = MIPS_SH; break;
+    case 0x2a: n = MIPS_SWL; break;
+    case 0x2b: n = MIPS_SW; break;
+    case 0x2e: n = MIPS_SWR; break;
+    case 0x2f: n = MIPS_NOP; break; // cache
+    case 0x30: n = MIPS_LL; break;
+    case 0x31: n = MIPS_LWC1; break;
+    case 0x33: n = MIPS_NOP; break; // pref
+    case 0x35: n = MIPS_LDC1; break;
+    case 0x38: n = MIPS_SC; break;
+    case 0x39: n = MIPS_SWC1; break;
+    case 0x3d: n = MIPS_SDC1; break;
   }
 
+  decode->execute = handlers[n];
+}
+
+void SimulateMips::flush_decode_cache()
+{
+  // Each entry gets an address that belongs to a different entry so
+  // nothing matches until it's decoded again.
+  for (int n = 0; n < MIPS_DECODE_CACHE_SIZE; n++)
+  {
+    decode_cache[n].address = (n + 1) << 2;
+  }
+}
+
+int SimulateMips::exception(const MipsDecode *decode, int code, uint32_t address)
+{
+  uint32_t vector = (cop0[MIPS_COP0_STATUS] & MIPS_STATUS_BEV) != 0 ?
+    0xbfc00380 : ebase + 0x180;
+
+  if (has_code(vector) == false)
+  {
+    pc = decode->address;
+    next_pc = pc + 4;
+    delay_slot_next = false;
+
+    // Without an exception handler break and syscall end the program
+    // the way ebreak and ecall do on RISC-V.
+    if (code == MIPS_EXCEPTION_BREAK || code == MIPS_EXCEPTION_SYSCALL)
+    {
+      halted = true;
+      return 0;
+    }
+
+    switch (code)
+    {
+      case MIPS_EXCEPTION_ADDRESS_LOAD:
+        printf("Alignment error.  Reading address 0x%08x\n", address);
+        break;
+      case MIPS_EXCEPTION_ADDRESS_STORE:
+        printf("Alignment error.  Writing address 0x%08x\n", address);
+        break;
+      case MIPS_EXCEPTION_OVERFLOW:
+        printf("Integer overflow at address 0x%08x\n", pc);
+        break;
+      case MIPS_EXCEPTION_TRAP:
+        printf("Trap at address 0x%08x\n", pc);
+        break;
+      default:
+        printf("Illegal instruction at address 0x%08x\n", pc);
+        break;
+    }
+
+    return -1;
+  }
+
+  if ((cop0[MIPS_COP0_STATUS] & MIPS_STATUS_EXL) == 0)
+  {
+    if (in_delay_slot)
+    {
+      cop0[MIPS_COP0_EPC] = decode->address - 4;
+      cop0[MIPS_COP0_CAUSE] |= MIPS_CAUSE_BD;
+    }
+      else
+    {
+      cop0[MIPS_COP0_EPC] = decode->address;
+      cop0[MIPS_COP0_CAUSE] &= ~MIPS_CAUSE_BD;
+    }
+  }
+
+  cop0[MIPS_COP0_CAUSE] = (cop0[MIPS_COP0_CAUSE] & ~0x7c) | (code << 2);
+  cop0[MIPS_COP0_STATUS] |= MIPS_STATUS_EXL;
+
+  if (code == MIPS_EXCEPTION_ADDRESS_LOAD ||
+      code == MIPS_EXCEPTION_ADDRESS_STORE)
+  {
+    cop0[MIPS_COP0_BADVADDR] = address;
+  }
+
+  pc = vector;
+  next_pc = vector + 4;
+  delay_slot_next = false;
+
   return 0;
 }
 
-int SimulateMips::execute_mips_i(uint32_t opcode)
+bool SimulateMips::has_code(uint32_t address)
 {
-  uint32_t address;
+  if (memory->in_use(address) == false) { return false; }
 
-  int rs = (opcode >> 21) & 0x1f;
-  int rt = (opcode >> 16) & 0x1f;
+  return address >= memory->get_page_address_min(address) &&
+         address <= memory->get_page_address_max(address);
+}
 
-  switch (opcode >> 26)
+void SimulateMips::show_instructions(uint32_t address)
+{
+  char instruction[128];
+  int cycles_min, cycles_max;
+  int n;
+
+  for (n = 0; n < 6; n++)
+  {
+    printf("%c", has_break_point(address) ? '*' : ' ');
+
+    if (n == 0) { printf("! "); }
+    else if (address == pc) { printf("> "); }
+    else { printf("  "); }
+
+    disasm_mips(
+      memory,
+      MIPS_I | MIPS_II | MIPS_III | MIPS_32 | MIPS_FPU,
+      address,
+      instruction,
+      sizeof(instruction),
+      &cycles_min,
+      &cycles_max);
+
+    printf("0x%08x: 0x%08x %-40s\n",
+      address, memory->read32(address), instruction);
+
+    address += 4;
+  }
+}
+
+float SimulateMips::get_float(int index)
+{
+  float value;
+
+  memcpy(&value, &fpr[index], sizeof(value));
+
+  return value;
+}
+
+// With Status.FR clear a double is held in an even / odd register pair
+// with the low word in the even register.
+double SimulateMips::get_double(int index)
+{
+  uint64_t data;
+  double value;
+
+  index &= 0x1e;
+  data = ((uint64_t)fpr[index + 1] << 32) | fpr[index];
+  memcpy(&value, &data, sizeof(value));
+
+  return value;
+}
+
+void SimulateMips::set_float(int index, float value)
+{
+  memcpy(&fpr[index], &value, sizeof(value));
+}
+
+void SimulateMips::set_double(int index, double value)
+{
+  uint64_t data;
+
+  memcpy(&data, &value, sizeof(data));
+
+  index &= 0x1e;
+  fpr[index] = data & 0xffffffff;
+  fpr[index + 1] = data >> 32;
+}
+
+bool SimulateMips::get_cc(int cc)
+{
+  uint32_t mask = cc == 0 ? FCSR_CC0 : FCSR_CC1 << (cc - 1);
+
+  return (fcsr & mask) != 0;
+}
+
+void SimulateMips::set_cc(int cc, bool value)
+{
+  uint32_t mask = cc == 0 ? FCSR_CC0 : FCSR_CC1 << (cc - 1);
+
+  if (value) { fcsr |= mask; }
+  else { fcsr &= ~mask; }
+}
+
+// Values that don't fit in 32 bits (and NaN) convert to 0x7fffffff the
+// same as the FPU does with the invalid operation exception disabled.
+int32_t SimulateMips::round_to_int(double value, int mode)
+{
+  switch (mode)
+  {
+    case ROUND_NEAREST: value = nearbyint(value); break;
+    case ROUND_ZERO: value = trunc(value); break;
+    case ROUND_UP: value = ceil(value); break;
+    case ROUND_DOWN: value = floor(value); break;
+  }
+
+  if (isnan(value) || value > 2147483647.0 || value < -2147483648.0)
   {
-    case 0x08: // addi
-      // FIXME - need to trap on overflow
-      reg[rt] = reg[rs] + (int16_t)(opcode & 0xffff);
+    return 0x7fffffff;
+  }
+
+  return (int32_t)value;
+}
+
+#define BRANCH(condition) \
+  delay_slot_next = true; \
+  if (condition) { next_pc = decode->address + 4 + decode->imm; }
+
+// Likely branches that aren't taken skip their delay slot.
+#define BRANCH_LIKELY(condition) \
+  if (condition) \
+  { \
+    delay_slot_next = true; \
+    next_pc = decode->address + 4 + decode->imm; \
+  } \
+    else \
+  { \
+    pc = next_pc; \
+    next_pc += 4; \
+  }
+
+#define TRAP(condition) \
+  if (condition) { return exception(decode, MIPS_EXCEPTION_TRAP, 0); }
+
+#define CHECK_ALIGN(mask, code) \
+  if ((address & mask) != 0) { return exception(decode, code, address); }
+
+// OP is a constant so the switch is reduced to the one instruction.
+template<int OP>
+int SimulateMips::execute(const MipsDecode *decode)
+{
+  const int rs = decode->rs;
+  const int rt = decode->rt;
+  const int rd = decode->rd;
+  const int sa = decode->sa;
+  const int32_t imm = decode->imm;
+  uint32_t address = reg[rs] + imm;
+
+  switch (OP)
+  {
+    case MIPS_ILLEGAL:
+      return exception(decode, MIPS_EXCEPTION_RESERVED, 0);
+    case MIPS_FETCH_ERROR:
+      return exception(decode, MIPS_EXCEPTION_ADDRESS_LOAD, decode->address);
+    case MIPS_NOP:
       break;
-    case 0x09: // addiu
-      reg[rt] = reg[rs] + (int16_t)(opcode & 0xffff);
+    case MIPS_SLL:
+      reg[rd] = (uint32_t)reg[rt] << sa;
       break;
-    case 0x0a: // slti
-      reg[rt] =
-        (reg[rs] < (int16_t)(opcode & 0xffff)) ? 1 : 0;
+    case MIPS_SRL:
+      reg[rd] = (uint32_t)reg[rt] >> sa;
       break;
-    case 0x0b: // sltiu
-      reg[rt] =
-        (reg[rs] < (int16_t)(opcode & 0xffff)) ? 1 : 0;
+    case MIPS_ROTR:
+    {
+      uint32_t value = reg[rt];
+      reg[rd] = sa == 0 ? value : (value >> sa) | (value << (32 - sa));
       break;
-    case 0x0c: // andi
-      reg[rt] = reg[rs] & (opcode & 0xffff);
+    }
+    case MIPS_SRA:
+      reg[rd] = reg[rt] >> sa;
       break;
-    case 0x0d: // ori
-      reg[rt] = reg[rs] | (opcode & 0xffff);
+    case MIPS_SLLV:
+      reg[rd] = (uint32_t)reg[rt] << (reg[rs] & 0x1f);
       break;
-    case 0x0e: // xori
-      reg[rt] = reg[rs] ^ (opcode & 0xffff);
+    case MIPS_SRLV:
+      reg[rd] = (uint32_t)reg[rt] >> (reg[rs] & 0x1f);
       break;
-    case 0x0f: // lui
-      if (rs != 0) { return -1; }
-      reg[rt] = (opcode & 0xffff) << 16;
+    case MIPS_ROTRV:
+    {
+      uint32_t value = reg[rt];
+      int shift = reg[rs] & 0x1f;
+      reg[rd] = shift == 0 ? value : (value >> shift) | (value << (32 - shift));
       break;
-    case 0x20: // lb
-      address = reg[rs] + ((int16_t)(opcode & 0xffff));
-      reg[rt] = (int32_t)((int8_t)memory->read8(address));
+    }
+    case MIPS_SRAV:
+      reg[rd] = reg[rt] >> (reg[rs] & 0x1f);
       break;
-    case 0x21: // lh
-      address = reg[rs] + ((int16_t)(opcode & 0xffff));
-      if ((address & 1) != 0)
-      {
-        printf("Alignment error.  Reading address 0x%04x\n", address);
-        return -2;
-      }
-      reg[rt] = (int32_t)((int16_t)memory->read16(address));
+    case MIPS_JR:
+      delay_slot_next = true;
+      next_pc = reg[rs];
       break;
-    case 0x23: // lw
-      address = reg[rs] + ((int16_t)(opcode & 0xffff));
-      if ((address & 3) != 0)
-      {
-        printf("Alignment error.  Reading address 0x%04x\n", address);
-        return -2;
-      }
-      reg[rt] = memory->read32(address);
+    case MIPS_JALR:
+      delay_slot_next = true;
+      next_pc = reg[rs];
+      reg[rd] = decode->address + 8;
       break;
-    case 0x24: // lbu
-      address = reg[rs] + ((int16_t)(opcode & 0xffff));
-      reg[rt] = memory->read8(address);
+    case MIPS_MOVZ:
+      if (reg[rt] == 0) { reg[rd] = reg[rs]; }
       break;
-    case 0x25: // lhu
-      address = reg[rs] + ((int16_t)(opcode & 0xffff));
-      if ((address & 1) != 0)
-      {
-        printf("Alignment error.  Reading address 0x%04x\n", address);
-        return -2;
-      }
-      reg[rt] = (int32_t)((uint16_t)memory->read16(address));
+    case MIPS_MOVN:
+      if (reg[rt] != 0) { reg[rd] = reg[rs]; }
       break;
-    case 0x28: // sb
-      address = reg[rs] + ((int16_t)(opcode & 0xffff));
-      memory->write8(address, reg[rt] & 0xff);
+    case MIPS_MOVF:
+      if (!get_cc(sa)) { reg[rd] = reg[rs]; }
       break;
-    case 0x29: // sh
-      address = reg[rs] + ((int16_t)(opcode & 0xffff));
-      if ((address & 1) != 0)
-      {
-        printf("Alignment error.  Reading address 0x%04x\n", address);
-        return -2;
-      }
-      memory->write16(address, reg[rt] & 0xffff);
+    case MIPS_MOVT:
+      if (get_cc(sa)) { reg[rd] = reg[rs]; }
       break;
-    case 0x2b: // sw
-      address = reg[rs] + ((int16_t)(opcode & 0xffff));
-      if ((address & 3) != 0)
-      {
-        printf("Alignment error.  Reading address 0x%04x\n", address);
-        return -2;
-      }
-      memory->write32(address, reg[rt]);
+    case MIPS_SYSCALL:
+      return exception(decode, MIPS_EXCEPTION_SYSCALL, 0);
+    case MIPS_BREAK:
+      return exception(decode, MIPS_EXCEPTION_BREAK, 0);
+    case MIPS_MFHI:
+      reg[rd] = hi;
       break;
-    default:
-      return -1;
-  }
-
-  return 0;
-}
-
-int SimulateMips::execute()
-{
-  uint32_t opcode = memory->read32(pc);
-
-  int rs = (opcode >> 21) & 0x1f;
-  int rt = (opcode >> 16) & 0x1f;
-  int rd = (opcode >> 11) & 0x1f;
+    case MIPS_MTHI:
+      hi = reg[rs];
+      break;
+    case MIPS_MFLO:
+      reg[rd] = lo;
+      break;
+    case MIPS_MTLO:
+      lo = reg[rs];
+      break;
+    case MIPS_MULT:
+    {
+      int64_t result = (int64_t)reg[rs] * (int64_t)reg[rt];
+      hi = (uint64_t)result >> 32;
+      lo = result & 0xffffffff;
+      break;
+    }
+    case MIPS_MULTU:
+    {
+      uint64_t result = (uint64_t)(uint32_t)reg[rs] * (uint32_t)reg[rt];
+      hi = result >> 32;
+      lo = result & 0xffffffff;
+      break;
+    }
+    case MIPS_DIV:
+      // Dividing by zero leaves HI and LO unpredictable.
+      if (reg[rt] == 0) { break; }
 
-  switch (opcode >> 26)
-  {
-    case 0x00:
-      if (((opcode >> 6) & 0x3ff) == 0 && (opcode & 0x3f) == 0x1a)
+      if (reg[rs] == INT32_MIN && reg[rt] == -1)
       {
-        // div
-        hi = reg[rs] % reg[rt];
-        lo = reg[rs] / reg[rt];
+        lo = reg[rs];
+        hi = 0;
         break;
       }
 
-      if (((opcode >> 6) & 0x3ff) == 0 && (opcode & 0x3f) == 0x1b)
+      lo = reg[rs] / reg[rt];
+      hi = reg[rs] % reg[rt];
+      break;
+    case MIPS_DIVU:
+      if (reg[rt] == 0) { break; }
+      lo = (uint32_t)reg[rs] / (uint32_t)reg[rt];
+      hi = (uint32_t)reg[rs] % (uint32_t)reg[rt];
+      break;
+    case MIPS_ADD:
+    {
+      int32_t result = (uint32_t)reg[rs] + (uint32_t)reg[rt];
+
+      if (((reg[rs] ^ result) & (reg[rt] ^ result)) < 0)
       {
-        // divu
-        hi = reg[rs] % reg[rt];
-        lo = reg[rs] / reg[rt];
-        break;
+        return exception(decode, MIPS_EXCEPTION_OVERFLOW, 0);
       }
 
-      if (((opcode >> 6) & 0x1f) == 0 && (opcode & 0x3f) == 0x18)
+      reg[rd] = result;
+      break;
+    }
+    case MIPS_ADDU:
+      reg[rd] = (uint32_t)reg[rs] + (uint32_t)reg[rt];
+      break;
+    case MIPS_SUB:
+    {
+      int32_t result = (uint32_t)reg[rs] - (uint32_t)reg[rt];
+
+      if (((reg[rs] ^ reg[rt]) & (reg[rs] ^ result)) < 0)
       {
-        // mult
-        uint64_t result = reg[rs] * reg[rt];
-        hi = result >> 32;
-        lo = result & 0xffffffff;
-        break;
+        return exception(decode, MIPS_EXCEPTION_OVERFLOW, 0);
       }
 
-      if (((opcode >> 6) & 0x1f) == 0 && (opcode & 0x3f) == 0x19)
+      reg[rd] = result;
+      break;
+    }
+    case MIPS_SUBU:
+      reg[rd] = (uint32_t)reg[rs] - (uint32_t)reg[rt];
+      break;
+    case MIPS_AND:
+      reg[rd] = reg[rs] & reg[rt];
+      break;
+    case MIPS_OR:
+      reg[rd] = reg[rs] | reg[rt];
+      break;
+    case MIPS_XOR:
+      reg[rd] = reg[rs] ^ reg[rt];
+      break;
+    case MIPS_NOR:
+      reg[rd] = ~(reg[rs] | reg[rt]);
+      break;
+    case MIPS_SLT:
+      reg[rd] = reg[rs] < reg[rt] ? 1 : 0;
+      break;
+    case MIPS_SLTU:
+      reg[rd] = (uint32_t)reg[rs] < (uint32_t)reg[rt] ? 1 : 0;
+      break;
+    case MIPS_TGE:
+      TRAP(reg[rs] >= reg[rt]);
+      break;
+    case MIPS_TGEU:
+      TRAP((uint32_t)reg[rs] >= (uint32_t)reg[rt]);
+      break;
+    case MIPS_TLT:
+      TRAP(reg[rs] < reg[rt]);
+      break;
+    case MIPS_TLTU:
+      TRAP((uint32_t)reg[rs] < (uint32_t)reg[rt]);
+      break;
+    case MIPS_TEQ:
+      TRAP(reg[rs] == reg[rt]);
+      break;
+    case MIPS_TNE:
+      TRAP(reg[rs] != reg[rt]);
+      break;
+    case MIPS_BLTZ:
+      BRANCH(reg[rs] < 0);
+      break;
+    case MIPS_BGEZ:
+      BRANCH(reg[rs] >= 0);
+      break;
+    case MIPS_BLTZL:
+      BRANCH_LIKELY(reg[rs] < 0);
+      break;
+    case MIPS_BGEZL:
+      BRANCH_LIKELY(reg[rs] >= 0);
+      break;
+    case MIPS_TGEI:
+      TRAP(reg[rs] >= imm);
+      break;
+    case MIPS_TGEIU:
+      TRAP((uint32_t)reg[rs] >= (uint32_t)imm);
+      break;
+    case MIPS_TLTI:
+      TRAP(reg[rs] < imm);
+      break;
+    case MIPS_TLTIU:
+      TRAP((uint32_t)reg[rs] < (uint32_t)imm);
+      break;
+    case MIPS_TEQI:
+      TRAP(reg[rs] == imm);
+      break;
+    case MIPS_TNEI:
+      TRAP(reg[rs] != imm);
+      break;
+    case MIPS_BLTZAL:
+    {
+      bool taken = reg[rs] < 0;
+      reg[31] = decode->address + 8;
+      BRANCH(taken);
+      break;
+    }
+    case MIPS_BGEZAL:
+    {
+      bool taken = reg[rs] >= 0;
+      reg[31] = decode->address + 8;
+      BRANCH(taken);
+      break;
+    }
+    case MIPS_BLTZALL:
+    {
+      bool taken = reg[rs] < 0;
+      reg[31] = decode->address + 8;
+      BRANCH_LIKELY(taken);
+      break;
+    }
+    case MIPS_BGEZALL:
+    {
+      bool taken = reg[rs] >= 0;
+      reg[31] = decode->address + 8;
+      BRANCH_LIKELY(taken);
+      break;
+    }
+    case MIPS_J:
+      delay_slot_next = true;
+      next_pc = ((decode->address + 4) & 0xf0000000) | imm;
+      break;
+    case MIPS_JAL:
+      delay_slot_next = true;
+      next_pc = ((decode->address + 4) & 0xf0000000) | imm;
+      reg[31] = decode->address + 8;
+      break;
+    case MIPS_BEQ:
+      BRANCH(reg[rs] == reg[rt]);
+      break;
+    case MIPS_BNE:
+      BRANCH(reg[rs] != reg[rt]);
+      break;
+    case MIPS_BLEZ:
+      BRANCH(reg[rs] <= 0);
+      break;
+    case MIPS_BGTZ:
+      BRANCH(reg[rs] > 0);
+      break;
+    case MIPS_BEQL:
+      BRANCH_LIKELY(reg[rs] == reg[rt]);
+      break;
+    case MIPS_BNEL:
+      BRANCH_LIKELY(reg[rs] != reg[rt]);
+      break;
+    case MIPS_BLEZL:
+      BRANCH_LIKELY(reg[rs] <= 0);
+      break;
+    case MIPS_BGTZL:
+      BRANCH_LIKELY(reg[rs] > 0);
+      break;
+    case MIPS_ADDI:
+    {
+      int32_t result = (uint32_t)reg[rs] + (uint32_t)imm;
+
+      if (((reg[rs] ^ result) & (imm ^ result)) < 0)
       {
-        // multu
-        uint64_t result = reg[rs] * reg[rt];
-        hi = result >> 32;
-        lo = result & 0xffffffff;
-        break;
+        return exception(decode, MIPS_EXCEPTION_OVERFLOW, 0);
       }
 
-      if (((opcode >> 6) & 0x7fff) == 0 && (opcode & 0x3f) == 0x11)
+      reg[rt] = result;
+      break;
+    }
+    case MIPS_ADDIU:
+      reg[rt] = (uint32_t)reg[rs] + (uint32_t)imm;
+      break;
+    case MIPS_SLTI:
+      reg[rt] = reg[rs] < imm ? 1 : 0;
+      break;
+    case MIPS_SLTIU:
+      reg[rt] = (uint32_t)reg[rs] < (uint32_t)imm ? 1 : 0;
+      break;
+    case MIPS_ANDI:
+      reg[rt] = reg[rs] & imm;
+      break;
+    case MIPS_ORI:
+      reg[rt] = reg[rs] | imm;
+      break;
+    case MIPS_XORI:
+      reg[rt] = reg[rs] ^ imm;
+      break;
+    case MIPS_LUI:
+      reg[rt] = imm;
+      break;
+    case MIPS_MFC0:
+      if (rd == MIPS_COP0_COUNT && sa == 0)
       {
-        // mthi
-        hi = reg[rs];
-        break;
+        reg[rt] = cycle_count - count_offset;
       }
-
-      if (((opcode >> 6) & 0x7fff) == 0 && (opcode & 0x3f) == 0x13)
+        else
+      if (rd == MIPS_COP0_PRID && sa == 1)
       {
-        // mtlo
-        lo = reg[rs];
-        break;
+        reg[rt] = ebase;
       }
-
-      if (((opcode >> 16) & 0x3ff) == 0 &&
-          ((opcode >> 6) & 0x1f) == 0 &&
-           (opcode & 0x3f) == 0x10)
+        else
       {
-        // mfhi
-        reg[rd] = hi;
-        break;
+        reg[rt] = sa == 0 ? cop0[rd] : 0;
       }
-
-      if (((opcode >> 16) & 0x3ff) == 0 &&
-          ((opcode >> 6) & 0x1f) == 0 &&
-           (opcode & 0x3f) == 0x12)
+      break;
+    case MIPS_MTC0:
+      if (sa != 0)
       {
-        // mflo
-        reg[rd] = lo;
+        if (rd == MIPS_COP0_PRID && sa == 1)
+        {
+          ebase = 0x80000000 | (reg[rt] & 0x3ffff000);
+        }
         break;
       }
 
-      if (((opcode >> 6) & 0x1f) == 0)
+      switch (rd)
       {
-        if (execute_mips_r(opcode) == 0) { break; }
+        case MIPS_COP0_COUNT:
+          count_offset = cycle_count - reg[rt];
+          break;
+        case MIPS_COP0_CAUSE:
+          // Only the software interrupt bits can be written.
+          cop0[rd] = (cop0[rd] & ~0x300) | (reg[rt] & 0x300);
+          break;
+        case MIPS_COP0_PRID:
+        case MIPS_COP0_CONFIG:
+          break;
+        default:
+          cop0[rd] = reg[rt];
+          break;
       }
+      break;
+    case MIPS_DI:
+      reg[rt] = cop0[MIPS_COP0_STATUS];
+      cop0[MIPS_COP0_STATUS] &= ~MIPS_STATUS_IE;
+      break;
+    case MIPS_EI:
+      reg[rt] = cop0[MIPS_COP0_STATUS];
+      cop0[MIPS_COP0_STATUS] |= MIPS_STATUS_IE;
+      break;
+    case MIPS_ERET:
+      pc = cop0[MIPS_COP0_EPC];
+      next_pc = pc + 4;
+      cop0[MIPS_COP0_STATUS] &= ~MIPS_STATUS_EXL;
+      ll_bit = false;
+      break;
+    case MIPS_MADD:
+    case MIPS_MADDU:
+    case MIPS_MSUB:
+    case MIPS_MSUBU:
+    {
+      uint64_t acc = ((uint64_t)hi << 32) | lo;
+      uint64_t product;
 
-      if (((opcode >> 21) & 0x1f) == 0)
+      if (OP == MIPS_MADD || OP == MIPS_MSUB)
       {
-        if (execute_shift(opcode) == 0) { break; }
+        product = (uint64_t)((int64_t)reg[rs] * (int64_t)reg[rt]);
       }
-
-      if (((opcode >> 11) & 0x3ff) == 0 && (opcode & 0x3f) == 0x08)
+        else
       {
-        // jr
-        if (((opcode >> 21) & 0x1f) == 31)
-        {
-          //if (! ra_was_set) { force_break = true; }
-        }
-
-        delay_slot();
-        pc = reg[(opcode >> 21) & 0x1f];
-        return 0;
+        product = (uint64_t)(uint32_t)reg[rs] * (uint32_t)reg[rt];
       }
 
-      return -1;
-    case 0x01:
-      if (rt == 1) // bgez
+      if (OP == MIPS_MADD || OP == MIPS_MADDU) { acc += product; }
+      else { acc -= product; }
+
+      hi = acc >> 32;
+      lo = acc & 0xffffffff;
+      break;
+    }
+    case MIPS_MUL:
+      reg[rd] = (uint32_t)reg[rs] * (uint32_t)reg[rt];
+      break;
+    case MIPS_CLZ:
+      reg[rd] = reg[rs] == 0 ? 32 : __builtin_clz(reg[rs]);
+      break;
+    case MIPS_CLO:
+      reg[rd] = reg[rs] == -1 ? 32 : __builtin_clz(~reg[rs]);
+      break;
+    case MIPS_EXT:
+    {
+      // sa is the position and rd is the size - 1.
+      uint32_t mask = rd == 31 ? 0xffffffff : (1U << (rd + 1)) - 1;
+      reg[rt] = ((uint32_t)reg[rs] >> sa) & mask;
+      break;
+    }
+    case MIPS_INS:
+    {
+      // sa is the position and rd is the position of the last bit.
+      int size = rd - sa + 1;
+      if (size <= 0) { break; }
+      uint32_t mask = size == 32 ? 0xffffffff : ((1U << size) - 1) << sa;
+      reg[rt] = (reg[rt] & ~mask) | (((uint32_t)reg[rs] << sa) & mask);
+      break;
+    }
+    case MIPS_WSBH:
+      reg[rd] = (((uint32_t)reg[rt] & 0x00ff00ff) << 8) |
+                (((uint32_t)reg[rt] >> 8) & 0x00ff00ff);
+      break;
+    case MIPS_SEB:
+      reg[rd] = (int8_t)reg[rt];
+      break;
+    case MIPS_SEH:
+      reg[rd] = (int16_t)reg[rt];
+      break;
+    case MIPS_LB:
+      watch_access(address, BREAK_POINT_READ);
+      reg[rt] = (int8_t)memory->read8(address);
+      break;
+    case MIPS_LH:
+      CHECK_ALIGN(1, MIPS_EXCEPTION_ADDRESS_LOAD);
+      watch_access(address, BREAK_POINT_READ);
+      reg[rt] = (int16_t)memory->read16(address);
+      break;
+    case MIPS_LW:
+    case MIPS_LL:
+      CHECK_ALIGN(3, MIPS_EXCEPTION_ADDRESS_LOAD);
+      watch_access(address, BREAK_POINT_READ);
+      reg[rt] = memory->read32(address);
+      if (OP == MIPS_LL) { ll_bit = true; }
+      break;
+    case MIPS_LBU:
+      watch_access(address, BREAK_POINT_READ);
+      reg[rt] = memory->read8(address);
+      break;
+    case MIPS_LHU:
+      CHECK_ALIGN(1, MIPS_EXCEPTION_ADDRESS_LOAD);
+      watch_access(address, BREAK_POINT_READ);
+      reg[rt] = memory->read16(address);
+      break;
+    case MIPS_LWL:
+    case MIPS_LWR:
+    {
+      // Merge the part of the aligned word from address to the end
+      // (lwl) or start (lwr) of the word into rt.
+      const int b = address & 3;
+      const bool big = memory->endian == ENDIAN_BIG;
+      address &= 0xfffffffc;
+      watch_access(address, BREAK_POINT_READ);
+      const uint32_t data = memory->read32(address);
+      const uint32_t value = reg[rt];
+
+      if (OP == MIPS_LWL)
       {
-        if (reg[rs] >= 0)
-        {
-          delay_slot();
-          pc += 4 + get_offset16(opcode);
-          return 0;
-        }
-        break;
+        const int shift = (big ? b : 3 - b) * 8;
+        reg[rt] = (data << shift) | (value & ((1U << shift) - 1));
       }
-      return -1;
-    case 0x02: // j
-      delay_slot();
-      pc &= 0xfc000000;
-      pc |= ((opcode & 0x3ffffff) << 2);
-      return 0;
-    case 0x03: // jal
-      delay_slot();
-      reg[31] = pc + 8;
-      pc &= 0xfc000000;
-      pc |= ((opcode & 0x3ffffff) << 2);
-      return 0;
-    case 0x04: // beq
-      if (reg[rs] == reg[rt])
+        else
       {
-        delay_slot();
-        pc += 4 + get_offset16(opcode);
-        return 0;
+        const int shift = (big ? 3 - b : b) * 8;
+        reg[rt] = (data >> shift) | (value & ~(0xffffffff >> shift));
       }
       break;
-    case 0x05: // bne
-      if (reg[rs] != reg[rt])
+    }
+    case MIPS_SB:
+      watch_access(address, BREAK_POINT_WRITE);
+      memory->write8(address, reg[rt] & 0xff);
+      check_code_write(address);
+      break;
+    case MIPS_SH:
+      CHECK_ALIGN(1, MIPS_EXCEPTION_ADDRESS_STORE);
+      watch_access(address, BREAK_POINT_WRITE);
+      memory->write16(address, reg[rt] & 0xffff);
+      check_code_write(address);
+      break;
+    case MIPS_SW:
+      CHECK_ALIGN(3, MIPS_EXCEPTION_ADDRESS_STORE);
+      watch_access(address, BREAK_POINT_WRITE);
+      memory->write32(address, reg[rt]);
+      check_code_write(address);
+      break;
+    case MIPS_SWL:
+    case MIPS_SWR:
+    {
+      const int b = address & 3;
+      const bool big = memory->endian == ENDIAN_BIG;
+      address &= 0xfffffffc;
+      watch_access(address, BREAK_POINT_WRITE);
+      const uint32_t data = memory->read32(address);
+      const uint32_t value = reg[rt];
+
+      if (OP == MIPS_SWL)
       {
-        delay_slot();
-        pc += 4 + get_offset16(opcode);
-        return 0;
+        const int shift = (big ? b : 3 - b) * 8;
+        memory->write32(address,
+          (value >> shift) | (data & ~(0xffffffff >> shift)));
       }
-      break;
-    case 0x06: // blez
-      if (rt != 0) { return -1; }
-      if (reg[rs] <= reg[rt])
+        else
       {
-        delay_slot();
-        pc += 4 + get_offset16(opcode);
-        return 0;
+        const int shift = (big ? 3 - b : b) * 8;
+        memory->write32(address,
+          (value << shift) | (data & ((1U << shift) - 1)));
       }
+
+      check_code_write(address);
       break;
-    case 0x07: // bgtz
-      if (rt != 0) { return -1; }
-      if (reg[rs] > reg[rt])
+    }
+    case MIPS_SC:
+      CHECK_ALIGN(3, MIPS_EXCEPTION_ADDRESS_STORE);
+
+      if (ll_bit)
+      {
+        watch_access(address, BREAK_POINT_WRITE);
+        memory->write32(address, reg[rt]);
+        check_code_write(address);
+        reg[rt] = 1;
+      }
+        else
       {
-        delay_slot();
-        pc += 4 + get_offset16(opcode);
-        return 0;
+        reg[rt] = 0;
       }
+
+      ll_bit = false;
+      break;
+    case MIPS_LWC1:
+      CHECK_ALIGN(3, MIPS_EXCEPTION_ADDRESS_LOAD);
+      watch_access(address, BREAK_POINT_READ);
+      fpr[rt] = memory->read32(address);
+      break;
+    case MIPS_SWC1:
+      CHECK_ALIGN(3, MIPS_EXCEPTION_ADDRESS_STORE);
+      watch_access(address, BREAK_POINT_WRITE);
+      memory->write32(address, fpr[rt]);
+      check_code_write(address);
+      break;
+    case MIPS_LDC1:
+    {
+      CHECK_ALIGN(7, MIPS_EXCEPTION_ADDRESS_LOAD);
+      watch_access(address, BREAK_POINT_READ);
+      const int index = rt & 0x1e;
+      const int high = memory->endian == ENDIAN_BIG ? 0 : 4;
+      fpr[index] = memory->read32(address + (4 - high));
+      fpr[index + 1] = memory->read32(address + high);
+      break;
+    }
+    case MIPS_SDC1:
+    {
+      CHECK_ALIGN(7, MIPS_EXCEPTION_ADDRESS_STORE);
+      watch_access(address, BREAK_POINT_WRITE);
+      const int index = rt & 0x1e;
+      const int high = memory->endian == ENDIAN_BIG ? 0 : 4;
+      memory->write32(address + (4 - high), fpr[index]);
+      memory->write32(address + high, fpr[index + 1]);
+      check_code_write(address);
+      check_code_write(address + 4);
+      break;
+    }
+    case MIPS_MFC1:
+      reg[rt] = fpr[rd];
+      break;
+    case MIPS_MFHC1:
+      reg[rt] = fpr[(rd & 0x1e) + 1];
+      break;
+    case MIPS_CFC1:
+      if (rd == 0) { reg[rt] = FIR_VALUE; }
+      else if (rd == 31) { reg[rt] = fcsr; }
+      else { reg[rt] = 0; }
+      break;
+    case MIPS_MTC1:
+      fpr[rd] = reg[rt];
+      break;
+    case MIPS_MTHC1:
+      fpr[(rd & 0x1e) + 1] = reg[rt];
+      break;
+    case MIPS_CTC1:
+      if (rd == 31) { fcsr = reg[rt]; }
+      break;
+    case MIPS_BC1F:
+      BRANCH(!get_cc(sa));
+      break;
+    case MIPS_BC1T:
+      BRANCH(get_cc(sa));
+      break;
+    case MIPS_BC1FL:
+      BRANCH_LIKELY(!get_cc(sa));
+      break;
+    case MIPS_BC1TL:
+      BRANCH_LIKELY(get_cc(sa));
+      break;
+    case MIPS_ADD_S:
+      set_float(sa, get_float(rd) + get_float(rt));
+      break;
+    case MIPS_SUB_S:
+      set_float(sa, get_float(rd) - get_float(rt));
+      break;
+    case MIPS_MUL_S:
+      set_float(sa, get_float(rd) * get_float(rt));
+      break;
+    case MIPS_DIV_S:
+      set_float(sa, get_float(rd) / get_float(rt));
+      break;
+    case MIPS_SQRT_S:
+      set_float(sa, sqrtf(get_float(rd)));
+      break;
+    case MIPS_ABS_S:
+      set_float(sa, fabsf(get_float(rd)));
+      break;
+    case MIPS_MOV_S:
+      fpr[sa] = fpr[rd];
+      break;
+    case MIPS_NEG_S:
+      fpr[sa] = fpr[rd] ^ 0x80000000;
+      break;
+    case MIPS_ROUND_W_S:
+      fpr[sa] = round_to_int(get_float(rd), ROUND_NEAREST);
+      break;
+    case MIPS_TRUNC_W_S:
+      fpr[sa] = round_to_int(get_float(rd), ROUND_ZERO);
+      break;
+    case MIPS_CEIL_W_S:
+      fpr[sa] = round_to_int(get_float(rd), ROUND_UP);
+      break;
+    case MIPS_FLOOR_W_S:
+      fpr[sa] = round_to_int(get_float(rd), ROUND_DOWN);
+      break;
+    case MIPS_MOVF_S:
+      if (!get_cc(rt)) { fpr[sa] = fpr[rd]; }
+      break;
+    case MIPS_MOVT_S:
+      if (get_cc(rt)) { fpr[sa] = fpr[rd]; }
+      break;
+    case MIPS_MOVZ_S:
+      if (reg[rt] == 0) { fpr[sa] = fpr[rd]; }
+      break;
+    case MIPS_MOVN_S:
+      if (reg[rt] != 0) { fpr[sa] = fpr[rd]; }
+      break;
+    case MIPS_CVT_D_S:
+      set_double(sa, get_float(rd));
+      break;
+    case MIPS_CVT_W_S:
+      fpr[sa] = round_to_int(get_float(rd), fcsr & 0x3);
       break;
-    case 0x1c: // mul
-      if (((opcode >> 6) & 0x1f) == 0)
+    case MIPS_ADD_D:
+      set_double(sa, get_double(rd) + get_double(rt));
+      break;
+    case MIPS_SUB_D:
+      set_double(sa, get_double(rd) - get_double(rt));
+      break;
+    case MIPS_MUL_D:
+      set_double(sa, get_double(rd) * get_double(rt));
+      break;
+    case MIPS_DIV_D:
+      set_double(sa, get_double(rd) / get_double(rt));
+      break;
+    case MIPS_SQRT_D:
+      set_double(sa, sqrt(get_double(rd)));
+      break;
+    case MIPS_ABS_D:
+      set_double(sa, fabs(get_double(rd)));
+      break;
+    case MIPS_MOV_D:
+    case MIPS_NEG_D:
+    case MIPS_MOVF_D:
+    case MIPS_MOVT_D:
+    case MIPS_MOVZ_D:
+    case MIPS_MOVN_D:
+    {
+      bool move = true;
+
+      if (OP == MIPS_MOVF_D) { move = !get_cc(rt); }
+      if (OP == MIPS_MOVT_D) { move = get_cc(rt); }
+      if (OP == MIPS_MOVZ_D) { move = reg[rt] == 0; }
+      if (OP == MIPS_MOVN_D) { move = reg[rt] != 0; }
+
+      if (move)
       {
-        reg[rd] = reg[rs] * reg[rt];
-        break;
+        fpr[sa & 0x1e] = fpr[rd & 0x1e];
+        fpr[(sa & 0x1e) + 1] = fpr[(rd & 0x1e) + 1];
+
+        if (OP == MIPS_NEG_D) { fpr[(sa & 0x1e) + 1] ^= 0x80000000; }
       }
-      return -1;
-    default:
-      if (execute_mips_i(opcode) == 0) { break; }
-      return -1;
+      break;
+    }
+    case MIPS_ROUND_W_D:
+      fpr[sa] = round_to_int(get_double(rd), ROUND_NEAREST);
+      break;
+    case MIPS_TRUNC_W_D:
+      fpr[sa] = round_to_int(get_double(rd), ROUND_ZERO);
+      break;
+    case MIPS_CEIL_W_D:
+      fpr[sa] = round_to_int(get_double(rd), ROUND_UP);
+      break;
+    case MIPS_FLOOR_W_D:
+      fpr[sa] = round_to_int(get_double(rd), ROUND_DOWN);
+      break;
+    case MIPS_CVT_S_D:
+      set_float(sa, get_double(rd));
+      break;
+    case MIPS_CVT_W_D:
+      fpr[sa] = round_to_int(get_double(rd), fcsr & 0x3);
+      break;
+    case MIPS_C_S:
+    case MIPS_C_D:
+    {
+      // The low 4 bits of the condition are the less than, equal and
+      // unordered results to check for.  The signaling versions (bit 3)
+      // compare the same since FPU exceptions aren't simulated.
+      double a = OP == MIPS_C_S ? get_float(rd) : get_double(rd);
+      double b = OP == MIPS_C_S ? get_float(rt) : get_double(rt);
+      bool unordered = isnan(a) || isnan(b);
+      bool result =
+        ((imm & 1) != 0 && unordered) ||
+        ((imm & 2) != 0 && !unordered && a == b) ||
+        ((imm & 4) != 0 && !unordered && a < b);
+
+      set_cc(sa, result);
+      break;
+    }
+    case MIPS_CVT_S_W:
+      set_float(sa, (float)(int32_t)fpr[rd]);
+      break;
+    case MIPS_CVT_D_W:
+      set_double(sa, (double)(int32_t)fpr[rd]);
       break;
   }
 
-  reg[0] = 0;
-  pc += 4;
-
   return 0;
 }
-
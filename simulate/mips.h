@@ -16,6 +16,53 @@
 
 #include "simulate/Simulate.h"
 
+#define MIPS_DECODE_CACHE_SIZE 16384
+#define MIPS_DECODE_CACHE_MASK (MIPS_DECODE_CACHE_SIZE - 1)
+
+// Returning to this address ends a function started with "call".
+#define MIPS_RETURN_ADDRESS 0xfffffffc
+
+// COP0 registers.
+#define MIPS_COP0_BADVADDR 8
+#define MIPS_COP0_COUNT 9
+#define MIPS_COP0_COMPARE 11
+#define MIPS_COP0_STATUS 12
+#define MIPS_COP0_CAUSE 13
+#define MIPS_COP0_EPC 14
+#define MIPS_COP0_PRID 15
+#define MIPS_COP0_CONFIG 16
+
+#define MIPS_STATUS_IE 0x00000001
+#define MIPS_STATUS_EXL 0x00000002
+#define MIPS_STATUS_BEV 0x00400000
+#define MIPS_CAUSE_BD 0x80000000
+
+// Cause.ExcCode values.
+#define MIPS_EXCEPTION_ADDRESS_LOAD 4
+#define MIPS_EXCEPTION_ADDRESS_STORE 5
+#define MIPS_EXCEPTION_SYSCALL 8
+#define MIPS_EXCEPTION_BREAK 9
+#define MIPS_EXCEPTION_RESERVED 10
+#define MIPS_EXCEPTION_OVERFLOW 12
+#define MIPS_EXCEPTION_TRAP 13
+
+class SimulateMips;
+
+// An instruction decoded once at an address into the function that runs
+// it and its fields.  For FPU instructions rd is fs, rt is ft and sa is
+// fd.  imm is the sign or zero extended immediate, the branch offset in
+// bytes, the jump target or the FPU compare condition.
+struct MipsDecode
+{
+  int (SimulateMips::*execute)(const MipsDecode *decode);
+  uint32_t address;
+  uint8_t rs;
+  uint8_t rt;
+  uint8_t rd;
+  uint8_t sa;
+  int32_t imm;
+};
+
 class SimulateMips : public Simulate
 {
 public:
@@ -30,23 +77,58 @@ public:
   virtual uint32_t get_reg(const char *reg_string);
   virtual void set_pc(uint32_t value);
   virtual void dump_registers();
-  virtual int run(int max_cycles, int step);
+  virtual int run(int64_t max_cycles, int step);
 
 private:
-  int32_t get_offset16(uint32_t opcode);
-  int delay_slot();
-  int execute_shift(uint32_t opcode);
-  int execute_mips_r(uint32_t opcode);
-  int execute_mips_i(uint32_t opcode);
+  typedef int (SimulateMips::*Handler)(const MipsDecode *decode);
+
+  template<int OP> static void build_handlers();
+  template<int OP> int execute(const MipsDecode *decode);
+
+  int execute_instructions(int count);
+  void decode(MipsDecode *decode, uint32_t address);
+  void flush_decode_cache();
+  int exception(const MipsDecode *decode, int code, uint32_t address);
+  bool has_code(uint32_t address);
+  void show_instructions(uint32_t address);
+
+  float get_float(int index);
+  double get_double(int index);
+  void set_float(int index, float value);
+  void set_double(int index, double value);
+  bool get_cc(int cc);
+  void set_cc(int cc, bool value);
+  int32_t round_to_int(double value, int mode);
 
-  int execute();
+  // Stores to memory that has been decoded drop the decoded instruction.
+  void check_code_write(uint32_t address)
+  {
+    MipsDecode *entry = &decode_cache[(address >> 2) & MIPS_DECODE_CACHE_MASK];
+
+    if (entry->address == (address & 0xfffffffc))
+    {
+      entry->address = ((address >> 2) + 1) << 2;
+    }
+  }
 
   int32_t reg[32];
   uint32_t pc;
+  uint32_t next_pc;
   uint32_t hi;
   uint32_t lo;
-  bool ra_was_set;
-  bool force_break;
+  uint32_t fpr[32];
+  uint32_t fcsr;
+  uint32_t cop0[32];
+  uint32_t ebase;
+  uint32_t count_offset;
+  bool in_delay_slot;
+  bool delay_slot_next;
+  bool ll_bit;
+  bool halted;
+
+  static Handler handlers[];
+
+  MipsDecode decode_cache[MIPS_DECODE_CACHE_SIZE];
 };
 
 #endif
@@ -25,14 +25,9 @@ Status: V SCG1 SCG0 OSCOFF CPUOFF GIE N Z C
 
 */
 
-#define SHOW_STACK sp, memory->read8(sp + 1), memory->read8(sp)
-#define READ_RAM(a) memory->read8(a)
-#define WRITE_RAM(a,b) \
-  if (a == break_io) \
-  { \
-    exit(b); \
-  } \
-  memory->write8(a, b);
+#define SHOW_STACK sp, peek_ram8(sp + 1), peek_ram8(sp)
+#define READ_RAM(a) read_ram8(a)
+#define WRITE_RAM(a,b) write_ram(a, b)
 
 #define GET_V()      ((reg[2] >>  8) & 1)
 #define GET_SCG1()   ((reg[2] >> 7) & 1)
@@ -130,6 +125,7 @@ static const char *flags[] =
 
 SimulateMsp430::SimulateMsp430(Memory *memory) : Simulate(memory)
 {
+  enable_flat_ram(16);
   reset();
 }
 
@@ -147,6 +143,7 @@ void SimulateMsp430::reset()
   cycle_count = 0;
   nested_call_count = 0;
   memset(reg, 0, sizeof(reg));
+  memset(decode_valid, 0, sizeof(decode_valid));
 
   // Set PC to reset vector.
   reg[0] = READ_RAM(0xfffe) | (READ_RAM(0xffff) << 8);
@@ -154,7 +151,6 @@ void SimulateMsp430::reset()
   // FIXME - A real chip wouldn't set the SP to this, but this is
   // in case someone is simulating code that won't run on a chip.
   reg[1] = 0x800;
-  break_point = -1;
 }
 
 void SimulateMsp430::push(uint32_t value)
@@ -265,14 +261,13 @@ void SimulateMsp430::dump_registers()
   }
   printf("      0x%04x: 0x%02x%02x", SHOW_STACK);
   printf("\n\n");
-  printf("%d clock cycles have passed since last reset.\n\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
-int SimulateMsp430::run(int max_cycles, int step)
+int SimulateMsp430::run(int64_t max_cycles, int step)
 {
   char instruction[128];
-  uint16_t opcode;
-  int cycles = 0;
+  int64_t cycles = 0;
   int ret;
   int pc;
   int c;
@@ -280,33 +275,41 @@ int SimulateMsp430::run(int max_cycles, int step)
 
   printf("Running... Press Ctl-C to break.\n");
 
+  // Memory could have been changed from outside since the last run.
+  memset(decode_valid, 0, sizeof(decode_valid));
+
+  stop_reason = SIMULATE_STOP_NONE;
+
   while (stop_running == false)
   {
+    instruction_count++;
+
     pc = reg[0];
-    opcode = READ_RAM(pc) | (READ_RAM(pc + 1) << 8);
-    c = get_cycle_count(opcode);
+
+    Msp430Decode *entry = &decode_cache[pc];
+
+    if (decode_valid[pc] == 0)
+    {
+      decode(entry, pc);
+      decode_valid[pc] = 1;
+    }
+
+    trace_instruction(pc);
+    c = entry->cycles;
     if (c > 0) { cycle_count += c; }
     reg[0] += 2;
 
     if (show == true) printf("\x1b[1J\x1b[1;1H");
 
-    if ((opcode & 0xfc00) == 0x1000)
-    {
-      ret = one_operand_exe(opcode);
-    }
-      else
-    if ((opcode & 0xe000) == 0x2000)
-    {
-      ret = relative_jump_exe(opcode);
-    }
-      else
-    {
-      if (opcode == 0x4130) { nested_call_count--; }
-      ret = two_operand_exe(opcode);
-    }
+    if (entry->opcode == 0x4130) { nested_call_count--; }
+
+    ret = (this->*entry->execute)(entry);
 
     if (c > 0) { cycles += c; }
 
+    trace_state();
+    profile_instruction(pc, c > 0 ? c : 0);
+
     if (show == true)
     {
       dump_registers();
@@ -316,7 +319,7 @@ int SimulateMsp430::run(int max_cycles, int step)
       {
         int cycles_min,cycles_max;
         int num;
-        num = (READ_RAM(pc + 1) << 8) | READ_RAM(pc);
+        num = (peek_ram8(pc + 1) << 8) | peek_ram8(pc);
 
         int count = disasm_msp430(
           memory,
@@ -328,9 +331,9 @@ int SimulateMsp430::run(int max_cycles, int step)
 
         if (cycles_min == -1) { break; }
 
-        printf("%s", pc == break_point ? "*" : " ");
+        printf("%s", has_break_point(pc) ? "*" : " ");
 /*
-        if (pc == break_point) { printf("*"); }
+        if (has_break_point(pc)) { printf("*"); }
         else { printf(" "); }
 */
 
@@ -367,9 +370,9 @@ int SimulateMsp430::run(int max_cycles, int step)
         count -= 2;
         while (count > 0)
         {
-          printf("%s", pc == break_point ? "*" : " ");
+          printf("%s", has_break_point(pc) ? "*" : " ");
 /*
-          if (pc == break_point)
+          if (has_break_point(pc))
           {
             printf("*");
           }
@@ -379,7 +382,7 @@ int SimulateMsp430::run(int max_cycles, int step)
           }
 */
 
-          num = (READ_RAM(pc + 1) << 8) | READ_RAM(pc);
+          num = (peek_ram8(pc + 1) << 8) | peek_ram8(pc);
           printf("  0x%04x: 0x%04x\n", pc, num);
           pc += 2;
           count -= 2;
@@ -389,20 +392,26 @@ int SimulateMsp430::run(int max_cycles, int step)
 
     if (auto_run == true && nested_call_count < 0)
     {
+      stop_reason = SIMULATE_STOP_END;
       return 0;
     }
 
     if (ret == -1)
     {
       printf("Illegal instruction at address 0x%04x\n", pc);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
 
-    if (max_cycles != -1 && cycles > max_cycles) { break; }
+    if (max_cycles != -1 && cycles >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
 
-    if (break_point == reg[0])
+    if (break_hit(reg[0]))
     {
-      printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
@@ -415,324 +424,384 @@ int SimulateMsp430::run(int max_cycles, int step)
 
     if (reg[0] == 0xffff)
     {
-      printf("Function ended. Total cycles: %d\n", cycle_count);
+      printf("Function ended. Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
       step_mode = false;
       reg[0] = READ_RAM(0xfffe) | (READ_RAM(0xffff) << 8);
       disable_signal_handler();
       return 0;
     }
 
-    usleep(usec);
+    delay();
   }
 
   disable_signal_handler();
 
   printf("Stopped.  PC=0x%04x.\n", reg[0]);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
 
+int SimulateMsp430::disassemble(
+  Memory *memory,
+  uint32_t address,
+  char *instruction,
+  int length)
+{
+  int cycles_min, cycles_max;
+
+  return disasm_msp430(
+    memory,
+    address,
+    instruction,
+    length,
+    &cycles_min,
+    &cycles_max);
+}
+
+const char *SimulateMsp430::get_trace_reg_name(int index)
+{
+  const char *names[] =
+  {
+    "pc", "sp", "sr",  "cg",  "r4",  "r5",  "r6",  "r7",
+    "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"
+  };
+
+  if (index < 0 || index >= 16) { return "?"; }
+
+  return names[index];
+}
+
+void SimulateMsp430::trace_state()
+{
+  if (trace == NULL) { return; }
+
+  // The PC changes on every instruction so it's left out.
+  uint32_t regs[16];
+
+  regs[0] = 0;
+
+  for (int n = 1; n < 16; n++) { regs[n] = reg[n]; }
+
+  trace_registers(regs, 16);
+}
+
+void SimulateMsp430::save_state(uint8_t *state)
+{
+  memcpy(state, reg, sizeof(reg));
+}
+
+void SimulateMsp430::load_state(const uint8_t *state)
+{
+  memcpy(reg, state, sizeof(reg));
+
+  // Memory was put back too.
+  memset(decode_valid, 0, sizeof(decode_valid));
+}
+
 void SimulateMsp430::sp_inc(int *sp)
 {
   (*sp) += 2;
   if (*sp > 0xffff) { *sp = 0; }
 }
 
-uint16_t SimulateMsp430::get_data(int reg_index, int As, int bw)
+int SimulateMsp430::decode_operand(
+  Msp430Operand *operand,
+  int reg_index,
+  int mode,
+  int bw,
+  uint16_t address)
 {
+  operand->reg = reg_index;
+  operand->length = 0;
+  operand->value = 0;
+
   if (reg_index == 3) // CG
   {
-    if (As == 0)
-    {
-      return 0;
-    }
-      else
-    if (As == 1)
-    {
-      return 1;
-    }
-      else
-    if (As == 2)
-    {
-      return 2;
-    }
-      else
-    if (As == 3)
-    {
-      return (bw == 0) ? 0xffff : 0xff;
-    }
+    const uint16_t constants[] = { 0, 1, 2, 0xffff };
+
+    operand->mode = MSP430_OPERAND_CONST;
+    operand->value = (mode == 3 && bw != 0) ? 0xff : constants[mode];
+    return 0;
   }
 
-  if (As == 0) // Rn
+  if (mode == 0) // Rn
   {
-    return (bw == 0) ? reg[reg_index] : reg[reg_index] & 0xff;
+    operand->mode = MSP430_OPERAND_REG;
+    return 0;
   }
 
+  uint16_t a = peek_ram8(address) | (peek_ram8(address + 1) << 8);
+
   if (reg_index == 2)
   {
-    if (As == 1) // &LABEL
-    {
-      int PC = reg[0];
-      uint16_t a = READ_RAM(PC) | (READ_RAM(PC+1) << 8);
-
-      reg[0] += 2;
-
-      if (bw == 0)
-      {
-        return READ_RAM(a) | (READ_RAM(a+1) << 8);
-      }
-        else
-      {
-        return READ_RAM(a);
-      }
-    }
-      else
-    if (As == 2)
+    if (mode == 1) // &LABEL
     {
-      return 4;
+      operand->mode = MSP430_OPERAND_MEM;
+      operand->value = a;
+      operand->length = 2;
     }
       else
-    if (As == 3)
     {
-      return 8;
+      operand->mode = MSP430_OPERAND_CONST;
+      operand->value = (mode == 2) ? 4 : 8;
     }
+
+    return operand->length;
   }
 
   if (reg_index == 0) // PC
   {
-    // This is probably worthless.. some other condition should pick this up
-    if (As == 3) // #immediate
+    if (mode == 1) // LABEL
     {
-      uint16_t a = READ_RAM(reg[0]) | (READ_RAM(reg[0] + 1) << 8);
-
-      reg[0] += 2;
-
-      return (bw == 0) ? a : a & 0xff;
+      operand->mode = MSP430_OPERAND_MEM;
+      operand->value = address + a;
+      operand->length = 2;
     }
-  }
-
-  if (As == 1) // x(Rn)
-  {
-    uint16_t a = READ_RAM(reg[0]) | (READ_RAM(reg[0] + 1) << 8);
-    uint16_t index = reg[reg_index] + ((int16_t)a);
-
-    reg[0] += 2;
-
-    if (bw == 0)
+      else
+    if (mode == 2) // @PC
     {
-      return READ_RAM(index) | (READ_RAM(index+1) << 8);
+      operand->mode = MSP430_OPERAND_MEM;
+      operand->value = address;
     }
       else
-    {
-      return READ_RAM(index);
+    { // #immediate
+      operand->mode = MSP430_OPERAND_CONST;
+      operand->value = (bw == 0) ? a : a & 0xff;
+      operand->length = 2;
     }
+
+    return operand->length;
+  }
+
+  if (mode == 1) // x(Rn)
+  {
+    operand->mode = MSP430_OPERAND_INDEXED;
+    operand->value = a;
+    operand->length = 2;
   }
     else
-  if (As == 2 || As == 3) // @Rn (mode 2) or @Rn+ (mode 3)
+  if (mode == 2) // @Rn
   {
-    uint16_t index = reg[reg_index];
-
-    if (bw == 0)
-    {
-      return READ_RAM(index) | (READ_RAM(index + 1) << 8);
-    }
-      else
-    {
-      return READ_RAM(reg[reg_index]);
-    }
+    operand->mode = MSP430_OPERAND_INDIRECT;
+  }
+    else
+  { // @Rn+
+    operand->mode = MSP430_OPERAND_INDIRECT_INC;
+    operand->value = (bw == 0) ? 2 : 1;
   }
 
-  printf("Error: Unrecognized source addressing mode %d\n", As);
-
-  return 0;
+  return operand->length;
 }
 
-void SimulateMsp430::update_reg(int reg_index, int mode, int bw)
+void SimulateMsp430::decode(Msp430Decode *decode, uint16_t address)
 {
-  if (reg_index == 0) { return; }
-  if (reg_index == 2) { return; }
-  if (reg_index == 3) { return; }
+  uint16_t opcode = peek_ram8(address) | (peek_ram8(address + 1) << 8);
+  int bw = (opcode & 0x0040) >> 6;
+
+  memset(decode, 0, sizeof(Msp430Decode));
+
+  decode->opcode = opcode;
+  decode->cycles = get_cycle_count(opcode);
+  decode->bw = bw;
 
-  if (mode == 3) // @Rn+
+  address += 2;
+
+  if ((opcode & 0xfc00) == 0x1000)
   {
-    if (bw == 0)
-    {
-      reg[reg_index] += 2;
-    }
-      else
+    decode->op = (opcode & 0x0380) >> 7;
+
+    // RETI isn't simulated.
+    if (decode->op >= 6)
     {
-      reg[reg_index] += 1;
+      decode->execute = &SimulateMsp430::none_exe;
+      return;
     }
-  }
-}
 
-int SimulateMsp430::put_data(
-  int PC,
-  int reg_index,
-  int mode,
-  int bw,
-  uint32_t data)
-{
-  if (mode == 0) // Rn
+    decode->execute = &SimulateMsp430::one_operand_exe;
+
+    decode_operand(
+      &decode->src,
+      opcode & 0x000f,
+      (opcode & 0x0030) >> 4,
+      bw,
+      address);
+  }
+    else
+  if ((opcode & 0xe000) == 0x2000)
   {
-    if (bw == 0)
-    {
-      reg[reg_index] = data;
-    }
-      else
+    int offset = opcode & 0x03ff;
+
+    if ((offset & 0x0200) != 0)
     {
-      reg[reg_index] = data & 0xff;
+      offset = -((offset ^ 0x03ff) + 1);
     }
-    return 0;
-  }
 
-  if (reg_index == 2)
+    decode->execute = &SimulateMsp430::relative_jump_exe;
+    decode->op = (opcode & 0x1c00) >> 10;
+    decode->offset = offset * 2;
+  }
+    else
   {
-    if (mode == 1) // &LABEL
-    {
-      uint16_t a = READ_RAM(PC) | (READ_RAM(PC+1) << 8);
+    decode->op = opcode >> 12;
 
-      if (bw == 0)
-      {
-        WRITE_RAM(a, data & 0xff);
-        WRITE_RAM(a + 1, data >> 8);
-      }
-        else
-      { WRITE_RAM(a, data & 0xff); }
-
-      return 0;
+    if (decode->op < 4)
+    {
+      decode->execute = &SimulateMsp430::illegal_exe;
+      return;
     }
-  }
 
-  if (reg_index == 0) // PC
-  {
-    if (mode == 1) // LABEL
-    {
-      uint16_t a = READ_RAM(PC) | (READ_RAM(PC + 1) << 8);
+    decode->execute = &SimulateMsp430::two_operand_exe;
 
-      if (bw == 0)
-      {
-        WRITE_RAM(PC + a, data & 0xff);
-        WRITE_RAM(PC + a + 1, data >> 8);
-      }
-        else
-      {
-        WRITE_RAM(PC + a, data & 0xff);
-      }
+    address += decode_operand(
+      &decode->src,
+      (opcode >> 8) & 0x000f,
+      (opcode & 0x0030) >> 4,
+      bw,
+      address);
 
-      return 0;
-    }
+    decode_operand(
+      &decode->dst,
+      opcode & 0x000f,
+      (opcode & 0x0080) >> 7,
+      bw,
+      address);
   }
+}
 
-  if (mode == 1) // x(Rn)
-  {
-    uint16_t a = READ_RAM(PC) | (READ_RAM(PC + 1) << 8);
-    int address = reg[reg_index] + ((int16_t)a);
+uint16_t SimulateMsp430::read_operand(const Msp430Operand *operand, int bw)
+{
+  uint16_t address;
 
-    if (bw == 0)
-    {
-      WRITE_RAM(address, data & 0xff);
-      WRITE_RAM(address + 1, data >> 8);
-    }
-      else
-    {
-      WRITE_RAM(address, data & 0xff);
-    }
+  switch (operand->mode)
+  {
+    case MSP430_OPERAND_REG:
+      return (bw == 0) ? reg[operand->reg] : reg[operand->reg] & 0xff;
+    case MSP430_OPERAND_CONST:
+      return operand->value;
+    case MSP430_OPERAND_MEM:
+      address = operand->value;
+      break;
+    case MSP430_OPERAND_INDEXED:
+      address = reg[operand->reg] + operand->value;
+      break;
+    default:
+      address = reg[operand->reg];
+      break;
+  }
 
-    return 0;
+  if (bw == 0)
+  {
+    return READ_RAM(address) | (READ_RAM(address + 1) << 8);
   }
     else
-  if (mode == 2 || mode == 3) // @Rn (mode 2) or @Rn+ (mode 3)
   {
-    uint16_t index = reg[reg_index];
+    return READ_RAM(address);
+  }
+}
 
-    if (bw == 0)
-    {
-      WRITE_RAM(index, data & 0xff);
-      WRITE_RAM(index + 1, data >> 8);
-    }
-      else
-    {
-      WRITE_RAM(index, data & 0xff);
-    }
+void SimulateMsp430::write_operand(
+  const Msp430Operand *operand,
+  int bw,
+  uint32_t data)
+{
+  uint16_t address;
 
-    return 0;
+  switch (operand->mode)
+  {
+    case MSP430_OPERAND_REG:
+      reg[operand->reg] = (bw == 0) ? data : data & 0xff;
+      return;
+    case MSP430_OPERAND_CONST:
+      // Writes to the constant generator are dropped as on the chip.
+      return;
+    case MSP430_OPERAND_MEM:
+      address = operand->value;
+      break;
+    case MSP430_OPERAND_INDEXED:
+      address = reg[operand->reg] + operand->value;
+      break;
+    default:
+      address = reg[operand->reg];
+      break;
   }
 
-  printf("Error: Unrecognized addressing mode for destination %d\n", mode);
+  if (bw == 0)
+  {
+    WRITE_RAM(address, data & 0xff);
+    WRITE_RAM(address + 1, data >> 8);
+  }
+    else
+  {
+    WRITE_RAM(address, data & 0xff);
+  }
+}
 
-  return -1;
+void SimulateMsp430::update_reg(const Msp430Operand *operand)
+{
+  if (operand->mode == MSP430_OPERAND_INDIRECT_INC) // @Rn+
+  {
+    reg[operand->reg] += operand->value;
+  }
 }
 
-int SimulateMsp430::one_operand_exe(uint16_t opcode)
+int SimulateMsp430::one_operand_exe(const Msp430Decode *decode)
 {
-  int o;
-  int reg_index;
-  int As,bw;
-  int count = 1;
+  const Msp430Operand *operand = &decode->src;
+  int bw = decode->bw;
   uint32_t result;
   int src;
-  int pc;
-
-  o = (opcode & 0x0380) >> 7;
-
-  if (o == 7) { return 1; }
-  if (o == 6) { return count; }
 
-  As = (opcode & 0x0030) >> 4;
-  bw = (opcode & 0x0040) >> 6;
-  reg_index = opcode & 0x000f;
-
-  switch (o)
+  switch (decode->op)
   {
     case 0:  // RRC
     {
-      pc = reg[0];
-      src = get_data(reg_index, As, bw);
+      src = read_operand(operand, bw);
+      reg[0] += operand->length;
       int c = GET_C();
       if ((src & 1) == 1) { SET_C(); } else { CLEAR_C(); }
       if (bw == 0)
       { result = (c << 15) | (((uint16_t)src) >> 1); }
         else
       { result = (c << 7) | (((uint8_t)src) >> 1); }
-      put_data(pc, reg_index, As, bw, result);
-      update_reg(reg_index, As, bw);
+      write_operand(operand, bw, result);
+      update_reg(operand);
       AFFECTS_NZ(result);
       CLEAR_V();
       break;
     }
     case 1:  // SWPB (no bw)
     {
-      pc = reg[0];
-      src = get_data(reg_index, As, bw);
+      src = read_operand(operand, bw);
+      reg[0] += operand->length;
       result = ((src & 0xff00) >> 8) | ((src & 0xff) << 8);
-      put_data(pc, reg_index, As, bw, result);
-      update_reg(reg_index, As, bw);
+      write_operand(operand, bw, result);
+      update_reg(operand);
       break;
     }
     case 2:  // RRA
     {
-      pc = reg[0];
-      src = get_data(reg_index, As, bw);
+      src = read_operand(operand, bw);
+      reg[0] += operand->length;
       if ((src & 1) == 1) { SET_C(); } else { CLEAR_C(); }
       if (bw == 0)
       { result = ((int16_t)src) >> 1; }
         else
       { result = ((int8_t)src) >> 1; }
-      put_data(pc, reg_index, As, bw, result);
-      update_reg(reg_index, As, bw);
+      write_operand(operand, bw, result);
+      update_reg(operand);
       AFFECTS_NZ(result);
       CLEAR_V();
       break;
     }
     case 3:  // SXT (no bw)
     {
-      pc = reg[0];
-      src = get_data(reg_index, As, bw);
+      src = read_operand(operand, bw);
+      reg[0] += operand->length;
       result = (int16_t)((int8_t)((uint8_t)src));
-      put_data(pc, reg_index, As, bw, result);
-      update_reg(reg_index, As, bw);
+      write_operand(operand, bw, result);
+      update_reg(operand);
       AFFECTS_NZ(result);
       CHECK_CARRY(result);
       CLEAR_V();
@@ -741,16 +810,18 @@ int SimulateMsp430::one_operand_exe(uint16_t opcode)
     case 4:  // PUSH
     {
       reg[1] -= 2;
-      src = get_data(reg_index, As, bw);
-      update_reg(reg_index, As, bw);
+      src = read_operand(operand, bw);
+      reg[0] += operand->length;
+      update_reg(operand);
       WRITE_RAM(reg[1], src & 0xff);
       WRITE_RAM(reg[1] + 1, src >> 8);
       break;
     }
     case 5:  // CALL (no bw)
     {
-      src = get_data(reg_index, As, bw);
-      update_reg(reg_index, As, bw);
+      src = read_operand(operand, bw);
+      reg[0] += operand->length;
+      update_reg(operand);
       reg[1] -= 2;
       WRITE_RAM(reg[1], reg[0] & 0xff);
       WRITE_RAM(reg[1] + 1, reg[0] >> 8);
@@ -758,10 +829,6 @@ int SimulateMsp430::one_operand_exe(uint16_t opcode)
       nested_call_count++;
       break;
     }
-    case 6:  // RETI
-    {
-      break;
-    }
     default:
     {
       return -1;
@@ -771,21 +838,11 @@ int SimulateMsp430::one_operand_exe(uint16_t opcode)
   return 0;
 }
 
-int SimulateMsp430::relative_jump_exe(uint16_t opcode)
+int SimulateMsp430::relative_jump_exe(const Msp430Decode *decode)
 {
-  int o;
-
-  o = (opcode & 0x1c00) >> 10;
+  int offset = decode->offset;
 
-  int offset = opcode & 0x03ff;
-  if ((offset & 0x0200) != 0)
-  {
-    offset = -((offset ^ 0x03ff) + 1);
-  }
-
-  offset *= 2;
-
-  switch (o)
+  switch (decode->op)
   {
     case 0:  // JNE/JNZ  Z==0
       if (GET_Z() == 0) { reg[0] += offset; }
@@ -818,24 +875,20 @@ int SimulateMsp430::relative_jump_exe(uint16_t opcode)
   return 0;
 }
 
-int SimulateMsp430::two_operand_exe(uint16_t opcode)
+int SimulateMsp430::two_operand_exe(const Msp430Decode *decode)
 {
-  int o;
-  int src_reg,dst_reg;
-  int Ad,As,bw;
+  int bw = decode->bw;
   int dst,src;
-  int pc;
   uint32_t result;
 
-  o = opcode >> 12;
-  Ad = (opcode & 0x0080) >> 7;
-  As = (opcode & 0x0030) >> 4;
-  bw = (opcode & 0x0040) >> 6;
+  src = read_operand(&decode->src, bw);
+  reg[0] += decode->src.length;
+  update_reg(&decode->src);
 
-  src_reg = (opcode >> 8) & 0x000f;
-  dst_reg = opcode & 0x000f;
+  dst = read_operand(&decode->dst, bw);
+  reg[0] += decode->dst.length;
 
-  switch (o)
+  switch (decode->op)
   {
     case 0:
     case 1:
@@ -843,42 +896,26 @@ int SimulateMsp430::two_operand_exe(uint16_t opcode)
     case 3:
       return -1;
     case 4:  // MOV
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
-      put_data(pc, dst_reg, Ad, bw, src);
+      write_operand(&decode->dst, bw, src);
       break;
     case 5:  // ADD
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       result = (uint16_t)dst + (uint16_t)src;
       CHECK_OVERFLOW();
       dst = result & 0xffff;
-      put_data(pc, dst_reg, Ad, bw, dst);
+      write_operand(&decode->dst, bw, dst);
       AFFECTS_NZ(dst);
       CHECK_CARRY(result);
       break;
     case 6:  // ADDC
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       result = (uint16_t)dst + (uint16_t)src + GET_C();
       //CHECK_OVERFLOW_WITH_C();
       CHECK_OVERFLOW();
       dst = result & 0xffff;
-      put_data(pc, dst_reg, Ad, bw, dst);
+      write_operand(&decode->dst, bw, dst);
       AFFECTS_NZ(dst);
       CHECK_CARRY(result)
       break;
     case 7:  // SUBC
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       //src =~ ((uint16_t)src)+1;
       src = ((~((uint16_t)src)) & 0xffff);
       //result = (uint16_t)dst + (uint16_t)src + GET_C();
@@ -887,42 +924,30 @@ int SimulateMsp430::two_operand_exe(uint16_t opcode)
       //CHECK_OVERFLOW_WITH_C();
       CHECK_OVERFLOW();
       dst = result & 0xffff;
-      put_data(pc, dst_reg, Ad, bw, dst);
+      write_operand(&decode->dst, bw, dst);
       AFFECTS_NZ(dst);
       CHECK_CARRY(result)
       break;
     case 8:  // SUB
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       src = ((~((uint16_t)src)) & 0xffff) + 1;
       result = dst + src;
       CHECK_OVERFLOW();
       dst = result & 0xffff;
-      put_data(pc, dst_reg, Ad, bw, dst);
+      write_operand(&decode->dst, bw, dst);
       AFFECTS_NZ(dst);
       CHECK_CARRY(result)
       break;
     case 9:  // CMP
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       src = ((~((uint16_t)src)) & 0xffff) + 1;
       //result = (uint16_t)dst + (uint16_t)src;
       result = dst + src;
       CHECK_OVERFLOW();
       dst = result & 0xffff;
-      //put_data(pc, dst_reg, Ad, bw, dst);
+      //write_operand(&decode->dst, bw, dst);
       AFFECTS_NZ(dst);
       CHECK_CARRY(result)
       break;
     case 10: // DADD
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       result = src + dst + GET_C();
       if (bw == 0)
       {
@@ -942,53 +967,33 @@ int SimulateMsp430::two_operand_exe(uint16_t opcode)
         if( (a>>4) >= 10 ) { a = (((a >> 4) % 10) << 4) | (a & 0x0f); SET_C(); } else {CLEAR_C(); }
         result = a;
       }
-      put_data(pc, dst_reg, Ad, bw, result);
+      write_operand(&decode->dst, bw, result);
       AFFECTS_NZ(result);
       break;
     case 11: // BIT (dest & src)
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       result = src & dst;
       AFFECTS_NZ(result);
       if (result != 0) { SET_C(); } else { CLEAR_C(); }
       CLEAR_V();
       break;
     case 12: // BIC (dest &= ~src)
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       result = (~src) & dst;
-      put_data(pc, dst_reg, Ad, bw, result);
+      write_operand(&decode->dst, bw, result);
       break;
     case 13: // BIS (dest |= src)
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       result = src | dst;
-      put_data(pc, dst_reg, Ad, bw, result);
+      write_operand(&decode->dst, bw, result);
       break;
     case 14: // XOR
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       result = src ^ dst;
-      put_data(pc, dst_reg, Ad, bw, result);
+      write_operand(&decode->dst, bw, result);
       AFFECTS_NZ(result);
       if (result != 0) { SET_C(); } else { CLEAR_C(); }
       if ((src & 0x8000) && (dst & 0x8000)) { SET_V(); } else { CLEAR_V(); }
       break;
     case 15: // AND
-      src = get_data(src_reg, As, bw);
-      update_reg(src_reg, As, bw);
-      pc = reg[0];
-      dst = get_data(dst_reg, Ad, bw);
       result = src & dst;
-      put_data(pc, dst_reg, Ad, bw, result);
+      write_operand(&decode->dst, bw, result);
       AFFECTS_NZ(result);
       if (result != 0) { SET_C(); } else { CLEAR_C(); }
       CLEAR_V();
@@ -1000,3 +1005,15 @@ int SimulateMsp430::two_operand_exe(uint16_t opcode)
   return 0;
 }
 
+
+void SimulateMsp430::write_ram(uint16_t address, uint8_t value)
+{
+  write_ram8(address, value);
+
+  // An instruction is at most 3 words so it could start up to 5 bytes
+  // before the one written.
+  for (int n = 0; n < 6; n++)
+  {
+    decode_valid[(uint16_t)(address - n)] = 0;
+  }
+}
@@ -16,6 +16,40 @@
 
 #include "simulate/Simulate.h"
 
+#define MSP430_OPERAND_REG 0
+#define MSP430_OPERAND_CONST 1
+#define MSP430_OPERAND_MEM 2
+#define MSP430_OPERAND_INDEXED 3
+#define MSP430_OPERAND_INDIRECT 4
+#define MSP430_OPERAND_INDIRECT_INC 5
+
+// An addressing mode resolved when the instruction is decoded.  value is
+// the constant, the address, the index or how much @Rn+ adds to Rn.
+// length is the number of bytes of extension word the operand uses.
+struct Msp430Operand
+{
+  uint8_t mode;
+  uint8_t reg;
+  uint8_t length;
+  uint16_t value;
+};
+
+class SimulateMsp430;
+
+// An instruction decoded once at an address.  Entries are dropped when
+// the simulator writes to any byte the instruction could cover.
+struct Msp430Decode
+{
+  int (SimulateMsp430::*execute)(const Msp430Decode *decode);
+  uint16_t opcode;
+  uint8_t op;
+  uint8_t bw;
+  int8_t cycles;
+  int16_t offset;
+  Msp430Operand src;
+  Msp430Operand dst;
+};
+
 class SimulateMsp430 : public Simulate
 {
 public:
@@ -30,18 +64,44 @@ public:
   virtual uint32_t get_reg(const char *reg_string);
   virtual void set_pc(uint32_t value);
   virtual void dump_registers();
-  virtual int run(int max_cycles, int step);
+  virtual int run(int64_t max_cycles, int step);
+  virtual bool can_trace() { return true; }
+  virtual bool can_profile() { return true; }
+  virtual bool can_snapshot() { return true; }
+  virtual int disassemble(
+    Memory *memory,
+    uint32_t address,
+    char *instruction,
+    int length);
+  virtual const char *get_trace_reg_name(int index);
 
 private:
   void sp_inc(int *sp);
-  uint16_t get_data(int reg_index, int As, int bw);
-  void update_reg(int reg_index, int mode, int bw);
-  int put_data(int PC, int reg_index, int mode, int bw, uint32_t data);
-  int one_operand_exe(uint16_t opcode);
-  int relative_jump_exe(uint16_t opcode);
-  int two_operand_exe(uint16_t opcode);
+  int decode_operand(
+    Msp430Operand *operand,
+    int reg_index,
+    int mode,
+    int bw,
+    uint16_t address);
+  void decode(Msp430Decode *decode, uint16_t address);
+  uint16_t read_operand(const Msp430Operand *operand, int bw);
+  void write_operand(const Msp430Operand *operand, int bw, uint32_t data);
+  void update_reg(const Msp430Operand *operand);
+  int none_exe(const Msp430Decode *decode) { return 0; }
+  int illegal_exe(const Msp430Decode *decode) { return -1; }
+  int one_operand_exe(const Msp430Decode *decode);
+  int relative_jump_exe(const Msp430Decode *decode);
+  int two_operand_exe(const Msp430Decode *decode);
+  void write_ram(uint16_t address, uint8_t value);
+  void trace_state();
+  virtual int get_state_length() { return sizeof(reg); }
+  virtual void save_state(uint8_t *state);
+  virtual void load_state(const uint8_t *state);
 
   uint16_t reg[16];
+
+  Msp430Decode decode_cache[65536];
+  uint8_t decode_valid[65536];
 };
 
 #endif
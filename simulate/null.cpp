@@ -56,7 +56,7 @@ void SimulateNull::dump_registers()
 {
 }
 
-int SimulateNull::run(int max_cycles, int step)
+int SimulateNull::run(int64_t max_cycles, int step)
 {
   while (stop_running == false)
   {
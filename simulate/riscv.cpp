@@ -14,15 +14,92 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "disasm/riscv.h"
 #include "simulate/riscv.h"
 
+#define BITS(a,hi,lo) (((a) >> (lo)) & ((1 << ((hi) - (lo) + 1)) - 1))
+#define BIT(a,n) (((a) >> (n)) & 1)
+#define SIGN_EXTEND(a,bits) (((int32_t)((uint32_t)(a) << (32 - (bits)))) >> (32 - (bits)))
+
+enum
+{
+  RV_ILLEGAL,
+  RV_LUI,
+  RV_AUIPC,
+  RV_JAL,
+  RV_JALR,
+  RV_BEQ,
+  RV_BNE,
+  RV_BLT,
+  RV_BGE,
+  RV_BLTU,
+  RV_BGEU,
+  RV_LB,
+  RV_LH,
+  RV_LW,
+  RV_LBU,
+  RV_LHU,
+  RV_SB,
+  RV_SH,
+  RV_SW,
+  RV_ADDI,
+  RV_SLTI,
+  RV_SLTIU,
+  RV_XORI,
+  RV_ORI,
+  RV_ANDI,
+  RV_SLLI,
+  RV_SRLI,
+  RV_SRAI,
+  RV_ADD,
+  RV_SUB,
+  RV_SLL,
+  RV_SLT,
+  RV_SLTU,
+  RV_XOR,
+  RV_SRL,
+  RV_SRA,
+  RV_OR,
+  RV_AND,
+  RV_MUL,
+  RV_MULH,
+  RV_MULHSU,
+  RV_MULHU,
+  RV_DIV,
+  RV_DIVU,
+  RV_REM,
+  RV_REMU,
+  RV_FENCE,
+  RV_FENCE_I,
+  RV_ECALL,
+  RV_EBREAK,
+  RV_MRET,
+  RV_WFI,
+  RV_CSRRW,
+  RV_CSRRS,
+  RV_CSRRC,
+  RV_CSRRWI,
+  RV_CSRRSI,
+  RV_CSRRCI,
+};
+
+static const char *reg_names[32] =
+{
+  "zero", "ra", "sp", "gp", "tp",  "t0",  "t1", "t2",
+  "s0",   "s1", "a0", "a1", "a2",  "a3",  "a4", "a5",
+  "a6",   "a7", "s2", "s3", "s4",  "s5",  "s6", "s7",
+  "s8",   "s9", "s10", "s11", "t3", "t4", "t5", "t6"
+};
+
 SimulateRiscv::SimulateRiscv(Memory *memory) : Simulate(memory)
 {
+  memset(blocks, 0, sizeof(blocks));
   reset();
 }
 
 SimulateRiscv::~SimulateRiscv()
 {
+  flush_blocks();
 }
 
 Simulate *SimulateRiscv::init(Memory *memory)
@@ -33,40 +110,915 @@ Simulate *SimulateRiscv::init(Memory *memory)
 void SimulateRiscv::reset()
 {
   memset(reg, 0, sizeof(reg));
+
+  pc = memory->low_address;
+  reg[1] = RISCV_RETURN_ADDRESS;
+
+  csr_mstatus = 0;
+  csr_mie = 0;
+  csr_mtvec = 0;
+  csr_mscratch = 0;
+  csr_mepc = 0;
+  csr_mcause = 0;
+  csr_mtval = 0;
+
+  cycle_count = 0;
+  halted = false;
+
+  flush_blocks();
 }
 
 void SimulateRiscv::push(uint32_t value)
 {
+  reg[2] -= 4;
+  memory->write32(reg[2], value);
 }
 
 int SimulateRiscv::set_reg(const char *reg_string, uint32_t value)
 {
-  return 0;
+  while (*reg_string == ' ') { reg_string++; }
+
+  if (strcmp(reg_string, "pc") == 0)
+  {
+    pc = value;
+    return 0;
+  }
+
+  if (reg_string[0] == 'x')
+  {
+    char *end;
+    int index = strtol(reg_string + 1, &end, 10);
+
+    if (end == reg_string + 1 || *end != 0 || index < 0 || index > 31)
+    {
+      return -1;
+    }
+
+    if (index != 0) { reg[index] = value; }
+    return 0;
+  }
+
+  if (strcmp(reg_string, "fp") == 0) { reg_string = "s0"; }
+
+  for (int n = 1; n < 32; n++)
+  {
+    if (strcmp(reg_string, reg_names[n]) == 0)
+    {
+      reg[n] = value;
+      return 0;
+    }
+  }
+
+  return -1;
 }
 
 uint32_t SimulateRiscv::get_reg(const char *reg_string)
 {
+  while (*reg_string == ' ') { reg_string++; }
+
+  if (strcmp(reg_string, "pc") == 0) { return pc; }
+
+  if (reg_string[0] == 'x')
+  {
+    int index = atoi(reg_string + 1);
+    if (index < 0 || index > 31) { return 0; }
+
+    return reg[index];
+  }
+
+  if (strcmp(reg_string, "fp") == 0) { reg_string = "s0"; }
+
+  for (int n = 0; n < 32; n++)
+  {
+    if (strcmp(reg_string, reg_names[n]) == 0)
+    {
+      return reg[n];
+    }
+  }
+
   return 0;
 }
 
 void SimulateRiscv::set_pc(uint32_t value)
 {
+  pc = value;
 }
 
 void SimulateRiscv::dump_registers()
 {
+  int n;
+
+  printf("\nSimulation Register Dump\n");
+  printf("-------------------------------------------------------------------\n");
+  printf(" PC: 0x%08x\n", pc);
+
+  for (n = 0; n < 32; n++)
+  {
+    printf("%c%4s: 0x%08x", (n & 0x3) == 0 ? '\n' : ' ', reg_names[n], reg[n]);
+  }
+
+  printf("\n\n");
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
-int SimulateRiscv::run(int max_cycles, int step)
+int SimulateRiscv::run(int64_t max_cycles, int step)
 {
+  int64_t cycles = 0;
+
+  printf("Running... Press Ctl-C to break.\n");
+
+  stop_reason = SIMULATE_STOP_NONE;
+  halted = false;
+
+  // Memory could have been changed from outside since the last run and
+  // blocks are split at the break point, which could have moved.
+  flush_blocks();
+
   while (stop_running == false)
   {
-    printf("CPU not supported.\n");
-    break;
+    uint32_t current_pc = pc;
+
+    if (max_cycles != -1 && cycles >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    RiscvBlock *block = get_block(pc);
+
+    if (block == NULL)
+    {
+      stop_reason = SIMULATE_STOP_ILLEGAL;
+      disable_signal_handler();
+      return -1;
+    }
+
+    // Outside of batch mode instructions are run one at a time so each
+    // can be shown or delayed.  A watch point also needs to be checked
+    // after the instruction that hit it.
+    int count = 1;
+
+    if (batch_mode == true && step == false && watch_count == 0)
+    {
+      count = block->count;
+    }
+
+    if (max_cycles != -1 && count > max_cycles - cycles)
+    {
+      count = max_cycles - cycles;
+    }
+
+    int ret = execute_block(block, count);
+
+    if (ret == -1)
+    {
+      printf("Illegal instruction at address 0x%08x\n", pc);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
+      disable_signal_handler();
+      return -1;
+    }
+
+    // All instructions are counted as a single cycle.
+    cycle_count += ret;
+    instruction_count += ret;
+    cycles += ret;
+
+    if (code_changed == true) { flush_blocks(); }
+
+    if (show == true)
+    {
+      printf("\x1b[1J\x1b[1;1H");
+      dump_registers();
+      show_instructions(current_pc);
+    }
+
+    if (halted == true)
+    {
+      printf("Halted at 0x%08x.  Total cycles: %" PRIu64 "\n", pc, cycle_count);
+      stop_reason = SIMULATE_STOP_END;
+      disable_signal_handler();
+      return 0;
+    }
+
+    if (pc == RISCV_RETURN_ADDRESS)
+    {
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
+      step_mode = false;
+      disable_signal_handler();
+      return 0;
+    }
+
+    if (break_hit(pc))
+    {
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
+      break;
+    }
+
+    if (usec == 0 || step == true)
+    {
+      disable_signal_handler();
+      return 0;
+    }
+
+    delay();
   }
 
   disable_signal_handler();
 
+  printf("Stopped.  PC=0x%08x.\n", pc);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
+
   return 0;
 }
 
+void SimulateRiscv::decode(RiscvInstruction *instruction, uint32_t opcode)
+{
+  const int funct3 = BITS(opcode, 14, 12);
+  const int funct7 = BITS(opcode, 31, 25);
+
+  instruction->op = RV_ILLEGAL;
+  instruction->rd = BITS(opcode, 11, 7);
+  instruction->rs1 = BITS(opcode, 19, 15);
+  instruction->rs2 = BITS(opcode, 24, 20);
+  instruction->length = 4;
+  instruction->imm = (int32_t)opcode >> 20;
+
+  switch (opcode & 0x7f)
+  {
+    case 0x37:
+      instruction->op = RV_LUI;
+      instruction->imm = opcode & 0xfffff000;
+      break;
+    case 0x17:
+      instruction->op = RV_AUIPC;
+      instruction->imm = opcode & 0xfffff000;
+      break;
+    case 0x6f:
+      instruction->op = RV_JAL;
+      instruction->imm = SIGN_EXTEND(
+        (BIT(opcode, 31) << 20) |
+        (BITS(opcode, 19, 12) << 12) |
+        (BIT(opcode, 20) << 11) |
+        (BITS(opcode, 30, 21) << 1), 21);
+      break;
+    case 0x67:
+      if (funct3 == 0) { instruction->op = RV_JALR; }
+      break;
+    case 0x63:
+    {
+      const uint8_t ops[] =
+      {
+        RV_BEQ, RV_BNE, RV_ILLEGAL, RV_ILLEGAL,
+        RV_BLT, RV_BGE, RV_BLTU, RV_BGEU
+      };
+
+      instruction->op = ops[funct3];
+      instruction->imm = SIGN_EXTEND(
+        (BIT(opcode, 31) << 12) |
+        (BIT(opcode, 7) << 11) |
+        (BITS(opcode, 30, 25) << 5) |
+        (BITS(opcode, 11, 8) << 1), 13);
+      break;
+    }
+    case 0x03:
+    {
+      const uint8_t ops[] =
+      {
+        RV_LB, RV_LH, RV_LW, RV_ILLEGAL,
+        RV_LBU, RV_LHU, RV_ILLEGAL, RV_ILLEGAL
+      };
+
+      instruction->op = ops[funct3];
+      break;
+    }
+    case 0x23:
+    {
+      const uint8_t ops[] =
+      {
+        RV_SB, RV_SH, RV_SW, RV_ILLEGAL,
+        RV_ILLEGAL, RV_ILLEGAL, RV_ILLEGAL, RV_ILLEGAL
+      };
+
+      instruction->op = ops[funct3];
+      instruction->imm = SIGN_EXTEND((funct7 << 5) | BITS(opcode, 11, 7), 12);
+      break;
+    }
+    case 0x13:
+    {
+      const uint8_t ops[] =
+      {
+        RV_ADDI, RV_SLLI, RV_SLTI, RV_SLTIU,
+        RV_XORI, RV_SRLI, RV_ORI, RV_ANDI
+      };
+
+      instruction->op = ops[funct3];
+
+      if (funct3 == 1 || funct3 == 5)
+      {
+        instruction->imm = instruction->rs2;
+
+        if (funct3 == 5 && funct7 == 0x20) { instruction->op = RV_SRAI; }
+        else if (funct7 != 0) { instruction->op = RV_ILLEGAL; }
+      }
+      break;
+    }
+    case 0x33:
+    {
+      const uint8_t ops[] =
+      {
+        RV_ADD, RV_SLL, RV_SLT, RV_SLTU, RV_XOR, RV_SRL, RV_OR, RV_AND
+      };
+
+      const uint8_t ops_m[] =
+      {
+        RV_MUL, RV_MULH, RV_MULHSU, RV_MULHU, RV_DIV, RV_DIVU, RV_REM, RV_REMU
+      };
+
+      if (funct7 == 0x00) { instruction->op = ops[funct3]; }
+      else if (funct7 == 0x01) { instruction->op = ops_m[funct3]; }
+      else if (funct7 == 0x20 && funct3 == 0) { instruction->op = RV_SUB; }
+      else if (funct7 == 0x20 && funct3 == 5) { instruction->op = RV_SRA; }
+      break;
+    }
+    case 0x0f:
+      if (funct3 == 0) { instruction->op = RV_FENCE; }
+      else if (funct3 == 1) { instruction->op = RV_FENCE_I; }
+      break;
+    case 0x73:
+    {
+      const uint8_t ops[] =
+      {
+        RV_ILLEGAL, RV_CSRRW, RV_CSRRS, RV_CSRRC,
+        RV_ILLEGAL, RV_CSRRWI, RV_CSRRSI, RV_CSRRCI
+      };
+
+      if (opcode == 0x00000073) { instruction->op = RV_ECALL; }
+      else if (opcode == 0x00100073) { instruction->op = RV_EBREAK; }
+      else if (opcode == 0x30200073) { instruction->op = RV_MRET; }
+      else if (opcode == 0x10500073) { instruction->op = RV_WFI; }
+      else
+      {
+        instruction->op = ops[funct3];
+        instruction->imm = opcode >> 20;
+      }
+      break;
+    }
+  }
+}
+
+void SimulateRiscv::decode_compressed(
+  RiscvInstruction *instruction,
+  uint16_t opcode)
+{
+  const int rd = BITS(opcode, 11, 7);
+  const int rs2 = BITS(opcode, 6, 2);
+  const int rd_short = BITS(opcode, 4, 2) + 8;
+  const int rs1_short = BITS(opcode, 9, 7) + 8;
+  const int32_t imm6 = SIGN_EXTEND((BIT(opcode, 12) << 5) | rs2, 6);
+
+  const int32_t offset_j = SIGN_EXTEND(
+    (BIT(opcode, 12) << 11) |
+    (BIT(opcode, 11) << 4) |
+    (BITS(opcode, 10, 9) << 8) |
+    (BIT(opcode, 8) << 10) |
+    (BIT(opcode, 7) << 6) |
+    (BIT(opcode, 6) << 7) |
+    (BITS(opcode, 5, 3) << 1) |
+    (BIT(opcode, 2) << 5), 12);
+
+  const int32_t offset_b = SIGN_EXTEND(
+    (BIT(opcode, 12) << 8) |
+    (BITS(opcode, 11, 10) << 3) |
+    (BITS(opcode, 6, 5) << 6) |
+    (BITS(opcode, 4, 3) << 1) |
+    (BIT(opcode, 2) << 5), 9);
+
+  const int offset_w =
+    (BITS(opcode, 12, 10) << 3) | (BIT(opcode, 6) << 2) | (BIT(opcode, 5) << 6);
+
+  instruction->op = RV_ILLEGAL;
+  instruction->rd = 0;
+  instruction->rs1 = 0;
+  instruction->rs2 = 0;
+  instruction->length = 2;
+  instruction->imm = 0;
+
+  switch (((opcode & 0x3) << 3) | BITS(opcode, 15, 13))
+  {
+    case 0x00: // c.addi4spn
+      instruction->op = RV_ADDI;
+      instruction->rd = rd_short;
+      instruction->rs1 = 2;
+      instruction->imm =
+        (BITS(opcode, 12, 11) << 4) |
+        (BITS(opcode, 10, 7) << 6) |
+        (BIT(opcode, 6) << 2) |
+        (BIT(opcode, 5) << 3);
+      if (instruction->imm == 0) { instruction->op = RV_ILLEGAL; }
+      break;
+    case 0x02: // c.lw
+      instruction->op = RV_LW;
+      instruction->rd = rd_short;
+      instruction->rs1 = rs1_short;
+      instruction->imm = offset_w;
+      break;
+    case 0x06: // c.sw
+      instruction->op = RV_SW;
+      instruction->rs1 = rs1_short;
+      instruction->rs2 = rd_short;
+      instruction->imm = offset_w;
+      break;
+    case 0x08: // c.addi
+      instruction->op = RV_ADDI;
+      instruction->rd = rd;
+      instruction->rs1 = rd;
+      instruction->imm = imm6;
+      break;
+    case 0x09: // c.jal
+      instruction->op = RV_JAL;
+      instruction->rd = 1;
+      instruction->imm = offset_j;
+      break;
+    case 0x0a: // c.li
+      instruction->op = RV_ADDI;
+      instruction->rd = rd;
+      instruction->imm = imm6;
+      break;
+    case 0x0b:
+      if (rd == 2)
+      {
+        // c.addi16sp
+        instruction->op = RV_ADDI;
+        instruction->rd = 2;
+        instruction->rs1 = 2;
+        instruction->imm = SIGN_EXTEND(
+          (BIT(opcode, 12) << 9) |
+          (BIT(opcode, 6) << 4) |
+          (BIT(opcode, 5) << 6) |
+          (BITS(opcode, 4, 3) << 7) |
+          (BIT(opcode, 2) << 5), 10);
+      }
+        else
+      {
+        // c.lui
+        instruction->op = RV_LUI;
+        instruction->rd = rd;
+        instruction->imm = imm6 << 12;
+      }
+      if (instruction->imm == 0) { instruction->op = RV_ILLEGAL; }
+      break;
+    case 0x0c:
+      instruction->rd = rs1_short;
+      instruction->rs1 = rs1_short;
+      instruction->rs2 = rd_short;
+
+      switch (BITS(opcode, 11, 10))
+      {
+        case 0:
+          instruction->op = RV_SRLI;
+          instruction->imm = rs2;
+          break;
+        case 1:
+          instruction->op = RV_SRAI;
+          instruction->imm = rs2;
+          break;
+        case 2:
+          instruction->op = RV_ANDI;
+          instruction->imm = imm6;
+          break;
+        case 3:
+        {
+          const uint8_t ops[] = { RV_SUB, RV_XOR, RV_OR, RV_AND };
+          instruction->op = ops[BITS(opcode, 6, 5)];
+          break;
+        }
+      }
+
+      // RV32C has no shift amounts over 31 and no c.subw / c.addw.
+      if (BIT(opcode, 12) == 1 && BITS(opcode, 11, 10) != 2)
+      {
+        instruction->op = RV_ILLEGAL;
+      }
+      break;
+    case 0x0d: // c.j
+      instruction->op = RV_JAL;
+      instruction->imm = offset_j;
+      break;
+    case 0x0e: // c.beqz
+    case 0x0f: // c.bnez
+      instruction->op = BIT(opcode, 13) == 0 ? RV_BEQ : RV_BNE;
+      instruction->rs1 = rs1_short;
+      instruction->imm = offset_b;
+      break;
+    case 0x10: // c.slli
+      instruction->op = BIT(opcode, 12) == 0 ? RV_SLLI : RV_ILLEGAL;
+      instruction->rd = rd;
+      instruction->rs1 = rd;
+      instruction->imm = rs2;
+      break;
+    case 0x12: // c.lwsp
+      instruction->op = rd != 0 ? RV_LW : RV_ILLEGAL;
+      instruction->rd = rd;
+      instruction->rs1 = 2;
+      instruction->imm =
+        (BIT(opcode, 12) << 5) | (BITS(opcode, 6, 4) << 2) | (BITS(opcode, 3, 2) << 6);
+      break;
+    case 0x14:
+      if (BIT(opcode, 12) == 0)
+      {
+        if (rs2 == 0)
+        {
+          // c.jr
+          instruction->op = rd != 0 ? RV_JALR : RV_ILLEGAL;
+          instruction->rs1 = rd;
+        }
+          else
+        {
+          // c.mv
+          instruction->op = RV_ADD;
+          instruction->rd = rd;
+          instruction->rs2 = rs2;
+        }
+      }
+        else
+      {
+        if (rd == 0 && rs2 == 0)
+        {
+          instruction->op = RV_EBREAK;
+        }
+          else
+        if (rs2 == 0)
+        {
+          // c.jalr
+          instruction->op = RV_JALR;
+          instruction->rd = 1;
+          instruction->rs1 = rd;
+        }
+          else
+        {
+          // c.add
+          instruction->op = RV_ADD;
+          instruction->rd = rd;
+          instruction->rs1 = rd;
+          instruction->rs2 = rs2;
+        }
+      }
+      break;
+    case 0x16: // c.swsp
+      instruction->op = RV_SW;
+      instruction->rs1 = 2;
+      instruction->rs2 = rs2;
+      instruction->imm = (BITS(opcode, 12, 9) << 2) | (BITS(opcode, 8, 7) << 6);
+      break;
+  }
+}
+
+RiscvBlock *SimulateRiscv::get_block(uint32_t address)
+{
+  const int hash = (address >> 1) & (RISCV_BLOCK_HASH_SIZE - 1);
+  RiscvBlock *block;
+
+  for (block = blocks[hash]; block != NULL; block = block->next)
+  {
+    if (block->address == address) { return block; }
+  }
+
+  block = (RiscvBlock *)malloc(sizeof(RiscvBlock));
+
+  if (block == NULL)
+  {
+    printf("Error: Cannot allocate block at 0x%08x.\n", address);
+    return NULL;
+  }
+
+  block->address = address;
+  block->count = 0;
+  block->next = blocks[hash];
+  blocks[hash] = block;
+
+  while (block->count < RISCV_BLOCK_MAX)
+  {
+    // Blocks end before a break point so it's checked after the block.
+    if (block->count != 0 && has_break_point(address)) { break; }
+
+    RiscvInstruction *instruction = &block->instructions[block->count++];
+    uint16_t opcode = memory->read16(address);
+
+    if ((opcode & 0x3) == 0x3)
+    {
+      decode(instruction, memory->read32(address));
+    }
+      else
+    {
+      decode_compressed(instruction, opcode);
+    }
+
+    address += instruction->length;
+
+    if (instruction->op == RV_ILLEGAL ||
+        (instruction->op >= RV_JAL && instruction->op <= RV_BGEU) ||
+        instruction->op >= RV_FENCE_I)
+    {
+      break;
+    }
+  }
+
+  if (block->address < code_low) { code_low = block->address; }
+  if (address > code_high) { code_high = address; }
+
+  return block;
+}
+
+void SimulateRiscv::flush_blocks()
+{
+  for (int n = 0; n < RISCV_BLOCK_HASH_SIZE; n++)
+  {
+    RiscvBlock *block = blocks[n];
+
+    while (block != NULL)
+    {
+      RiscvBlock *next = block->next;
+      free(block);
+      block = next;
+    }
+
+    blocks[n] = NULL;
+  }
+
+  code_low = 0xffffffff;
+  code_high = 0;
+  code_changed = false;
+}
+
+int SimulateRiscv::execute_block(RiscvBlock *block, int count)
+{
+  uint32_t address;
+  uint32_t value;
+  int n;
+
+  for (n = 0; n < count; n++)
+  {
+    const RiscvInstruction *instruction = &block->instructions[n];
+    const uint32_t a = reg[instruction->rs1];
+    const uint32_t b = reg[instruction->rs2];
+    const int32_t imm = instruction->imm;
+    uint32_t *rd = &reg[instruction->rd];
+    uint32_t next_pc = pc + instruction->length;
+
+    switch (instruction->op)
+    {
+      case RV_LUI:    *rd = imm; break;
+      case RV_AUIPC:  *rd = pc + imm; break;
+      case RV_JAL:    *rd = next_pc; next_pc = pc + imm; break;
+      case RV_JALR:   *rd = next_pc; next_pc = (a + imm) & ~1; break;
+      case RV_BEQ:    if (a == b) { next_pc = pc + imm; } break;
+      case RV_BNE:    if (a != b) { next_pc = pc + imm; } break;
+      case RV_BLT:    if ((int32_t)a < (int32_t)b) { next_pc = pc + imm; } break;
+      case RV_BGE:    if ((int32_t)a >= (int32_t)b) { next_pc = pc + imm; } break;
+      case RV_BLTU:   if (a < b) { next_pc = pc + imm; } break;
+      case RV_BGEU:   if (a >= b) { next_pc = pc + imm; } break;
+      case RV_LB:
+        watch_access(a + imm, BREAK_POINT_READ);
+        *rd = (int8_t)memory->read8(a + imm);
+        break;
+      case RV_LH:
+        watch_access(a + imm, BREAK_POINT_READ);
+        *rd = (int16_t)memory->read16(a + imm);
+        break;
+      case RV_LW:
+        watch_access(a + imm, BREAK_POINT_READ);
+        *rd = memory->read32(a + imm);
+        break;
+      case RV_LBU:
+        watch_access(a + imm, BREAK_POINT_READ);
+        *rd = memory->read8(a + imm);
+        break;
+      case RV_LHU:
+        watch_access(a + imm, BREAK_POINT_READ);
+        *rd = memory->read16(a + imm);
+        break;
+      case RV_SB:
+      case RV_SH:
+      case RV_SW:
+        address = a + imm;
+        watch_access(address, BREAK_POINT_WRITE);
+
+        if (instruction->op == RV_SB) { memory->write8(address, b); }
+        else if (instruction->op == RV_SH) { memory->write16(address, b); }
+        else { memory->write32(address, b); }
+
+        // Writing over decoded code drops all blocks after this one.
+        if (address < code_high && address + 4 > code_low)
+        {
+          code_changed = true;
+          pc = next_pc;
+          return n + 1;
+        }
+        break;
+      case RV_ADDI:   *rd = a + imm; break;
+      case RV_SLTI:   *rd = (int32_t)a < imm ? 1 : 0; break;
+      case RV_SLTIU:  *rd = a < (uint32_t)imm ? 1 : 0; break;
+      case RV_XORI:   *rd = a ^ imm; break;
+      case RV_ORI:    *rd = a | imm; break;
+      case RV_ANDI:   *rd = a & imm; break;
+      case RV_SLLI:   *rd = a << imm; break;
+      case RV_SRLI:   *rd = a >> imm; break;
+      case RV_SRAI:   *rd = (int32_t)a >> imm; break;
+      case RV_ADD:    *rd = a + b; break;
+      case RV_SUB:    *rd = a - b; break;
+      case RV_SLL:    *rd = a << (b & 0x1f); break;
+      case RV_SLT:    *rd = (int32_t)a < (int32_t)b ? 1 : 0; break;
+      case RV_SLTU:   *rd = a < b ? 1 : 0; break;
+      case RV_XOR:    *rd = a ^ b; break;
+      case RV_SRL:    *rd = a >> (b & 0x1f); break;
+      case RV_SRA:    *rd = (int32_t)a >> (b & 0x1f); break;
+      case RV_OR:     *rd = a | b; break;
+      case RV_AND:    *rd = a & b; break;
+      case RV_MUL:    *rd = a * b; break;
+      case RV_MULH:
+        *rd = ((int64_t)(int32_t)a * (int64_t)(int32_t)b) >> 32;
+        break;
+      case RV_MULHSU:
+        *rd = ((int64_t)(int32_t)a * (int64_t)b) >> 32;
+        break;
+      case RV_MULHU:
+        *rd = ((uint64_t)a * (uint64_t)b) >> 32;
+        break;
+      case RV_DIV:
+        if (b == 0) { *rd = 0xffffffff; }
+        else if (a == 0x80000000 && b == 0xffffffff) { *rd = a; }
+        else { *rd = (int32_t)a / (int32_t)b; }
+        break;
+      case RV_DIVU:
+        *rd = b == 0 ? 0xffffffff : a / b;
+        break;
+      case RV_REM:
+        if (b == 0) { *rd = a; }
+        else if (a == 0x80000000 && b == 0xffffffff) { *rd = 0; }
+        else { *rd = (int32_t)a % (int32_t)b; }
+        break;
+      case RV_REMU:
+        *rd = b == 0 ? a : a % b;
+        break;
+      case RV_FENCE:
+      case RV_WFI:
+        break;
+      case RV_FENCE_I:
+        code_changed = true;
+        break;
+      case RV_ECALL:
+      case RV_EBREAK:
+        // Stay on the instruction so the dump shows where it stopped.
+        next_pc = pc;
+        halted = true;
+        break;
+      case RV_MRET:
+        next_pc = csr_mepc;
+        break;
+      case RV_CSRRW:
+      case RV_CSRRS:
+      case RV_CSRRC:
+      case RV_CSRRWI:
+      case RV_CSRRSI:
+      case RV_CSRRCI:
+      {
+        const int csr = imm & 0xfff;
+        const uint32_t source =
+          instruction->op >= RV_CSRRWI ? instruction->rs1 : a;
+
+        if (read_csr(csr, &value, n) != 0) { return -1; }
+
+        switch (instruction->op)
+        {
+          case RV_CSRRW:
+          case RV_CSRRWI:
+            if (write_csr(csr, source) != 0) { return -1; }
+            break;
+          default:
+            // Set and clear with x0 or 0 are reads only.
+            if (instruction->rs1 == 0) { break; }
+
+            if (instruction->op == RV_CSRRS || instruction->op == RV_CSRRSI)
+            {
+              if (write_csr(csr, value | source) != 0) { return -1; }
+            }
+              else
+            {
+              if (write_csr(csr, value & ~source) != 0) { return -1; }
+            }
+            break;
+        }
+
+        *rd = value;
+        break;
+      }
+      default:
+        return -1;
+    }
+
+    reg[0] = 0;
+    pc = next_pc;
+  }
+
+  return n;
+}
+
+int SimulateRiscv::read_csr(int csr, uint32_t *value, int executed)
+{
+  uint64_t count;
+
+  switch (csr)
+  {
+    case 0xc00: // cycle
+    case 0xc01: // time
+    case 0xb00: // mcycle
+    case 0xc80: // cycleh
+    case 0xc81: // timeh
+    case 0xb80: // mcycleh
+      count = cycle_count + executed;
+      *value = (csr & 0x080) == 0 ? (uint32_t)count : (uint32_t)(count >> 32);
+      return 0;
+    case 0xc02: // instret
+    case 0xb02: // minstret
+    case 0xc82: // instreth
+    case 0xb82: // minstreth
+      count = instruction_count + executed;
+      *value = (csr & 0x080) == 0 ? (uint32_t)count : (uint32_t)(count >> 32);
+      return 0;
+    case 0x300: *value = csr_mstatus; return 0;
+    case 0x301: *value = (1 << 30) | (1 << 12) | (1 << 8) | (1 << 2); return 0;
+    case 0x304: *value = csr_mie; return 0;
+    case 0x305: *value = csr_mtvec; return 0;
+    case 0x340: *value = csr_mscratch; return 0;
+    case 0x341: *value = csr_mepc; return 0;
+    case 0x342: *value = csr_mcause; return 0;
+    case 0x343: *value = csr_mtval; return 0;
+    case 0x344: *value = 0; return 0;
+    case 0xf11:
+    case 0xf12:
+    case 0xf13:
+    case 0xf14: *value = 0; return 0;
+  }
+
+  return -1;
+}
+
+int SimulateRiscv::write_csr(int csr, uint32_t value)
+{
+  switch (csr)
+  {
+    case 0x300: csr_mstatus = value; return 0;
+    case 0x301: return 0;
+    case 0x304: csr_mie = value; return 0;
+    case 0x305: csr_mtvec = value; return 0;
+    case 0x340: csr_mscratch = value; return 0;
+    case 0x341: csr_mepc = value & ~1; return 0;
+    case 0x342: csr_mcause = value; return 0;
+    case 0x343: csr_mtval = value; return 0;
+    case 0x344: return 0;
+  }
+
+  return -1;
+}
+
+void SimulateRiscv::show_instructions(uint32_t address)
+{
+  char instruction[128];
+  int cycles_min, cycles_max;
+  int n;
+
+  for (n = 0; n < 6; n++)
+  {
+    uint16_t opcode16 = memory->read16(address);
+    int count;
+
+    printf("%c", has_break_point(address) ? '*' : ' ');
+
+    if (n == 0) { printf("! "); }
+    else if (address == pc) { printf("> "); }
+    else { printf("  "); }
+
+    if ((opcode16 & 0x3) == 0x3)
+    {
+      count = disasm_riscv(
+        memory,
+        address,
+        instruction,
+        sizeof(instruction),
+        &cycles_min,
+        &cycles_max);
+
+      printf("0x%08x: 0x%08x %-40s\n",
+        address, memory->read32(address), instruction);
+    }
+      else
+    {
+      count = 2;
+      printf("0x%08x:     0x%04x %-40s\n", address, opcode16, "(compressed)");
+    }
+
+    address += count < 2 ? 4 : count;
+  }
+}
+
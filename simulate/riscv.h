@@ -16,6 +16,34 @@
 
 #include "simulate/Simulate.h"
 
+#define RISCV_BLOCK_MAX 32
+#define RISCV_BLOCK_HASH_SIZE 4096
+
+// Returning to this address ends a function started with "call".
+#define RISCV_RETURN_ADDRESS 0xfffffffc
+
+// An instruction decoded into the operation to run and its operands.
+// Compressed instructions decode to the same operations.
+struct RiscvInstruction
+{
+  uint8_t op;
+  uint8_t rd;
+  uint8_t rs1;
+  uint8_t rs2;
+  uint8_t length;
+  int32_t imm;
+};
+
+// Straight line code starting at address up to and including the first
+// instruction that can change the flow of the program.
+struct RiscvBlock
+{
+  uint32_t address;
+  int count;
+  RiscvBlock *next;
+  RiscvInstruction instructions[RISCV_BLOCK_MAX];
+};
+
 class SimulateRiscv : public Simulate
 {
 public:
@@ -30,10 +58,34 @@ public:
   virtual uint32_t get_reg(const char *reg_string);
   virtual void set_pc(uint32_t value);
   virtual void dump_registers();
-  virtual int run(int max_cycles, int step);
+  virtual int run(int64_t max_cycles, int step);
 
 private:
-  int16_t reg[32];
+  static void decode(RiscvInstruction *instruction, uint32_t opcode);
+  static void decode_compressed(RiscvInstruction *instruction, uint16_t opcode);
+
+  RiscvBlock *get_block(uint32_t address);
+  void flush_blocks();
+  int execute_block(RiscvBlock *block, int count);
+  int read_csr(int csr, uint32_t *value, int executed);
+  int write_csr(int csr, uint32_t value);
+  void show_instructions(uint32_t address);
+
+  uint32_t reg[32];
+  uint32_t pc;
+  uint32_t csr_mstatus;
+  uint32_t csr_mie;
+  uint32_t csr_mtvec;
+  uint32_t csr_mscratch;
+  uint32_t csr_mepc;
+  uint32_t csr_mcause;
+  uint32_t csr_mtval;
+
+  RiscvBlock *blocks[RISCV_BLOCK_HASH_SIZE];
+  uint32_t code_low;
+  uint32_t code_high;
+  bool code_changed;
+  bool halted;
 };
 
 #endif
@@ -54,11 +54,19 @@
 #define READ_RAM16(a) memory->read16(a)
 #define READ_RAM24(a) ((memory->read8(a) << 16 ) | (memory->read16(a + 1)))
 
+// Operand reads, which unlike instruction fetches can hit a watch point.
+#define READ_DATA(a)   (watch_access(a, BREAK_POINT_READ), READ_RAM(a))
+#define READ_DATA16(a) \
+  (watch_access(a, BREAK_POINT_READ), \
+   watch_access((a) + 1, BREAK_POINT_READ), \
+   READ_RAM16(a))
+
 #define WRITE_RAM(a, b) \
   if ((a) == (uint32_t)break_io) \
   { \
     exit(b); \
   } \
+  watch_access(a, BREAK_POINT_WRITE); \
   memory->write8(a, b)
 
 #define WRITE_RAM16(a, w) \
@@ -66,6 +74,8 @@
   { \
     exit(w); \
   } \
+  watch_access(a, BREAK_POINT_WRITE); \
+  watch_access((a) + 1, BREAK_POINT_WRITE); \
   memory->write16(a, w)
 
 #define PUSH_STACK(n)   memory->write8(REG_SP, (n) & 0xff); --REG_SP  // caution: "--" side-effects
@@ -193,7 +203,6 @@ void SimulateStm8::reset()
   }
 
   REG_CC = BV(CC_I1_FLAG) | BV(CC_I0_FLAG);
-  break_point = -1;
 }
 
 void SimulateStm8::push(uint32_t value)
@@ -454,21 +463,21 @@ void SimulateStm8::dump_registers()
      REG_CC, REG_SP, REG_PC, SHOW_STACK);
 
   printf("\n\n");
-  printf("%d clock cycles have passed since last reset.\n\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
 // Returns:
 //    -1 = hit unknown instruction or unsupported memory address
 //     0 = OK
-int SimulateStm8::run(int max_cycles, int step)
+int SimulateStm8::run(int64_t max_cycles, int step)
 {
   char instruction[128];
   char bytes[20];
+  int64_t cycles = 0;
 
-  if (max_cycles != 0)
-  {
-    printf("Running... Press Ctl-C to break.\n");
-  }
+  printf("Running... Press Ctl-C to break.\n");
+
+  stop_reason = SIMULATE_STOP_NONE;
 
   while (stop_running == false)
   {
@@ -476,11 +485,14 @@ int SimulateStm8::run(int max_cycles, int step)
     int n;
     uint32_t current_pc = REG_PC;
 
+    instruction_count++;
+
     ret = execute();
 
     if (ret > 0)
     {
       cycle_count += ret;
+      cycles += ret;
     }
 
     if (show == true)
@@ -531,7 +543,7 @@ int SimulateStm8::run(int max_cycles, int step)
         // '>' - next instruction indicator
 
         // Breakpoint.
-        printf("%s", disasm_pc == (uint32_t)break_point ? "*" : " ");
+        printf("%s", has_break_point(disasm_pc) ? "*" : " ");
 
         if (n == 0)
         {
@@ -572,6 +584,7 @@ int SimulateStm8::run(int max_cycles, int step)
     if (auto_run == true && nested_call_count < 0)
     {
       disable_signal_handler();
+      stop_reason = SIMULATE_STOP_END;
       return 0;
     }
 
@@ -579,24 +592,33 @@ int SimulateStm8::run(int max_cycles, int step)
     {
       disable_signal_handler();
       printf("Unknown instruction at address 0x%06x\n", current_pc);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
     else if (ret == INVALID_MEM_ADDR)
     {
       disable_signal_handler();
       printf("Unsupported memory space access at address 0x%06x\n", current_pc);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
 
-    if ((uint32_t)break_point == REG_PC)
+    if (max_cycles != -1 && cycles >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    if (break_hit(REG_PC))
     {
-      printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
     if (REG_PC >= memory_size)
     {
       printf("End of memory - setting PC to reset vector.\n");
+      stop_reason = SIMULATE_STOP_END;
       step_mode = 0;
 
       REG_PC = 0;
@@ -621,13 +643,13 @@ int SimulateStm8::run(int max_cycles, int step)
       return 0;
     }
 
-    usleep(usec);
+    delay();
   }
 
   disable_signal_handler();
 
   printf("Stopped.  PC=0x%06x.\n", REG_PC);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
@@ -932,7 +954,7 @@ int SimulateStm8::execute_op_common(
   }
   else
   {
-    data = READ_RAM(eff_addr);
+    data = READ_DATA(eff_addr);
   }
 
   switch (table_stm8->instr_enum)
@@ -975,7 +997,7 @@ int SimulateStm8::execute_op_common(
       calculate_flags(flag_bits, REG_A, data, rslt, SIZE_8BITS);
       return table_stm8->cycles_min;
     case STM8_CPW:
-      data16 = READ_RAM16(eff_addr);
+      data16 = READ_DATA16(eff_addr);
       flag_bits = BV(CC_V_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_SUB_TYPE;
       if (table_stm8->dest == OP_REG_X)
       {
@@ -1038,7 +1060,7 @@ int SimulateStm8::execute_op_common(
     case STM8_LDW:
       if (table_stm8->dest == OP_REG_X)
       {
-        rslt = READ_RAM16(eff_addr);
+        rslt = READ_DATA16(eff_addr);
         REG_X = rslt;
       }
       else if (table_stm8->src == OP_REG_Y)
@@ -1048,7 +1070,7 @@ int SimulateStm8::execute_op_common(
       }
       else if (table_stm8->dest == OP_REG_Y)
       {
-        rslt = READ_RAM16(eff_addr);
+        rslt = READ_DATA16(eff_addr);
         REG_Y = rslt;
       }
       else if (table_stm8->src == OP_REG_X)
@@ -1493,7 +1515,7 @@ int SimulateStm8::execute_op_address16(struct _table_stm8_opcodes *table_stm8)
   next_word = READ_RAM16(REG_PC);
   REG_PC += 2;
   eff_addr = next_word;
-  data = READ_RAM(eff_addr);
+  data = READ_DATA(eff_addr);
 
   switch (table_stm8->instr_enum)
   {
@@ -1513,14 +1535,14 @@ int SimulateStm8::execute_op_address16(struct _table_stm8_opcodes *table_stm8)
       switch (table_stm8->dest)
       {
         case OP_REG_X:
-          data16 = READ_RAM16(eff_addr);
+          data16 = READ_DATA16(eff_addr);
           rslt = REG_X + data16;
           flag_bits = BV(CC_V_FLAG) | BV(CC_H_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_ADD_TYPE;
           calculate_flags(flag_bits, REG_X, data16, rslt, SIZE_16BITS);
           REG_X = rslt;
           return table_stm8->cycles_min;
         case OP_REG_Y:
-          data16 = READ_RAM16(eff_addr);
+          data16 = READ_DATA16(eff_addr);
           rslt = REG_Y + data16;
           flag_bits = BV(CC_V_FLAG) | BV(CC_H_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_ADD_TYPE;
           calculate_flags(flag_bits, REG_Y, data16, rslt, SIZE_16BITS);
@@ -1558,13 +1580,13 @@ int SimulateStm8::execute_op_address16(struct _table_stm8_opcodes *table_stm8)
       switch (table_stm8->dest)
       {
         case OP_REG_X:
-          data16 = READ_RAM16(eff_addr);
+          data16 = READ_DATA16(eff_addr);
           rslt = REG_X - data16;
           flag_bits = BV(CC_V_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_SUB_TYPE;
           calculate_flags(flag_bits, REG_X, data16, rslt, SIZE_16BITS);
           return table_stm8->cycles_min;
         case OP_REG_Y:
-          data16 = READ_RAM16(eff_addr);
+          data16 = READ_DATA16(eff_addr);
           rslt = REG_Y - data16;
           flag_bits = BV(CC_V_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_SUB_TYPE;
           calculate_flags(flag_bits, REG_Y, data16, rslt, SIZE_16BITS);
@@ -1621,7 +1643,7 @@ int SimulateStm8::execute_op_address16(struct _table_stm8_opcodes *table_stm8)
     case STM8_LDW:
       if (table_stm8->dest == OP_REG_X)
       {
-        REG_X = READ_RAM16(eff_addr);
+        REG_X = READ_DATA16(eff_addr);
         flag_bits = BV(CC_N_FLAG) | BV(CC_Z_FLAG);
         calculate_flags(flag_bits, 0, 0, REG_X, SIZE_16BITS);
         return table_stm8->cycles_min;
@@ -1636,7 +1658,7 @@ int SimulateStm8::execute_op_address16(struct _table_stm8_opcodes *table_stm8)
       }
       else if (table_stm8->dest == OP_REG_Y)
       {
-        REG_Y = READ_RAM16(eff_addr);
+        REG_Y = READ_DATA16(eff_addr);
         flag_bits = BV(CC_N_FLAG) | BV(CC_Z_FLAG);
         calculate_flags(flag_bits, 0, 0, REG_Y, SIZE_16BITS);
         return table_stm8->cycles_min;
@@ -1780,14 +1802,14 @@ int SimulateStm8::execute_op_address16(struct _table_stm8_opcodes *table_stm8)
       switch (table_stm8->dest)
       {
         case OP_REG_X:
-          data16 = READ_RAM16(eff_addr);
+          data16 = READ_DATA16(eff_addr);
           rslt = REG_X - data16;
           flag_bits = BV(CC_V_FLAG) | BV(CC_H_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_SUB_TYPE;
           calculate_flags(flag_bits, REG_X, data16, rslt, SIZE_16BITS);
           REG_X = rslt;
           return table_stm8->cycles_min;
         case OP_REG_Y:
-          data16 = READ_RAM16(eff_addr);
+          data16 = READ_DATA16(eff_addr);
           rslt = REG_Y - data16;
           flag_bits = BV(CC_V_FLAG) | BV(CC_H_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_SUB_TYPE;
           calculate_flags(flag_bits, REG_Y, data16, rslt, SIZE_16BITS);
@@ -1853,7 +1875,7 @@ int SimulateStm8::execute_op_address24(struct _table_stm8_opcodes *table_stm8)
     case STM8_LDF:
       if (table_stm8->dest == OP_REG_A)
       {
-        REG_A = READ_RAM(eff_addr);
+        REG_A = READ_DATA(eff_addr);
         flag_bits = BV(CC_N_FLAG) | BV(CC_Z_FLAG);
         calculate_flags(flag_bits, 0, 0, REG_A, SIZE_8BITS);
         return table_stm8->cycles_min;
@@ -1944,7 +1966,7 @@ int SimulateStm8::execute_op_offset24_index_x(struct _table_stm8_opcodes *table_
     case STM8_LDF:
       if (table_stm8->dest == OP_REG_A)
       {
-        REG_A = READ_RAM(eff_addr);
+        REG_A = READ_DATA(eff_addr);
         flag_bits = BV(CC_N_FLAG) | BV(CC_Z_FLAG);
         calculate_flags(flag_bits, 0, 0, REG_A, SIZE_8BITS);
         return table_stm8->cycles_min;
@@ -2037,7 +2059,7 @@ int SimulateStm8::execute_op_offset24_index_y(
     case STM8_LDF:
       if (table_stm8->dest == OP_REG_A)
       {
-        REG_A = READ_RAM(eff_addr);
+        REG_A = READ_DATA(eff_addr);
         flag_bits = BV(CC_N_FLAG) | BV(CC_Z_FLAG);
         calculate_flags(flag_bits, 0, 0, REG_A, SIZE_8BITS);
         return table_stm8->cycles_min;
@@ -2082,14 +2104,14 @@ int SimulateStm8::execute_op_offset8_index_sp(
       switch (table_stm8->dest)
       {
         case OP_REG_X:
-          data16 = READ_RAM16(eff_addr);
+          data16 = READ_DATA16(eff_addr);
           rslt = REG_X + data16;
           flag_bits = BV(CC_V_FLAG) | BV(CC_H_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_ADD_TYPE;
           calculate_flags(flag_bits, REG_X, data16, rslt, SIZE_16BITS);
           REG_X = rslt;
           return table_stm8->cycles_min;
         case OP_REG_Y:
-          data16 = READ_RAM16(eff_addr);
+          data16 = READ_DATA16(eff_addr);
           rslt = REG_Y + data16;
           flag_bits = BV(CC_V_FLAG) | BV(CC_H_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_ADD_TYPE;
           calculate_flags(flag_bits, REG_Y, data16, rslt, SIZE_16BITS);
@@ -2102,14 +2124,14 @@ int SimulateStm8::execute_op_offset8_index_sp(
       switch (table_stm8->dest)
       {
         case OP_REG_X:
-          data16 = READ_RAM16(eff_addr);
+          data16 = READ_DATA16(eff_addr);
           rslt = REG_X - data16;
           flag_bits = BV(CC_V_FLAG) | BV(CC_H_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_SUB_TYPE;
           calculate_flags(flag_bits, REG_X, data16, rslt, SIZE_16BITS);
           REG_X = rslt;
           return table_stm8->cycles_min;
         case OP_REG_Y:
-          data16 = READ_RAM16(eff_addr);
+          data16 = READ_DATA16(eff_addr);
           rslt = REG_Y - data16;
           flag_bits = BV(CC_V_FLAG) | BV(CC_H_FLAG) | BV(CC_N_FLAG) | BV(CC_Z_FLAG) | BV(CC_C_FLAG) | OP_SUB_TYPE;
           calculate_flags(flag_bits, REG_Y, data16, rslt, SIZE_16BITS);
@@ -2193,7 +2215,7 @@ int SimulateStm8::execute_op_indirect16_e(
     case STM8_LDF:
       if (table_stm8->dest == OP_REG_A)
       {
-        REG_A = READ_RAM(eff_addr);
+        REG_A = READ_DATA(eff_addr);
         flag_bits = BV(CC_N_FLAG) | BV(CC_Z_FLAG);
         calculate_flags(flag_bits, 0, 0, REG_A, SIZE_8BITS);
         return table_stm8->cycles_min;
@@ -2277,7 +2299,7 @@ int SimulateStm8::execute_op_indirect16_e_x(
     case STM8_LDF:
       if (table_stm8->dest == OP_REG_A)
       {
-        REG_A = READ_RAM(eff_addr);
+        REG_A = READ_DATA(eff_addr);
         flag_bits = BV(CC_N_FLAG) | BV(CC_Z_FLAG);
         calculate_flags(flag_bits, 0, 0, REG_A, SIZE_8BITS);
         return table_stm8->cycles_min;
@@ -2343,7 +2365,7 @@ int SimulateStm8::execute_op_indirect16_e_y(
     case STM8_LDF:
       if (table_stm8->dest == OP_REG_A)
       {
-        REG_A = READ_RAM(eff_addr);
+        REG_A = READ_DATA(eff_addr);
         flag_bits = BV(CC_N_FLAG) | BV(CC_Z_FLAG);
         calculate_flags(flag_bits, 0, 0, REG_A, SIZE_8BITS);
         return table_stm8->cycles_min;
@@ -18,15 +18,15 @@
 #include "disasm/tms9900.h"
 #include "simulate/tms9900.h"
 
-#define SHOW_STACK sp, memory->read8(sp + 1), memory->read8(sp)
-#define READ_RAM(a) memory->read8(a)
-#define WRITE_RAM(a,b) memory->write8(a, b)
+#define SHOW_STACK sp, peek_ram8(sp + 1), peek_ram8(sp)
+#define READ_RAM(a) read_ram8(a)
+#define WRITE_RAM(a,b) write_ram8(a, b)
 #define READ_REG(a) \
-  (memory->read8(wp + (a * 2)) << 8) | \
-   memory->read8(wp + (a * 2) + 1)
+  (read_ram8(wp + (a * 2)) << 8) | \
+   read_ram8(wp + (a * 2) + 1)
 #define WRITE_REG(a, b) \
-   memory->write8(wp + (a * 2), b >> 8); \
-   memory->write8(wp + (a * 2) + 1, b & 0xff);
+   write_ram8(wp + (a * 2), b >> 8); \
+   write_ram8(wp + (a * 2) + 1, b & 0xff);
 
 #define AFFECTS_NZ(a) \
   if (bw == 0) \
@@ -122,6 +122,7 @@ static const char *flags[] = { "L>", "A>", "=", "C", "O", "P", "X" };
 
 SimulateTms9900::SimulateTms9900(Memory *memory) : Simulate(memory)
 {
+  enable_flat_ram(16);
   reset();
 }
 
@@ -148,7 +149,6 @@ void SimulateTms9900::reset()
   pc = 0;
   wp = 0;
   st = 0;
-  break_point = -1;
 }
 
 void SimulateTms9900::push(uint32_t value)
@@ -251,18 +251,19 @@ void SimulateTms9900::dump_registers()
 
     char reg[4];
     snprintf(reg, sizeof(reg), "r%d",n);
-    printf("%3s: 0x%04x,", reg, READ_REG(n));
+    printf("%3s: 0x%04x,", reg,
+      (peek_ram8(wp + (n * 2)) << 8) | peek_ram8(wp + (n * 2) + 1));
   }
   //printf("      0x%04x: 0x%02x%02x", SHOW_STACK);
   printf("\n\n");
-  printf("%d clock cycles have passed since last reset.\n\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
-int SimulateTms9900::run(int max_cycles, int step)
+int SimulateTms9900::run(int64_t max_cycles, int step)
 {
   char instruction[128];
   uint16_t opcode;
-  int cycles = 0;
+  int64_t cycles = 0;
   int ret;
   int pc_current;
   int c = 0; // FIXME - broken
@@ -270,8 +271,12 @@ int SimulateTms9900::run(int max_cycles, int step)
 
   printf("Running... Press Ctl-C to break.\n");
 
+  stop_reason = SIMULATE_STOP_NONE;
+
   while (stop_running == false)
   {
+    instruction_count++;
+
     pc_current = pc;
     opcode = (READ_RAM(pc_current) << 8) | READ_RAM(pc_current);
     //c = get_cycle_count(opcode);
@@ -296,7 +301,7 @@ int SimulateTms9900::run(int max_cycles, int step)
       {
         int cycles_min,cycles_max;
         int num;
-        num = (READ_RAM(pc_current) << 8) | READ_RAM(pc_current + 1);
+        num = (peek_ram8(pc_current) << 8) | peek_ram8(pc_current + 1);
 
         int count = disasm_tms9900(
           memory,
@@ -308,7 +313,7 @@ int SimulateTms9900::run(int max_cycles, int step)
 
         if (cycles_min == -1) { break; }
 
-        if (pc_current == break_point)
+        if (has_break_point(pc_current))
         {
           printf("*");
         }
@@ -350,9 +355,9 @@ int SimulateTms9900::run(int max_cycles, int step)
         count--;
         while (count > 0)
         {
-          if (pc_current == break_point) { printf("*"); }
+          if (has_break_point(pc_current)) { printf("*"); }
           else { printf(" "); }
-          num = (READ_RAM(pc_current + 1) << 8) | READ_RAM(pc_current);
+          num = (peek_ram8(pc_current + 1) << 8) | peek_ram8(pc_current);
           printf("  0x%04x: 0x%04x\n", pc_current, num);
           pc_current += 2;
           count--;
@@ -360,18 +365,28 @@ int SimulateTms9900::run(int max_cycles, int step)
       }
     }
 
-    if (auto_run == true && nested_call_count < 0) { return 0; }
+    if (auto_run == true && nested_call_count < 0)
+    {
+      stop_reason = SIMULATE_STOP_END;
+      return 0;
+    }
 
     if (ret == -1)
     {
       printf("Illegal instruction at address 0x%04x\n", pc_current);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
 
-    if (max_cycles != -1 && cycles > max_cycles) break;
-    if (break_point == pc)
+    if (max_cycles != -1 && cycles >= max_cycles)
+    {
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    if (break_hit(pc))
     {
-       printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
@@ -384,19 +399,20 @@ int SimulateTms9900::run(int max_cycles, int step)
 
     if (pc == 0xffff)
     {
-      printf("Function ended.  Total cycles: %d\n", cycle_count);
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
       step_mode = 0;
       pc = 0;
       disable_signal_handler();
       return 0;
     }
 
-    usleep(usec);
+    delay();
   }
 
   disable_signal_handler();
   printf("Stopped.  PC=0x%04x.\n", pc);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
@@ -23,11 +23,11 @@
 #define VFLAG_CLEAR 1
 #define VFLAG_PARITY 2
 
-#define READ_RAM(a) memory->read8(a)
-#define READ_RAM16(a) (memory->read8(a + 1) << 8) | memory->read8(a)
+#define READ_RAM(a) read_ram8(a)
+#define READ_RAM16(a) (read_ram8(a + 1) << 8) | read_ram8(a)
 
-#define READ_OPCODE16(a) (memory->read8(a) << 8) | memory->read8(a + 1)
-#define WRITE_RAM(a,b) memory->write8(a, b)
+#define READ_OPCODE16(a) (peek_ram8(a) << 8) | peek_ram8(a + 1)
+#define WRITE_RAM(a,b) write_ram(a, b)
 
 #define GET_S() ((reg[REG_F] >> 7) & 1)
 #define GET_Z() ((reg[REG_F] >> 6) & 1)
@@ -58,6 +58,7 @@
 
 SimulateZ80::SimulateZ80(Memory *memory) : Simulate(memory)
 {
+  enable_flat_ram(16);
 }
 
 SimulateZ80::~SimulateZ80()
@@ -80,6 +81,8 @@ void SimulateZ80::reset()
   //status = 0;
   iff1 = 0;
   iff2 = 0;
+
+  memset(decode_valid, 0, sizeof(decode_valid));
 }
 
 void SimulateZ80::push(uint32_t value)
@@ -129,14 +132,14 @@ void SimulateZ80::dump_registers()
          sp, pc);
 
   printf("\n\n");
-  printf("%d clock cycles have passed since last reset.\n\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n\n", cycle_count);
 }
 
-int SimulateZ80::run(int max_cycles, int step)
+int SimulateZ80::run(int64_t max_cycles, int step)
 {
   char instruction[128];
   //uint16_t opcode;
-  int cycles = 0;
+  int64_t cycles = 0;
   int ret;
   int pc_current;
   //int c;
@@ -144,26 +147,43 @@ int SimulateZ80::run(int max_cycles, int step)
 
   printf("Running... Press Ctl-C to break.\n");
 
+  // Memory could have been changed from outside since the last run.
+  memset(decode_valid, 0, sizeof(decode_valid));
+
+  stop_reason = SIMULATE_STOP_NONE;
+
   while (stop_running == false)
   {
     int cycles_min, cycles_max;
+    instruction_count++;
     pc_current = pc;
 
     if (show == 1) { printf("\x1b[1J\x1b[1;1H"); }
 
-    int count = disasm_z80(
-      memory,
-      pc_current,
-      instruction,
-      sizeof(instruction),
-      &cycles_min,
-      &cycles_max);
+    Z80Decode *entry = &decode_cache[pc_current];
+
+    if (decode_valid[pc_current] == 0)
+    {
+      decode(entry, pc_current);
+      decode_valid[pc_current] = 1;
+    }
+
+    // Opcodes come from the decode cache instead of read_ram8(), so
+    // read watch points on them are checked each time they run.
+    // Operands are still read with read_ram8() by execute().
+    if (watch_count != 0)
+    {
+      watch_access(pc_current, BREAK_POINT_READ);
+
+      if (entry->table != NULL && entry->table->mask > 0xff)
+      {
+        watch_access((uint16_t)(pc_current + 1), BREAK_POINT_READ);
+      }
+    }
 
-    // Insert code execution
-    // FIXME
-    ret = execute();
+    ret = execute(entry);
 
-    pc += count;
+    pc += entry->count;
 
     if (show == true)
     {
@@ -183,7 +203,7 @@ int SimulateZ80::run(int max_cycles, int step)
 
         if (cycles_min == -1) break;
 
-        if (disasm_pc == break_point)
+        if (has_break_point(disasm_pc))
         {
           printf("*");
         }
@@ -197,7 +217,7 @@ int SimulateZ80::run(int max_cycles, int step)
           printf("! ");
         }
           else
-        if (disasm_pc == reg[0])
+        if (disasm_pc == pc)
         {
           printf("> ");
         }
@@ -210,31 +230,31 @@ int SimulateZ80::run(int max_cycles, int step)
 
         if (count == 1)
         {
-          snprintf(hex, sizeof(hex), "         %02x", READ_RAM(disasm_pc));
+          snprintf(hex, sizeof(hex), "         %02x", peek_ram8(disasm_pc));
         }
           else
         if (count == 2)
         {
           snprintf(hex, sizeof(hex), "      %02x %02x",
-            READ_RAM(disasm_pc),
-            READ_RAM(disasm_pc + 1));
+            peek_ram8(disasm_pc),
+            peek_ram8(disasm_pc + 1));
         }
           else
         if (count == 3)
         {
           snprintf(hex, sizeof(hex), "   %02x %02x %02x",
-            READ_RAM(disasm_pc),
-            READ_RAM(disasm_pc + 1),
-            READ_RAM(disasm_pc + 2));
+            peek_ram8(disasm_pc),
+            peek_ram8(disasm_pc + 1),
+            peek_ram8(disasm_pc + 2));
         }
           else
         if (count == 4)
         {
           snprintf(hex, sizeof(hex), "%02x %02x %02x %02x",
-            READ_RAM(disasm_pc),
-            READ_RAM(disasm_pc + 1),
-            READ_RAM(disasm_pc + 2),
-            READ_RAM(disasm_pc + 3));
+            peek_ram8(disasm_pc),
+            peek_ram8(disasm_pc + 1),
+            peek_ram8(disasm_pc + 2),
+            peek_ram8(disasm_pc + 3));
         }
           else
         {
@@ -260,19 +280,31 @@ int SimulateZ80::run(int max_cycles, int step)
       }
     }
 
-    if (auto_run == true && nested_call_count < 0) { return 0; }
+    if (auto_run == true && nested_call_count < 0)
+    {
+      stop_reason = SIMULATE_STOP_END;
+      return 0;
+    }
 
     if (ret == -1)
     {
       printf("Illegal instruction at address 0x%04x\n", pc_current);
+      stop_reason = SIMULATE_STOP_ILLEGAL;
       return -1;
     }
 
     cycle_count += ret;
-    if (max_cycles != -1 && cycles > max_cycles) break;
-    if (break_point == reg[0])
+    cycles += ret;
+
+    if (max_cycles != -1 && cycles >= max_cycles)
     {
-       printf("Breakpoint hit at 0x%04x\n", break_point);
+      stop_reason = SIMULATE_STOP_MAX_CYCLES;
+      break;
+    }
+
+    if (break_hit(pc))
+    {
+      stop_reason = SIMULATE_STOP_BREAKPOINT;
       break;
     }
 
@@ -285,20 +317,21 @@ int SimulateZ80::run(int max_cycles, int step)
 
     if (pc == 0xffff)
     {
-      printf("Function ended.  Total cycles: %d\n", cycle_count);
+      printf("Function ended.  Total cycles: %" PRIu64 "\n", cycle_count);
+      stop_reason = SIMULATE_STOP_END;
       step_mode = 0;
       pc = READ_RAM(0xfffe) | (READ_RAM(0xffff) << 8);
       disable_signal_handler();
       return 0;
     }
 
-    usleep(usec);
+    delay();
   }
 
   disable_signal_handler();
 
   printf("Stopped.  PC=0x%04x.\n", pc);
-  printf("%d clock cycles have passed since last reset.\n", cycle_count);
+  printf("%" PRIu64 " clock cycles have passed since last reset.\n", cycle_count);
 
   return 0;
 }
@@ -511,6 +544,18 @@ void SimulateZ80::add_reg16(int xy, int reg16)
   set_flags16(_new, old, number, VFLAG_OVERFLOW);
 }
 
+void SimulateZ80::write_ram(uint16_t address, uint8_t value)
+{
+  write_ram8(address, value);
+
+  // Instructions are at most 4 bytes long so any decoded in the 3 bytes
+  // before address could have been changed too.
+  decode_valid[address] = 0;
+  decode_valid[(uint16_t)(address - 1)] = 0;
+  decode_valid[(uint16_t)(address - 2)] = 0;
+  decode_valid[(uint16_t)(address - 3)] = 0;
+}
+
 int SimulateZ80::execute_op_none(struct _table_z80 *table_z80, uint16_t opcode)
 {
   int tmp;
@@ -903,95 +948,34 @@ int SimulateZ80::execute_op_xy(struct _table_z80 *table_z80, uint16_t opcode16)
   return -1;
 }
 
-int SimulateZ80::execute()
+void SimulateZ80::decode(Z80Decode *decode, uint16_t address)
 {
-  int index, n;
-  int reg16, xy;
-  int offset;
-  int address;
+  char instruction[128];
+  int cycles_min, cycles_max;
+  int n;
 
-  uint16_t opcode = READ_RAM(pc);
-  uint16_t opcode16 = READ_OPCODE16(pc);
+  // peek_ram8() so decoding doesn't count as a read by the program.
+  decode->opcode = peek_ram8(address);
+  decode->opcode16 = READ_OPCODE16(address);
+  decode->table = NULL;
+
+  // The disassembler is only used here to find the instruction length.
+  decode->count = disasm_z80(
+    memory,
+    address,
+    instruction,
+    sizeof(instruction),
+    &cycles_min,
+    &cycles_max);
 
   n = 0;
   while (table_z80[n].instr_enum != Z80_NONE)
   {
-    if (table_z80[n].opcode == (opcode & table_z80[n].mask))
+    if (table_z80[n].mask <= 0xff &&
+        table_z80[n].opcode == (decode->opcode & table_z80[n].mask))
     {
-      if (table_z80[n].mask > 0xff) { n++; continue; }
-      switch (table_z80[n].type)
-      {
-        case OP_NONE:
-          return execute_op_none(&table_z80[n], opcode);
-        case OP_A_REG8:
-          return execute_op_a_reg8(&table_z80[n], opcode);
-        case OP_REG8:
-          return execute_op_reg8(&table_z80[n], opcode);
-        case OP_A_NUMBER8:
-          return execute_op_a_number8(&table_z80[n], opcode16);
-        case OP_HL_REG16_1:
-          return -1;
-        case OP_A_INDEX_HL:
-          return -1;
-        case OP_INDEX_HL:
-          return -1;
-        case OP_NUMBER8:
-          return execute_op_number8(&table_z80[n], opcode16);
-        case OP_ADDRESS:
-          return -1;
-        case OP_COND_ADDRESS:
-          return -1;
-        case OP_REG8_V2:
-          return execute_op_reg8_v2(&table_z80[n], opcode);
-        case OP_REG16:
-          return execute_op_reg16(&table_z80[n], opcode);
-        case OP_INDEX_SP_HL:
-          return -1;
-        case OP_AF_AF_TICK:
-          return -1;
-        case OP_DE_HL:
-          return -1;
-        case OP_A_INDEX_N:
-          return -1;
-        case OP_JR_COND_ADDRESS:
-          return -1;
-        case OP_REG8_REG8:
-          index = (opcode >> 3) & 0x7;
-          reg[index] = reg[opcode & 0x7];
-          return table_z80->cycles_min;
-        case OP_REG8_NUMBER8:
-          index = (opcode16 >> 11) & 0x7;
-          reg[index] = opcode16 & 0xff;
-          return table_z80->cycles_min;
-        case OP_REG8_INDEX_HL:
-          return -1;
-        case OP_INDEX_HL_REG8:
-        case OP_INDEX_HL_NUMBER8:
-        case OP_A_INDEX_BC:
-        case OP_A_INDEX_DE:
-        case OP_A_INDEX_ADDRESS:
-        case OP_INDEX_BC_A:
-        case OP_INDEX_DE_A:
-        case OP_INDEX_ADDRESS_A:
-          return -1;
-        case OP_REG16_ADDRESS:
-          reg16 = (opcode >> 4) & 0x3;
-          set_q(reg16, READ_RAM16(pc + 1));
-          return table_z80->cycles_min;
-        case OP_HL_INDEX_ADDRESS:
-        case OP_INDEX_ADDRESS_HL:
-        case OP_SP_HL:
-        case OP_INDEX_ADDRESS8_A:
-          return -1;
-        case OP_REG16P:
-          return execute_op_reg16p(&table_z80[n], opcode);
-          return 1;
-        case OP_COND:
-          return -1;
-        case OP_RESTART_ADDRESS:
-        default:
-          return -1;
-      }
+      decode->table = &table_z80[n];
+      return;
     }
 
     n++;
@@ -1000,91 +984,184 @@ int SimulateZ80::execute()
   n = 0;
   while (table_z80[n].instr_enum != Z80_NONE)
   {
-    if (table_z80[n].mask <= 0xff) { n++; continue; }
-    if (table_z80[n].opcode == (opcode16 & table_z80[n].mask))
+    if (table_z80[n].mask > 0xff &&
+        table_z80[n].opcode == (decode->opcode16 & table_z80[n].mask))
     {
-      switch (table_z80[n].type)
-      {
-        case OP_NONE16:
-        case OP_NONE24:
-        case OP_A_REG_IHALF:
-        case OP_A_INDEX:
-          return -1;
-        case OP_HL_REG16_2:
-          return execute_op_hl_reg16_2(&table_z80[n], opcode16);
-        case OP_XY_REG16:
-          xy = (opcode16 >> 13) & 0x1;
-          reg16 = (opcode16 >> 4) & 0x3;
-          add_reg16(xy, reg16);
-          return table_z80->cycles_min;
-        case OP_REG_IHALF:
-        case OP_INDEX:
-        case OP_BIT_REG8:
-        case OP_BIT_INDEX_HL:
-        case OP_BIT_INDEX:
-        case OP_REG_IHALF_V2:
-        case OP_XY:
-          return execute_op_xy(&table_z80[n], opcode16);
-        case OP_INDEX_SP_XY:
-        case OP_IM_NUM:
-        case OP_REG8_INDEX_C:
-        case OP_F_INDEX_C:
-        case OP_INDEX_XY:
-        case OP_REG8_REG_IHALF:
-        case OP_REG_IHALF_REG8:
-        case OP_REG_IHALF_REG_IHALF:
-          return -1;
-        case OP_REG8_INDEX:
-          xy = (opcode16 >> 13) & 0x1;
-          offset = READ_RAM(pc + 2);
-          address = xy + offset;
-          index = (opcode16 >> 3) & 0x7;
-          reg[index] = READ_RAM(address);
-          return table_z80->cycles_min;
-        case OP_INDEX_REG8:
-          xy = (opcode16 >> 13) & 0x1;
-          offset = READ_RAM(pc + 2);
-          address = xy + offset;
-          index = opcode16 & 0x7;
-          WRITE_RAM(address, reg[index]);
-          return table_z80->cycles_min;
-        case OP_INDEX_NUMBER8:
-          xy = (opcode16 >> 13) & 0x1;
-          offset = READ_RAM(pc + 2);
-          address = xy + offset;
-          WRITE_RAM(address, READ_RAM(pc + 3));
-          return table_z80->cycles_min;
-        case OP_IR_A:
-          return -1;
-        case OP_A_IR:
-          return -1;
-        case OP_XY_ADDRESS:
-          xy = (opcode16 >> 13) & 0x1;
-          set_xy(xy, READ_RAM16(pc + 2));
-          return table_z80->cycles_min;
-        case OP_REG16_INDEX_ADDRESS:
-        case OP_XY_INDEX_ADDRESS:
-        case OP_INDEX_ADDRESS_REG16:
-        case OP_INDEX_ADDRESS_XY:
-          return -1;
-        case OP_SP_XY:
-          xy = (opcode16 >> 13) & 0x1;
-          sp = get_xy(xy);
-          return table_z80->cycles_min;
-        case OP_INDEX_C_REG8:
-        case OP_INDEX_C_ZERO:
-        case OP_REG8_CB:
-        case OP_INDEX_HL_CB:
-          case OP_BIT_INDEX_V2:
-          case OP_BIT_INDEX_REG8:
-        default:
-          return -1;
-      }
+      decode->table = &table_z80[n];
+      return;
     }
 
     n++;
   }
+}
+
+int SimulateZ80::execute(const Z80Decode *decode)
+{
+  int index;
+  int reg16, xy;
+  int offset;
+  int address;
+
+  struct _table_z80 *entry = decode->table;
+  uint16_t opcode = decode->opcode;
+  uint16_t opcode16 = decode->opcode16;
+
+  if (entry == NULL) { return -1; }
+
+  if (entry->mask <= 0xff)
+  {
+    switch (entry->type)
+    {
+      case OP_NONE:
+        return execute_op_none(entry, opcode);
+      case OP_A_REG8:
+        return execute_op_a_reg8(entry, opcode);
+      case OP_REG8:
+        return execute_op_reg8(entry, opcode);
+      case OP_A_NUMBER8:
+        return execute_op_a_number8(entry, opcode16);
+      case OP_HL_REG16_1:
+        return -1;
+      case OP_A_INDEX_HL:
+        return -1;
+      case OP_INDEX_HL:
+        return -1;
+      case OP_NUMBER8:
+        return execute_op_number8(entry, opcode16);
+      case OP_ADDRESS:
+        return -1;
+      case OP_COND_ADDRESS:
+        return -1;
+      case OP_REG8_V2:
+        return execute_op_reg8_v2(entry, opcode);
+      case OP_REG16:
+        return execute_op_reg16(entry, opcode);
+      case OP_INDEX_SP_HL:
+        return -1;
+      case OP_AF_AF_TICK:
+        return -1;
+      case OP_DE_HL:
+        return -1;
+      case OP_A_INDEX_N:
+        return -1;
+      case OP_JR_COND_ADDRESS:
+        return -1;
+      case OP_REG8_REG8:
+        index = (opcode >> 3) & 0x7;
+        reg[index] = reg[opcode & 0x7];
+        return table_z80->cycles_min;
+      case OP_REG8_NUMBER8:
+        index = (opcode16 >> 11) & 0x7;
+        reg[index] = opcode16 & 0xff;
+        return table_z80->cycles_min;
+      case OP_REG8_INDEX_HL:
+        return -1;
+      case OP_INDEX_HL_REG8:
+      case OP_INDEX_HL_NUMBER8:
+      case OP_A_INDEX_BC:
+      case OP_A_INDEX_DE:
+      case OP_A_INDEX_ADDRESS:
+      case OP_INDEX_BC_A:
+      case OP_INDEX_DE_A:
+      case OP_INDEX_ADDRESS_A:
+        return -1;
+      case OP_REG16_ADDRESS:
+        reg16 = (opcode >> 4) & 0x3;
+        set_q(reg16, READ_RAM16(pc + 1));
+        return table_z80->cycles_min;
+      case OP_HL_INDEX_ADDRESS:
+      case OP_INDEX_ADDRESS_HL:
+      case OP_SP_HL:
+      case OP_INDEX_ADDRESS8_A:
+        return -1;
+      case OP_REG16P:
+        return execute_op_reg16p(entry, opcode);
+        return 1;
+      case OP_COND:
+        return -1;
+      case OP_RESTART_ADDRESS:
+      default:
+        return -1;
+    }
+  }
+
+  switch (entry->type)
+  {
+    case OP_NONE16:
+    case OP_NONE24:
+    case OP_A_REG_IHALF:
+    case OP_A_INDEX:
+      return -1;
+    case OP_HL_REG16_2:
+      return execute_op_hl_reg16_2(entry, opcode16);
+    case OP_XY_REG16:
+      xy = (opcode16 >> 13) & 0x1;
+      reg16 = (opcode16 >> 4) & 0x3;
+      add_reg16(xy, reg16);
+      return table_z80->cycles_min;
+    case OP_REG_IHALF:
+    case OP_INDEX:
+    case OP_BIT_REG8:
+    case OP_BIT_INDEX_HL:
+    case OP_BIT_INDEX:
+    case OP_REG_IHALF_V2:
+    case OP_XY:
+      return execute_op_xy(entry, opcode16);
+    case OP_INDEX_SP_XY:
+    case OP_IM_NUM:
+    case OP_REG8_INDEX_C:
+    case OP_F_INDEX_C:
+    case OP_INDEX_XY:
+    case OP_REG8_REG_IHALF:
+    case OP_REG_IHALF_REG8:
+    case OP_REG_IHALF_REG_IHALF:
+      return -1;
+    case OP_REG8_INDEX:
+      xy = (opcode16 >> 13) & 0x1;
+      offset = READ_RAM(pc + 2);
+      address = xy + offset;
+      index = (opcode16 >> 3) & 0x7;
+      reg[index] = READ_RAM(address);
+      return table_z80->cycles_min;
+    case OP_INDEX_REG8:
+      xy = (opcode16 >> 13) & 0x1;
+      offset = READ_RAM(pc + 2);
+      address = xy + offset;
+      index = opcode16 & 0x7;
+      WRITE_RAM(address, reg[index]);
+      return table_z80->cycles_min;
+    case OP_INDEX_NUMBER8:
+      xy = (opcode16 >> 13) & 0x1;
+      offset = READ_RAM(pc + 2);
+      address = xy + offset;
+      WRITE_RAM(address, READ_RAM(pc + 3));
+      return table_z80->cycles_min;
+    case OP_IR_A:
+      return -1;
+    case OP_A_IR:
+      return -1;
+    case OP_XY_ADDRESS:
+      xy = (opcode16 >> 13) & 0x1;
+      set_xy(xy, READ_RAM16(pc + 2));
+      return table_z80->cycles_min;
+    case OP_REG16_INDEX_ADDRESS:
+    case OP_XY_INDEX_ADDRESS:
+    case OP_INDEX_ADDRESS_REG16:
+    case OP_INDEX_ADDRESS_XY:
+      return -1;
+    case OP_SP_XY:
+      xy = (opcode16 >> 13) & 0x1;
+      sp = get_xy(xy);
+      return table_z80->cycles_min;
+    case OP_INDEX_C_REG8:
+    case OP_INDEX_C_ZERO:
+    case OP_REG8_CB:
+    case OP_INDEX_HL_CB:
+      case OP_BIT_INDEX_V2:
+      case OP_BIT_INDEX_REG8:
+    default:
+      return -1;
+  }
 
   return -1;
 }
-
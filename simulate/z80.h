@@ -25,6 +25,16 @@
 #define REG_F 6
 #define REG_A 7
 
+// An instruction decoded once at an address.  Entries are dropped when
+// the simulator writes to any byte the instruction could cover.
+struct Z80Decode
+{
+  struct _table_z80 *table;
+  uint16_t opcode;
+  uint16_t opcode16;
+  uint8_t count;
+};
+
 class SimulateZ80 : public Simulate
 {
 public:
@@ -39,7 +49,7 @@ public:
   virtual uint32_t get_reg(const char *reg_string);
   virtual void set_pc(uint32_t value);
   virtual void dump_registers();
-  virtual int run(int max_cycles, int step);
+  virtual int run(int64_t max_cycles, int step);
 
 private:
   int get_q(int reg16);
@@ -63,7 +73,9 @@ private:
   int execute_op_reg16p(struct _table_z80 *table_z80, uint8_t opcode);
   int execute_op_hl_reg16_2(struct _table_z80 *table_z80, uint8_t opcode);
   int execute_op_xy(struct _table_z80 *table_z80, uint16_t opcode16);
-  int execute();
+  void decode(Z80Decode *decode, uint16_t address);
+  int execute(const Z80Decode *decode);
+  void write_ram(uint16_t address, uint8_t value);
 
   uint8_t reg[8];
   uint16_t ix;
@@ -73,6 +85,9 @@ private:
   //uint8_t status;
   uint8_t iff1;
   uint8_t iff2;
+
+  Z80Decode decode_cache[65536];
+  uint8_t decode_valid[65536];
 };
 
 #endif
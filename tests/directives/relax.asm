@@ -0,0 +1,13 @@
+;; z is in zero page only when lda z uses the absolute encoding, so
+;; -relax never settles and has to fall back to a normal assemble.
+
+.6502
+.org 0xf0
+start:
+  lda z
+end:
+  nop
+.org 0xff + 0x80 * (3 - (end - start))
+z:
+  nop
+
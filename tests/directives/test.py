@@ -22,3 +22,20 @@ else:
   print("\x1b[31mFAIL\x1b[0m")
   sys.exit(-1)
 
+
+print("Relax test: ", end = '')
+
+os.system("../../naken_asm -q -o relax_normal.hex relax.asm > /dev/null")
+r = os.system("../../naken_asm -q -relax -o relax.hex relax.asm > /dev/null")
+
+normal = open("relax_normal.hex", "r").read()
+relaxed = open("relax.hex", "r").read() if r == 0 else ""
+
+os.remove("relax_normal.hex")
+if os.path.exists("relax.hex"): os.remove("relax.hex")
+
+if r == 0 and relaxed == normal:
+  print("\x1b[32mPASS\x1b[0m")
+else:
+  print("\x1b[31mFAIL\x1b[0m")
+  sys.exit(-1)
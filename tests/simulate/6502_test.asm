@@ -0,0 +1,229 @@
+;; Checks for the 6502 simulator.  Run with -break_io 0x8000: each check
+;; that fails writes its number to STATUS, which makes naken_util exit
+;; with that number.  When every check passes the program returns to
+;; 0xffff and the simulator prints "Function ended".
+
+.6502
+
+STATUS equ 0x8000
+
+.org 0x1000
+start:
+  ldx #0xff
+  txs
+  cld
+  ;; Return address for the final rts, the same one the call command uses.
+  lda #0xff
+  pha
+  lda #0xfe
+  pha
+
+  ;; 1: INY sets N and Z from the result.
+test_1:
+  ldy #0x7f
+  iny
+  bpl fail_1
+  beq fail_1
+  ldy #0xff
+  iny
+  bne fail_1
+  bmi fail_1
+  jmp test_2
+fail_1:
+  lda #1
+  sta STATUS
+
+  ;; 2: TAX, TAY and TSX set N from the value transferred.
+test_2:
+  lda #0x80
+  tax
+  bpl fail_2
+  lda #0x00
+  tay
+  bne fail_2
+  lda #0x90
+  tay
+  bpl fail_2
+  cpy #0x90
+  bne fail_2
+  ldx #0xff
+  txs
+  lda #0x01
+  tsx
+  bpl fail_2
+  cpx #0xff
+  bne fail_2
+  ldx #0xfd
+  txs
+  jmp test_3
+fail_2:
+  lda #2
+  sta STATUS
+
+  ;; 3: PLA sets N and Z from the pulled byte.
+test_3:
+  lda #0x00
+  pha
+  lda #0x01
+  pla
+  bne fail_3
+  lda #0x80
+  pha
+  lda #0x00
+  pla
+  bpl fail_3
+  cmp #0x80
+  bne fail_3
+  jmp test_4
+fail_3:
+  lda #3
+  sta STATUS
+
+  ;; 4: SBC overflow and carry.
+test_4:
+  sec
+  lda #0x80
+  sbc #0x01
+  bvc fail_4
+  bcc fail_4
+  cmp #0x7f
+  bne fail_4
+  sec
+  lda #0x50
+  sbc #0xb0
+  bvc fail_4
+  bcs fail_4
+  cmp #0xa0
+  bne fail_4
+  sec
+  lda #0x50
+  sbc #0x10
+  bvs fail_4
+  bcc fail_4
+  cmp #0x40
+  bne fail_4
+  clc
+  lda #0x10
+  sbc #0x0f
+  bne fail_4
+  jmp test_5
+fail_4:
+  lda #4
+  sta STATUS
+
+  ;; 5: zp,x and zp,y wrap around inside the zero page.
+test_5:
+  lda #0x55
+  sta 0x0010
+  lda #0xaa
+  sta 0x0110
+  ldy #0x20
+  ldx 0xf0,y
+  cpx #0x55
+  bne fail_5
+  ldx #0x20
+  lda 0xf0,x
+  cmp #0x55
+  bne fail_5
+  lda #0x66
+  sta 0xf0,x
+  lda 0x0010
+  cmp #0x66
+  bne fail_5
+  jmp test_6
+fail_5:
+  lda #5
+  sta STATUS
+
+  ;; 6: (zp,x) and (zp),y read a pointer at 0xff from 0xff and 0x00.
+test_6:
+  lda #0x00
+  sta 0x00ff
+  lda #0x20
+  sta 0x0000
+  lda #0x30
+  sta 0x0100
+  lda #0x77
+  sta 0x2000
+  lda #0x88
+  sta 0x3000
+  lda #0x99
+  sta 0x2005
+  ldx #0x01
+  lda (0xfe,x)
+  cmp #0x77
+  bne fail_6
+  ldy #0x05
+  lda (0xff),y
+  cmp #0x99
+  bne fail_6
+  jmp test_7
+fail_6:
+  lda #6
+  sta STATUS
+
+  ;; 7: JSR and RTS, with the subroutine adding up a table.
+test_7:
+  jsr add_table
+  cmp #0x3c
+  bne fail_7
+  lda 0x0200
+  cmp #0x3c
+  bne fail_7
+  tsx
+  cpx #0xfd
+  bne fail_7
+  jmp test_8
+fail_7:
+  lda #7
+  sta STATUS
+
+  ;; 8: ADC and SBC in decimal mode.
+test_8:
+  sed
+  clc
+  lda #0x45
+  adc #0x55
+  bcc fail_8
+  cmp #0x00
+  bne fail_8
+  sec
+  lda #0x00
+  sbc #0x01
+  bcs fail_8
+  cmp #0x99
+  bne fail_8
+  clc
+  lda #0x42
+  sbc #0x12
+  bcc fail_8
+  cmp #0x29
+  bne fail_8
+  cld
+  jmp done
+fail_8:
+  cld
+  lda #8
+  sta STATUS
+
+done:
+  rts
+
+add_table:
+  lda #0
+  ldx #0
+add_table_loop:
+  clc
+  adc table,x
+  inx
+  cpx #5
+  bne add_table_loop
+  sta 0x0200
+  rts
+
+table:
+  .db 4, 8, 12, 16, 20
+
+.org 0xfffc
+  .dw start
+
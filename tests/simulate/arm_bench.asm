@@ -0,0 +1,93 @@
+;; Benchmark for the ARM simulator running Thumb code.  Build and run
+;; with "make bench" and naken_util reports the instructions run per
+;; second and the simulated clock in MHz.  Each pass copies a buffer
+;; with ldmia / stmia, sums it a byte at a time, multiplies and shifts
+;; and calls a function so loads, stores, branches, push / pop and the
+;; flags are all used.  The program ends with bx lr, which stops the
+;; simulator.
+
+.thumb
+
+BUFFER_SIZE equ 64
+
+.org 0x1000
+start:
+  push {r4-r7, lr}
+
+  ;; Fill the source buffer with 0, 1, 2, ...
+  ldr r0, source_address
+  mov r1, #0
+fill:
+  str r1, [r0, #0]
+  add r0, #4
+  add r1, #1
+  cmp r1, #BUFFER_SIZE
+  bne fill
+
+  ldr r6, passes
+  mov r7, #0
+pass:
+  ;; Copy source to dest 3 words at a time.
+  ldr r0, source_address
+  ldr r1, dest_address
+  mov r2, #BUFFER_SIZE / 3
+copy:
+  ldmia r0!, { r3-r5 }
+  stmia r1!, { r3-r5 }
+  sub r2, #1
+  bne copy
+
+  ;; Sum the bytes of dest.
+  ldr r0, dest_address
+  mov r2, #0
+  mov r4, #0
+  mov r5, #BUFFER_SIZE * 2
+  lsl r5, r5, #1
+sum:
+  ldrb r3, [r0, r2]
+  add r4, r4, r3
+  add r2, #1
+  cmp r2, r5
+  blt sum
+
+  mov r0, r4
+  bl mix
+  add r7, r7, r0
+
+  sub r6, #1
+  bne pass
+
+  ldr r0, total_address
+  str r7, [r0, #0]
+
+  pop {r4-r7}
+  pop {r0}
+  bx r0
+
+;; Shuffle the bits of r0 around with shifts, multiply and the logic
+;; instructions.
+mix:
+  push {r4, lr}
+  ldr r1, mask
+  eor r0, r1
+  lsl r0, r0, #3
+  mul r0, r1
+  mov r2, #5
+  ror r0, r2
+  lsr r3, r0, #8
+  bic r0, r3
+  asr r4, r0, #4
+  orr r0, r4
+  pop {r4, pc}
+
+.align 32
+passes:
+  dc32 20000
+mask:
+  dc32 0x5a5a
+source_address:
+  dc32 0x2000
+dest_address:
+  dc32 0x2100
+total_address:
+  dc32 0x2200
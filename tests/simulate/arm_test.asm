@@ -0,0 +1,205 @@
+;; Checks for the ARM simulator.  When every check passes the program
+;; returns to lr and the simulator prints "Function ended".  A failing
+;; check runs the swi after it, so the simulator halts at that address.
+;;
+;; The instructions naken_asm doesn't assemble yet are written with .dc32
+;; and the instruction they encode in the comment.
+
+.arm
+
+.org 0x1000
+start:
+  stmfd sp!, {r4-r7, lr}
+
+  ;; 1: ADDS sets N and V on signed overflow and C on unsigned carry.
+test_1:
+  mvn r0, #0x80000000
+  adds r1, r0, #1
+  bvc fail_1
+  bpl fail_1
+  bcs fail_1
+  beq fail_1
+  mvn r0, #0
+  adds r1, r0, #1
+  bcc fail_1
+  bne fail_1
+  bvs fail_1
+  b test_2
+fail_1:
+  swi 0
+
+  ;; 2: SUBS and CMP set C when there is no borrow.
+test_2:
+  mov r0, #0
+  cmp r0, #1
+  bcs fail_2
+  bpl fail_2
+  mov r0, #5
+  subs r1, r0, #5
+  bne fail_2
+  bcc fail_2
+  mov r0, #0x80000000
+  cmp r0, #1
+  bvc fail_2
+  bmi fail_2
+  b test_3
+fail_2:
+  swi 0
+
+  ;; 3: Conditional execution, signed and unsigned.
+test_3:
+  mov r2, #0
+  mvn r0, #0
+  cmp r0, #1
+  addlt r2, r2, #1
+  addge r2, r2, #0x10
+  addhi r2, r2, #2
+  addls r2, r2, #0x20
+  addne r2, r2, #4
+  addeq r2, r2, #0x40
+  addmi r2, r2, #8
+  cmp r2, #15
+  bne fail_3
+  movs r0, #0
+  movne r2, #1
+  moveq r2, #2
+  cmp r2, #2
+  bne fail_3
+  b test_4
+fail_3:
+  swi 0
+
+  ;; 4: The shifter's carry out, RRX and shifts by a register of 32 or
+  ;; more.  r7 is 0 so the orrs are moves.
+test_4:
+  mov r7, #0
+  mov r1, #0x80000000
+  orrs r0, r7, r1, lsl #1
+  bcc fail_4
+  bne fail_4
+  mov r1, #3
+  orrs r0, r7, r1, lsr #1
+  bcc fail_4
+  .dc32 0xe1b00060          ; movs r0, r0, rrx
+  bcc fail_4
+  cmp r0, #0x80000000
+  bne fail_4
+  mov r3, #32
+  mov r1, #0x80000000
+  orrs r0, r7, r1, asr r3
+  bcc fail_4
+  cmn r0, #1
+  bne fail_4
+  mov r3, #33
+  orrs r0, r7, r1, lsr r3
+  bcs fail_4
+  bne fail_4
+  b test_5
+fail_4:
+  swi 0
+
+  ;; 5: ADC and SBC chain 64 bit math through C.
+test_5:
+  mvn r0, #0
+  mov r1, #1
+  mov r2, #1
+  mov r3, #0
+  adds r0, r0, r2
+  adc r1, r1, r3
+  cmp r0, #0
+  bne fail_5
+  cmp r1, #2
+  bne fail_5
+  subs r0, r0, #1
+  sbc r1, r1, #0
+  cmn r0, #1
+  bne fail_5
+  cmp r1, #1
+  bne fail_5
+  b test_6
+fail_5:
+  swi 0
+
+  ;; 6: Long multiplies.
+test_6:
+  mvn r2, #1
+  mov r3, #3
+  .dc32 0xe0c10392          ; smull r0, r1, r2, r3
+  cmn r0, #6
+  bne fail_6
+  cmn r1, #1
+  bne fail_6
+  .dc32 0xe0810392          ; umull r0, r1, r2, r3
+  cmp r1, #2
+  bne fail_6
+  mov r4, #1
+  mov r5, #0
+  .dc32 0xe0a54392          ; umlal r4, r5, r2, r3
+  cmn r4, #5
+  bne fail_6
+  cmp r5, #2
+  bne fail_6
+  b test_7
+fail_6:
+  swi 0
+
+  ;; 7: Byte, halfword and signed loads.
+test_7:
+  mov r4, #0x8000
+  mov r0, #0xff
+  orr r0, r0, #0x8000
+  str r0, [r4]
+  ldrb r1, [r4]
+  cmp r1, #0xff
+  bne fail_7
+  .dc32 0xe1d410d0          ; ldrsb r1, [r4]
+  cmn r1, #1
+  bne fail_7
+  .dc32 0xe1d410b0          ; ldrh r1, [r4]
+  cmp r1, r0
+  bne fail_7
+  .dc32 0xe1d410f0          ; ldrsh r1, [r4]
+  mvn r2, #0x7f00
+  cmp r1, r2
+  bne fail_7
+  mov r1, #0x12
+  strb r1, [r4, #1]
+  ldr r1, [r4]
+  cmp r1, #0x12ff
+  bne fail_7
+  b test_8
+fail_7:
+  swi 0
+
+  ;; 8: BX to Thumb code and back to ARM.
+test_8:
+  ldr r0, thumb_address
+  mov lr, pc
+  bx r0
+  cmp r0, #42
+  bne fail_8
+  cmp r1, #1
+  bne fail_8
+  b done
+fail_8:
+  swi 0
+
+done:
+  ldmfd sp!, {r4-r7, lr}
+  bx lr
+
+thumb_address:
+  .dc32 thumb_code + 1
+
+.thumb
+.align 16
+thumb_code:
+  mov r0, #40
+  add r0, #2
+  mov r1, #0
+  cmp r0, #42
+  bne thumb_done
+  mov r1, #1
+thumb_done:
+  bx lr
+
@@ -0,0 +1,103 @@
+;; ALU checks for the eBPF simulator.  r9 holds the number of the check
+;; being run: a failing check exits with it in r0 and when every check
+;; passes the program exits with r0 = 0x100.
+
+.ebpf
+
+.include "ebpf.inc"
+
+  ;; 1: 64 bit immediates are sign extended and 32 bit results are zero
+  ;; extended.
+  mov r9, 1
+  mov r1, -1
+  JUMP(0x55, 1, 0, fail, -1)           ; jne r1, -1
+  mov32 r1, -1
+  JUMP(0x15, 1, 0, fail, -1)           ; jeq r1, -1
+  rsh r1, 32
+  JUMP(0x55, 1, 0, fail, 0)            ; jne r1, 0
+  mov r2, -1
+  add32 r2, 1
+  JUMP(0x55, 2, 0, fail, 0)            ; jne r2, 0
+
+  ;; 2: Dividing by a register that is 0 gives 0, mod leaves dst alone
+  ;; (its low 32 bits for mod32).
+  mov r9, 2
+  mov r1, 7
+  mov r2, 0
+  div r1, r2
+  JUMP(0x55, 1, 0, fail, 0)            ; jne r1, 0
+  mov r1, 7
+  mod r1, r2
+  JUMP(0x55, 1, 0, fail, 7)            ; jne r1, 7
+  mov r1, -1
+  mod32 r1, r2
+  mov32 r3, -1
+  JUMP(0x5d, 1, 3, fail, 0)            ; jne r1, r3
+
+  ;; 3: Signed divide and mod round toward zero, and the most negative
+  ;; number divided by -1 is itself.
+  mov r9, 3
+  mov r1, -7
+  mov r2, 2
+  INSN(0x3f, 1, 2, 1, 0)               ; sdiv r1, r2
+  JUMP(0x55, 1, 0, fail, -3)           ; jne r1, -3
+  mov r1, -7
+  INSN(0x9f, 1, 2, 1, 0)               ; smod r1, r2
+  JUMP(0x55, 1, 0, fail, -1)           ; jne r1, -1
+  mov r1, 7
+  INSN(0x34, 1, 0, 1, -2)              ; sdiv32 r1, -2
+  mov32 r3, -3
+  JUMP(0x5d, 1, 3, fail, 0)            ; jne r1, r3
+  LDDW(1, 0, 0x80000000)
+  mov r3, r1
+  INSN(0x37, 1, 0, 1, -1)              ; sdiv r1, -1
+  JUMP(0x5d, 1, 3, fail, 0)            ; jne r1, r3
+  INSN(0x97, 1, 0, 1, -1)              ; smod r1, -1
+  JUMP(0x55, 1, 0, fail, 0)            ; jne r1, 0
+
+  ;; 4: Arithmetic shifts copy the sign bit of 64 or 32 bits.
+  mov r9, 4
+  LDDW(1, 0, 0x80000000)
+  arsh r1, 63
+  JUMP(0x55, 1, 0, fail, -1)           ; jne r1, -1
+  mov32 r1, 0x40000000
+  lsh32 r1, 1
+  arsh32 r1, 31
+  mov32 r3, -1
+  JUMP(0x5d, 1, 3, fail, 0)            ; jne r1, r3
+
+  ;; 5: neg, and mov with an offset sign extends 8, 16 or 32 bits.
+  mov r9, 5
+  mov r1, 5
+  neg r1
+  JUMP(0x55, 1, 0, fail, -5)           ; jne r1, -5
+  mov r2, 0x180
+  INSN(0xbf, 3, 2, 8, 0)               ; movsx r3, (s8)r2
+  JUMP(0x55, 3, 0, fail, -128)         ; jne r3, -128
+  mov r2, 0x8000
+  INSN(0xbc, 3, 2, 16, 0)              ; movsx32 r3, (s16)r2
+  mov32 r4, 0xffff8000
+  JUMP(0x5d, 3, 4, fail, 0)            ; jne r3, r4
+  mov32 r2, 0x80000000
+  INSN(0xbf, 3, 2, 32, 0)              ; movsx r3, (s32)r2
+  JUMP(0x55, 3, 0, fail, 0x80000000)   ; jne r3, 0xffffffff80000000
+
+  ;; 6: Byte swaps on a little endian target.
+  mov r9, 6
+  mov r1, 0x11234
+  INSN(0xdc, 1, 0, 0, 16)              ; be16 r1
+  JUMP(0x55, 1, 0, fail, 0x3412)       ; jne r1, 0x3412
+  mov r1, 0x12345678
+  INSN(0xd4, 1, 0, 0, 16)              ; le16 r1
+  JUMP(0x55, 1, 0, fail, 0x5678)       ; jne r1, 0x5678
+  mov r1, 0x12345678
+  INSN(0xd7, 1, 0, 0, 32)              ; bswap32 r1
+  JUMP(0x55, 1, 0, fail, 0x78563412)   ; jne r1, 0x78563412
+
+  mov r0, 0x100
+  exit
+
+fail:
+  mov r0, r9
+  exit
+
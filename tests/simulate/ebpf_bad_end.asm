@@ -0,0 +1,13 @@
+;; The verifier has to reject a program that can run past its end, here
+;; through the second half of an lddw.
+
+.ebpf
+
+.include "ebpf.inc"
+
+  mov r0, 0
+  JUMP(0x05, 0, 0, load, 0)            ; ja load
+  exit
+load:
+  LDDW(0, 1, 2)
+
@@ -0,0 +1,9 @@
+;; The verifier has to reject calls to helpers that don't exist, such as
+;; 4 which is unused.
+
+.ebpf
+
+  mov r0, 0
+  call 4
+  exit
+
@@ -0,0 +1,12 @@
+;; The verifier has to reject a jump to the second half of an lddw.
+
+.ebpf
+
+.include "ebpf.inc"
+
+  mov r0, 0
+  JUMP(0x15, 1, 0, load + 1, 0)        ; jeq r1, 0
+load:
+  LDDW(0, 1, 2)
+  exit
+
@@ -0,0 +1,82 @@
+;; Jump checks for the eBPF simulator.  r9 holds the number of the check
+;; being run: a failing check exits with it in r0 and when every check
+;; passes the program exits with r0 = 0x100.
+
+.ebpf
+
+.include "ebpf.inc"
+
+  ;; 1: JMP32 compares only the low 32 bits.
+  mov r9, 1
+  LDDW(1, 5, 1)
+  JUMP(0x15, 1, 0, fail, 5)            ; jeq r1, 5
+  JUMP(0x56, 1, 0, fail, 5)            ; jne32 r1, 5
+
+  ;; 2: Signed JMP32 compares see bit 31 as the sign.
+  mov r9, 2
+  mov32 r1, 0x80000000
+  JUMP(0xc5, 1, 0, fail, 0)            ; jslt r1, 0
+  JUMP(0xd6, 1, 0, ok_2, 0)            ; jsle32 r1, 0
+  JUMP(0x05, 0, 0, fail, 0)            ; ja fail
+ok_2:
+
+  ;; 3: The immediate is sign extended for 64 bit compares and register
+  ;; compares use all of both registers.
+  mov r9, 3
+  mov32 r1, -1
+  JUMP(0x15, 1, 0, fail, -1)           ; jeq r1, -1
+  JUMP(0x56, 1, 0, fail, -1)           ; jne32 r1, -1
+  LDDW(2, 1, 0x80000000)
+  JUMP(0x2d, 1, 2, fail, 0)            ; jgt r1, r2
+  JUMP(0x6d, 1, 2, ok_3, 0)            ; jsgt r1, r2
+  JUMP(0x05, 0, 0, fail, 0)            ; ja fail
+ok_3:
+  JUMP(0xae, 2, 1, ok_3a, 0)           ; jlt32 r2, r1
+  JUMP(0x05, 0, 0, fail, 0)            ; ja fail
+ok_3a:
+
+  ;; 4: jset tests the bits of the sign extended immediate.
+  mov r9, 4
+  LDDW(1, 0, 1)
+  JUMP(0x46, 1, 0, fail, -1)           ; jset32 r1, -1
+  JUMP(0x45, 1, 0, ok_4, -1)           ; jset r1, -1
+  JUMP(0x05, 0, 0, fail, 0)            ; ja fail
+ok_4:
+
+  ;; 5: Backward jumps and the 32 bit offset of gotol.
+  mov r9, 5
+  mov r2, 0
+loop_5:
+  add r2, 1
+  JUMP(0xa5, 2, 0, loop_5, 3)          ; jlt r2, 3
+  JUMP(0x55, 2, 0, fail, 3)            ; jne r2, 3
+  .db 0x06, 0x00                       ; gotol ok_5
+  .dc16 0
+  .dc32 ok_5 - $ - 1
+  JUMP(0x05, 0, 0, fail, 0)            ; ja fail
+ok_5:
+
+  ;; 6: A call to a function in the program gets its own r6 to r9 back
+  ;; when it returns.
+  mov r9, 6
+  mov r6, 6
+  mov r1, 20
+  CALL_LOCAL(double)
+  JUMP(0x55, 0, 0, fail, 40)           ; jne r0, 40
+  JUMP(0x55, 6, 0, fail, 6)            ; jne r6, 6
+  JUMP(0x55, 9, 0, fail, 6)            ; jne r9, 6
+
+  mov r0, 0x100
+  exit
+
+fail:
+  mov r0, r9
+  exit
+
+double:
+  mov r6, r1
+  mov r9, 0
+  mov r0, r6
+  add r0, r6
+  exit
+
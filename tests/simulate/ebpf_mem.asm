@@ -0,0 +1,96 @@
+;; Memory checks for the eBPF simulator, run on ebpf_packet.bin.  r9
+;; holds the number of the check being run: a failing check exits with
+;; it in r0 and when every check passes the program exits with r0 = 0x100.
+
+.ebpf
+
+.include "ebpf.inc"
+
+  ;; 1: r2 is the packet length and loads through r1 are little endian.
+  mov r9, 1
+  mov r6, r1
+  JUMP(0x55, 2, 0, fail, 8)            ; jne r2, 8
+  INSN(0x61, 3, 1, 0, 0)               ; ldxw r3, [r1]
+  JUMP(0x55, 3, 0, fail, 0x04030201)   ; jne r3, 0x04030201
+  INSN(0x69, 3, 1, 6, 0)               ; ldxh r3, [r1+6]
+  JUMP(0x55, 3, 0, fail, 0x007f)       ; jne r3, 0x7f
+  INSN(0x91, 3, 1, 4, 0)               ; ldxsb r3, [r1+4]
+  JUMP(0x55, 3, 0, fail, -128)         ; jne r3, -128
+  INSN(0x89, 3, 1, 4, 0)               ; ldxsh r3, [r1+4]
+  JUMP(0x55, 3, 0, fail, -128)         ; jne r3, 0xff80
+
+  ;; 2: The old packet loads read in network order into r0.
+  mov r9, 2
+  INSN(0x28, 0, 0, 0, 0)               ; ldabsh 0
+  JUMP(0x55, 0, 0, fail, 0x0102)       ; jne r0, 0x0102
+  mov r7, 2
+  INSN(0x40, 0, 7, 0, 1)               ; ldindw r7 + 1
+  JUMP(0x55, 0, 0, fail, 0x0480ff7f)   ; jne r0, 0x0480ff7f
+  mov r1, r6
+
+  ;; 3: Stores to the stack and the packet.
+  mov r9, 3
+  INSN(0x7a, 10, 0, -8, -2)            ; stdw [r10-8], -2
+  INSN(0x79, 3, 10, -8, 0)             ; ldxdw r3, [r10-8]
+  JUMP(0x55, 3, 0, fail, -2)           ; jne r3, -2
+  INSN(0x71, 3, 10, -1, 0)             ; ldxb r3, [r10-1]
+  JUMP(0x55, 3, 0, fail, 0xff)         ; jne r3, 0xff
+  mov r3, 0x55
+  INSN(0x73, 1, 3, 7, 0)               ; stxb [r1+7], r3
+  INSN(0x30, 0, 0, 0, 7)               ; ldabsb 7
+  JUMP(0x55, 0, 0, fail, 0x55)         ; jne r0, 0x55
+
+  ;; 4: Atomic add, or, and, xor with and without fetch.
+  mov r9, 4
+  INSN(0x7a, 10, 0, -16, 100)          ; stdw [r10-16], 100
+  mov r3, 5
+  INSN(0xdb, 10, 3, -16, 0x00)         ; lock *(u64 *)(r10-16) += r3
+  JUMP(0x55, 3, 0, fail, 5)            ; jne r3, 5
+  INSN(0xdb, 10, 3, -16, 0x01)         ; r3 = atomic_fetch_add(r10-16, r3)
+  JUMP(0x55, 3, 0, fail, 105)          ; jne r3, 105
+  mov r3, 0x0f
+  INSN(0xdb, 10, 3, -16, 0x51)         ; r3 = atomic_fetch_and(r10-16, r3)
+  JUMP(0x55, 3, 0, fail, 110)          ; jne r3, 110
+  mov r3, 0x30
+  INSN(0xdb, 10, 3, -16, 0x40)         ; lock *(u64 *)(r10-16) |= r3
+  mov r3, 0x01
+  INSN(0xdb, 10, 3, -16, 0xa1)         ; r3 = atomic_fetch_xor(r10-16, r3)
+  JUMP(0x55, 3, 0, fail, 0x3e)         ; jne r3, 0x3e
+  INSN(0x79, 3, 10, -16, 0)            ; ldxdw r3, [r10-16]
+  JUMP(0x55, 3, 0, fail, 0x3f)         ; jne r3, 0x3f
+
+  ;; 5: 32 bit atomics only change the low word and zero extend what
+  ;; they fetch.
+  mov r9, 5
+  INSN(0x7a, 10, 0, -16, -1)           ; stdw [r10-16], -1
+  mov r3, 1
+  INSN(0xc3, 10, 3, -16, 0x01)         ; r3 = atomic_fetch_add32(r10-16, r3)
+  mov32 r4, -1
+  JUMP(0x5d, 3, 4, fail, 0)            ; jne r3, r4
+  INSN(0x79, 3, 10, -16, 0)            ; ldxdw r3, [r10-16]
+  LDDW(4, 0, 0xffffffff)
+  JUMP(0x5d, 3, 4, fail, 0)            ; jne r3, r4
+
+  ;; 6: xchg and cmpxchg.  cmpxchg always loads the old value into r0
+  ;; and only stores when r0 matched it.
+  mov r9, 6
+  INSN(0x7a, 10, 0, -16, 7)            ; stdw [r10-16], 7
+  mov r3, 9
+  INSN(0xdb, 10, 3, -16, 0xe1)         ; r3 = xchg(r10-16, r3)
+  JUMP(0x55, 3, 0, fail, 7)            ; jne r3, 7
+  mov r0, 1
+  mov r3, 11
+  INSN(0xdb, 10, 3, -16, 0xf1)         ; r0 = cmpxchg(r10-16, r0, r3)
+  JUMP(0x55, 0, 0, fail, 9)            ; jne r0, 9
+  INSN(0xdb, 10, 3, -16, 0xf1)         ; r0 = cmpxchg(r10-16, r0, r3)
+  JUMP(0x55, 0, 0, fail, 9)            ; jne r0, 9
+  INSN(0x79, 3, 10, -16, 0)            ; ldxdw r3, [r10-16]
+  JUMP(0x55, 3, 0, fail, 11)           ; jne r3, 11
+
+  mov r0, 0x100
+  exit
+
+fail:
+  mov r0, r9
+  exit
+
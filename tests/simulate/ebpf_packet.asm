@@ -0,0 +1,6 @@
+;; Packet for the eBPF tests.
+
+.ebpf
+
+  .db 0x01, 0x02, 0x03, 0x04, 0x80, 0xff, 0x7f, 0x00
+
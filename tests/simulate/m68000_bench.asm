@@ -0,0 +1,79 @@
+;; Benchmark for the 68000 simulator.  Build and run with "make bench"
+;; and naken_util reports the instructions run per second and the
+;; simulated clock in MHz.  Each pass copies a buffer with movem, sums
+;; it a byte at a time, multiplies and shifts and calls a function so
+;; most of the addressing modes, branches and the flags are used.  The
+;; program ends with the rts from the top level, which stops the
+;; simulator.
+
+.68000
+
+BUFFER_SIZE equ 64
+PASSES equ 20000
+
+.org 0x1000
+start:
+  movem.l d2-d7/a2-a3, -(sp)
+
+  ;; Fill the source buffer with 0, 1, 2, ...
+  lea (source).l, a0
+  moveq #0, d0
+fill:
+  move.l d0, (a0)+
+  addq.l #1, d0
+  cmpi.w #BUFFER_SIZE, d0
+  bne.s fill
+
+  move.w #PASSES - 1, d7
+  moveq #0, d6
+pass:
+  ;; Copy source to dest 4 longs at a time.
+  lea (source).l, a0
+  lea (dest).l, a1
+  moveq #(BUFFER_SIZE / 4) - 1, d5
+copy:
+  movem.l (a0)+, d0-d3
+  movem.l d0-d3, (a1)
+  lea (16,a1), a1
+  dbra d5, copy
+
+  ;; Add up the bytes of dest.
+  lea (dest).l, a2
+  move.w #(BUFFER_SIZE * 4) - 1, d5
+  moveq #0, d0
+  moveq #0, d1
+sum:
+  move.b (a2)+, d1
+  add.l d1, d0
+  dbra d5, sum
+
+  ;; Mix it into the running total.
+  move.w d0, d2
+  mulu.w #3, d2
+  lsr.l #1, d2
+  eor.l d2, d6
+
+  bsr.w checksum
+  add.l d0, d6
+
+  dbra d7, pass
+
+  move.l d6, d0
+  movem.l (sp)+, d2-d7/a2-a3
+  rts
+
+;; Returns the sum of the first 4 longs of dest in d0.
+checksum:
+  lea (dest).l, a3
+  moveq #3, d1
+  moveq #0, d0
+checksum_loop:
+  add.l (a3)+, d0
+  dbra d1, checksum_loop
+  rts
+
+.align 32
+source:
+  .resb BUFFER_SIZE * 4
+dest:
+  .resb BUFFER_SIZE * 4
@@ -0,0 +1,201 @@
+;; Checks for the 68000 simulator.  When every check passes the program
+;; returns with rts and the simulator prints "Function ended".  A failing
+;; check runs the illegal after it, which stops the simulator with an
+;; error at that address.
+
+.68000
+
+.org 0x1000
+start:
+  movem.l d2-d7, -(sp)
+
+  ;; 1: DIVS gives the quotient the sign of the operands and the remainder
+  ;; the sign of the dividend.
+test_1:
+  moveq #-7, d0
+  divs.w #2, d0
+  bpl.s fail_1
+  cmpi.l #0xfffffffd, d0
+  bne.s fail_1
+  moveq #7, d0
+  divs.w #-2, d0
+  cmpi.l #0x0001fffd, d0
+  bne.s fail_1
+  moveq #-7, d0
+  move.w #-2, d1
+  divs.w d1, d0
+  bmi.s fail_1
+  cmpi.l #0xffff0003, d0
+  bne.s fail_1
+  bra.s test_2
+fail_1:
+  illegal
+
+  ;; 2: A quotient that doesn't fit in 16 bits sets V and leaves the
+  ;; destination alone.  DIVU is unsigned.
+test_2:
+  move.l #0x40000, d0
+  divs.w #2, d0
+  bvc.s fail_2
+  cmpi.l #0x40000, d0
+  bne.s fail_2
+  move.l #100000, d0
+  divu.w #3, d0
+  bvs.s fail_2
+  cmpi.l #0x00018235, d0
+  bne.s fail_2
+  moveq #-1, d0
+  divs.w #-1, d0
+  cmpi.l #0x00000001, d0
+  bne.s fail_2
+  move.l #-32768, d0
+  divs.w #-1, d0
+  bvc.s fail_2
+  bra.s test_3
+fail_2:
+  illegal
+
+  ;; 3: Dividing by zero goes through vector 5.
+test_3:
+  move.l #div_zero, (0x14).w
+  moveq #0, d7
+  moveq #9, d0
+  moveq #0, d1
+  divu.w d1, d0
+  cmpi.l #1, d7
+  bne.s fail_3
+  cmpi.l #9, d0
+  bne.s fail_3
+  bra.s test_4
+fail_3:
+  illegal
+
+  ;; 4: ADD and SUB set V on signed overflow and X and C on carry.
+test_4:
+  move.b #0x7f, d0
+  addq.b #1, d0
+  bvc.s fail_4
+  bpl.s fail_4
+  bcs.s fail_4
+  move.b #0xff, d0
+  addq.b #1, d0
+  bcc.s fail_4
+  bne.s fail_4
+  moveq #1, d0
+  subq.l #2, d0
+  bcc.s fail_4
+  bpl.s fail_4
+  bvs.s fail_4
+  bra.s test_5
+fail_4:
+  illegal
+
+  ;; 5: ADDX and SUBX carry through X for 64 bit math and only clear Z.
+test_5:
+  moveq #-1, d0
+  moveq #0, d1
+  moveq #1, d2
+  moveq #0, d3
+  add.l d2, d0
+  addx.l d3, d1
+  cmpi.l #1, d1
+  bne.s fail_5
+  moveq #0, d0
+  moveq #0, d1
+  moveq #0, d3
+  add.l d3, d0
+  addx.l d3, d1
+  bne.s fail_5
+  moveq #0, d0
+  moveq #1, d1
+  sub.l d2, d0
+  subx.l d3, d1
+  tst.l d1
+  bne.s fail_5
+  addq.l #1, d0
+  bne.s fail_5
+  bra.s test_6
+fail_5:
+  illegal
+
+  ;; 6: MULS and MULU, EXT and SWAP.
+test_6:
+  moveq #-3, d0
+  muls.w #4, d0
+  bpl.s fail_6
+  moveq #-12, d1
+  cmp.l d1, d0
+  bne.s fail_6
+  move.w #0xffff, d0
+  mulu.w #2, d0
+  cmpi.l #0x1fffe, d0
+  bne.s fail_6
+  move.l #0x1234ff80, d0
+  ext.w d0
+  cmpi.l #0x1234ff80, d0
+  bne.s fail_6
+  move.l #0x00008000, d0
+  ext.l d0
+  cmpi.l #0xffff8000, d0
+  bne.s fail_6
+  swap d0
+  cmpi.l #0x8000ffff, d0
+  bne.s fail_6
+  bra.s test_7
+fail_6:
+  illegal
+
+  ;; 7: Shifts and rotates: ASL sets V when the sign changes, the last bit
+  ;; out goes to C and X and ROXL rotates through X.
+test_7:
+  move.b #0x40, d0
+  asl.b #1, d0
+  bvc.s fail_7
+  move.b #0x81, d0
+  asr.b #1, d0
+  bcc.s fail_7
+  cmpi.b #0xc0, d0
+  bne.s fail_7
+  move.b #0x01, d0
+  lsr.b #1, d0
+  bne.s fail_7
+  moveq #0, d1
+  roxl.b #1, d1
+  cmpi.b #1, d1
+  bne.s fail_7
+  bra.s test_8
+fail_7:
+  illegal
+
+  ;; 8: Scc on signed and unsigned compares, and ABCD.
+test_8:
+  moveq #-1, d0
+  cmpi.l #1, d0
+  slt d1
+  shi d2
+  sgt d3
+  cmpi.b #0xff, d1
+  bne.s fail_8
+  cmpi.b #0xff, d2
+  bne.s fail_8
+  tst.b d3
+  bne.s fail_8
+  move.b #0x45, d0
+  move.b #0x55, d1
+  andi.b #0xef, ccr
+  abcd d1, d0
+  bcc.s fail_8
+  cmpi.b #0x00, d0
+  bne.s fail_8
+  bra.s done
+fail_8:
+  illegal
+
+done:
+  movem.l (sp)+, d2-d7
+  rts
+
+div_zero:
+  moveq #1, d7
+  rte
+
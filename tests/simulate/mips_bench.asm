@@ -0,0 +1,87 @@
+;; Benchmark for the MIPS simulator.  Build and run with "make bench"
+;; and naken_util reports the instructions run per second and the
+;; simulated clock in MHz.  Each pass copies a buffer, sums it, does
+;; some multiply / divide and bit operations and calls a function so
+;; loads, stores, branches with delay slots and HI / LO are all used.
+;; The program ends with jr $ra, which stops the simulator.
+
+.pic32
+
+BUFFER_SIZE equ 64
+PASSES equ 20000
+
+source equ 0x2000
+dest equ 0x2100
+total equ 0x2200
+
+.org 0x1000
+start:
+  move $s7, $ra
+
+  ;; Fill the source buffer with 0, 1, 2, ...
+  li $t0, source
+  li $t1, 0
+fill:
+  sw $t1, 0($t0)
+  addiu $t1, $t1, 1
+  slti $t2, $t1, BUFFER_SIZE
+  bne $t2, $0, fill
+  addiu $t0, $t0, 4
+
+  li $s0, PASSES
+  li $s1, 0
+pass:
+  ;; Copy source to dest a word at a time.
+  li $t0, source
+  li $t1, dest
+  li $t2, BUFFER_SIZE
+copy:
+  lw $t3, 0($t0)
+  addiu $t0, $t0, 4
+  sw $t3, 0($t1)
+  addiu $t2, $t2, -1
+  bne $t2, $0, copy
+  addiu $t1, $t1, 4
+
+  ;; Sum the bytes of dest.
+  li $t0, dest
+  li $t2, BUFFER_SIZE * 4
+  li $t4, 0
+sum:
+  lbu $t3, 0($t0)
+  addiu $t2, $t2, -1
+  addu $t4, $t4, $t3
+  bne $t2, $0, sum
+  addiu $t0, $t0, 1
+
+  jal mix
+  move $a0, $t4
+  addu $s1, $s1, $v0
+
+  addiu $s0, $s0, -1
+  bne $s0, $0, pass
+  nop
+
+  li $t0, total
+  sw $s1, 0($t0)
+
+  jr $s7
+  nop
+
+;; Shuffle the bits of $a0 around with shifts, HI / LO and the MIPS32
+;; bit field instructions.
+mix:
+  li $t5, 0x5a5a
+  xor $v0, $a0, $t5
+  sll $v0, $v0, 3
+  mult $v0, $t5
+  mflo $v0
+  mfhi $t6
+  li $t7, 7
+  divu $v0, $t7
+  mfhi $t6
+  ext $t8, $v0, 4, 8
+  ins $v0, $t6, 0, 4
+  rotr $v0, $v0, 5
+  jr $ra
+  addu $v0, $v0, $t8
@@ -0,0 +1,234 @@
+;; Checks for the MIPS simulator's FPU.  When every check passes the
+;; program returns to $ra and the simulator prints "Function ended".  A
+;; failing check runs the break after it, so the simulator halts at that
+;; address.
+;;
+;; The FPU instructions naken_asm doesn't assemble yet are written with
+;; .dc32 and the instruction they encode in the comment.
+
+.mips32
+
+.org 0x1000
+start:
+  ;; 1: cvt.w.s rounds the way FCSR says: nearest even, toward zero, up
+  ;; and down.
+test_1:
+  li $t0, 0x40200000                   ; 2.5
+  mtc1 $t0, $f0
+  li $t0, 0xc0200000                   ; -2.5
+  mtc1 $t0, $f2
+  ctc1 $0, $f31
+  cvt.w.s $f4, $f0
+  mfc1 $t1, $f4
+  li $t2, 2
+  bne $t1, $t2, fail_1
+  nop
+  li $t0, 1
+  ctc1 $t0, $f31
+  cvt.w.s $f4, $f2
+  mfc1 $t1, $f4
+  li $t2, -2
+  bne $t1, $t2, fail_1
+  nop
+  li $t0, 2
+  ctc1 $t0, $f31
+  cvt.w.s $f4, $f0
+  mfc1 $t1, $f4
+  li $t2, 3
+  bne $t1, $t2, fail_1
+  nop
+  li $t0, 3
+  ctc1 $t0, $f31
+  cvt.w.s $f4, $f2
+  mfc1 $t1, $f4
+  li $t2, -3
+  bne $t1, $t2, fail_1
+  nop
+  ctc1 $0, $f31
+  li $t0, -7
+  mtc1 $t0, $f4
+  cvt.s.w $f6, $f4
+  mfc1 $t1, $f6
+  li $t2, 0xc0e00000                   ; -7.0
+  bne $t1, $t2, fail_1
+  nop
+  b test_2
+  nop
+fail_1:
+  break
+
+  ;; 2: round, trunc, ceil and floor ignore FCSR, and values that don't
+  ;; fit (and NaN) give 0x7fffffff.
+test_2:
+  li $t0, 3
+  ctc1 $t0, $f31
+  li $t0, 0xbfc00000                   ; -1.5
+  mtc1 $t0, $f0
+  .dc32 0x4600010c          ; round.w.s $f4, $f0
+  mfc1 $t1, $f4
+  li $t2, -2
+  bne $t1, $t2, fail_2
+  nop
+  .dc32 0x4600010d          ; trunc.w.s $f4, $f0
+  mfc1 $t1, $f4
+  li $t2, -1
+  bne $t1, $t2, fail_2
+  nop
+  .dc32 0x4600010e          ; ceil.w.s $f4, $f0
+  mfc1 $t1, $f4
+  bne $t1, $t2, fail_2
+  nop
+  .dc32 0x4600010f          ; floor.w.s $f4, $f0
+  mfc1 $t1, $f4
+  li $t2, -2
+  bne $t1, $t2, fail_2
+  nop
+  li $t0, 0x4f32d05e                   ; 3e9
+  mtc1 $t0, $f0
+  .dc32 0x4600010d          ; trunc.w.s $f4, $f0
+  mfc1 $t1, $f4
+  li $t2, 0x7fffffff
+  bne $t1, $t2, fail_2
+  nop
+  li $t0, 0x7fc00000                   ; NaN
+  mtc1 $t0, $f0
+  cvt.w.s $f4, $f0
+  mfc1 $t1, $f4
+  bne $t1, $t2, fail_2
+  nop
+  ctc1 $0, $f31
+  b test_3
+  nop
+fail_2:
+  break
+
+  ;; 3: Conversions between single, double and word.
+test_3:
+  li $t0, 7
+  mtc1 $t0, $f0
+  .dc32 0x468000a1          ; cvt.d.w $f2, $f0
+  mfc1 $t1, $f3
+  li $t2, 0x401c0000                   ; 7.0 high word
+  bne $t1, $t2, fail_3
+  nop
+  mfc1 $t1, $f2
+  bne $t1, $0, fail_3
+  nop
+  li $t0, 0x40200000                   ; 2.5
+  mtc1 $t0, $f0
+  .dc32 0x46000121          ; cvt.d.s $f4, $f0
+  .dc32 0x46222180          ; add.d $f6, $f4, $f2
+  .dc32 0x46203220          ; cvt.s.d $f8, $f6
+  mfc1 $t1, $f8
+  li $t2, 0x41180000                   ; 9.5
+  bne $t1, $t2, fail_3
+  nop
+  li $t0, 0x55555555                   ; 1 / 3 rounds up to a float
+  mtc1 $t0, $f10
+  li $t0, 0x3fd55555
+  mtc1 $t0, $f11
+  .dc32 0x46205220          ; cvt.s.d $f8, $f10
+  mfc1 $t1, $f8
+  li $t2, 0x3eaaaaab
+  bne $t1, $t2, fail_3
+  nop
+  .dc32 0x46203187          ; neg.d $f6, $f6
+  .dc32 0x4620320d          ; trunc.w.d $f8, $f6
+  mfc1 $t1, $f8
+  li $t2, -9
+  bne $t1, $t2, fail_3
+  nop
+  .dc32 0x46203224          ; cvt.w.d $f8, $f6
+  mfc1 $t1, $f8
+  li $t2, -10
+  bne $t1, $t2, fail_3
+  nop
+  b test_4
+  nop
+fail_3:
+  break
+
+  ;; 4: Single compares, including -0.0 == 0.0 and NaN, which is
+  ;; unordered so only the conditions that include "un" are true.
+test_4:
+  li $t0, 0x3f800000                   ; 1.0
+  mtc1 $t0, $f0
+  li $t0, 0x40000000                   ; 2.0
+  mtc1 $t0, $f2
+  c.lt.s $f0, $f2
+  bc1f fail_4
+  nop
+  c.lt.s $f2, $f0
+  bc1t fail_4
+  nop
+  c.le.s $f0, $f0
+  bc1f fail_4
+  nop
+  c.eq.s $f0, $f2
+  bc1t fail_4
+  nop
+  mtc1 $0, $f4
+  li $t0, 0x80000000                   ; -0.0
+  mtc1 $t0, $f6
+  c.eq.s $f4, $f6
+  bc1f fail_4
+  nop
+  li $t0, 0x7fc00000                   ; NaN
+  mtc1 $t0, $f8
+  c.eq.s $f8, $f8
+  bc1t fail_4
+  nop
+  .dc32 0x46004034          ; c.olt.s $f8, $f0
+  bc1t fail_4
+  nop
+  .dc32 0x46004031          ; c.un.s $f8, $f0
+  bc1f fail_4
+  nop
+  .dc32 0x46004035          ; c.ult.s $f8, $f0
+  bc1f fail_4
+  nop
+  .dc32 0x46080033          ; c.ueq.s $f0, $f8
+  bc1f fail_4
+  nop
+  .dc32 0x46080036          ; c.ole.s $f0, $f8
+  bc1t fail_4
+  nop
+  b test_5
+  nop
+fail_4:
+  break
+
+  ;; 5: Double compares into condition codes other than 0, and branches
+  ;; on them running their delay slot.
+test_5:
+  li $t0, 0x3ff00000                   ; 1.0
+  mtc1 $t0, $f1
+  mtc1 $0, $f0
+  li $t0, 0x40000000                   ; 2.0
+  mtc1 $t0, $f3
+  mtc1 $0, $f2
+  c.eq.s $f0, $f0
+  .dc32 0x4620133c          ; c.lt.d 3, $f2, $f0
+  bc1f fail_5
+  nop
+  .dc32 0x450d0000 | (((fail_5 - $ - 4) >> 2) & 0xffff)   ; bc1t 3, fail_5
+  nop
+  .dc32 0x4622053e          ; c.le.d 5, $f0, $f2
+  .dc32 0x45140000 | (((fail_5 - $ - 4) >> 2) & 0xffff)   ; bc1f 5, fail_5
+  nop
+  .dc32 0x450c0000 | (((ok_5 - $ - 4) >> 2) & 0xffff)   ; bc1f 3, ok_5
+  li $t3, 5
+  break
+ok_5:
+  li $t2, 5
+  bne $t3, $t2, fail_5
+  nop
+  b done
+  nop
+fail_5:
+  break
+
+done:
+  jr $ra
+  nop
+
@@ -0,0 +1,75 @@
+;; Benchmark for the MSP430 simulator.  Build and run with "make bench"
+;; and naken_util reports the instructions run per second and the
+;; simulated clock in MHz.  Each pass copies a buffer, sums it, does some
+;; byte and bit operations and calls a function so most of the addressing
+;; modes are used.  The program ends with ret, which stops the simulator.
+
+.msp430
+
+BUFFER_SIZE equ 64
+PASSES equ 20000
+
+source equ 0x0200
+dest equ 0x0280
+total equ 0x0300
+
+.org 0xc000
+start:
+  ;; Fill the source buffer with 0, 1, 2, ...
+  mov.w #source, r4
+  mov.w #0, r5
+fill:
+  mov.b r5, 0(r4)
+  inc.w r4
+  inc.w r5
+  cmp.w #BUFFER_SIZE, r5
+  jne fill
+
+  mov.w #PASSES, r15
+  mov.w #0, &total
+pass:
+  ;; Copy source to dest a word at a time.
+  mov.w #source, r4
+  mov.w #dest, r5
+  mov.w #BUFFER_SIZE / 2, r6
+copy:
+  mov.w @r4+, 0(r5)
+  incd.w r5
+  dec.w r6
+  jnz copy
+
+  ;; Sum the bytes of dest.
+  mov.w #dest, r4
+  mov.w #BUFFER_SIZE, r6
+  clr.w r7
+sum:
+  mov.b @r4+, r8
+  add.w r8, r7
+  dec.w r6
+  jnz sum
+
+  call #mix
+  add.w r7, &total
+
+  dec.w r15
+  jnz pass
+
+  ret
+
+;; Shuffle bits of r7 around using the stack, absolute and indexed
+;; addressing.
+mix:
+  push r7
+  xor.w #0x5a5a, r7
+  rla.w r7
+  bic.b #0x0f, r7
+  bis.w #0x0100, r7
+  mov.w r7, &total + 2
+  and.w 0(sp), r7
+  swpb r7
+  pop r8
+  add.w r8, r7
+  ret
+
+.org 0xfffe
+  dw start
@@ -0,0 +1,230 @@
+;; Checks for the RISC-V simulator.  When every check passes the program
+;; returns to ra and the simulator prints "Function ended".  A failing
+;; check runs the sbreak after it, so the simulator halts at that address.
+;;
+;; naken_asm doesn't assemble compressed instructions yet so they are
+;; written with .dc16 and the instruction they encode in the comment.
+
+.riscv
+
+.org 0x1000
+start:
+  lui sp, 0x8
+  addi sp, sp, -16
+  sw ra, 12(sp)
+
+  ;; 1: DIV, DIVU, REM and REMU with a divisor of 0.
+test_1:
+  addi a0, zero, 7
+  div a1, a0, zero
+  addi t0, zero, -1
+  bne a1, t0, fail_1
+  divu a1, a0, zero
+  bne a1, t0, fail_1
+  rem a1, a0, zero
+  bne a1, a0, fail_1
+  addi a0, zero, -7
+  remu a1, a0, zero
+  bne a1, a0, fail_1
+  jal zero, test_2
+fail_1:
+  sbreak
+
+  ;; 2: 0x80000000 / -1 overflows: the quotient is the dividend and the
+  ;; remainder is 0.
+test_2:
+  lui a0, 0x80000
+  addi t0, zero, -1
+  div a1, a0, t0
+  bne a1, a0, fail_2
+  rem a1, a0, t0
+  bne a1, zero, fail_2
+  divu a1, a0, t0
+  bne a1, zero, fail_2
+  remu a1, a0, t0
+  bne a1, a0, fail_2
+  jal zero, test_3
+fail_2:
+  sbreak
+
+  ;; 3: Signed division rounds toward zero and the remainder takes the
+  ;; sign of the dividend.
+test_3:
+  addi a0, zero, -7
+  addi a2, zero, 2
+  div a1, a0, a2
+  addi t0, zero, -3
+  bne a1, t0, fail_3
+  rem a1, a0, a2
+  addi t0, zero, -1
+  bne a1, t0, fail_3
+  addi a0, zero, 7
+  addi a2, zero, -2
+  div a1, a0, a2
+  addi t0, zero, -3
+  bne a1, t0, fail_3
+  rem a1, a0, a2
+  addi t0, zero, 1
+  bne a1, t0, fail_3
+  addi a0, zero, -1
+  addi a2, zero, 2
+  mulh a1, a0, a2
+  bne a1, a0, fail_3
+  mulhu a1, a0, a2
+  bne a1, t0, fail_3
+  mulhsu a1, a0, a2
+  bne a1, a0, fail_3
+  jal zero, test_4
+fail_3:
+  sbreak
+
+  ;; 4: Compressed ALU instructions.
+test_4:
+  .dc16 0x556d    ; c.li a0, -5
+  .dc16 0x050d    ; c.addi a0, 3
+  addi t0, zero, -2
+  bne a0, t0, fail_4
+  .dc16 0x85aa    ; c.mv a1, a0
+  .dc16 0x95aa    ; c.add a1, a0
+  .dc16 0x0592    ; c.slli a1, 4
+  addi t0, zero, -64
+  bne a1, t0, fail_4
+  .dc16 0x8589    ; c.srai a1, 2
+  addi t0, zero, -16
+  bne a1, t0, fail_4
+  .dc16 0x81f1    ; c.srli a1, 28
+  addi t0, zero, 15
+  bne a1, t0, fail_4
+  .dc16 0x4531    ; c.li a0, 0x0c
+  .dc16 0x8d6d    ; c.and a0, a1
+  .dc16 0x42b1    ; c.li t0, 0x0c
+  bne a0, t0, fail_4
+  .dc16 0x4541    ; c.li a0, 0x10
+  .dc16 0x8d4d    ; c.or a0, a1
+  .dc16 0x42fd    ; c.li t0, 0x1f
+  bne a0, t0, fail_4
+  .dc16 0x8d2d    ; c.xor a0, a1
+  .dc16 0x42c1    ; c.li t0, 0x10
+  bne a0, t0, fail_4
+  .dc16 0x8d0d    ; c.sub a0, a1
+  .dc16 0x4285    ; c.li t0, 1
+  bne a0, t0, fail_4
+  .dc16 0x557d    ; c.li a0, -1
+  .dc16 0x9941    ; c.andi a0, -16
+  addi t0, zero, -16
+  bne a0, t0, fail_4
+  .dc16 0x767d    ; c.lui a2, -1
+  lui t0, 0xfffff
+  bne a2, t0, fail_4
+  .dc16 0x6605    ; c.lui a2, 1
+  lui t0, 1
+  bne a2, t0, fail_4
+  jal zero, test_5
+fail_4:
+  sbreak
+
+  ;; 5: Compressed loads and stores, relative to sp and to a register.
+test_5:
+  addi s1, sp, 0
+  .dc16 0x713d    ; c.addi16sp sp, -32
+  addi t0, s1, -32
+  bne sp, t0, fail_5
+  .dc16 0x4555    ; c.li a0, 21
+  .dc16 0xc42a    ; c.swsp a0, 8(sp)
+  .dc16 0x46a2    ; c.lwsp a3, 8(sp)
+  bne a3, a0, fail_5
+  .dc16 0x0038    ; c.addi4spn a4, sp, 8
+  addi t0, sp, 8
+  bne a4, t0, fail_5
+  .dc16 0x431c    ; c.lw a5, 0(a4)
+  bne a5, a0, fail_5
+  .dc16 0x555d    ; c.li a0, -9
+  .dc16 0xcb48    ; c.sw a0, 20(a4)
+  lw a5, 28(sp)
+  bne a5, a0, fail_5
+  .dc16 0x6105    ; c.addi16sp sp, 32
+  bne sp, s1, fail_5
+  jal zero, test_6
+fail_5:
+  sbreak
+
+  ;; 6: Compressed branches and jumps.  Each c.ebreak is skipped when the
+  ;; one before it works.
+test_6:
+  .dc16 0x4501    ; c.li a0, 0
+  .dc16 0xc111    ; c.beqz a0, 4
+  .dc16 0x9002    ; c.ebreak
+  .dc16 0x4505    ; c.li a0, 1
+  .dc16 0xc111    ; c.beqz a0, 4
+  .dc16 0xa011    ; c.j 4
+  .dc16 0x9002    ; c.ebreak
+  .dc16 0xe111    ; c.bnez a0, 4
+  .dc16 0x9002    ; c.ebreak
+  .dc16 0x458d    ; c.li a1, 3
+  .dc16 0x4601    ; c.li a2, 0
+  .dc16 0x0609    ; c.addi a2, 2
+  .dc16 0x15fd    ; c.addi a1, -1
+  .dc16 0xfdf5    ; c.bnez a1, -4
+  .dc16 0x4299    ; c.li t0, 6
+  bne a2, t0, fail_6
+  .dc16 0x2019    ; c.jal 6
+  .dc16 0xa019    ; c.j 6
+  .dc16 0x9002    ; c.ebreak
+  .dc16 0x8082    ; c.jr ra
+  auipc a2, 0
+  .dc16 0x0631    ; c.addi a2, 12
+  .dc16 0x9602    ; c.jalr a2
+  .dc16 0xa019    ; c.j 6
+  .dc16 0x9002    ; c.ebreak
+  .dc16 0x8082    ; c.jr ra
+  .dc16 0x0001    ; c.nop
+  jal zero, test_7
+fail_6:
+  sbreak
+
+  ;; 7: Stores over code that already ran replace it, including the next
+  ;; instruction in the same straight line of code.
+test_7:
+  jal ra, patch_me
+  addi t0, zero, 1
+  bne a0, t0, fail_7
+  lui t0, 0x00200
+  addi t0, t0, 0x513
+patch_1:
+  auipc t1, 0
+  sw t0, patch_me - patch_1(t1)
+  jal ra, patch_me
+  addi t0, zero, 2
+  bne a0, t0, fail_7
+  lui t0, 0x00300
+  addi t0, t0, 0x513
+  addi a0, zero, 0
+patch_2:
+  auipc t1, 0
+  sw t0, patch_3 - patch_2(t1)
+patch_3:
+  addi a0, zero, 1
+  addi t0, zero, 3
+  bne a0, t0, fail_7
+  lui t0, 0x4
+  addi t0, t0, 0x515
+patch_4:
+  auipc t1, 0
+  sh t0, patch_5 - patch_4(t1)
+patch_5:
+  .dc16 0x4511    ; c.li a0, 4
+  .dc16 0x0001    ; c.nop
+  addi t0, zero, 5
+  bne a0, t0, fail_7
+  jal zero, done
+fail_7:
+  sbreak
+
+done:
+  lw ra, 12(sp)
+  addi sp, sp, 16
+  jalr zero, ra, 0
+
+patch_me:
+  addi a0, zero, 1
+  jalr zero, ra, 0
@@ -0,0 +1,74 @@
+#!/usr/bin/env sh
+
+# Each test gives the exit code and a line naken_util has to print.  The
+# CPU test programs return from their top level function when every check
+# passes, so naken_util exits 0 and prints "Function ended".  A failing
+# check either stops the simulator some other way or exits with the
+# check's number through -break_io.  The eBPF programs exit with r0 set
+# to 0x100 when every check passes or are rejected before they run.
+
+NAKEN_UTIL=../../naken_util
+
+errors=0
+
+run_test()
+{
+  name=$1
+  code=$2
+  expect=$3
+  shift 3
+
+  output=`${NAKEN_UTIL} "$@" 2>&1 < /dev/null`
+  ret=$?
+
+  if [ ${ret} -eq ${code} ] && echo "${output}" | grep -qF "${expect}"
+  then
+    printf "%-24s \033[32mPASS\033[0m\n" "${name}"
+  else
+    printf "%-24s \033[31mFAIL\033[0m (exit %d)\n" "${name}" ${ret}
+    echo "${output}" | sed -n '/^Running/,/^$/p'
+    errors=`expr ${errors} + 1`
+  fi
+}
+
+run_test "6502" 0 "Function ended" -6502 -break_io 0x8000 -set_pc 0x1000 \
+  -max_cycles 100000 -run -quiet 6502_test.hex
+run_test "6502 (step)" 0 "Function ended" -6502 -break_io 0x8000 \
+  -set_pc 0x1000 -max_cycles 100000 -run 6502_test.hex
+run_test "RISC-V" 0 "Function ended" -riscv -max_cycles 100000 \
+  -run -quiet riscv_test.hex
+run_test "RISC-V (step)" 0 "Function ended" -riscv -max_cycles 100000 \
+  -run riscv_test.hex
+run_test "ARM" 0 "Function ended" -arm -max_cycles 100000 \
+  -run -quiet arm_test.hex
+run_test "ARM (step)" 0 "Function ended" -arm -max_cycles 100000 \
+  -run arm_test.hex
+run_test "68000" 0 "Function ended" -68000 -max_cycles 100000 \
+  -run -quiet m68000_test.hex
+run_test "68000 (step)" 0 "Function ended" -68000 -max_cycles 100000 \
+  -run m68000_test.hex
+run_test "MIPS" 0 "Function ended" -mips32 -max_cycles 100000 \
+  -run -quiet mips_test.hex
+run_test "MIPS (step)" 0 "Function ended" -mips32 -max_cycles 100000 \
+  -run mips_test.hex
+
+for test in alu jmp32 mem
+do
+  run_test "eBPF ${test}" 0 "Program exited with r0=0x100." -ebpf \
+    -packet ebpf_packet.bin -max_cycles 100000 -run -quiet ebpf_${test}.hex
+done
+
+run_test "eBPF bad lddw jump" 1 \
+  "Error: Jump into the middle of lddw at 0x0001" \
+  -ebpf -packet ebpf_packet.bin -run -quiet ebpf_bad_lddw_jump.hex
+run_test "eBPF bad end" 1 \
+  "Error: Program can run past its last instruction at 0x0004" \
+  -ebpf -packet ebpf_packet.bin -run -quiet ebpf_bad_end.hex
+run_test "eBPF bad helper" 1 "Error: Unknown helper at 0x0001" \
+  -ebpf -packet ebpf_packet.bin -run -quiet ebpf_bad_helper.hex
+
+if [ ${errors} -ne 0 ]
+then
+  echo "${errors} simulate test(s) failed."
+  exit 1
+fi
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "common/assembler.h"
+#include "common/macros.h"
+#include "common/tokens.h"
+
+static double get_time()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+
+  return (double)tv.tv_sec + ((double)tv.tv_usec / 1000000.0);
+}
+
+static char *build_source(int define_count, int line_count, int *token_count)
+{
+  int size = (define_count + line_count) * 64;
+  char *source = (char *)malloc(size);
+  int ptr = 0;
+  int n;
+
+  *token_count = 0;
+
+  // .define REG_n n
+  for (n = 0; n < define_count; n++)
+  {
+    ptr += snprintf(source + ptr, size - ptr, ".define REG_%d %d\n", n, n);
+    *token_count += 5;
+  }
+
+  // .dw REG_a, REG_b, REG_c
+  for (n = 0; n < line_count; n++)
+  {
+    ptr += snprintf(source + ptr, size - ptr, ".dw REG_%d, REG_%d, REG_%d\n",
+      (int)(((int64_t)n * 7919) % define_count),
+      (int)(((int64_t)n * 104729) % define_count),
+      define_count - 1 - (n % define_count));
+    *token_count += 8;
+  }
+
+  return source;
+}
+
+static int bench(int define_count, int line_count)
+{
+  AsmContext asm_context;
+  int token_count;
+  int errors = 0;
+
+  char *source = build_source(define_count, line_count, &token_count);
+
+  tokens_open_buffer(&asm_context, source);
+  tokens_reset(&asm_context);
+
+  asm_context.quiet_output = 1;
+
+  double start = get_time();
+
+  if (assemble(&asm_context) != 0) { errors++; }
+
+  double elapsed = get_time() - start;
+
+  // First line is .dw REG_0, REG_0, REG_<define_count - 1>
+  if (asm_context.memory_read(0) != 0 ||
+      asm_context.memory_read(4) != ((define_count - 1) & 0xff))
+  {
+    printf("Error: unexpected output %s:%d\n", __FILE__, __LINE__);
+    errors++;
+  }
+
+  printf("%6d defines, %6d lines: %.3fs, %12.0f tokens/sec\n",
+    define_count,
+    line_count,
+    elapsed,
+    (double)token_count / elapsed);
+
+  tokens_close(&asm_context);
+
+  free(source);
+
+  return errors;
+}
+
+int main(int argc, char *argv[])
+{
+  int errors = 0;
+
+  errors += bench(1000, 100000);
+  errors += bench(50000, 100000);
+
+  if (errors != 0)
+  {
+    printf("Total errors: %d\n", errors);
+    return -1;
+  }
+
+  return 0;
+}
+
@@ -51,6 +51,50 @@ int test_Memory()
   return errors;
 }
 
+int test_Memory_sparse()
+{
+  Memory memory;
+  int errors = 0;
+
+  // Pages far apart in the address space.
+  memory.write8(0x00000000, 0x11);
+  memory.write8(0x00100000, 0x22);
+  memory.write8(0xfffffff0, 0x33);
+  memory.write8(0xffffffff, 0x44);
+
+  if (memory.read8(0x00000000) != 0x11) { errors++; }
+  if (memory.read8(0x00100000) != 0x22) { errors++; }
+  if (memory.read8(0xfffffff0) != 0x33) { errors++; }
+  if (memory.read8(0xffffffff) != 0x44) { errors++; }
+  if (memory.read8(0x80000000) != 0x00) { errors++; }
+
+  if (memory.in_use(0x00100000 + PAGE_SIZE - 1) != true) { errors++; }
+  if (memory.in_use(0x00100000 + PAGE_SIZE) != false) { errors++; }
+
+  if (memory.low_address != 0x00000000) { errors++; }
+  if (memory.high_address != 0xffffffff) { errors++; }
+
+  if (memory.get_page_address_min(0xfffffff0) != 0xfffffff0) { errors++; }
+  if (memory.get_page_address_max(0xfffffff0) != 0xffffffff) { errors++; }
+
+  // clear() keeps the pages but forgets what was written to them.
+  memory.write(0x00100010, 0x55, 10);
+  memory.clear();
+
+  if (memory.read8(0x00100010) != 0x00) { errors++; }
+  if (memory.read_debug(0x00100010) != DL_EMPTY) { errors++; }
+  if (memory.in_use(0x00100000) != true) { errors++; }
+  if (memory.low_address != 0xffffffff) { errors++; }
+  if (memory.high_address != 0) { errors++; }
+
+  if (errors != 0)
+  {
+    fprintf(stderr, "Error: sparse memory %s:%d\n", __FILE__, __LINE__);
+  }
+
+  return errors;
+}
+
 int test_MemoryPage()
 {
   MemoryPage memory_page(PAGE_SIZE + 100);
@@ -81,12 +125,69 @@ int test_MemoryPage()
   return errors;
 }
 
+int test_MemoryPage_debug()
+{
+  MemoryPage *memory_page = new MemoryPage(0);
+  int *expected = (int *)malloc(PAGE_SIZE * sizeof(int));
+  uint32_t n;
+  int errors = 0;
+
+  for (n = 0; n < PAGE_SIZE; n++) { expected[n] = DL_EMPTY; }
+
+  // Pass 1 style sequential writes, then pass 2 style overwrites with
+  // alternating values and some random blocks.
+  for (n = 0x100; n < 0x2000; n++)
+  {
+    memory_page->set_debug(n, DL_NO_CG);
+    expected[n] = DL_NO_CG;
+  }
+
+  for (n = 0x100; n < 0x2000; n += 2)
+  {
+    memory_page->set_debug(n, n);
+    expected[n] = n;
+  }
+
+  srand(1234);
+
+  for (int i = 0; i < 20000; i++)
+  {
+    uint32_t offset = rand() % PAGE_SIZE;
+    uint32_t len = (rand() % 64) + 1;
+    int value = (rand() % 5) - 3;
+
+    if (offset + len > PAGE_SIZE) { len = PAGE_SIZE - offset; }
+
+    memory_page->set_debug_block(offset, value, len);
+
+    for (n = 0; n < len; n++) { expected[offset + n] = value; }
+  }
+
+  for (n = 0; n < PAGE_SIZE; n++)
+  {
+    if (memory_page->get_debug(n) != expected[n])
+    {
+      fprintf(stderr, "Error: debug line 0x%x %d != %d %s:%d\n",
+        n, memory_page->get_debug(n), expected[n], __FILE__, __LINE__);
+      errors += 1;
+      break;
+    }
+  }
+
+  free(expected);
+  delete memory_page;
+
+  return errors;
+}
+
 int main(int argc, char *argv[])
 {
   int errors = 0;
 
   errors += test_Memory();
+  errors += test_Memory_sparse();
   errors += test_MemoryPage();
+  errors += test_MemoryPage_debug();
 
   printf("Total errors: %d\n", errors);
   printf("%s\n", errors == 0 ? "PASSED." : "FAILED.");
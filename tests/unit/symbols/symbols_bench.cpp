@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "common/Symbols.h"
+
+static double get_time()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+
+  return (double)tv.tv_sec + ((double)tv.tv_usec / 1000000.0);
+}
+
+static int bench(int count)
+{
+  Symbols symbols;
+  char name[64];
+  uint32_t address;
+  int errors = 0;
+  int n;
+
+  symbols_init(&symbols);
+
+  double start = get_time();
+
+  for (n = 0; n < count; n++)
+  {
+    snprintf(name, sizeof(name), "label_%d", n);
+
+    if (symbols_append(&symbols, name, n) != 0) { errors++; }
+  }
+
+  double append_time = get_time() - start;
+
+  // Do at least 1M lookups so small tables still get a stable number.
+  const int lookups = count < 1000000 ? 1000000 : count;
+
+  start = get_time();
+
+  for (n = 0; n < lookups; n++)
+  {
+    int index = (int)(((int64_t)n * 7919) % count);
+
+    snprintf(name, sizeof(name), "label_%d", index);
+
+    if (symbols_lookup(&symbols, name, &address) != 0 ||
+        address != (uint32_t)index)
+    {
+      errors++;
+    }
+  }
+
+  double lookup_time = get_time() - start;
+
+  printf("%8d symbols: append %.3fs, %12.0f lookups/sec\n",
+    count,
+    append_time,
+    (double)lookups / lookup_time);
+
+  if (symbols_count(&symbols) != count) { errors++; }
+
+  symbols_free(&symbols);
+
+  return errors;
+}
+
+int main(int argc, char *argv[])
+{
+  int errors = 0;
+
+  errors += bench(1000);
+  errors += bench(100000);
+  errors += bench(1000000);
+
+  printf("Total errors: %d\n", errors);
+
+  if (errors != 0) { return -1; }
+
+  return 0;
+}
+
@@ -128,6 +128,20 @@ int main(int argc, char *argv[])
   append(&symbols, "test4", 50);
   check_symbols_count(&symbols, 8);
 
+  // Locked symbols only move when relaxing.
+  check_lookup(&symbols, "test4", 100, 0);
+  symbols.relax = 1;
+  append(&symbols, "test4", 50);
+  append(&symbols, "test1", 100);
+  check_lookup(&symbols, "test4", 50, 0);
+  check_symbols_count(&symbols, 8);
+
+  if (symbols.moved != 1)
+  {
+    printf("Error: moved != 1 (%d)  %s:%d\n", symbols.moved, __FILE__, __LINE__);
+    errors++;
+  }
+
   if (errors != 0)
   {
     symbols_print(&symbols, stdout);
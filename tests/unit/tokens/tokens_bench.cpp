@@ -0,0 +1,95 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "common/assembler.h"
+#include "common/tokens.h"
+
+static double get_time()
+{
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+
+  return (double)tv.tv_sec + ((double)tv.tv_usec / 1000000.0);
+}
+
+static char *build_source(int size, int *length)
+{
+  const char *lines[] =
+  {
+    "main:\n",
+    "  mov.w #0x1234, r15     ; load the counter\n",
+    "  add.w @r4+, r5\n",
+    "  bis.b #BIT0|BIT6, &P1DIR\n",
+    "loop_%d:\n",
+    "  dec.w r15\n",
+    "  jnz loop_%d\n",
+    "  .db 1, 2, 3, 4, \"hello world\", 0\n",
+    "  // C++ style comment line\n",
+    "  mov.w 16(r4), 0x0200\n",
+    "  /* block comment */ ret\n",
+    "\n",
+  };
+
+  const int line_count = sizeof(lines) / sizeof(const char *);
+  char *source = (char *)malloc(size + 256);
+  int ptr = 0;
+  int n = 0;
+
+  while (ptr < size)
+  {
+    ptr += snprintf(source + ptr, 256, lines[n % line_count], n);
+    n++;
+  }
+
+  *length = ptr;
+
+  return source;
+}
+
+int main(int argc, char *argv[])
+{
+  AsmContext asm_context;
+  char token[TOKENLEN];
+  int token_type;
+  int length;
+  int64_t count = 0;
+
+  // 100MB of synthetic MSP430 source.
+  char *source = build_source(100 * 1024 * 1024, &length);
+
+  tokens_open_buffer(&asm_context, source);
+  tokens_reset(&asm_context);
+
+  double start = get_time();
+
+  while (true)
+  {
+    token_type = tokens_get(&asm_context, token, TOKENLEN);
+
+    if (token_type == TOKEN_EOF) { break; }
+    if (token_type == TOKEN_EOL) { asm_context.tokens.line++; }
+
+    count++;
+  }
+
+  double elapsed = get_time() - start;
+
+  printf("%d bytes, %" PRId64 " tokens, %d lines: %.3fs, %.1f MB/s, %.0f tokens/sec\n",
+    length,
+    count,
+    asm_context.tokens.line,
+    elapsed,
+    ((double)length / (1024 * 1024)) / elapsed,
+    (double)count / elapsed);
+
+  tokens_close(&asm_context);
+
+  free(source);
+
+  return 0;
+}
+